@@ -59,6 +59,7 @@ namespace Avogadro {
     else {
       // Make sure any selection is an atom
       // FIXME: Do we need to do bonds or other primitives?
+      m_molecule->beginEdit();
       foreach(unsigned long atomid, m_selectedList.subList(Primitive::AtomType)) {
         Atom *atom = m_molecule->atomById(atomid);
         if(atom)
@@ -80,6 +81,7 @@ namespace Avogadro {
           m_molecule->removeResidue(residue);
         }
       }
+      m_molecule->endEdit();
     }
     m_molecule->update();
   }
@@ -146,6 +148,7 @@ namespace Avogadro {
     else {
       // Make sure any selection is an atom
       // FIXME: Do we need to do bonds or other primitives?
+      m_molecule->beginEdit();
       foreach(unsigned long atomid, m_selectedList.subList(Primitive::AtomType)) {
         Atom *atom = m_molecule->atomById(atomid);
         if(atom)
@@ -167,6 +170,7 @@ namespace Avogadro {
           m_molecule->removeResidue(residue);
         }
       }
+      m_molecule->endEdit();
     }
     m_molecule->update();
   }
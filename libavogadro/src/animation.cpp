@@ -25,17 +25,13 @@
 #include "animation.h"
 
 #include <avogadro/molecule.h>
+#include <avogadro/trajectoryfile.h>
+#include <avogadro/bondperceiver.h>
 #include <avogadro/atom.h>
-#include <avogadro/bond.h>
-#include <openbabel/mol.h>
-#include <openbabel/atom.h>
-#include <openbabel/bond.h>
-#include <openbabel/obiter.h>
 #include <Eigen/Core>
 
 #include <QTimer>
 
-using namespace OpenBabel;
 using Eigen::Vector3d;
 
 namespace Avogadro {
@@ -44,7 +40,7 @@ namespace Avogadro {
   {
     public:
       AnimationPrivate() : fps(25), framesSet(false), dynamicBonds(false),
-                           loop(false), paused(false)
+                           loop(false), paused(false), trajectory(0), frame(0)
       {
       }
 
@@ -53,6 +49,13 @@ namespace Avogadro {
       bool dynamicBonds;
       bool loop;
       bool paused;
+
+      TrajectoryFile *trajectory;
+      // Current frame of the trajectory, counting from 1
+      int frame;
+      std::vector<Vector3d> coords;
+
+      BondPerceiver bondPerceiver;
   };
 
   Animation::Animation(QObject *parent) : QObject(parent), d(new AnimationPrivate),
@@ -63,12 +66,16 @@ namespace Avogadro {
 
   Animation::~Animation()
   {
+    delete d->trajectory;
     delete m_timer;
     delete d;
   }
 
   void Animation::setMolecule(Molecule *molecule)
   {
+    // The trajectory belongs to the previous molecule
+    if (molecule != m_molecule)
+      setTrajectory(0);
     m_molecule = molecule;
     if (molecule == NULL)
       return; // we can't save the current conformers
@@ -83,6 +90,8 @@ namespace Avogadro {
 
   int Animation::numFrames() const
   {
+    if (d->trajectory)
+      return d->trajectory->numFrames();
     if (d->framesSet)
       return m_frames.size();
     if (m_molecule)
@@ -118,36 +127,37 @@ namespace Avogadro {
 
   void Animation::setFrame(int i)
   {
-    if (i <= 0 || !m_molecule || i > (int)m_molecule->numConformers())
+    if (i <= 0 || !m_molecule)
       return; // nothing to do
+    if (i > (d->trajectory ? numFrames() : (int)m_molecule->numConformers()))
+      return;
 
-    m_molecule->lock()->lockForWrite();
-    m_molecule->setConformer(i-1); // Frame counting starts from 1
+    if (d->trajectory) {
+      if (d->trajectory->numAtoms() != m_molecule->numAtoms())
+        return;
+      if (!d->trajectory->frame(i-1, d->coords))
+        return;
+      // Read the next frames while this one is shown, up to a second ahead
+      // in the direction the frames are going
+      int step = (i < d->frame && i > 1) ? -1 : 1;
+      d->trajectory->readAhead(i-1 + step, step, qMax(4, d->fps));
+      d->frame = i;
+    }
 
-    if (d->dynamicBonds) {
-      // construct minimal OBMol
-      OpenBabel::OBMol obmol;
-      obmol.BeginModify();
+    m_molecule->lock()->lockForWrite();
+    if (d->trajectory) {
+      // The frames are in the order of the atoms
       foreach(Atom *atom, m_molecule->atoms()) {
-        OpenBabel::OBAtom *a = obmol.NewAtom();
-        OpenBabel::OBAtom obatom = atom->OBAtom();
-        *a = obatom;
+        if (atom->index() < d->coords.size())
+          m_molecule->setAtomPos(atom->id(), d->coords[atom->index()]);
       }
-      obmol.EndModify();
-
-      // connect the dots
-      obmol.ConnectTheDots();
-
-      QList<Bond*> bonds(m_molecule->bonds());
-      foreach(Bond *bond, bonds)
-        m_molecule->removeBond(bond->id());
+    }
+    else
+      m_molecule->setConformer(i-1); // Frame counting starts from 1
 
-      FOR_BONDS_OF_MOL (obbond, obmol) {
-        Bond *bond = m_molecule->addBond();
-        bond->setBegin(m_molecule->atom(obbond->GetBeginAtomIdx()-1));
-        bond->setEnd(m_molecule->atom(obbond->GetEndAtomIdx()-1));
-        bond->setOrder(obbond->GetBondOrder());
-      }
+    if (d->dynamicBonds) {
+      // Only the bonds that changed since the last frame are replaced
+      d->bondPerceiver.update(m_molecule);
     }
     m_molecule->lock()->unlock();
     m_molecule->update();
@@ -190,6 +200,8 @@ namespace Avogadro {
     if (frames.size() == 0)
       return; // nothing to do
 
+    setTrajectory(0);
+
     if (!m_originalConformers.empty())
       m_originalConformers.clear();
     if (m_molecule) {
@@ -202,6 +214,16 @@ namespace Avogadro {
     m_frames = frames;
   }
 
+  void Animation::setTrajectory(TrajectoryFile *trajectory)
+  {
+    if (trajectory == d->trajectory)
+      return;
+    delete d->trajectory;
+    d->trajectory = trajectory;
+    d->frame = 0;
+    d->coords.clear();
+  }
+
   void Animation::stop()
   {
     if(!m_molecule)
@@ -210,7 +232,7 @@ namespace Avogadro {
     m_timer->stop();
 
     // restore original conformers
-    if (d->framesSet) {
+    if (d->framesSet && !d->trajectory) {
       m_molecule->lock()->lockForWrite();
       m_molecule->setAllConformers(m_originalConformers);
       m_molecule->lock()->unlock();
@@ -226,14 +248,14 @@ namespace Avogadro {
     startTimer();
 
     // set molecule conformers
-    if (d->framesSet) {
+    if (d->framesSet && !d->trajectory) {
       m_molecule->lock()->lockForWrite();
       // don't delete the existing conformers -- we save them as m_originalConformers
       m_molecule->setAllConformers(m_frames, false);
       m_molecule->lock()->unlock();
     }
 
-    if (m_molecule->currentConformer() + 1 == m_molecule->numConformers())
+    if (currentFrame() == numFrames())
       setFrame(1);
   }
   
@@ -244,18 +266,25 @@ namespace Avogadro {
 
   void Animation::timerFired()
   {
-    const unsigned int currentConformer = m_molecule->currentConformer();
-    if (currentConformer + 1 == m_molecule->numConformers()) {
+    const int frame = currentFrame();
+    if (frame == numFrames()) {
       if (d->loop) {
         setFrame(1);
       } else {
         m_timer->stop();
       }
     } else {
-      setFrame(currentConformer + 1 + 1);
+      setFrame(frame + 1);
     }
   }
 
+  int Animation::currentFrame() const
+  {
+    if (d->trajectory)
+      return d->frame;
+    return m_molecule->currentConformer() + 1;
+  }
+
   void Animation::startTimer()
   {
     const int interval = 1000 / d->fps;
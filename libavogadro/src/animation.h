@@ -39,6 +39,7 @@ class QTimer;
 namespace Avogadro {
 
   class Molecule;
+  class TrajectoryFile;
 
   /**
    * @class Animation animation.h <avogadro/animation.h>
@@ -55,7 +56,8 @@ namespace Avogadro {
    * An Animation object works by changing conformers inside a Molecule. Consequently,
    * you can either read in the conformers from a file, or call Animation::setFrames()
    * to set the coordinates for the animation. The latter works well for generated coordinates,
-   * for example, vibrations.
+   * for example, vibrations. Long trajectories are best played from a TrajectoryFile
+   * with setTrajectory(), which reads each frame into the current conformer as needed.
    */
   class AnimationPrivate;
   class A_EXPORT Animation : public QObject
@@ -76,7 +78,8 @@ namespace Avogadro {
       virtual ~Animation();
     
       /**
-       * Set the molecule to animate.
+       * Set the molecule to animate. A trajectory set for another molecule
+       * is dropped.
        */
       void setMolecule(Molecule *molecule);
       /**
@@ -88,6 +91,14 @@ namespace Avogadro {
        */
       void setFrames(std::vector< std::vector< Eigen::Vector3d> *> frames);
 
+      /**
+       * Play the frames of @p trajectory, read on demand into the current
+       * conformer of the molecule. The frames ahead of the current one in the
+       * direction of play are read in the background. The Animation takes
+       * ownership of @p trajectory, pass 0 to go back to using conformers.
+       */
+      void setTrajectory(TrajectoryFile *trajectory);
+
       /**
        * @return The number of frames per second.
        */
@@ -167,6 +178,11 @@ namespace Avogadro {
        */
       void startTimer();
 
+      /**
+       * @return The frame shown, counting from 1.
+       */
+      int currentFrame() const;
+
     private:
       AnimationPrivate * const d;
       
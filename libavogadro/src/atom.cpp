@@ -152,6 +152,8 @@ namespace Avogadro {
    {
      Q_D(const Atom);
      d->partialCharge = charge;
+     if (m_molecule)
+       m_molecule->chargeChanged(false);
    }
 
    void Atom::setFormalCharge(int charge)
@@ -159,6 +161,8 @@ namespace Avogadro {
      Q_D(Atom);
      d->assignedFormalCharge = true;
      d->formalCharge = charge;
+     if (m_molecule)
+       m_molecule->chargeChanged(true);
    }
 
    int Atom::formalCharge() const
@@ -60,6 +60,8 @@
     }
     m_beginAtomId = atom->id();
     atom->addBond(this);
+    if (m_molecule)
+      m_molecule->bondChanged();
   }
 
   Atom * Bond::beginAtom() const
@@ -75,6 +77,8 @@
     }
     m_endAtomId = atom->id();
     atom->addBond(this);
+    if (m_molecule)
+      m_molecule->bondChanged();
   }
 
   Atom * Bond::endAtom() const
@@ -102,6 +106,16 @@
       qDebug() << "Non-existent atom:" << atom2;
     }
     m_order = order;
+    m_molecule->bondChanged();
+  }
+
+  void Bond::setOrder(short order)
+  {
+    if (order == m_order)
+      return;
+    m_order = order;
+    if (m_molecule)
+      m_molecule->bondChanged();
   }
 
   const Eigen::Vector3d * Bond::beginPos() const
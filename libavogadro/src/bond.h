@@ -87,7 +87,7 @@ namespace Avogadro {
     /**
      * Set the order of the bond.
      */
-    void setOrder(short order) { m_order = order; }
+    void setOrder(short order);
 
     /**
      * Set the aromaticity of the bond.
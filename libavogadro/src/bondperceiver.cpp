@@ -0,0 +1,316 @@
+/**********************************************************************
+  BondPerceiver - Perceive single bonds from interatomic distances
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "bondperceiver.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+#include <openbabel/elements.h>
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QVector>
+
+#include <algorithm>
+#include <utility>
+
+using Eigen::Vector3d;
+
+namespace Avogadro {
+
+  // Added to the sum of the covalent radii, as in OBMol::ConnectTheDots()
+  const double BOND_TOLERANCE = 0.45;
+  // Closer atoms are not bonded, e.g. disorder in crystal structures
+  const double MIN_BOND_DISTANCE2 = 0.4 * 0.4;
+  // Atoms checked by each thread, smaller systems are done in one go
+  const int BLOCK_SIZE = 8192;
+
+  struct BondBlock
+  {
+    BondPerceiver *perceiver;
+    int index;
+    int begin, end;            // The range of atoms in this block
+  };
+
+  namespace {
+    inline quint64 bondKey(unsigned long id1, unsigned long id2)
+    {
+      if (id1 > id2)
+        std::swap(id1, id2);
+      return (static_cast<quint64>(id1) << 32) | static_cast<quint64>(id2);
+    }
+
+    typedef std::pair<quint64, Bond *> KeyedBond;
+
+    inline bool keyLessThan(const KeyedBond &a, const KeyedBond &b)
+    {
+      return a.first < b.first;
+    }
+  }
+
+  BondPerceiver::BondPerceiver() : m_valenceLimited(true), m_maxDistance(0.0),
+    m_maxRadius(0.0), m_cellSize(0.0)
+  {
+    m_dims[0] = m_dims[1] = m_dims[2] = 0;
+  }
+
+  BondPerceiver::~BondPerceiver()
+  {
+  }
+
+  void BondPerceiver::updateRadii(Molecule *molecule)
+  {
+    QList<Atom *> atoms = molecule->atoms();
+    bool changed = static_cast<int>(m_atomicNumbers.size()) != atoms.size();
+    for (int i = 0; !changed && i < atoms.size(); ++i)
+      changed = m_atomicNumbers[i] != atoms[i]->atomicNumber();
+
+    m_positions.resize(atoms.size());
+    for (int i = 0; i < atoms.size(); ++i)
+      m_positions[i] = *atoms[i]->pos();
+
+    if (!changed)
+      return;
+
+    m_atomicNumbers.resize(atoms.size());
+    m_radii.resize(atoms.size());
+    m_maxBonds.resize(atoms.size());
+    m_maxRadius = 0.0;
+    for (int i = 0; i < atoms.size(); ++i) {
+      int atomicNumber = atoms[i]->atomicNumber();
+      m_atomicNumbers[i] = atomicNumber;
+      m_radii[i] = OpenBabel::OBElements::GetCovalentRad(atomicNumber);
+      m_maxBonds[i] = OpenBabel::OBElements::GetMaxBonds(atomicNumber);
+      m_maxRadius = qMax(m_maxRadius, m_radii[i]);
+    }
+  }
+
+  void BondPerceiver::fillCells()
+  {
+    int numAtoms = static_cast<int>(m_positions.size());
+    Vector3d min = m_positions[0];
+    Vector3d max = m_positions[0];
+    for (int i = 1; i < numAtoms; ++i) {
+      min = min.cwiseMin(m_positions[i]);
+      max = max.cwiseMax(m_positions[i]);
+    }
+    m_origin = min;
+    Vector3d extent = max - min;
+
+    // Bonded atoms are at most one cell apart. Use larger cells for sparse
+    // systems so that the grid stays in proportion to the number of atoms.
+    m_cellSize = 2.0 * m_maxRadius + BOND_TOLERANCE;
+    if (m_maxDistance > 0.0)
+      m_cellSize = qMin(m_cellSize, m_maxDistance);
+    const double maxCells = qMax(8.0, 4.0 * numAtoms);
+    for (;;) {
+      double numCells = 1.0;
+      for (int k = 0; k < 3; ++k) {
+        m_dims[k] = static_cast<int>(extent[k] / m_cellSize) + 1;
+        numCells *= m_dims[k];
+      }
+      if (numCells <= maxCells)
+        break;
+      m_cellSize *= 1.26;
+    }
+
+    // Counting sort of the atoms by cell
+    int numCells = m_dims[0] * m_dims[1] * m_dims[2];
+    m_atomCells.resize(numAtoms);
+    m_cellStart.assign(numCells + 1, 0);
+    for (int i = 0; i < numAtoms; ++i) {
+      Vector3d cell = (m_positions[i] - m_origin) / m_cellSize;
+      int x = qMin(static_cast<int>(cell.x()), m_dims[0] - 1);
+      int y = qMin(static_cast<int>(cell.y()), m_dims[1] - 1);
+      int z = qMin(static_cast<int>(cell.z()), m_dims[2] - 1);
+      m_atomCells[i] = (z * m_dims[1] + y) * m_dims[0] + x;
+      ++m_cellStart[m_atomCells[i] + 1];
+    }
+    for (int c = 0; c < numCells; ++c)
+      m_cellStart[c + 1] += m_cellStart[c];
+    m_cellAtoms.resize(numAtoms);
+    std::vector<int> next(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (int i = 0; i < numAtoms; ++i)
+      m_cellAtoms[next[m_atomCells[i]]++] = i;
+  }
+
+  void BondPerceiver::findCandidates()
+  {
+    m_candidates.clear();
+    int numAtoms = static_cast<int>(m_positions.size());
+    if (numAtoms <= BLOCK_SIZE) {
+      findCandidates(0, numAtoms, m_candidates);
+      return;
+    }
+
+    QVector<BondBlock> blocks;
+    for (int begin = 0; begin < numAtoms; begin += BLOCK_SIZE) {
+      BondBlock block;
+      block.perceiver = this;
+      block.index = blocks.size();
+      block.begin = begin;
+      block.end = qMin(begin + BLOCK_SIZE, numAtoms);
+      blocks.push_back(block);
+    }
+    m_blockCandidates.resize(blocks.size());
+    QtConcurrent::blockingMap(blocks, BondPerceiver::processBlock);
+
+    size_t total = 0;
+    for (int b = 0; b < blocks.size(); ++b)
+      total += m_blockCandidates[b].size();
+    m_candidates.reserve(total);
+    for (int b = 0; b < blocks.size(); ++b)
+      m_candidates.insert(m_candidates.end(), m_blockCandidates[b].begin(),
+                          m_blockCandidates[b].end());
+  }
+
+  void BondPerceiver::processBlock(BondBlock &block)
+  {
+    std::vector<Candidate> &candidates =
+        block.perceiver->m_blockCandidates[block.index];
+    candidates.clear();
+    block.perceiver->findCandidates(block.begin, block.end, candidates);
+  }
+
+  void BondPerceiver::findCandidates(int begin, int end,
+                                     std::vector<Candidate> &candidates) const
+  {
+    for (int i = begin; i < end; ++i) {
+      if (m_valenceLimited && m_maxBonds[i] == 0)
+        continue;
+      int cell = m_atomCells[i];
+      int x = cell % m_dims[0];
+      int y = (cell / m_dims[0]) % m_dims[1];
+      int z = cell / (m_dims[0] * m_dims[1]);
+      for (int nz = qMax(z - 1, 0); nz <= qMin(z + 1, m_dims[2] - 1); ++nz) {
+        for (int ny = qMax(y - 1, 0); ny <= qMin(y + 1, m_dims[1] - 1); ++ny) {
+          for (int nx = qMax(x - 1, 0); nx <= qMin(x + 1, m_dims[0] - 1); ++nx) {
+            int c = (nz * m_dims[1] + ny) * m_dims[0] + nx;
+            for (int k = m_cellStart[c]; k < m_cellStart[c + 1]; ++k) {
+              int j = m_cellAtoms[k];
+              // Check each pair once
+              if (j <= i || (m_valenceLimited && m_maxBonds[j] == 0))
+                continue;
+              double cutoff = m_radii[i] + m_radii[j] + BOND_TOLERANCE;
+              if (m_maxDistance > 0.0)
+                cutoff = qMin(cutoff, m_maxDistance);
+              double d2 = (m_positions[i] - m_positions[j]).squaredNorm();
+              if (d2 > cutoff * cutoff || d2 < MIN_BOND_DISTANCE2)
+                continue;
+              Candidate candidate = { static_cast<float>(d2), i, j };
+              candidates.push_back(candidate);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  bool BondPerceiver::update(Molecule *molecule)
+  {
+    if (!molecule)
+      return false;
+
+    updateRadii(molecule);
+    QList<Atom *> atoms = molecule->atoms();
+
+    // The new bonds, shortest first so that atoms with too many candidates
+    // keep their shortest bonds
+    m_keys.clear();
+    if (!atoms.isEmpty()) {
+      fillCells();
+      findCandidates();
+      if (m_valenceLimited) {
+        std::sort(m_candidates.begin(), m_candidates.end());
+        m_bondCounts.assign(atoms.size(), 0);
+      }
+      m_keys.reserve(m_candidates.size());
+      for (size_t k = 0; k < m_candidates.size(); ++k) {
+        int i = m_candidates[k].first;
+        int j = m_candidates[k].second;
+        if (m_valenceLimited) {
+          if (m_bondCounts[i] >= m_maxBonds[i]
+              || m_bondCounts[j] >= m_maxBonds[j])
+            continue;
+          ++m_bondCounts[i];
+          ++m_bondCounts[j];
+        }
+        m_keys.push_back(bondKey(atoms[i]->id(), atoms[j]->id()));
+      }
+      std::sort(m_keys.begin(), m_keys.end());
+    }
+
+    // The current bonds
+    QList<Bond *> bonds = molecule->bonds();
+    std::vector<KeyedBond> existing;
+    existing.reserve(bonds.size());
+    foreach (Bond *bond, bonds)
+      existing.push_back(KeyedBond(bondKey(bond->beginAtomId(),
+                                           bond->endAtomId()), bond));
+    std::sort(existing.begin(), existing.end(), keyLessThan);
+
+    bool changed = false;
+    molecule->beginEdit();
+    // Drop duplicate bonds between the same atoms
+    std::vector<KeyedBond>::iterator last = existing.begin();
+    for (std::vector<KeyedBond>::iterator it = existing.begin();
+         it != existing.end(); ++it) {
+      if (last != existing.begin() && (last - 1)->first == it->first) {
+        molecule->removeBond(it->second);
+        changed = true;
+      }
+      else
+        *last++ = *it;
+    }
+    existing.erase(last, existing.end());
+
+    // Merge the two sorted lists, only touching the bonds that differ
+    std::vector<KeyedBond>::const_iterator current = existing.begin();
+    std::vector<quint64>::const_iterator perceived = m_keys.begin();
+    while (current != existing.end() || perceived != m_keys.end()) {
+      if (perceived == m_keys.end()
+          || (current != existing.end() && current->first < *perceived)) {
+        molecule->removeBond(current->second);
+        changed = true;
+        ++current;
+      }
+      else if (current == existing.end() || *perceived < current->first) {
+        molecule->addBond(static_cast<unsigned long>(*perceived >> 32),
+                          static_cast<unsigned long>(*perceived & 0xffffffff),
+                          1);
+        changed = true;
+        ++perceived;
+      }
+      else {
+        ++current;
+        ++perceived;
+      }
+    }
+    molecule->endEdit();
+
+    return changed;
+  }
+
+} // End namespace Avogadro
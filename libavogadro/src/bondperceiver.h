@@ -0,0 +1,137 @@
+/**********************************************************************
+  BondPerceiver - Perceive single bonds from interatomic distances
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef BONDPERCEIVER_H
+#define BONDPERCEIVER_H
+
+#include "config.h"
+
+#include <avogadro/global.h>
+
+#include <QtGlobal>
+
+#include <Eigen/Core>
+
+#include <vector>
+
+namespace Avogadro {
+
+  class Molecule;
+  struct BondBlock;
+
+  /**
+   * @class BondPerceiver bondperceiver.h <avogadro/bondperceiver.h>
+   * @brief Connects atoms closer than the sum of their covalent radii.
+   *
+   * Two atoms are bonded when their distance is below the sum of their
+   * covalent radii plus a tolerance of 0.45 Angstrom, and above 0.4 Angstrom,
+   * like OpenBabel::OBMol::ConnectTheDots(). When an atom would get more
+   * bonds than its element allows the longest ones are left out.
+   *
+   * Candidate pairs are found with a cell list, so perception scales
+   * linearly with the number of atoms, and large systems are split into
+   * blocks of atoms checked in parallel. The radii and the cells are kept
+   * between calls, so calling update() for every frame of a trajectory only
+   * costs the distance checks and the bonds that actually changed.
+   */
+  class A_EXPORT BondPerceiver
+  {
+    public:
+      BondPerceiver();
+      ~BondPerceiver();
+
+      /**
+       * Perceive the bonds of @p molecule from the current atom positions.
+       * Bonds that are no longer found are removed and new ones are added as
+       * single bonds, in one Molecule::beginEdit() batch. Bonds that are
+       * still found are kept, with their order.
+       * @return True if any bond was added or removed.
+       */
+      bool update(Molecule *molecule);
+
+      /**
+       * Limit the number of bonds of each atom to the maximum for its
+       * element, the default. The crystallography extensions turn this off,
+       * as atoms in ionic and metallic solids have more neighbors than
+       * their valence.
+       */
+      void setValenceLimited(bool limited) { m_valenceLimited = limited; }
+      bool valenceLimited() const { return m_valenceLimited; }
+
+      /**
+       * Do not bond atoms further apart than @p distance Angstrom, whatever
+       * their radii. Zero, the default, leaves only the radii as a limit.
+       */
+      void setMaxDistance(double distance) { m_maxDistance = distance; }
+      double maxDistance() const { return m_maxDistance; }
+
+    private:
+      struct Candidate
+      {
+        float distance2;
+        int first;
+        int second;
+        bool operator<(const Candidate &other) const
+        {
+          return distance2 < other.distance2;
+        }
+      };
+
+      void updateRadii(Molecule *molecule);
+      void fillCells();
+      void findCandidates();
+      void findCandidates(int begin, int end,
+                          std::vector<Candidate> &candidates) const;
+
+      /// Re-entrant block of atoms for QtConcurrent
+      static void processBlock(BondBlock &block);
+
+      bool m_valenceLimited;
+      double m_maxDistance;
+
+      // Per atom, in the order of the atom indices
+      std::vector<int> m_atomicNumbers;
+      std::vector<double> m_radii;
+      std::vector<int> m_maxBonds;
+      std::vector<Eigen::Vector3d> m_positions;
+      double m_maxRadius;
+
+      // The atoms sorted by cell, the atoms of cell c are
+      // m_cellAtoms[m_cellStart[c]] to m_cellAtoms[m_cellStart[c + 1] - 1]
+      Eigen::Vector3d m_origin;
+      double m_cellSize;
+      int m_dims[3];
+      std::vector<int> m_atomCells;
+      std::vector<int> m_cellStart;
+      std::vector<int> m_cellAtoms;
+
+      std::vector<Candidate> m_candidates;
+      std::vector<std::vector<Candidate> > m_blockCandidates;
+      std::vector<int> m_bondCounts;
+      std::vector<quint64> m_keys;
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -107,6 +107,7 @@ namespace Avogadro {
   {
     _smartsString = newPattern;
     _pattern->Init(_smartsString.toLatin1());
+    _matchedOBMol.clear();
     emit changed();
   }
 
@@ -146,24 +147,9 @@ namespace Avogadro {
 
     bool matched = false;
     if (!_smartsString.isEmpty() && _pattern->IsValid()) { // finite, valid SMARTS, so let's go for it!
-      OBMol obmol = molecule->OBMol();
-      bool moleculeMatched = _pattern->Match(obmol);
-
-      if (moleculeMatched) {
-        std::vector<std::vector<int> > mlist = _pattern->GetUMapList();
-        std::vector<std::vector<int> >::iterator match;
-        for (match = mlist.begin(); match != mlist.end(); ++match) { // iterate through matches
-          for (unsigned idx = 0; idx < (*match).size(); ++idx) { // iterate through atoms in match
-            if (static_cast<int>(atom->index()) == ((*match)[idx] - 1)) { // TODO: OB uses index from 1
-              matched = true;
-              break;
-            }
-          } // atoms in match
-          if (matched)
-            break; // no need to check other matches
-        } // matches
-        
-      } // matched molecule
+      updateMatches(molecule);
+      int index = static_cast<int>(atom->index());
+      matched = index < _matches.size() && _matches.testBit(index);
     } // finite, valid SMARTS
 
     // OK, now highlight the SMARTS match
@@ -174,6 +160,30 @@ namespace Avogadro {
     m_channels[3] = 1.0;
   }
 
+  void SmartsColor::updateMatches(Molecule *molecule)
+  {
+    // setFromPrimitive() is called for every atom, match the whole molecule
+    // once. A new snapshot is made whenever the topology changes.
+    QSharedPointer<OBMol> obmol = molecule->OBMolSnapshot();
+    if (obmol == _matchedOBMol)
+      return;
+
+    _matchedOBMol = obmol;
+    _matches.fill(false, obmol->NumAtoms());
+    if (!_pattern->Match(*obmol))
+      return;
+
+    std::vector<std::vector<int> > mlist = _pattern->GetUMapList();
+    std::vector<std::vector<int> >::iterator match;
+    for (match = mlist.begin(); match != mlist.end(); ++match) { // iterate through matches
+      for (unsigned idx = 0; idx < (*match).size(); ++idx) { // iterate through atoms in match
+        int index = (*match)[idx] - 1; // OB uses index from 1
+        if (index >= 0 && index < _matches.size())
+          _matches.setBit(index);
+      }
+    }
+  }
+
 }
 
 
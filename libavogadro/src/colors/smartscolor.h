@@ -29,15 +29,20 @@
 #include <avogadro/plugin.h>
 #include <avogadro/color.h>
 
+#include <QBitArray>
+#include <QSharedPointer>
 #include <QString>
 
 // forward declaration
 namespace OpenBabel {
+  class OBMol;
   class OBSmartsPattern;
 }
 
 namespace Avogadro {
 
+  class Molecule;
+
   /**
    * @class Smartscolor 
    * @brief Color by highlighting a SMARTS pattern match
@@ -68,10 +73,19 @@ namespace Avogadro {
       void colorChanged(QColor);
 
   private:
+    /**
+     * Match the pattern against the whole molecule, unless it was already
+     * matched against the same topology. */
+    void updateMatches(Molecule *molecule);
+
     OpenBabel::OBSmartsPattern *_pattern;
     QString                     _smartsString;
     QColor                      _highlightColor;
     QWidget                    *_settingsWidget;
+
+    // The OBMol snapshot last matched, and its matched atoms by index
+    QSharedPointer<OpenBabel::OBMol> _matchedOBMol;
+    QBitArray                   _matches;
   };
 
   class SmartsColorFactory : public QObject, public PluginFactory
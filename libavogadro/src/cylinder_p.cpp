@@ -31,9 +31,12 @@
 #endif
 
 #include <QOpenGLWidget>
+#include <QOpenGLBuffer>
 
 #include <Eigen/Geometry>
 
+#include <vector>
+
 // Win32 build (19/05/08)
 #include <math.h> 
 #ifndef M_PI
@@ -46,7 +49,10 @@ namespace Avogadro {
 
   class CylinderPrivate {
     public:
-      CylinderPrivate() : vertexBuffer(0), normalBuffer(0), displayList(0), isValid(false) {}
+      CylinderPrivate() : vertexBuffer(0), normalBuffer(0), displayList(0),
+        isValid(false), triangleIndexCount(0),
+        triangleVertexObject(QOpenGLBuffer::VertexBuffer),
+        triangleIndexObject(QOpenGLBuffer::IndexBuffer) {}
 
       /** Pointer to the buffer storing the vertex array */
       Eigen::Vector3f *vertexBuffer;
@@ -61,6 +67,15 @@ namespace Avogadro {
        * includes the lateral faces, as the base and top faces (the
        * two discs) are not rendered. */
       int faces;
+
+      /** The vertices followed by the normals, and the triangles of the
+       * cylinder, kept until they are uploaded to the buffer objects below */
+      std::vector<Eigen::Vector3f> triangleVertices;
+      std::vector<unsigned short> triangleIndices;
+      int triangleIndexCount;
+      /** Buffer objects used for instanced drawing, created on first use */
+      QOpenGLBuffer triangleVertexObject;
+      QOpenGLBuffer triangleIndexObject;
   };
 
   Cylinder::Cylinder(int faces) : d(new CylinderPrivate)
@@ -103,6 +118,15 @@ namespace Avogadro {
     d->isValid = false;
     if( d->faces < 0 ) return;
 
+    // the triangles used for instanced drawing must be uploaded again
+    d->triangleVertices.clear();
+    d->triangleIndices.clear();
+    d->triangleIndexCount = 0;
+    if( d->triangleVertexObject.isCreated() )
+      d->triangleVertexObject.destroy();
+    if( d->triangleIndexObject.isCreated() )
+      d->triangleIndexObject.destroy();
+
     // compile display list and free buffers
     if( ! d->displayList ) d->displayList = glGenLists( 1 );
     if( ! d->displayList ) return;
@@ -152,11 +176,67 @@ namespace Avogadro {
       glEndList();
       glDisableClientState( GL_VERTEX_ARRAY );
       glDisableClientState( GL_NORMAL_ARRAY );
+
+      // the same quads split into two triangles each
+      d->triangleVertices.assign( d->vertexBuffer,
+          d->vertexBuffer + vertexCount );
+      d->triangleVertices.insert( d->triangleVertices.end(),
+          d->normalBuffer, d->normalBuffer + vertexCount );
+      for( int i = 0; i < d->faces; i++ )
+      {
+        unsigned short quad[4] = { static_cast<unsigned short>(2 * i),
+          static_cast<unsigned short>(2 * i + 1),
+          static_cast<unsigned short>(2 * i + 3),
+          static_cast<unsigned short>(2 * i + 2) };
+        d->triangleIndices.push_back( quad[0] );
+        d->triangleIndices.push_back( quad[1] );
+        d->triangleIndices.push_back( quad[2] );
+        d->triangleIndices.push_back( quad[0] );
+        d->triangleIndices.push_back( quad[2] );
+        d->triangleIndices.push_back( quad[3] );
+      }
     }
     freeBuffers();
     d->isValid = true;
   }
 
+  int Cylinder::bindTriangles() const
+  {
+    if( ! d->isValid ) return 0;
+
+    if( ! d->triangleVertexObject.isCreated() )
+    {
+      if( d->triangleIndices.empty() ) return 0;
+      if( ! d->triangleVertexObject.create()
+          || ! d->triangleIndexObject.create() )
+      {
+        d->triangleVertexObject.destroy();
+        return 0;
+      }
+      d->triangleVertexObject.bind();
+      d->triangleVertexObject.allocate( &d->triangleVertices[0],
+          d->triangleVertices.size() * sizeof(Vector3f) );
+      d->triangleIndexObject.bind();
+      d->triangleIndexObject.allocate( &d->triangleIndices[0],
+          d->triangleIndices.size() * sizeof(unsigned short) );
+      d->triangleIndexCount = d->triangleIndices.size();
+      // the buffer objects now hold the only copy needed
+      std::vector<Vector3f>().swap( d->triangleVertices );
+      std::vector<unsigned short>().swap( d->triangleIndices );
+    }
+    else
+    {
+      d->triangleVertexObject.bind();
+      d->triangleIndexObject.bind();
+    }
+
+    // the normals follow the 2 * faces + 2 vertices
+    glVertexPointer( 3, GL_FLOAT, 0, 0 );
+    glNormalPointer( GL_FLOAT, 0, reinterpret_cast<const GLvoid *>(
+          ( 2 * d->faces + 2 ) * sizeof(Vector3f) ) );
+    return d->triangleIndexCount;
+  }
+
   void Cylinder::draw( const Eigen::Vector3d &end1, const Eigen::Vector3d &end2,
       double radius ) const
   {
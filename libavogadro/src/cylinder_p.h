@@ -93,6 +93,17 @@ namespace Avogadro {
           double radius, int order, double shift,
           const Eigen::Vector3d &planeNormalVector ) const;
 
+      /**
+       * binds buffer objects holding the triangles of the unit cylinder,
+       * going from z=0 to z=1 with radius 1, and sets them as the vertex,
+       * normal and element arrays. The indices are of type
+       * GL_UNSIGNED_SHORT. This is used to draw many cylinders with a
+       * single instanced draw call.
+       @return the number of indices, or 0 if buffer objects are not
+       available or the cylinder is drawn as a line
+       */
+      int bindTriangles() const;
+
     private:
       CylinderPrivate * const d;
   };
@@ -35,6 +35,7 @@
 
 #include <QOpenGLWidget> // for OpenGL bits
 #include <QDebug>
+#include <QVector>
 
 #include <openbabel/mol.h>
 #include <openbabel/elements.h>
@@ -105,7 +106,8 @@ namespace Avogadro
   BSDYEngine::BSDYEngine(QObject *parent) : Engine(parent),
       m_settingsWidget(0), m_atomRadiusPercentage(0.3), m_atomRadiusScale(50.0),
       m_bondRadius(0.1), m_bondRadiusScale(40.0),
-      m_atomRadiusType(1), m_showMulti(2), m_alpha(1.), pRadius(radiusVdW)
+      m_atomRadiusType(1), m_showMulti(2), m_impostors(false), m_alpha(1.),
+      pRadius(radiusVdW)
   {  }
 
   Engine *BSDYEngine::clone() const
@@ -115,6 +117,7 @@ namespace Avogadro
     engine->m_atomRadiusPercentage = m_atomRadiusPercentage;
     engine->m_bondRadius = m_bondRadius;
     engine->m_showMulti = m_showMulti;
+    engine->m_impostors = m_impostors;
     engine->m_atomRadiusType = m_atomRadiusType;
     engine->m_alpha = m_alpha;
     engine->setEnabled(isEnabled());
@@ -140,7 +143,14 @@ namespace Avogadro
     Color *map = colorMap(); // possible custom color map
     if (!map) map = pd->colorMap(); // fall back to global color map
 
-    // Render the bonds
+    // Render the bonds, each as two halves in the colors of their atoms
+    QVector<Vector3d> ends1, ends2;
+    QVector<int> orders;
+    QVector<QColor> colors;
+    ends1.reserve(2 * bonds().size());
+    ends2.reserve(2 * bonds().size());
+    orders.reserve(2 * bonds().size());
+    colors.reserve(2 * bonds().size());
     foreach(const Bond *b, bonds()) {
       Atom* atom1 = pd->molecule()->atomById(b->beginAtomId());
       Atom* atom2 = pd->molecule()->atomById(b->endAtomId());
@@ -156,38 +166,54 @@ namespace Avogadro
       d.normalize();
       Vector3d v3((v1 + v2 + d*(radius(atom1) - radius(atom2))) / 2);
 
-      double shift = 0.15;
       int order = 1;
       if (m_showMulti) order = b->order();
 
       map->setFromPrimitive(atom1);
+      ends1.append(v1);
+      ends2.append(v3);
+      orders.append(order);
       if (atom1->customColorName().isEmpty())
-        pd->painter()->setColor( map );
+        colors.append(map->color());
       else
-        pd->painter()->setColor(atom1->customColorName());
-      pd->painter()->drawMultiCylinder( v1, v3, m_bondRadius, order, shift );
+        colors.append(QColor(atom1->customColorName()));
 
       map->setFromPrimitive(atom2);
+      ends1.append(v3);
+      ends2.append(v2);
+      orders.append(order);
       if (atom2->customColorName().isEmpty())
-        pd->painter()->setColor( map );
+        colors.append(map->color());
       else
-        pd->painter()->setColor(atom2->customColorName());
-      pd->painter()->drawMultiCylinder( v3, v2, m_bondRadius, order, shift );
+        colors.append(QColor(atom2->customColorName()));
     }
+    double shift = 0.15;
+    pd->painter()->setImpostors(m_impostors);
+    pd->painter()->drawMultiCylinders(ends1, ends2, m_bondRadius, orders,
+                                      shift, colors);
 
     glDisable( GL_NORMALIZE );
     glEnable( GL_RESCALE_NORMAL );
 
     // Render the atoms and atom images
     QList<Atom *> allAtoms = atoms() + atomImages();
+    QVector<Vector3d> centers;
+    QVector<double> radii;
+    centers.reserve(allAtoms.size());
+    radii.reserve(allAtoms.size());
+    colors.clear();
+    colors.reserve(allAtoms.size());
     foreach(const Atom *a, allAtoms) {
       map->setFromPrimitive(a);
+      centers.append(*a->pos());
+      radii.append(radius(a));
       if (a->customColorName().isEmpty())
-        pd->painter()->setColor( map );
+        colors.append(map->color());
       else
-        pd->painter()->setColor(a->customColorName());
-      pd->painter()->drawSphere(a->pos(), radius(a));
+        colors.append(QColor(a->customColorName()));
     }
+    pd->painter()->drawSpheres(centers, radii, colors);
+    pd->painter()->setImpostors(false);
 
     // normalize normal vectors of bonds
     glDisable( GL_RESCALE_NORMAL );
@@ -417,6 +443,12 @@ namespace Avogadro
     emit changed();
   }
 
+  void BSDYEngine::setImpostors(int value)
+  {
+    m_impostors = value != Qt::Unchecked;
+    emit changed();
+  }
+
   void BSDYEngine::setOpacity(int value)
   {
     m_alpha = 0.05 * value;
@@ -468,6 +500,8 @@ namespace Avogadro
               this, SLOT(setBondRadius(int)));
       connect(m_settingsWidget->showMulti, SIGNAL(stateChanged(int)),
               this, SLOT(setShowMulti(int)));
+      connect(m_settingsWidget->impostors, SIGNAL(stateChanged(int)),
+              this, SLOT(setImpostors(int)));
       connect(m_settingsWidget->opacitySlider, SIGNAL(valueChanged(int)),
               this, SLOT(setOpacity(int)));
       connect(m_settingsWidget, SIGNAL(destroyed()),
@@ -477,6 +511,10 @@ namespace Avogadro
       m_settingsWidget->bondRadiusSlider
           ->setValue(int(m_bondRadiusScale * m_bondRadius));
       m_settingsWidget->showMulti->setCheckState((Qt::CheckState)m_showMulti);
+      m_settingsWidget->impostors->setChecked(m_impostors);
+#ifndef ENABLE_GLSL
+      m_settingsWidget->impostors->hide();
+#endif
       m_settingsWidget->opacitySlider->setValue(int(20 * m_alpha));
       m_settingsWidget->combo_radius->setCurrentIndex(m_atomRadiusType);
     }
@@ -498,6 +536,7 @@ namespace Avogadro
     settings.setValue("bondRadius",
                       m_bondRadiusScale * m_bondRadius);
     settings.setValue("showMulti", m_showMulti);
+    settings.setValue("impostors", m_impostors);
     settings.setValue("opacity", 20 * m_alpha);
   }
 
@@ -507,6 +546,7 @@ namespace Avogadro
     setAtomRadiusPercentage(settings.value("atomRadius", 25).toDouble());
     setBondRadius(settings.value("bondRadius", 4).toDouble());
     setShowMulti(settings.value("showMulti", 2).toInt());
+    m_impostors = settings.value("impostors", false).toBool();
     setOpacity(settings.value("opacity", 100).toInt());
     setAtomRadiusType(settings.value("radiusType", 1).toInt());
 
@@ -517,6 +557,7 @@ namespace Avogadro
       m_settingsWidget->bondRadiusSlider
           ->setValue(int(m_bondRadiusScale * m_bondRadius));
       m_settingsWidget->showMulti->setCheckState((Qt::CheckState)m_showMulti);
+      m_settingsWidget->impostors->setChecked(m_impostors);
       m_settingsWidget->opacitySlider->setValue(int(20 * m_alpha));
       m_settingsWidget->combo_radius->setCurrentIndex(m_atomRadiusType);
     }
@@ -89,6 +89,7 @@ namespace Avogadro {
       const double m_bondRadiusScale;
       int m_atomRadiusType;
       int m_showMulti;
+      bool m_impostors; // ray cast the atoms and bonds
 
       double m_alpha; // transparency of the balls & sticks
 
@@ -118,6 +119,11 @@ namespace Avogadro {
        */
       void setShowMulti(int value);
 
+      /**
+       * @param value checked state of the impostors check box
+       */
+      void setImpostors(int value);
+
       /**
        * @param value opacity of the balls & sticks / 20
        */
@@ -47,8 +47,13 @@ using namespace Eigen;
 
 namespace Avogadro {
 
+  // Above this many changed atoms, finding all hydrogen bonds again with a
+  // neighbor list is cheaper than looking around each of them
+  const int MAX_CHANGED_ATOMS = 32;
+
   HBondEngine::HBondEngine(QObject *parent) : Engine(parent), m_settingsWidget(0),
-                                              m_width(2), m_radius(2.0), m_angle(120)
+                                              m_width(2), m_radius(2.0), m_angle(120),
+                                              m_invalid(true)
   {
   }
 
@@ -68,9 +73,9 @@ namespace Avogadro {
   {
   }
 
-  unsigned long createUniqueHbondId(Atom *donorH, Atom *acceptor)
+  inline quint64 hbondKey(unsigned long hydrogenId, unsigned long acceptorId)
   {
-    return acceptor->index() * static_cast<Molecule*>(acceptor->parent())->numAtoms() + donorH->index();
+    return (static_cast<quint64>(hydrogenId) << 32) | acceptorId;
   }
 
   bool HBondEngine::renderOpaque(PainterDevice *pd)
@@ -79,62 +84,194 @@ namespace Avogadro {
     if (!molecule->numAtoms())
       return false;
 
+    updateHbonds(molecule);
+
     pd->painter()->setColor(1.0, 1.0, 0.3);
     int stipple = 0xF0F0; // pattern for lines
 
-    QList<unsigned long> rendered;
+    for (int i = 0; i + 1 < m_lines.size(); i += 2)
+      pd->painter()->drawMultiLine(m_lines[i], m_lines[i + 1], m_width, 1, stipple);
+
+    return true;
+  }
+
+  void HBondEngine::updateHbonds(Molecule *molecule)
+  {
+    if (molecule != m_cachedMolecule) {
+      if (m_cachedMolecule)
+        disconnect(m_cachedMolecule, 0, this, 0);
+      m_cachedMolecule = molecule;
+      connect(molecule, SIGNAL(moleculeChanged()), this, SLOT(invalidate()));
+      connect(molecule, SIGNAL(updated()), this, SLOT(invalidate()));
+      connect(molecule, SIGNAL(atomAdded(Atom*)), this, SLOT(atomChanged(Atom*)));
+      connect(molecule, SIGNAL(atomUpdated(Atom*)), this, SLOT(atomChanged(Atom*)));
+      connect(molecule, SIGNAL(atomRemoved(Atom*)), this, SLOT(atomChanged(Atom*)));
+      connect(molecule, SIGNAL(bondAdded(Bond*)), this, SLOT(bondChanged(Bond*)));
+      connect(molecule, SIGNAL(bondUpdated(Bond*)), this, SLOT(bondChanged(Bond*)));
+      connect(molecule, SIGNAL(bondRemoved(Bond*)), this, SLOT(bondChanged(Bond*)));
+      m_invalid = true;
+    }
+
+    // Another set of atoms to render
+    QList<Atom *> atomList = atoms();
+    if (atomList != m_cachedAtoms) {
+      m_cachedAtoms = atomList;
+      m_invalid = true;
+    }
+
+    if (!m_invalid && m_changedAtoms.isEmpty())
+      return;
+
+    // Looking around single atoms only works when all atoms are rendered
+    if (m_changedAtoms.size() > MAX_CHANGED_ATOMS
+        || static_cast<unsigned int>(atomList.size()) != molecule->numAtoms())
+      m_invalid = true;
 
-    NeighborList *nbrList = new NeighborList(molecule, m_radius);
-    //for (unsigned int i = 0; i < molecule->numAtoms(); ++i) {
-    foreach(Atom *atom, atoms()) {
+    if (m_invalid) {
+      findAllHbonds(molecule);
+    }
+    else {
+      // Hydrogen bonds also depend on the donor, so look again around the
+      // hydrogens bonded to the changed atoms
+      QSet<unsigned long> changed = m_changedAtoms;
+      foreach (unsigned long id, m_changedAtoms) {
+        Atom *atom = molecule->atomById(id);
+        if (!atom)
+          continue;
+        foreach (unsigned long nbrId, atom->neighbors()) {
+          Atom *nbr = molecule->atomById(nbrId);
+          if (nbr && nbr->isHydrogen())
+            changed.insert(nbrId);
+        }
+      }
+
+      QSet<quint64>::iterator it = m_hbonds.begin();
+      while (it != m_hbonds.end()) {
+        if (changed.contains(static_cast<unsigned long>(*it >> 32))
+            || changed.contains(static_cast<unsigned long>(*it & 0xffffffff)))
+          it = m_hbonds.erase(it);
+        else
+          ++it;
+      }
+
+      foreach (unsigned long id, changed) {
+        Atom *atom = molecule->atomById(id);
+        if (atom)
+          findHbonds(molecule, atom);
+      }
+    }
+    m_invalid = false;
+    m_changedAtoms.clear();
+
+    m_lines.clear();
+    m_lines.reserve(2 * m_hbonds.size());
+    foreach (quint64 key, m_hbonds) {
+      Atom *hydrogen = molecule->atomById(static_cast<unsigned long>(key >> 32));
+      Atom *acceptor = molecule->atomById(static_cast<unsigned long>(key & 0xffffffff));
+      if (!hydrogen || !acceptor)
+        continue;
+      m_lines.append(*hydrogen->pos());
+      m_lines.append(*acceptor->pos());
+    }
+  }
+
+  void HBondEngine::findAllHbonds(Molecule *molecule)
+  {
+    m_hbonds.clear();
+
+    NeighborList nbrList(molecule, m_radius);
+    foreach(Atom *atom, m_cachedAtoms) {
       bool atomIsH = atom->isHydrogen() ? true : false;
 
       if (!atomIsH && !isHbondAcceptor(atom))
           continue;
 
       // get ALL possible pairs for atom (uniqueOnly = false)
-      QList<Atom*> nbrs = nbrList->nbrs(atom, false);
+      QList<Atom*> nbrs = nbrList.nbrs(atom, false);
       foreach(Atom *nbr, nbrs) {
-        double angle = 180.0;
-        Atom *hydrogen, *acceptor, *donor = 0;
-
-        if (atomIsH) {
-          if (!isHbondDonorH(atom) || !isHbondAcceptor(nbr))
-            continue;
-
-          hydrogen = atom;
-          acceptor = nbr;
-          foreach (unsigned long id, atom->neighbors())
-            donor = static_cast<Molecule*>(atom->parent())->atomById(id);
-        } else {
-           if (!isHbondDonorH(nbr) || !isHbondAcceptor(atom))
-            continue;
-
-          hydrogen = nbr;
-          acceptor = atom;
-          foreach (unsigned long id, nbr->neighbors())
-            donor = static_cast<Molecule*>(atom->parent())->atomById(id);
-        }
+        Atom *hydrogen = atomIsH ? atom : nbr;
+        Atom *acceptor = atomIsH ? nbr : atom;
+        if (isHbond(hydrogen, acceptor))
+          m_hbonds.insert(hbondKey(hydrogen->id(), acceptor->id()));
+      } // for each nbr
+    } // for each atom
+  }
 
-        if (donor) {
-          Eigen::Vector3d ab = *donor->pos() - *hydrogen->pos();
-          Eigen::Vector3d bc = *acceptor->pos() - *hydrogen->pos();
-          angle = 180. * acos( ab.dot(bc) / (ab.norm() * bc.norm()) ) / M_PI;
-        }
+  void HBondEngine::findHbonds(Molecule *molecule, Atom *atom)
+  {
+    bool atomIsH = atom->isHydrogen();
+    if (atomIsH ? !isHbondDonorH(atom) : !isHbondAcceptor(atom))
+      return;
+
+    foreach (Atom *other, molecule->atoms()) {
+      Atom *hydrogen = atomIsH ? atom : other;
+      Atom *acceptor = atomIsH ? other : atom;
+      if (hydrogen->isHydrogen() && isHbond(hydrogen, acceptor))
+        m_hbonds.insert(hbondKey(hydrogen->id(), acceptor->id()));
+    }
+  }
 
-        if (angle < m_angle)
-          continue;
+  bool HBondEngine::isHbond(Atom *hydrogen, Atom *acceptor)
+  {
+    if (hydrogen == acceptor)
+      return false;
+    Vector3d bc = *acceptor->pos() - *hydrogen->pos();
+    if (bc.squaredNorm() > m_radius * m_radius)
+      return false;
+    if (!isHbondDonorH(hydrogen) || !isHbondAcceptor(acceptor))
+      return false;
 
-        unsigned long HbondId = createUniqueHbondId(hydrogen, acceptor);
-        if (rendered.contains(HbondId))
-          continue;
-        rendered.append(HbondId);
+    // Like the NeighborList, skip atoms in 1-2 and 1-3 positions
+    Molecule *molecule = static_cast<Molecule*>(hydrogen->parent());
+    Atom *donor = 0;
+    foreach (unsigned long id, hydrogen->neighbors()) {
+      if (id == acceptor->id())
+        return false;
+      donor = molecule->atomById(id);
+      if (donor && donor->neighbors().contains(acceptor->id()))
+        return false;
+    }
 
-        pd->painter()->drawMultiLine(*atom->pos(), *nbr->pos(), m_width, 1, stipple);
-      } // for each nbr
-    } // for each atom
+    double angle = 180.0;
+    if (donor) {
+      Eigen::Vector3d ab = *donor->pos() - *hydrogen->pos();
+      angle = 180. * acos( ab.dot(bc) / (ab.norm() * bc.norm()) ) / M_PI;
+    }
 
-    return true;
+    return angle >= m_angle;
+  }
+
+  void HBondEngine::invalidate()
+  {
+    m_invalid = true;
+  }
+
+  void HBondEngine::atomChanged(Atom *atom)
+  {
+    if (atom)
+      m_changedAtoms.insert(atom->id());
+  }
+
+  void HBondEngine::bondChanged(Bond *bond)
+  {
+    if (!bond)
+      return;
+    m_changedAtoms.insert(bond->beginAtomId());
+    m_changedAtoms.insert(bond->endAtomId());
+  }
+
+  void HBondEngine::setMolecule(const Molecule *molecule)
+  {
+    Engine::setMolecule(molecule);
+    // The base class may have disconnected us from the molecule
+    if (m_cachedMolecule)
+      disconnect(m_cachedMolecule, 0, this, 0);
+    m_cachedMolecule = 0;
+  }
+
+  void HBondEngine::setMolecule(Molecule *molecule)
+  {
+    setMolecule(const_cast<const Molecule *>(molecule));
   }
 
   double HBondEngine::radius(const PainterDevice *, const Primitive *) const
@@ -167,12 +304,14 @@ namespace Avogadro {
   void HBondEngine::setRadius(double value)
   {
     m_radius = value;
+    m_invalid = true;
     emit changed();
   }
 
   void HBondEngine::setAngle(double value)
   {
     m_angle = value;
+    m_invalid = true;
     emit changed();
   }
 
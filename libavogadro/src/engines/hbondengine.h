@@ -29,6 +29,11 @@
 #include <avogadro/global.h>
 #include <avogadro/engine.h>
 
+#include <Eigen/Core>
+
+#include <QPointer>
+#include <QSet>
+#include <QVector>
 
 #include "ui_hbondsettingswidget.h"
 
@@ -72,20 +77,45 @@ namespace Avogadro {
        */
       void readSettings(QSettings &settings);
 
-
+    public Q_SLOTS:
+      void setMolecule(const Molecule *molecule);
+      void setMolecule(Molecule *molecule);
 
     private:
       HBondSettingsWidget *m_settingsWidget;
       int    m_width;
       double m_radius;
       double m_angle;
-  
+
+      // The hydrogen bonds found so far, keyed by the ids of the hydrogen
+      // and the acceptor. They are only looked for again around the atoms
+      // that changed since, or everywhere after large changes.
+      QPointer<Molecule> m_cachedMolecule;
+      QList<Atom *> m_cachedAtoms;
+      QSet<quint64> m_hbonds;
+      QSet<unsigned long> m_changedAtoms;
+      bool m_invalid;
+      // Ends of the lines to draw, two per hydrogen bond
+      QVector<Eigen::Vector3d> m_lines;
+
       bool isHbondAcceptor(Atom *atom);
       bool isHbondDonor(Atom *atom);
       bool isHbondDonorH(Atom *atom);
-    
+      bool isHbond(Atom *hydrogen, Atom *acceptor);
+
+      void updateHbonds(Molecule *molecule);
+      void findAllHbonds(Molecule *molecule);
+      void findHbonds(Molecule *molecule, Atom *atom);
+
     private Q_SLOTS:
       void settingsWidgetDestroyed();
+
+      /**
+       * Find all hydrogen bonds again before the next render.
+       */
+      void invalidate();
+      void atomChanged(Atom *atom);
+      void bondChanged(Bond *bond);
     
      /**
        * @param value width of the hydrogen bonds
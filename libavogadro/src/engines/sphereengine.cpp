@@ -35,6 +35,7 @@
 
 #include <QMessageBox>
 #include <QDebug>
+#include <QVector>
 
 #include <openbabel/mol.h>
 #include <openbabel/elements.h>
@@ -44,7 +45,7 @@ using namespace Eigen;
 namespace Avogadro {
 
   SphereEngine::SphereEngine(QObject *parent) : Engine(parent), m_settingsWidget(0),
-  m_alpha(1.0)
+  m_alpha(1.0), m_impostors(false)
   {
   }
 
@@ -61,6 +62,7 @@ namespace Avogadro {
 
     engine->setAlias(alias());
     engine->m_alpha = m_alpha;
+    engine->m_impostors = m_impostors;
     engine->setEnabled(isEnabled());
     return engine;
   }
@@ -73,9 +75,7 @@ namespace Avogadro {
       // Render the atoms as VdW spheres
       glDisable(GL_NORMALIZE);
       glEnable(GL_RESCALE_NORMAL);
-      QList<Atom *> allAtoms = atoms() + atomImages();
-      foreach(Atom *a, allAtoms)
-        render(pd, a);
+      render(pd, atoms() + atomImages());
       glDisable(GL_RESCALE_NORMAL);
       glEnable(GL_NORMALIZE);
     }
@@ -100,9 +100,19 @@ namespace Avogadro {
 
       // Render all atoms and atom images
       QList<Atom *> allAtoms = atoms() + atomImages();
+      QVector<Vector3d> centers;
+      QVector<double> radii;
+      centers.reserve(allAtoms.size());
+      radii.reserve(allAtoms.size());
       foreach(Atom *a, allAtoms) {
-        pd->painter()->drawSphere(a->pos(), radius(a)*0.9999);
+        centers.append(*a->pos());
+        radii.append(radius(a)*0.9999);
       }
+      pd->painter()->setImpostors(m_impostors);
+      pd->painter()->drawSpheres(centers, radii,
+                                 QVector<QColor>(allAtoms.size(),
+                                                 QColor(0, 0, 0, 255)));
+      pd->painter()->setImpostors(false);
 
       glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
       glEnable(GL_BLEND);
@@ -112,8 +122,7 @@ namespace Avogadro {
       glDisable(GL_NORMALIZE);
       glEnable(GL_RESCALE_NORMAL);
 
-      foreach(Atom *a, allAtoms)
-        render(pd, a);
+      render(pd, allAtoms);
 
       glDisable(GL_RESCALE_NORMAL);
       glEnable(GL_NORMALIZE);
@@ -156,17 +165,28 @@ namespace Avogadro {
     return true;
   }
 
-  bool SphereEngine::render(PainterDevice *pd, const Atom *a)
+  bool SphereEngine::render(PainterDevice *pd, const QList<Atom *> &atomList)
   {
-    // Render the atoms as Van der Waals spheres
+    // Render the atoms as Van der Waals spheres, all in one go
     Color *map = colorMap(); // possible custom color map
     if (!map) map = pd->colorMap(); // fall back to global color map
 
-    map->setFromPrimitive(a);
-    map->setAlpha(m_alpha);
-    pd->painter()->setColor(map);
-    pd->painter()->setName(a);
-    pd->painter()->drawSphere(a->pos(), radius(a));
+    QVector<Vector3d> centers;
+    QVector<double> radii;
+    QVector<QColor> colors;
+    centers.reserve(atomList.size());
+    radii.reserve(atomList.size());
+    colors.reserve(atomList.size());
+    foreach(const Atom *a, atomList) {
+      map->setFromPrimitive(a);
+      map->setAlpha(m_alpha);
+      centers.append(*a->pos());
+      radii.append(radius(a));
+      colors.append(map->color());
+    }
+    pd->painter()->setImpostors(m_impostors);
+    pd->painter()->drawSpheres(centers, radii, colors);
+    pd->painter()->setImpostors(false);
 
     return true;
   }
@@ -215,6 +235,12 @@ namespace Avogadro {
     emit changed();
   }
 
+  void SphereEngine::setImpostors(int value)
+  {
+    m_impostors = value != Qt::Unchecked;
+    emit changed();
+  }
+
   QWidget* SphereEngine::settingsWidget()
   {
     if(!m_settingsWidget)
@@ -222,7 +248,12 @@ namespace Avogadro {
       m_settingsWidget = new SphereSettingsWidget();
       connect(m_settingsWidget->opacitySlider, SIGNAL(valueChanged(int)), this, SLOT(setOpacity(int)));
       connect(m_settingsWidget, SIGNAL(destroyed()), this, SLOT(settingsWidgetDestroyed()));
+      connect(m_settingsWidget->impostors, SIGNAL(stateChanged(int)), this, SLOT(setImpostors(int)));
       m_settingsWidget->opacitySlider->setValue(20*m_alpha);
+      m_settingsWidget->impostors->setChecked(m_impostors);
+#ifndef ENABLE_GLSL
+      m_settingsWidget->impostors->hide();
+#endif
     }
     return m_settingsWidget;
   }
@@ -237,14 +268,17 @@ namespace Avogadro {
   {
     Engine::writeSettings(settings);
     settings.setValue("opacity", 20*m_alpha);
+    settings.setValue("impostors", m_impostors);
   }
 
   void SphereEngine::readSettings(QSettings &settings)
   {
     Engine::readSettings(settings);
     setOpacity(settings.value("opacity", 20).toInt());
+    m_impostors = settings.value("impostors", false).toBool();
     if (m_settingsWidget) {
       m_settingsWidget->opacitySlider->setValue(20*m_alpha);
+      m_settingsWidget->impostors->setChecked(m_impostors);
     }
   }
 
@@ -82,12 +82,13 @@ namespace Avogadro {
 
     private:
       double radius(const Atom *a) const;
-      //! Render an Atom.
-      bool render(PainterDevice *pd, const Atom *a);
+      //! Render a list of Atoms in one batch.
+      bool render(PainterDevice *pd, const QList<Atom *> &atomList);
 
       SphereSettingsWidget *m_settingsWidget;
 
       double m_alpha; // transparency of the VdW spheres
+      bool m_impostors; // ray cast the spheres
 
     private Q_SLOTS:
       void settingsWidgetDestroyed();
@@ -98,6 +99,11 @@ namespace Avogadro {
        */
       void setOpacity(int value);
 
+      /**
+       * @param value checked state of the impostors check box
+       */
+      void setImpostors(int value);
+
   };
 
   class SphereSettingsWidget : public QWidget, public Ui::SphereSettingsWidget
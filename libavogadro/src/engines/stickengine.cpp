@@ -37,6 +37,7 @@
 #include <openbabel/mol.h>
 
 #include <QMessageBox>
+#include <QVector>
 
 using namespace Eigen;
 
@@ -48,7 +49,7 @@ using namespace Eigen;
 namespace Avogadro {
 
   StickEngine::StickEngine(QObject *parent) : Engine(parent), m_settingsWidget(0),
-        m_radius(0.25)
+        m_radius(0.25), m_impostors(false)
   {
   }
 
@@ -66,6 +67,7 @@ namespace Avogadro {
     engine->setAlias(alias());
     engine->setEnabled(isEnabled());
     engine->setRadius(m_radius * SCALING_FACTOR);
+    engine->m_impostors = m_impostors;
     return engine;
   }
 
@@ -75,16 +77,57 @@ namespace Avogadro {
     glDisable( GL_NORMALIZE );
     glEnable( GL_RESCALE_NORMAL );
 
+    Color *map = colorMap(); // possible custom color map
+    if (!map) map = pd->colorMap(); // fall back to global color map
+
     // Render the atoms and images
     QList<Atom *> allAtoms = atoms() + atomImages();
-    foreach(Atom *a, allAtoms)
-      renderOpaque(pd, a);
+    QVector<Vector3d> centers;
+    QVector<double> radii;
+    QVector<QColor> colors;
+    centers.reserve(allAtoms.size());
+    radii.reserve(allAtoms.size());
+    colors.reserve(allAtoms.size());
+    foreach(Atom *a, allAtoms) {
+      map->setFromPrimitive(a);
+      centers.append(*a->pos());
+      radii.append(radius(a));
+      colors.append(map->color());
+    }
+    pd->painter()->setImpostors(m_impostors);
+    pd->painter()->drawSpheres(centers, radii, colors);
 
-    // render bonds (sticks)
+    // render bonds (sticks), each as two halves in the colors of their atoms
     glDisable( GL_RESCALE_NORMAL );
     glEnable( GL_NORMALIZE );
-    foreach(Bond *b, bonds())
-      renderOpaque(pd, b);
+    QVector<Vector3d> ends1, ends2;
+    radii.clear();
+    colors.clear();
+    ends1.reserve(2 * bonds().size());
+    ends2.reserve(2 * bonds().size());
+    radii.reserve(2 * bonds().size());
+    colors.reserve(2 * bonds().size());
+    foreach(Bond *b, bonds()) {
+      Atom* atom1 = pd->molecule()->atomById(b->beginAtomId());
+      Atom* atom2 = pd->molecule()->atomById(b->endAtomId());
+      Vector3d v1 (*atom1->pos());
+      Vector3d v2 (*atom2->pos());
+      Vector3d v3 (( v1 + v2 ) / 2);
+
+      map->setFromPrimitive(atom1);
+      ends1.append(v1);
+      ends2.append(v3);
+      radii.append(radius(atom1));
+      colors.append(map->color());
+
+      map->setFromPrimitive(atom2);
+      ends1.append(v3);
+      ends2.append(v2);
+      radii.append(radius(atom1));
+      colors.append(map->color());
+    }
+    pd->painter()->drawCylinders(ends1, ends2, radii, colors);
+    pd->painter()->setImpostors(false);
 
 //    glPopAttrib();
 
@@ -146,19 +189,6 @@ namespace Avogadro {
     return true;
   }
 
-  inline bool StickEngine::renderOpaque(PainterDevice *pd, const Atom* a)
-  {
-    Color *map = colorMap(); // possible custom color map
-    if (!map) map = pd->colorMap(); // fall back to global color map
-
-    map->setFromPrimitive(a);
-    pd->painter()->setColor(map);
-    pd->painter()->setName(a);
-    pd->painter()->drawSphere( a->pos(), radius(a) );
-
-    return true;
-  }
-
   inline bool StickEngine::renderPick(PainterDevice *pd, const Atom* a)
   {
     Color *map = colorMap(); // possible custom color map
@@ -237,6 +267,12 @@ namespace Avogadro {
     emit changed();
   }
 
+  void StickEngine::setImpostors(int value)
+  {
+    m_impostors = value != Qt::Unchecked;
+    emit changed();
+  }
+
   QWidget* StickEngine::settingsWidget()
   {
     if(!m_settingsWidget)
@@ -244,7 +280,12 @@ namespace Avogadro {
       m_settingsWidget = new StickSettingsWidget();
       connect(m_settingsWidget->radiusSlider, SIGNAL(valueChanged(int)), this, SLOT(setRadius(int)));
       connect(m_settingsWidget, SIGNAL(destroyed()), this, SLOT(settingsWidgetDestroyed()));
+      connect(m_settingsWidget->impostors, SIGNAL(stateChanged(int)), this, SLOT(setImpostors(int)));
       m_settingsWidget->radiusSlider->setValue(SCALING_FACTOR*m_radius);
+      m_settingsWidget->impostors->setChecked(m_impostors);
+#ifndef ENABLE_GLSL
+      m_settingsWidget->impostors->hide();
+#endif
     }
     return m_settingsWidget;
   }
@@ -258,6 +299,7 @@ namespace Avogadro {
   {
     Engine::writeSettings(settings);
     settings.setValue("radius", SCALING_FACTOR*m_radius);
+    settings.setValue("impostors", m_impostors);
   }
 
   void StickEngine::readSettings(QSettings &settings)
@@ -265,8 +307,10 @@ namespace Avogadro {
     Engine::readSettings(settings);
         // default = 0.25 as far as m_radius
     setRadius(settings.value("radius", 5).toInt());
+    m_impostors = settings.value("impostors", false).toBool();
     if (m_settingsWidget) {
       m_settingsWidget->radiusSlider->setValue(SCALING_FACTOR*m_radius);
+      m_settingsWidget->impostors->setChecked(m_impostors);
     }
   }
 }
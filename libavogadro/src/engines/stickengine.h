@@ -80,8 +80,7 @@ namespace Avogadro {
     private:
       inline double radius(const Atom *) const
       { return m_radius; }
-      //! Render an Atom.
-      bool renderOpaque(PainterDevice *pd, const Atom *a);
+      //! Render an Atom for picking.
       bool renderPick(PainterDevice *pd, const Atom *a);
       //! Render a Bond.
       bool renderOpaque(PainterDevice *pd, const Bond *b);
@@ -89,6 +88,7 @@ namespace Avogadro {
       StickSettingsWidget *m_settingsWidget;
 
 			double m_radius; //!< The radius of the stick bonds
+			bool m_impostors; //!< Ray cast the atoms and bonds
 
 		private Q_SLOTS:
 	    void settingsWidgetDestroyed();
@@ -96,6 +96,10 @@ namespace Avogadro {
 	     * @param value radius of the sticks / 20
 	     */
 	    void setRadius(int value);
+	    /**
+	     * @param value checked state of the impostors check box
+	     */
+	    void setImpostors(int value);
   };
 
   class StickSettingsWidget : public QWidget, public Ui::StickSettingsWidget
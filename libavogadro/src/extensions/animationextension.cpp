@@ -26,6 +26,7 @@
 #include <avogadro/molecule.h>
 #include <avogadro/color.h>
 #include <avogadro/animation.h>
+#include <avogadro/trajectoryfile.h>
 #include <avogadro/glwidget.h>
 
 #include <openbabel/mol.h>
@@ -83,6 +84,12 @@ namespace Avogadro {
   void AnimationExtension::setMolecule(Molecule *molecule)
   {
     m_molecule = molecule;
+    // Drop the trajectory of the previous molecule
+    if (m_animation) {
+      m_animation->setMolecule(molecule);
+      if (m_animationDialog)
+        m_animationDialog->setFrameCount(m_animation->numFrames());
+    }
   }
 
   QUndoCommand* AnimationExtension::performAction(QAction *, GLWidget* widget)
@@ -151,8 +158,10 @@ namespace Avogadro {
                               .arg( file ) );
         return;
       }
-      else
+      else {
+        m_animation->setTrajectory(0);
         m_molecule->setOBMol(&obmol);
+      }
     }
 
     m_animationDialog->setFrameCount(m_animation->numFrames());
@@ -229,57 +238,33 @@ namespace Avogadro {
 
   void AnimationExtension::readTrajFromFile(QString trajfile)
   {
-
-    const char *format;
+    TrajectoryFile::Format format;
     if ( trajfile.endsWith(QLatin1String(".xyz")))
-      format="XYZ";
+      format = TrajectoryFile::XyzFormat;
     else if (trajfile.endsWith(QLatin1String("HISTORY")))
-      format="HISTORY";
+      format = TrajectoryFile::HistoryFormat;
     else
       {
         QMessageBox::warning( NULL, tr( "Avogadro" ),
                               tr( "Could not determine format from filename: %1").arg( trajfile ) );
         return;
       }
-      
-    OBConversion conv;
-    if (!conv.SetInFormat(format)) {
-      QMessageBox::warning( NULL, tr( "Avogadro" ),
-                            tr( "Could not set format: %1").arg( format ));
-      return;
-    }
-
-    m_molecule->clearConformers();
-
-    std::ifstream file(QFile::encodeName(trajfile));
 
-    OpenBabel::OBMol tmpMol;
-    int i=0;
-    while (true) {
-      tmpMol.Clear();
-      if (!conv.Read(&tmpMol, &file))
-        break;
-      double* tmpCoords = tmpMol.GetCoordinates();
-      if (!tmpCoords) {
-        QMessageBox::warning( NULL, tr( "Avogadro" ),
-                              tr( "Problem reading traj file %1").arg(trajfile));
-        return;
-      }
-      if (tmpMol.NumAtoms() != m_molecule->numAtoms()) {
+    // Only the frame offsets are read now, the frames as they are played
+    TrajectoryFile *trajectory = new TrajectoryFile;
+    if (!trajectory->open(trajfile, format, m_molecule->numAtoms())) {
+      if (trajectory->error() == TrajectoryFile::AtomCountError)
         QMessageBox::warning( NULL, tr( "Avogadro" ),
           tr( "Trajectory file %1 disagrees on the number of atoms in the present molecule").arg(trajfile));
-        return;
-      }
-
-      std::vector<Eigen::Vector3d> *coords = m_molecule->addConformer(i);
-      //copy coords read in to a new array that will not be deleted
-      for (uint j = 0; j < tmpMol.NumAtoms(); ++j) {
-        (*coords)[j] = Vector3d(tmpCoords[3*j], tmpCoords[3*j+1], tmpCoords[3*j+2]);
-      }
-      ++i;
+      else
+        QMessageBox::warning( NULL, tr( "Avogadro" ),
+                              tr( "Problem reading traj file %1").arg(trajfile));
+      delete trajectory;
+      return;
     }
 
-    file.close();
+    m_molecule->clearConformers();
+    m_animation->setTrajectory(trajectory);
   }
 
   bool AnimationExtension::writeXyzTraj(QString filename) {
@@ -288,7 +273,7 @@ namespace Avogadro {
 
     std::ofstream file(QFile::encodeName(filename));
 
-    for (unsigned int i = 1; i <= m_molecule->numConformers(); ++i) {
+    for (int i = 1; i <= m_animation->numFrames(); ++i) {
       m_animation->setFrame(i);
 
       OpenBabel::OBMol obmol(m_molecule->OBMol());
@@ -48,7 +48,7 @@
 #include <avogadro/camera.h>
 #include <avogadro/glwidget.h>
 #include <avogadro/obeigenconv.h>
-#include <avogadro/neighborlist.h>
+#include <avogadro/bondperceiver.h>
 #include <avogadro/bond.h>
 
 #include <openbabel/generic.h>
@@ -1512,41 +1512,14 @@ namespace Avogadro
   void CrystallographyExtension::rebuildBonds()
   {
     m_molecule->blockSignals(true);
-    // Remove any bonds
-    foreach(Bond *b, m_molecule->bonds())
-      m_molecule->removeBond(b);
 
-    // Migrated from supercellextension
     // Add single bonds between all atoms closer than their combined atomic
-    // covalent radii.
-    std::vector<double> rad;
-    NeighborList nbrs(m_molecule, 2.5); // 2.5 is the maximum covalent radius expected
-
-    // Store the covalent radius for each atom
-    rad.reserve(m_molecule->numAtoms());
-    foreach (Atom *atom, m_molecule->atoms())
-      rad.push_back(OpenBabel::OBElements::GetCovalentRad(atom->atomicNumber()));
-
-    foreach (Atom *atom1, m_molecule->atoms()) {
-      foreach (Atom *atom2, nbrs.nbrs(atom1)) {
-        if (m_molecule->bond(atom1, atom2))
-          continue;
-        if (atom1->isHydrogen() && atom2->isHydrogen())
-          continue;
-        // bonded if closer than elemental Rcov + tolerance
-        double cutoff = (rad[atom1->index()] + rad[atom2->index()] + 0.45)
-               * (rad[atom1->index()] + rad[atom2->index()] + 0.45);
-
-        double d2  = ((*atom1->pos()) - (*atom2->pos())).squaredNorm();
-
-        // If atoms are closer than 0.4, we declare them as non-bonded (e.g., disorder)
-        if (d2 > cutoff || d2 < 0.40)
-          continue;
-
-        Bond *bond = m_molecule->addBond();
-        bond->setAtoms(atom1->id(), atom2->id(), 1);
-      }
-    }
+    // covalent radii, and remove the others. Large radii would bond
+    // neighbors in metallic and ionic solids, so cap the distance.
+    BondPerceiver perceiver;
+    perceiver.setValenceLimited(false);
+    perceiver.setMaxDistance(2.5);
+    perceiver.update(m_molecule);
 
     m_molecule->blockSignals(false);
     m_molecule->updateMolecule();
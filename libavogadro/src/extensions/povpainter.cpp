@@ -222,16 +222,22 @@ namespace Avogadro
     // Render the triangles of the mesh
     std::vector<Eigen::Vector3f> t = mesh.vertices();
     std::vector<Eigen::Vector3f> n = mesh.normals();
+    std::vector<unsigned int> ind = mesh.indices();
 
     // If there are no triangles then don't bother doing anything
     if (t.size() == 0)
       return;
 
+    // Non-indexed meshes use three consecutive vertices for each triangle
+    if (ind.empty())
+      for (unsigned int i = 0; i < t.size(); ++i)
+        ind.push_back(i);
+
     QString vertsStr, ivertsStr, normsStr, inormsStr;
     QTextStream verts(&vertsStr);
     verts << "vertex_vectors{" << t.size() << ",\n";
     QTextStream iverts(&ivertsStr);
-    iverts << "face_indices{" << t.size() / 3 << ",\n";
+    iverts << "face_indices{" << ind.size() / 3 << ",\n";
     QTextStream norms(&normsStr);
     norms << "normal_vectors{" << n.size() << ",\n";
     for(unsigned int i = 0; i < t.size(); ++i) {
@@ -247,9 +253,9 @@ namespace Avogadro
       }
     }
     // Now to write out the indices
-    for (unsigned int i = 0; i < t.size(); i += 3) {
-      iverts << "<" << i << "," << i+1 << "," << i+2 << ">";
-      if (i != t.size()-3) {
+    for (unsigned int i = 0; i < ind.size(); i += 3) {
+      iverts << "<" << ind[i] << "," << ind[i+1] << "," << ind[i+2] << ">";
+      if (i != ind.size()-3) {
         iverts << ", ";
       }
       if (i != 0 && ((i+1)/3)%3 == 0) {
@@ -289,16 +295,22 @@ namespace Avogadro
     std::vector<Eigen::Vector3f> v = mesh.vertices();
     std::vector<Eigen::Vector3f> n = mesh.normals();
     std::vector<Color3f> c = mesh.colors();
+    std::vector<unsigned int> ind = mesh.indices();
 
     // If there are no triangles then don't bother doing anything
     if (v.size() == 0 || v.size() != c.size())
       return;
 
+    // Non-indexed meshes use three consecutive vertices for each triangle
+    if (ind.empty())
+      for (unsigned int i = 0; i < v.size(); ++i)
+        ind.push_back(i);
+
     QString vertsStr, ivertsStr, normsStr, texturesStr;
     QTextStream verts(&vertsStr);
     verts << "vertex_vectors{" << v.size() << ",\n";
     QTextStream iverts(&ivertsStr);
-    iverts << "face_indices{" << v.size() / 3 << ",\n";
+    iverts << "face_indices{" << ind.size() / 3 << ",\n";
     QTextStream norms(&normsStr);
     norms << "normal_vectors{" << n.size() << ",\n";
     QTextStream textures(&texturesStr);
@@ -320,10 +332,10 @@ namespace Avogadro
       }
     }
     // Now to write out the indices
-    for (unsigned int i = 0; i < v.size(); i += 3) {
-      iverts << "<" << i << "," << i+1 << "," << i+2 << ">";
-      iverts << "," << i << "," << i+1 << "," << i+2;
-      if (i != v.size()-3)
+    for (unsigned int i = 0; i < ind.size(); i += 3) {
+      iverts << "<" << ind[i] << "," << ind[i+1] << "," << ind[i+2] << ">";
+      iverts << "," << ind[i] << "," << ind[i+1] << "," << ind[i+2];
+      if (i != ind.size()-3)
         iverts << ", ";
       if (i != 0 && ((i+1)/3)%3 == 0)
         iverts << '\n';
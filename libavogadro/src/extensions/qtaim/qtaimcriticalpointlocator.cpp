@@ -33,14 +33,10 @@
 #include <Eigen/Core>
 
 #include <QList>
+#include <QVector>
 
 #include <QtConcurrent/QtConcurrentMap>
 
-#include <QTemporaryFile>
-#include <QFile>
-#include <QDataStream>
-#include <QDir>
-
 #include <QVariant>
 
 #include <QProgressDialog>
@@ -58,7 +54,7 @@ namespace Avogadro
 
   QList<QVariant> QTAIMLocateNuclearCriticalPoint( QList<QVariant> input  )
   {
-    const QString fileName=input.at(0).toString();
+    const QTAIMSharedWavefunction wfn=input.at(0).value<QTAIMSharedWavefunction>();
     const qint64 nucleus=input.at(1).toInt();
     const QVector3D x0y0z0(
         input.at(2).toReal(),
@@ -66,14 +62,11 @@ namespace Avogadro
         input.at(4).toReal()
         );
 
-    QTAIMWavefunction wfn;
-    wfn.loadFromBinaryFile(fileName);
-
-    QTAIMWavefunctionEvaluator eval(wfn);
+    QTAIMWavefunctionEvaluator &eval=QTAIMWavefunctionEvaluator::threadEvaluator(wfn);
 
     QVector3D result;
 
-    if( wfn.nuclearCharge(nucleus) < 4 )
+    if( wfn->nuclearCharge(nucleus) < 4 )
     {
       //      QTAIMODEIntegrator ode(eval,QTAIMODEIntegrator::CMBPMinusThreeGradientInElectronDensity);
       QTAIMLSODAIntegrator ode(eval,QTAIMLSODAIntegrator::CMBPMinusThreeGradientInElectronDensity);
@@ -124,8 +117,8 @@ namespace Avogadro
     QList<QVariant> value;
     value.clear();
 
-    const QString wfnFileName=input.at(0).toString();
-    const QString nuclearCriticalPointsFileName=input.at(1).toString();
+    const QTAIMSharedWavefunction wfn=input.at(0).value<QTAIMSharedWavefunction>();
+    const QList<QVector3D> nuclearCriticalPoints=input.at(1).value<QList<QVector3D> >();
     const qint64 nucleusA=input.at(2).toInt();
     const qint64 nucleusB=input.at(3).toInt();
     const QVector3D x0y0z0(
@@ -134,16 +127,6 @@ namespace Avogadro
         input.at(6).toReal()
         );
 
-    QTAIMWavefunction wfn;
-    wfn.loadFromBinaryFile(wfnFileName);
-
-    QList<QVector3D> nuclearCriticalPoints;
-    QFile nuclearCriticalPointsFile(nuclearCriticalPointsFileName);
-    nuclearCriticalPointsFile.open(QIODevice::ReadOnly);
-    QDataStream nuclearCriticalPointsFileIn(&nuclearCriticalPointsFile);
-    nuclearCriticalPointsFileIn >> nuclearCriticalPoints ;
-    nuclearCriticalPointsFile.close();
-
     QList<QPair<QVector3D,qreal> > betaSpheres;
     for( qint64 i=0 ; i < nuclearCriticalPoints.length() ; ++i )
     {
@@ -153,7 +136,7 @@ namespace Avogadro
       betaSpheres.append(thisBetaSphere);
     }
 
-    QTAIMWavefunctionEvaluator eval(wfn);
+    QTAIMWavefunctionEvaluator &eval=QTAIMWavefunctionEvaluator::threadEvaluator(wfn);
 
     QList<QVector3D> ncpList;
 
@@ -212,10 +195,10 @@ namespace Avogadro
     qreal smallestDistance=HUGE_REAL_NUMBER;
     qint64 smallestDistanceIndex=0;
 
-    for( qint64 n=0 ; n < wfn.numberOfNuclei()  ; ++n )
+    for( qint64 n=0 ; n < wfn->numberOfNuclei()  ; ++n )
     {
       Matrix<qreal,3,1> a(forwardEndpoint.x(),forwardEndpoint.y(),forwardEndpoint.z());
-      Matrix<qreal,3,1> b(wfn.xNuclearCoordinate(n), wfn.yNuclearCoordinate(n), wfn.zNuclearCoordinate(n));
+      Matrix<qreal,3,1> b(wfn->xNuclearCoordinate(n), wfn->yNuclearCoordinate(n), wfn->zNuclearCoordinate(n));
 
       qreal distance=QTAIMMathUtilities::distance(a,b);
 
@@ -230,10 +213,10 @@ namespace Avogadro
     smallestDistance=HUGE_REAL_NUMBER;
     smallestDistanceIndex=0;
 
-    for( qint64 n=0 ; n < wfn.numberOfNuclei()  ; ++n )
+    for( qint64 n=0 ; n < wfn->numberOfNuclei()  ; ++n )
     {
       Matrix<qreal,3,1> a(backwardEndpoint.x(),backwardEndpoint.y(),backwardEndpoint.z());
-      Matrix<qreal,3,1> b(wfn.xNuclearCoordinate(n), wfn.yNuclearCoordinate(n), wfn.zNuclearCoordinate(n));
+      Matrix<qreal,3,1> b(wfn->xNuclearCoordinate(n), wfn->yNuclearCoordinate(n), wfn->zNuclearCoordinate(n));
 
       qreal distance=QTAIMMathUtilities::distance(a,b);
 
@@ -322,7 +305,7 @@ namespace Avogadro
   QList<QVariant> QTAIMLocateElectronDensitySink( QList<QVariant> input  )
   {
     qint64 counter=0;
-    const QString fileName=input.at(counter).toString(); counter++;
+    const QTAIMSharedWavefunction wfn=input.at(counter).value<QTAIMSharedWavefunction>(); counter++;
     //    const qint64 nucleus=input.at(counter).toInt(); counter++
     qreal x0=input.at(counter).toReal(); counter++;
     qreal y0=input.at(counter).toReal(); counter++;
@@ -330,10 +313,7 @@ namespace Avogadro
 
     const QVector3D x0y0z0(x0,y0,z0);
 
-    QTAIMWavefunction wfn;
-    wfn.loadFromBinaryFile(fileName);
-
-    QTAIMWavefunctionEvaluator eval(wfn);
+    QTAIMWavefunctionEvaluator &eval=QTAIMWavefunctionEvaluator::threadEvaluator(wfn);
 
     bool correctSignature;
     QVector3D result;
@@ -393,7 +373,7 @@ namespace Avogadro
   QList<QVariant> QTAIMLocateElectronDensitySource( QList<QVariant> input  )
   {
     qint64 counter=0;
-    const QString fileName=input.at(counter).toString(); counter++;
+    const QTAIMSharedWavefunction wfn=input.at(counter).value<QTAIMSharedWavefunction>(); counter++;
     //    const qint64 nucleus=input.at(counter).toInt(); counter++
     qreal x0=input.at(counter).toReal(); counter++;
     qreal y0=input.at(counter).toReal(); counter++;
@@ -401,10 +381,7 @@ namespace Avogadro
 
     const QVector3D x0y0z0(x0,y0,z0);
 
-    QTAIMWavefunction wfn;
-    wfn.loadFromBinaryFile(fileName);
-
-    QTAIMWavefunctionEvaluator eval(wfn);
+    QTAIMWavefunctionEvaluator &eval=QTAIMWavefunctionEvaluator::threadEvaluator(wfn);
 
     bool correctSignature;
     QVector3D result;
@@ -464,6 +441,7 @@ namespace Avogadro
   QTAIMCriticalPointLocator::QTAIMCriticalPointLocator( QTAIMWavefunction &wfn)
   {
     m_wfn=&wfn;
+    m_sharedWfn=QTAIMSharedWavefunction(new QTAIMWavefunction(wfn));
 
     m_nuclearCriticalPoints.empty();
     m_bondCriticalPoints.empty();
@@ -484,7 +462,7 @@ namespace Avogadro
   void QTAIMCriticalPointLocator::locateNuclearCriticalPoints()
   {
 
-    QString temporaryFileName=QTAIMCriticalPointLocator::temporaryFileName();
+    const QVariant sharedWfn=QVariant::fromValue(m_sharedWfn);
 
     QList<QList<QVariant> > inputList;
 
@@ -493,7 +471,7 @@ namespace Avogadro
     for( qint64 n=0 ; n < numberOfNuclei ; ++n)
     {
       QList<QVariant> input;
-      input.append( temporaryFileName );
+      input.append( sharedWfn );
       input.append( n );
       input.append( m_wfn->xNuclearCoordinate(n) );
       input.append( m_wfn->yNuclearCoordinate(n) );
@@ -502,8 +480,6 @@ namespace Avogadro
       inputList.append(input);
     }
 
-    m_wfn->saveToBinaryFile(temporaryFileName);
-
     QProgressDialog dialog;
     dialog.setWindowTitle("QTAIM");
     dialog.setLabelText(QString("Nuclear Critical Points Search"));
@@ -529,9 +505,6 @@ namespace Avogadro
       results=future.results();
     }
 
-    QFile file;
-    file.remove(temporaryFileName);
-
     for( qint64 n=0 ; n < results.length() ; ++n )
     {
 
@@ -568,14 +541,8 @@ namespace Avogadro
       return;
     }
 
-    QString temporaryFileName=QTAIMCriticalPointLocator::temporaryFileName();
-
-    QString nuclearCriticalPointsFileName=QTAIMCriticalPointLocator::temporaryFileName();
-    QFile nuclearCriticalPointsFile(nuclearCriticalPointsFileName);
-    nuclearCriticalPointsFile.open(QIODevice::WriteOnly);
-    QDataStream nuclearCriticalPointsOut(&nuclearCriticalPointsFile);
-    nuclearCriticalPointsOut << m_nuclearCriticalPoints;
-    nuclearCriticalPointsFile.close();
+    const QVariant sharedWfn=QVariant::fromValue(m_sharedWfn);
+    const QVariant nuclearCriticalPoints=QVariant::fromValue(m_nuclearCriticalPoints);
 
     QList<QList<QVariant> > inputList;
 
@@ -599,8 +566,8 @@ namespace Avogadro
                             ( m_wfn->zNuclearCoordinate(M) + m_wfn->zNuclearCoordinate(N) ) / 2.0 );
 
           QList<QVariant> input;
-          input.append( temporaryFileName );
-          input.append( nuclearCriticalPointsFileName );
+          input.append( sharedWfn );
+          input.append( nuclearCriticalPoints );
           input.append( M );
           input.append( N );
           input.append( x0y0z0.x() );
@@ -612,8 +579,6 @@ namespace Avogadro
       } // end N
     } // end M
 
-    m_wfn->saveToBinaryFile(temporaryFileName);
-
     QProgressDialog dialog;
     dialog.setWindowTitle("QTAIM");
     dialog.setLabelText(QString("Bond Critical Points Search"));
@@ -639,10 +604,6 @@ namespace Avogadro
       results=future.results();
     }
 
-    QFile file;
-    file.remove(temporaryFileName);
-    file.remove(nuclearCriticalPointsFileName);
-
     for( qint64 i=0 ; i < results.length() ; ++i )
     {
       QList<QVariant> thisCriticalPoint=results.at(i);
@@ -686,7 +647,7 @@ namespace Avogadro
   void QTAIMCriticalPointLocator::locateElectronDensitySources()
   {
 
-    QString temporaryFileName=QTAIMCriticalPointLocator::temporaryFileName();
+    const QVariant sharedWfn=QVariant::fromValue(m_sharedWfn);
 
     QList<QList<QVariant> > inputList;
 
@@ -758,25 +719,41 @@ namespace Avogadro
 
     xstep=ystep=zstep= 0.5;
 
+    QVector<qreal> gridCoordinates;
     for( qreal x=xmin ; x < xmax+xstep ; x=x+xstep)
     {
       for( qreal y=ymin ; y < ymax+ystep ; y=y+ystep)
       {
         for( qreal z=zmin ; z < zmax+zstep ; z=z+zstep)
         {
-          QList<QVariant> input;
-          input.append( temporaryFileName );
-//          input.append( n );
-          input.append( x );
-          input.append( y );
-          input.append( z );
-
-          inputList.append(input);
+          gridCoordinates.append(x);
+          gridCoordinates.append(y);
+          gridCoordinates.append(z);
         }
       }
     }
 
-    m_wfn->saveToBinaryFile(temporaryFileName);
+    // Skip the points where the search is not started, all at once
+    Map<const Matrix<qreal,3,Dynamic> > gridMatrix(gridCoordinates.constData(),3,gridCoordinates.size()/3);
+    QTAIMWavefunctionEvaluator eval(*m_sharedWfn);
+    const Matrix<qreal,Dynamic,1> densities=eval.electronDensities(gridMatrix);
+
+    for( qint64 i=0 ; i < gridMatrix.cols() ; ++i )
+    {
+      if( densities(i) < 1.e-1 )
+      {
+        continue;
+      }
+
+      QList<QVariant> input;
+      input.append( sharedWfn );
+//      input.append( n );
+      input.append( gridMatrix(0,i) );
+      input.append( gridMatrix(1,i) );
+      input.append( gridMatrix(2,i) );
+
+      inputList.append(input);
+    }
 
     QProgressDialog dialog;
     dialog.setWindowTitle("QTAIM");
@@ -803,9 +780,6 @@ namespace Avogadro
       results=future.results();
     }
 
-    QFile file;
-    file.remove(temporaryFileName);
-
     for( qint64 n=0 ; n < results.length() ; ++n )
     {
 
@@ -856,7 +830,7 @@ namespace Avogadro
   void QTAIMCriticalPointLocator::locateElectronDensitySinks()
   {
 
-    QString temporaryFileName=QTAIMCriticalPointLocator::temporaryFileName();
+    const QVariant sharedWfn=QVariant::fromValue(m_sharedWfn);
 
     QList<QList<QVariant> > inputList;
 
@@ -928,25 +902,41 @@ namespace Avogadro
 
     xstep=ystep=zstep= 0.5;
 
+    QVector<qreal> gridCoordinates;
     for( qreal x=xmin ; x < xmax+xstep ; x=x+xstep)
     {
       for( qreal y=ymin ; y < ymax+ystep ; y=y+ystep)
       {
         for( qreal z=zmin ; z < zmax+zstep ; z=z+zstep)
         {
-          QList<QVariant> input;
-          input.append( temporaryFileName );
-//          input.append( n );
-          input.append( x );
-          input.append( y );
-          input.append( z );
-
-          inputList.append(input);
+          gridCoordinates.append(x);
+          gridCoordinates.append(y);
+          gridCoordinates.append(z);
         }
       }
     }
 
-    m_wfn->saveToBinaryFile(temporaryFileName);
+    // Skip the points where the search is not started, all at once
+    Map<const Matrix<qreal,3,Dynamic> > gridMatrix(gridCoordinates.constData(),3,gridCoordinates.size()/3);
+    QTAIMWavefunctionEvaluator eval(*m_sharedWfn);
+    const Matrix<qreal,Dynamic,1> densities=eval.electronDensities(gridMatrix);
+
+    for( qint64 i=0 ; i < gridMatrix.cols() ; ++i )
+    {
+      if( densities(i) < 1.e-1 )
+      {
+        continue;
+      }
+
+      QList<QVariant> input;
+      input.append( sharedWfn );
+//      input.append( n );
+      input.append( gridMatrix(0,i) );
+      input.append( gridMatrix(1,i) );
+      input.append( gridMatrix(2,i) );
+
+      inputList.append(input);
+    }
 
     QProgressDialog dialog;
     dialog.setWindowTitle("QTAIM");
@@ -973,9 +963,6 @@ namespace Avogadro
       results=future.results();
     }
 
-    QFile file;
-    file.remove(temporaryFileName);
-
     for( qint64 n=0 ; n < results.length() ; ++n )
     {
 
@@ -1023,22 +1010,4 @@ namespace Avogadro
 //    qDebug() << "SINKS" << m_electronDensitySinks;
   }
 
-  QString QTAIMCriticalPointLocator::temporaryFileName()
-  {
-    QTemporaryFile temporaryFile;
-    temporaryFile.open();
-    QString temporaryFileName=temporaryFile.fileName();
-    temporaryFile.close();
-    temporaryFile.remove();
-
-    // wait for temporary file to be deleted
-    QDir dir;
-    do
-    {
-      // Nothing
-    } while ( dir.exists(temporaryFileName) );
-
-    return temporaryFileName;
-  }
-
 } // namespace Avogadro
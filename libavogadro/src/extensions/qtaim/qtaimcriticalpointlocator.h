@@ -64,6 +64,8 @@ namespace Avogadro {
   private:
 
     QTAIMWavefunction *m_wfn;
+    // Copy of the wavefunction handed to the worker tasks
+    QTAIMSharedWavefunction m_sharedWfn;
 
     QList<QVector3D> m_nuclearCriticalPoints;
     QList<QVector3D> m_bondCriticalPoints;
@@ -78,8 +80,6 @@ namespace Avogadro {
     QList<QVector3D> m_electronDensitySources;
     QList<QVector3D> m_electronDensitySinks;
 
-    QString temporaryFileName();
-
   };
 
 } // namespace Avogadro
@@ -38,11 +38,7 @@
 
 #include <QtCore/qglobal.h>
 #include <QDebug>
-#include <QTemporaryFile>
-#include <QFile>
 #include <QTextStream>
-#include <QDataStream>
-#include <QDir>
 
 #include <QPair>
 #include <QVariantList>
@@ -50,14 +46,20 @@
 
 #include <QList>
 #include <QtConcurrent/QtConcurrentMap>
-#include <QTemporaryFile>
-#include <QFile>
-#include <QDataStream>
-#include <QDir>
 #include <QVariant>
 #include <QProgressDialog>
 #include <QFutureWatcher>
 #include <QFuture>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QThread>
+#include <QTimer>
 
 #include <cstdio>
 #include <cstdlib>
@@ -244,6 +246,17 @@ static void destroy_region(region *R)
   R->ee = 0;
 }
 
+static region copy_region(const region *R)
+{
+  region C = make_region(&R->h, R->fdim);
+  if (C.ee) {
+    memcpy(C.ee, R->ee, sizeof(esterr) * R->fdim);
+    C.splitDim = R->splitDim;
+    C.errmax = R->errmax;
+  }
+  return C;
+}
+
 static int cut_region(region *R, region *R2)
 {
   unsigned int d = R->splitDim, dim = R->h.dim;
@@ -920,14 +933,109 @@ static heap_item heap_pop(heap *h)
 
 /***************************************************************************/
 
+/* Hooks into the adaptive integration.
+
+   When regions is set on entry, the integration resumes from the
+   nRegions regions stored there instead of starting from the whole
+   hypercube.  Each region takes REGION_SIZE(dim, fdim) doubles: its
+   center, its half-widths, the dimension to cut next and the value
+   and error of each integrand.  On return the remaining regions are
+   stored there again (allocated with malloc), so that an interrupted
+   integration can be continued later.
+
+   The integration stops when stop() returns non-zero.  The regions
+   evaluated in the interrupted round are dropped and their parents
+   put back, so the regions stored on return are always consistent.
+   progress() gets the current estimate after every round, and
+   converged tells whether the requested error was reached. */
+#define REGION_SIZE(dim, fdim) (2 * (dim) + 1 + 2 * (fdim))
+
+typedef struct
+{
+  int (*stop)(void *data);
+  void (*progress)(void *data, unsigned int numEval,
+                   unsigned int fdim, const double *val, const double *err);
+  void *data;
+  double *regions;
+  unsigned int nRegions;
+  int converged;
+} adapt_control;
+
+static int control_stop(const adapt_control *control)
+{
+  return control && control->stop && control->stop(control->data);
+}
+
+static void control_progress(const adapt_control *control,
+                             unsigned int numEval, const heap *regions,
+                             double *val, double *err)
+{
+  unsigned int j;
+  if (!control || !control->progress) return;
+  for (j = 0; j < regions->fdim; ++j) {
+    val[j] = regions->ee[j].val;
+    err[j] = regions->ee[j].err;
+  }
+  control->progress(control->data, numEval, regions->fdim, val, err);
+}
+
+static int control_restore(const adapt_control *control, const hypercube *h,
+                           unsigned int fdim, heap *regions)
+{
+  unsigned int i, j, dim = h->dim;
+  for (i = 0; i < control->nRegions; ++i) {
+    const double *data = control->regions + i * REGION_SIZE(dim, fdim);
+    region R = make_region(h, fdim);
+    if (!R.ee) return FAILURE;
+    for (j = 0; j < 2 * dim; ++j)
+      R.h.data[j] = data[j];
+    R.h.vol = compute_vol(&R.h);
+    R.splitDim = (unsigned int) data[2 * dim];
+    for (j = 0; j < fdim; ++j) {
+      R.ee[j].val = data[2 * dim + 1 + 2 * j];
+      R.ee[j].err = data[2 * dim + 2 + 2 * j];
+    }
+    R.errmax = errMax(fdim, R.ee);
+    if (heap_push(regions, R)) return FAILURE;
+  }
+  return SUCCESS;
+}
+
+static int control_save(adapt_control *control, const heap *regions)
+{
+  unsigned int i, j, dim, fdim = regions->fdim;
+  free(control->regions);
+  control->regions = NULL;
+  control->nRegions = 0;
+  if (!regions->n) return SUCCESS;
+  dim = regions->items[0].h.dim;
+  control->regions = (double *) malloc(sizeof(double) * regions->n
+                                       * REGION_SIZE(dim, fdim));
+  if (!control->regions) return FAILURE;
+  for (i = 0; i < regions->n; ++i) {
+    const region *R = &regions->items[i];
+    double *data = control->regions + i * REGION_SIZE(dim, fdim);
+    for (j = 0; j < 2 * dim; ++j)
+      data[j] = R->h.data[j];
+    data[2 * dim] = R->splitDim;
+    for (j = 0; j < fdim; ++j) {
+      data[2 * dim + 1 + 2 * j] = R->ee[j].val;
+      data[2 * dim + 2 + 2 * j] = R->ee[j].err;
+    }
+  }
+  control->nRegions = regions->n;
+  return SUCCESS;
+}
+
 /* adaptive integration, analogous to adaptintegrator.cpp in HIntLib */
 
-static int ruleadapt_integrate(rule *r, unsigned int fdim, integrand_v f, void *fdata, const hypercube *h, unsigned int maxEval, double reqAbsError, double reqRelError, double *val, double *err, int parallel)
+static int ruleadapt_integrate(rule *r, unsigned int fdim, integrand_v f, void *fdata, const hypercube *h, unsigned int maxEval, double reqAbsError, double reqRelError, double *val, double *err, int parallel, adapt_control *control)
 {
   unsigned int numEval = 0;
   heap regions;
   unsigned int i, j;
   region *R = NULL; /* array of regions to evaluate */
+  region *P = NULL; /* copies of the regions before they were cut */
   unsigned int nR_alloc = 0;
   esterr *ee = NULL;
 
@@ -939,20 +1047,38 @@ static int ruleadapt_integrate(rule *r, unsigned int fdim, integrand_v f, void *
 
   nR_alloc = 2;
   R = (region *) malloc(sizeof(region) * nR_alloc);
-  if (!R) goto bad;
-  R[0] = make_region(h, fdim);
-  if (!R[0].ee
-      || eval_regions(1, R, f, fdata, r)
-      || heap_push(&regions, R[0]))
-    goto bad;
-  numEval += r->num_points;
+  P = (region *) malloc(sizeof(region) * nR_alloc);
+  if (!R || !P) goto bad;
+  if (control) control->converged = 0;
+  if (control && control->regions && control->nRegions) {
+    if (control_restore(control, h, fdim, &regions)) goto bad;
+  }
+  else {
+    R[0] = make_region(h, fdim);
+    if (!R[0].ee
+        || eval_regions(1, R, f, fdata, r))
+      goto bad;
+    if (control_stop(control)) {
+      destroy_region(&R[0]);
+      goto done;
+    }
+    if (heap_push(&regions, R[0]))
+      goto bad;
+    numEval += r->num_points;
+  }
+  control_progress(control, numEval, &regions, val, err);
 
   while (numEval < maxEval || !maxEval) {
+    unsigned int nR = 0;
     for (j = 0; j < fdim && (regions.ee[j].err <= reqAbsError
                              || relError(regions.ee[j]) <= reqRelError);
     ++j) ;
-    if (j == fdim)
+    if (j == fdim) {
+      if (control) control->converged = 1;
       break; /* convergence */
+    }
+    if (control_stop(control))
+      break;
 
     if (parallel) { /* maximize potential parallelism */
       /* adapted from I. Gladwell, "Vectorization of one
@@ -982,16 +1108,20 @@ static int ruleadapt_integrate(rule *r, unsigned int fdim, integrand_v f, void *
       out of N is only O(K log N), much better than the
       O(N) cost of the Bull and Freeman algorithm if K <<
       N, and it is also much simpler.] */
-      unsigned int nR = 0;
       for (j = 0; j < fdim; ++j) ee[j] = regions.ee[j];
       do {
         if (nR + 2 > nR_alloc) {
           nR_alloc = (nR + 2) * 2;
           R = (region *) realloc(R, nR_alloc * sizeof(region));
-          if (!R) goto bad;
+          P = (region *) realloc(P, nR_alloc * sizeof(region));
+          if (!R || !P) goto bad;
         }
         R[nR] = heap_pop(&regions);
         for (j = 0; j < fdim; ++j) ee[j].err -= R[nR].ee[j].err;
+        if (control) {
+          P[nR / 2] = copy_region(R + nR);
+          if (!P[nR / 2].ee) goto bad;
+        }
         if (cut_region(R+nR, R+nR+1)) goto bad;
         numEval += r->num_points * 2;
         nR += 2;
@@ -1000,20 +1130,38 @@ static int ruleadapt_integrate(rule *r, unsigned int fdim, integrand_v f, void *
                  || relError(ee[j]) <= reqRelError); ++j) ;
         if (j == fdim) break; /* other regions have small errs */
       } while (regions.n > 0 && (numEval < maxEval || !maxEval));
-      if (eval_regions(nR, R, f, fdata, r)
-        || heap_push_many(&regions, nR, R))
+      if (eval_regions(nR, R, f, fdata, r))
         goto bad;
     }
     else { /* minimize number of function evaluations */
       R[0] = heap_pop(&regions); /* get worst region */
+      if (control) {
+        P[0] = copy_region(R);
+        if (!P[0].ee) goto bad;
+      }
+      nR = 2;
       if (cut_region(R, R+1)
-        || eval_regions(2, R, f, fdata, r)
-        || heap_push_many(&regions, 2, R))
+        || eval_regions(2, R, f, fdata, r))
         goto bad;
       numEval += r->num_points * 2;
     }
+
+    if (control_stop(control)) {
+      /* interrupted, the new regions may be incomplete */
+      for (i = 0; i < nR; ++i) destroy_region(&R[i]);
+      if (heap_push_many(&regions, nR / 2, P)) goto bad;
+      break;
+    }
+    if (control)
+      for (i = 0; i < nR / 2; ++i) destroy_region(&P[i]);
+    if (heap_push_many(&regions, nR, R))
+      goto bad;
+    control_progress(control, numEval, &regions, val, err);
   }
 
+  done:
+  if (control && control_save(control, &regions)) goto bad;
+
   /* re-sum integral and errors */
   for (j = 0; j < fdim; ++j) val[j] = err[j] = 0;
   for (i = 0; i < regions.n; ++i) {
@@ -1028,19 +1176,22 @@ static int ruleadapt_integrate(rule *r, unsigned int fdim, integrand_v f, void *
   free(ee);
   heap_free(&regions);
   free(R);
+  free(P);
   return SUCCESS;
 
   bad:
   free(ee);
   heap_free(&regions);
   free(R);
+  free(P);
   return FAILURE;
 }
 
 static int integrate(unsigned int fdim, integrand_v f, void *fdata,
                      unsigned int dim, const double *xmin, const double *xmax,
                      unsigned int maxEval, double reqAbsError, double reqRelError,
-                     double *val, double *err, int parallel)
+                     double *val, double *err, int parallel,
+                     adapt_control *control)
 {
   rule *r;
   hypercube h;
@@ -1066,7 +1217,7 @@ static int integrate(unsigned int fdim, integrand_v f, void *fdata,
   status = !h.data ? FAILURE
     : ruleadapt_integrate(r, fdim, f, fdata, &h,
                           maxEval, reqAbsError, reqRelError,
-                          val, err, parallel);
+                          val, err, parallel, control);
   destroy_hypercube(&h);
   destroy_rule(r);
   return status;
@@ -1078,7 +1229,17 @@ int adapt_integrate_v(unsigned int fdim, integrand_v f, void *fdata,
                       double *val, double *err)
 {
   return integrate(fdim, f, fdata, dim, xmin, xmax,
-                   maxEval, reqAbsError, reqRelError, val, err, 1);
+                   maxEval, reqAbsError, reqRelError, val, err, 1, NULL);
+}
+
+/* as adapt_integrate_v, with the hooks of control */
+static int adapt_integrate_v_control(unsigned int fdim, integrand_v f, void *fdata,
+                                     unsigned int dim, const double *xmin, const double *xmax,
+                                     unsigned int maxEval, double reqAbsError, double reqRelError,
+                                     double *val, double *err, adapt_control *control)
+{
+  return integrate(fdim, f, fdata, dim, xmin, xmax,
+                   maxEval, reqAbsError, reqRelError, val, err, 1, control);
 }
 
 /* wrapper around non-vectorized integrand */
@@ -1118,17 +1279,25 @@ int adapt_integrate(unsigned int fdim, integrand f, void *fdata,
     return -2; /* ERROR */
   }
   ret = integrate(fdim, fv, &d, dim, xmin, xmax,
-                  maxEval, reqAbsError, reqRelError, val, err, 0);
+                  maxEval, reqAbsError, reqRelError, val, err, 0, NULL);
   free(d.fval1);
   return ret;
 }
 
+// The parameters of the vectorized integrands: the parameters handed to
+// each point, and the cubature that evaluates the points
+typedef struct
+{
+  QVariantList parameters;
+  Avogadro::QTAIMCubature *cubature;
+} QTAIMBasinIntegrand;
+
 // TODO: Consider QVariantList. For now, mimic what is known to work.
 QList<QVariant> QTAIMEvaluateProperty(QList<QVariant> variantList)
 {
   /*
      Order of variantList:
-     QString wfnFileName
+     QTAIMSharedWavefunction wfn
      qreal x0
      qreal y0
      qreal z0
@@ -1150,7 +1319,7 @@ QList<QVariant> QTAIMEvaluateProperty(QList<QVariant> variantList)
      ...
   */
   qint64 counter=0;
-  QString wfnFileName=variantList.at(counter).toString(); counter++;
+  const Avogadro::QTAIMSharedWavefunction wfn=variantList.at(counter).value<Avogadro::QTAIMSharedWavefunction>(); counter++;
   qreal x0=variantList.at(counter).toReal(); counter++;
   qreal y0=variantList.at(counter).toReal(); counter++;
   qreal z0=variantList.at(counter).toReal(); counter++;
@@ -1183,10 +1352,7 @@ QList<QVariant> QTAIMEvaluateProperty(QList<QVariant> variantList)
   }
   QSet<qint64> basinSet=basinList.toSet();
 
-  Avogadro::QTAIMWavefunction wfn;
-  wfn.loadFromBinaryFile(wfnFileName);
-
-  Avogadro::QTAIMWavefunctionEvaluator eval(wfn);
+  Avogadro::QTAIMWavefunctionEvaluator &eval=Avogadro::QTAIMWavefunctionEvaluator::threadEvaluator(wfn);
 
   QList<QVariant> valueList;
 
@@ -1283,11 +1449,11 @@ void property_v(unsigned int /* ndim */, unsigned int npts, const double *xyz, v
                 unsigned int /* dim */, double *fval)
 {
 
-  QVariantList *paramVariantListPtr = (QVariantList *)param;
-  QVariantList paramVariantList=*paramVariantListPtr;
+  QTAIMBasinIntegrand *data = (QTAIMBasinIntegrand *)param;
+  const QVariantList &paramVariantList=data->parameters;
 
   qint64 counter=0;
-  QString wfnFileName=paramVariantList.at(counter).toString(); counter++;
+  const QVariant wfn=paramVariantList.at(counter); counter++;
 
   qint64 nncp=paramVariantList.at(counter).toLongLong(); counter++;
   QList<QVector3D> ncpList;
@@ -1321,7 +1487,7 @@ void property_v(unsigned int /* ndim */, unsigned int npts, const double *xyz, v
 
     QList<QVariant> variantList;
 
-    variantList.append(wfnFileName);
+    variantList.append(wfn);
 
     variantList.append(x0);
     variantList.append(y0);
@@ -1352,31 +1518,17 @@ void property_v(unsigned int /* ndim */, unsigned int npts, const double *xyz, v
 
   }
 
-  // calculate
+  // calculate, together with the points of the other basins
 
-  QProgressDialog dialog;
-  dialog.setWindowTitle("QTAIM");
-  dialog.setLabelText(QString("Atomic Basin Integration"));
-
-  QFutureWatcher<void> futureWatcher;
-  QObject::connect(&futureWatcher, SIGNAL(finished()), &dialog, SLOT(reset()));
-  QObject::connect(&dialog, SIGNAL(canceled()), &futureWatcher, SLOT(cancel()));
-  QObject::connect(&futureWatcher, SIGNAL(progressRangeChanged(int,int)), &dialog, SLOT(setRange(int,int)));
-  QObject::connect(&futureWatcher, SIGNAL(progressValueChanged(int)), &dialog, SLOT(setValue(int)));
-
-  QFuture<QList<QVariant> > future=QtConcurrent::mapped(inputList, QTAIMEvaluateProperty);
-  futureWatcher.setFuture(future);
-  dialog.exec();
-  futureWatcher.waitForFinished();
-
-  QList<QList<QVariant> > results;
-  if( futureWatcher.future().isCanceled() )
-  {
-    results.clear();
-  }
-  else
+  QList<QList<QVariant> > results=data->cubature->evaluate(QTAIMEvaluateProperty, inputList);
+  if( results.length() != (qint64) npts )
   {
-    results=future.results();
+    // canceled, this round is thrown away
+    for( qint64 i=0 ; i < npts*nmode ; ++i )
+    {
+      fval[i]=0.0;
+    }
+    return;
   }
 
   // harvest results
@@ -1397,7 +1549,7 @@ QList<QVariant> QTAIMEvaluatePropertyRTP(QList<QVariant> variantList)
 {
   /*
      Order of variantList:
-     QString wfnFileName
+     QTAIMSharedWavefunction wfn
      qreal r0
      qreal t0
      qreal p0
@@ -1419,7 +1571,7 @@ QList<QVariant> QTAIMEvaluatePropertyRTP(QList<QVariant> variantList)
      ...
   */
   qint64 counter=0;
-  QString wfnFileName=variantList.at(counter).toString(); counter++;
+  const Avogadro::QTAIMSharedWavefunction wfn=variantList.at(counter).value<Avogadro::QTAIMSharedWavefunction>(); counter++;
   qreal r0=variantList.at(counter).toReal(); counter++;
   qreal t0=variantList.at(counter).toReal(); counter++;
   qreal p0=variantList.at(counter).toReal(); counter++;
@@ -1466,10 +1618,7 @@ QList<QVariant> QTAIMEvaluatePropertyRTP(QList<QVariant> variantList)
   qreal y0=x0y0z0(1);
   qreal z0=x0y0z0(2);
 
-  Avogadro::QTAIMWavefunction wfn;
-  wfn.loadFromBinaryFile(wfnFileName);
-
-  Avogadro::QTAIMWavefunctionEvaluator eval(wfn);
+  Avogadro::QTAIMWavefunctionEvaluator &eval=Avogadro::QTAIMWavefunctionEvaluator::threadEvaluator(wfn);
 
   QList<QVariant> valueList;
 
@@ -1571,11 +1720,11 @@ void property_v_rtp(unsigned int /* ndim */, unsigned int npts, const double *xy
                     unsigned int /* fdim */, double *fval)
 {
 
-  QVariantList *paramVariantListPtr = (QVariantList *)param;
-  QVariantList paramVariantList=*paramVariantListPtr;
+  QTAIMBasinIntegrand *data = (QTAIMBasinIntegrand *)param;
+  const QVariantList &paramVariantList=data->parameters;
 
   qint64 counter=0;
-  QString wfnFileName=paramVariantList.at(counter).toString(); counter++;
+  const QVariant wfn=paramVariantList.at(counter); counter++;
 
   qint64 nncp=paramVariantList.at(counter).toLongLong(); counter++;
   QList<QVector3D> ncpList;
@@ -1609,7 +1758,7 @@ void property_v_rtp(unsigned int /* ndim */, unsigned int npts, const double *xy
 
     QList<QVariant> variantList;
 
-    variantList.append(wfnFileName);
+    variantList.append(wfn);
 
     variantList.append(x0);
     variantList.append(y0);
@@ -1640,31 +1789,17 @@ void property_v_rtp(unsigned int /* ndim */, unsigned int npts, const double *xy
 
   }
 
-  // calculate
-
-  QProgressDialog dialog;
-  dialog.setWindowTitle("QTAIM");
-  dialog.setLabelText(QString("Atomic Basin Integration"));
+  // calculate, together with the points of the other basins
 
-  QFutureWatcher<void> futureWatcher;
-  QObject::connect(&futureWatcher, SIGNAL(finished()), &dialog, SLOT(reset()));
-  QObject::connect(&dialog, SIGNAL(canceled()), &futureWatcher, SLOT(cancel()));
-  QObject::connect(&futureWatcher, SIGNAL(progressRangeChanged(int,int)), &dialog, SLOT(setRange(int,int)));
-  QObject::connect(&futureWatcher, SIGNAL(progressValueChanged(int)), &dialog, SLOT(setValue(int)));
-
-  QFuture<QList<QVariant> > future=QtConcurrent::mapped(inputList, QTAIMEvaluatePropertyRTP);
-  futureWatcher.setFuture(future);
-  dialog.exec();
-  futureWatcher.waitForFinished();
-
-  QList<QList<QVariant> > results;
-  if( futureWatcher.future().isCanceled() )
-  {
-    results.clear();
-  }
-  else
+  QList<QList<QVariant> > results=data->cubature->evaluate(QTAIMEvaluatePropertyRTP, inputList);
+  if( results.length() != (qint64) npts )
   {
-    results=future.results();
+    // canceled, this round is thrown away
+    for( qint64 i=0 ; i < npts*nmode ; ++i )
+    {
+      fval[i]=0.0;
+    }
+    return;
   }
 
   // harvest results
@@ -1689,7 +1824,7 @@ void property_r(unsigned int ndim, const double *xyz, void *param,
   QVariantList paramVariantList=*paramVariantListPtr;
 
   qint64 counter=0;
-  QString wfnFileName=paramVariantList.at(counter).toString(); counter++;
+  const Avogadro::QTAIMSharedWavefunction wfn=paramVariantList.at(counter).value<Avogadro::QTAIMSharedWavefunction>(); counter++;
 
   qreal r=xyz[0];
   qreal t=paramVariantList.at(counter).toReal(); counter++;
@@ -1728,12 +1863,8 @@ void property_r(unsigned int ndim, const double *xyz, void *param,
   qreal y=XYZ(1);
   qreal z=XYZ(2);
 
-  // This routine reads the wavefunction file repeatedly.
-  // Let's hope that this time is dwarfed by the time
-  // taken to delineate the atomic basins in the calling routine.
-  Avogadro::QTAIMWavefunction wfn;
-  wfn.loadFromBinaryFile(wfnFileName);
-  Avogadro::QTAIMWavefunctionEvaluator eval(wfn);
+  // Called from QTAIMEvaluatePropertyTP, which uses the same evaluator
+  Avogadro::QTAIMWavefunctionEvaluator &eval=Avogadro::QTAIMWavefunctionEvaluator::threadEvaluator(wfn);
 
   for(qint64 m=0; m<nmode ; ++m )
   {
@@ -1750,7 +1881,7 @@ QList<QVariant> QTAIMEvaluatePropertyTP(QList<QVariant> variantList)
 
   /*
      Order of variantList:
-     QString wfnFileName
+     QTAIMSharedWavefunction wfn
      qreal t
      qreal p
      qint64 nncp
@@ -1771,7 +1902,7 @@ QList<QVariant> QTAIMEvaluatePropertyTP(QList<QVariant> variantList)
      ...
   */
   qint64 counter=0;
-  QString wfnFileName=variantList.at(counter).toString(); counter++;
+  const Avogadro::QTAIMSharedWavefunction wfn=variantList.at(counter).value<Avogadro::QTAIMSharedWavefunction>(); counter++;
   qreal t=variantList.at(counter).toReal(); counter++;
   qreal p=variantList.at(counter).toReal(); counter++;
 
@@ -1803,9 +1934,7 @@ QList<QVariant> QTAIMEvaluatePropertyTP(QList<QVariant> variantList)
   }
   QSet<qint64> basinSet=basinList.toSet();
 
-  Avogadro::QTAIMWavefunction wfn;
-  wfn.loadFromBinaryFile(wfnFileName);
-  Avogadro::QTAIMWavefunctionEvaluator eval(wfn);
+  Avogadro::QTAIMWavefunctionEvaluator &eval=Avogadro::QTAIMWavefunctionEvaluator::threadEvaluator(wfn);
 
   // Set up steepest ascent integrator and beta spheres
   QList<QPair<QVector3D,qreal> > betaSpheres;
@@ -2042,7 +2171,7 @@ QList<QVariant> QTAIMEvaluatePropertyTP(QList<QVariant> variantList)
   xmax[0] = rf;
 
   QVariantList paramVariantList;
-  paramVariantList.append(wfnFileName);
+  paramVariantList.append(QVariant::fromValue(wfn));
   paramVariantList.append(t);
   paramVariantList.append(p);
   paramVariantList.append(ncpList.length()); // number of nuclear critical points
@@ -2083,11 +2212,11 @@ void property_v_tp(unsigned int /* ndim */, unsigned int npts, const double *xyz
                    unsigned int /* fdim */, double *fval)
 {
 
-  QVariantList *paramVariantListPtr = (QVariantList *)param;
-  QVariantList paramVariantList=*paramVariantListPtr;
+  QTAIMBasinIntegrand *data = (QTAIMBasinIntegrand *)param;
+  const QVariantList &paramVariantList=data->parameters;
 
   qint64 counter=0;
-  QString wfnFileName=paramVariantList.at(counter).toString(); counter++;
+  const QVariant wfn=paramVariantList.at(counter); counter++;
 
   qint64 nncp=paramVariantList.at(counter).toLongLong(); counter++;
   QList<QVector3D> ncpList;
@@ -2120,7 +2249,7 @@ void property_v_tp(unsigned int /* ndim */, unsigned int npts, const double *xyz
 
     QList<QVariant> variantList;
 
-    variantList.append(wfnFileName);
+    variantList.append(wfn);
 
     variantList.append(t);
     variantList.append(p);
@@ -2150,31 +2279,17 @@ void property_v_tp(unsigned int /* ndim */, unsigned int npts, const double *xyz
 
   }
 
-  // calculate
-
-  QProgressDialog dialog;
-  dialog.setWindowTitle("QTAIM");
-  dialog.setLabelText(QString("Atomic Basin Integration"));
-
-  QFutureWatcher<void> futureWatcher;
-  QObject::connect(&futureWatcher, SIGNAL(finished()), &dialog, SLOT(reset()));
-  QObject::connect(&dialog, SIGNAL(canceled()), &futureWatcher, SLOT(cancel()));
-  QObject::connect(&futureWatcher, SIGNAL(progressRangeChanged(int,int)), &dialog, SLOT(setRange(int,int)));
-  QObject::connect(&futureWatcher, SIGNAL(progressValueChanged(int)), &dialog, SLOT(setValue(int)));
+  // calculate, together with the points of the other basins
 
-  QFuture<QList<QVariant> > future=QtConcurrent::mapped(inputList, QTAIMEvaluatePropertyTP);
-  futureWatcher.setFuture(future);
-  dialog.exec();
-  futureWatcher.waitForFinished();
-
-  QList<QList<QVariant> > results;
-  if( futureWatcher.future().isCanceled() )
-  {
-    results.clear();
-  }
-  else
+  QList<QList<QVariant> > results=data->cubature->evaluate(QTAIMEvaluatePropertyTP, inputList);
+  if( results.length() != (qint64) npts )
   {
-    results=future.results();
+    // canceled, this round is thrown away
+    for( qint64 i=0 ; i < npts*nmode ; ++i )
+    {
+      fval[i]=0.0;
+    }
+    return;
   }
 
   // harvest results
@@ -2191,13 +2306,16 @@ void property_v_tp(unsigned int /* ndim */, unsigned int npts, const double *xyz
 namespace Avogadro
 {
 
-  QTAIMCubature::QTAIMCubature(QTAIMWavefunction &wfn)
+  // Version of the checkpoint files
+  const quint32 CHECKPOINT_MAGIC=0x5154434b;
+  const qint32 CHECKPOINT_VERSION=1;
+
+  QTAIMCubature::QTAIMCubature(QTAIMWavefunction &wfn) : m_mode(0), m_canceled(0)
   {
 
     m_wfn=&wfn;
 
-    m_temporaryFileName=QTAIMCubature::temporaryFileName();
-    m_wfn->saveToBinaryFile(m_temporaryFileName);
+    m_sharedWfn=QTAIMSharedWavefunction(new QTAIMWavefunction(wfn));
 
     // Instantiate a Critical Point Locator
     QTAIMCriticalPointLocator cpl(wfn);
@@ -2208,6 +2326,24 @@ namespace Avogadro
     // QLists of results
     m_ncpList=cpl.nuclearCriticalPoints();
 
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const qint64 nuclei=wfn.numberOfNuclei();
+    const qint64 primitives=wfn.numberOfGaussianPrimitives();
+    const qint64 orbitals=wfn.numberOfMolecularOrbitals();
+    hash.addData( (const char *) wfn.xNuclearCoordinates(), nuclei*sizeof(qreal) );
+    hash.addData( (const char *) wfn.yNuclearCoordinates(), nuclei*sizeof(qreal) );
+    hash.addData( (const char *) wfn.zNuclearCoordinates(), nuclei*sizeof(qreal) );
+    hash.addData( (const char *) wfn.gaussianPrimitiveExponentCoefficients(), primitives*sizeof(qreal) );
+    hash.addData( (const char *) wfn.molecularOrbitalOccupationNumbers(), orbitals*sizeof(qreal) );
+    hash.addData( (const char *) wfn.molecularOrbitalCoefficients(), orbitals*primitives*sizeof(qreal) );
+    m_fingerprint=hash.result();
+
+    m_checkpointFileName=QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+                         + "/qtaim/" + QString(m_fingerprint.toHex()) + ".chk";
+
+    // Enough basins in flight to keep the global pool busy
+    m_basinPool.setMaxThreadCount( QThread::idealThreadCount() );
+
   }
 
   QList<QPair<qreal,qreal> > QTAIMCubature::integrate(qint64 mode, QList<qint64> basins )
@@ -2215,8 +2351,104 @@ namespace Avogadro
 
     QList<QPair<qreal,qreal> > value;
 
-    m_mode=mode;
     m_basins=basins;
+    m_canceled.store(0);
+
+    if( !m_checkpointFileName.isEmpty() )
+    {
+      loadCheckpoint(m_checkpointFileName);
+    }
+
+    // The saved states are those of another property
+    if( mode != m_mode )
+    {
+      QMutexLocker locker(&m_mutex);
+      m_states.clear();
+    }
+    m_mode=mode;
+
+    QList<QFuture<void> > futures;
+    for( qint64 i=0 ; i < m_basins.length() ; ++i )
+    {
+      futures.append( QtConcurrent::run(&m_basinPool, this, &QTAIMCubature::integrateBasin, m_basins.at(i)) );
+    }
+
+    // calculate
+
+    QProgressDialog dialog;
+    dialog.setWindowTitle("QTAIM");
+    dialog.setLabelText(progressText());
+    dialog.setRange(0, m_basins.length());
+    QObject::connect(&dialog, &QProgressDialog::canceled, [this]() { cancel(); });
+
+    QTimer timer;
+    QObject::connect(&timer, &QTimer::timeout, [&]()
+    {
+      qint64 finished=0;
+      for( qint64 i=0 ; i < futures.length() ; ++i )
+      {
+        if( futures.at(i).isFinished() )
+        {
+          ++finished;
+        }
+      }
+      dialog.setLabelText(progressText());
+      if( finished == futures.length() )
+      {
+        dialog.reset();
+      }
+      else
+      {
+        dialog.setValue(finished);
+      }
+    });
+    timer.start(250);
+    dialog.exec();
+    timer.stop();
+
+    // canceled or done
+    m_basinPool.waitForDone();
+
+    if( !m_checkpointFileName.isEmpty() )
+    {
+      QDir().mkpath( QFileInfo(m_checkpointFileName).absolutePath() );
+      saveCheckpoint(m_checkpointFileName);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    for( qint64 i=0 ; i < m_basins.length() ; ++i)
+    {
+      const BasinState state=m_states.value(m_basins.at(i));
+
+      qDebug() <<"basin=" << m_basins.at(i) + 1 <<  "value= " << state.value << "err=" << state.error
+              << (state.converged ? "" : "not converged");
+
+      QPair<qreal,qreal> thisPair;
+      thisPair.first=state.value;
+      thisPair.second=state.error;
+
+      value.append(thisPair);
+
+    }
+
+    return value;
+
+  }
+
+  void QTAIMCubature::integrateBasin(qint64 basin)
+  {
+
+    BasinState state;
+    {
+      QMutexLocker locker(&m_mutex);
+      state=m_states.value(basin);
+      if( state.converged || isCanceled() )
+      {
+        return;
+      }
+      state.running=true;
+      m_states.insert(basin, state);
+    }
 
     double tol=1.e-2;
     unsigned int maxEval=0;
@@ -2230,169 +2462,302 @@ namespace Avogadro
     val = (double *) malloc(sizeof(double) * fdim);
     err = (double *) malloc(sizeof(double) * fdim);
 
-    for( qint64 i=0 ; i < m_basins.length() ; ++i)
+    QTAIMBasinIntegrand data;
+    data.cubature=this;
+    data.parameters.append(QVariant::fromValue(m_sharedWfn));
+
+    data.parameters.append(m_ncpList.length()); // number of nuclear critical points
+    for( qint64 j=0 ; j < m_ncpList.length() ; ++j)
     {
-      if(threeDimensionalIntegration)
-      {
+      data.parameters.append(m_ncpList.at(j).x() );
+      data.parameters.append(m_ncpList.at(j).y() );
+      data.parameters.append(m_ncpList.at(j).z() );
+    }
+    data.parameters.append(0); // mode
+    data.parameters.append( basin ); // basin
+
+    BasinTask task;
+    task.cubature=this;
+    task.basin=basin;
+
+    // Resume from the saved regions
+    adapt_control control;
+    control.stop=basinCanceled;
+    control.progress=basinProgress;
+    control.data=&task;
+    control.nRegions=0;
+    control.regions=NULL;
+    control.converged=0;
+
+    unsigned int dim=threeDimensionalIntegration ? 3 : 2;
+    if( state.regions.size() > 0 )
+    {
+      control.nRegions=state.regions.size() / REGION_SIZE(dim, fdim);
+      control.regions=(double *) malloc(sizeof(double) * state.regions.size());
+      memcpy(control.regions, state.regions.constData(), sizeof(double) * state.regions.size());
+    }
 
-        unsigned int dim=3;
+    double *xmin;
+    double *xmax;
+    xmin = (double *) malloc(dim * sizeof(double));
+    xmax = (double *) malloc(dim * sizeof(double));
 
-        double *xmin;
-        double *xmax;
-        xmin = (double *) malloc(dim * sizeof(double));
-        xmax = (double *) malloc(dim * sizeof(double));
+    const qreal pi=4.0*atan(1.0);
 
-        if(cartesianIntegrationLimits)
-        {
+    if(threeDimensionalIntegration)
+    {
+      if(cartesianIntegrationLimits)
+      {
 
-          // shift origin of the integration to the nuclear coordinates of the ith nucleus.
-
-          xmin[0]= -8. + m_ncpList.at(i).x();
-          xmax[0]=  8. + m_ncpList.at(i).x();
-          xmin[1]= -8. + m_ncpList.at(i).y();
-          xmax[1]=  8. + m_ncpList.at(i).y();
-          xmin[2]= -8. + m_ncpList.at(i).z();
-          xmax[2]=  8. + m_ncpList.at(i).z();
-
-          QVariantList paramVariantList;
-          paramVariantList.append(m_temporaryFileName);
-
-          paramVariantList.append(m_ncpList.length()); // number of nuclear critical points
-          for( qint64 j=0 ; j < m_ncpList.length() ; ++j)
-          {
-            paramVariantList.append(m_ncpList.at(j).x() );
-            paramVariantList.append(m_ncpList.at(j).y() );
-            paramVariantList.append(m_ncpList.at(j).z() );
-          }
-          paramVariantList.append(0); // mode
-          paramVariantList.append( basins.at(i) ); // basin
-
-          adapt_integrate_v(fdim, property_v, &paramVariantList,
-                            dim, xmin, xmax,
-                            maxEval, tol, 0,
-                            val, err);
+        // shift origin of the integration to the nuclear coordinates of the ith nucleus.
 
-        }
-        else
-        {
-          const qreal pi=4.0*atan(1.0);
-
-          xmin[0]=  0.;
-          xmax[0]=  8.;
-          xmin[1]=  0.;
-          xmax[1]=  pi;
-          xmin[2]=  0.;
-          xmax[2]=  2.0*pi;
-
-          QVariantList paramVariantList;
-          paramVariantList.append(m_temporaryFileName);
-
-          paramVariantList.append(m_ncpList.length()); // number of nuclear critical points
-          for( qint64 j=0 ; j < m_ncpList.length() ; ++j)
-          {
-            paramVariantList.append(m_ncpList.at(j).x() );
-            paramVariantList.append(m_ncpList.at(j).y() );
-            paramVariantList.append(m_ncpList.at(j).z() );
-          }
-          paramVariantList.append(0); // mode
-          paramVariantList.append( basins.at(i) ); // basin
-
-          adapt_integrate_v(fdim, property_v_rtp, &paramVariantList,
-                            dim, xmin, xmax,
-                            maxEval, tol, 0,
-                            val, err);
-        }
+        xmin[0]= -8. + m_ncpList.at(basin).x();
+        xmax[0]=  8. + m_ncpList.at(basin).x();
+        xmin[1]= -8. + m_ncpList.at(basin).y();
+        xmax[1]=  8. + m_ncpList.at(basin).y();
+        xmin[2]= -8. + m_ncpList.at(basin).z();
+        xmax[2]=  8. + m_ncpList.at(basin).z();
 
-        free(xmin);
-        free(xmax);
+        adapt_integrate_v_control(fdim, property_v, &data,
+                                  dim, xmin, xmax,
+                                  maxEval, tol, 0,
+                                  val, err, &control);
 
       }
       else
       {
-        unsigned int dim=2;
+        xmin[0]=  0.;
+        xmax[0]=  8.;
+        xmin[1]=  0.;
+        xmax[1]=  pi;
+        xmin[2]=  0.;
+        xmax[2]=  2.0*pi;
+
+        adapt_integrate_v_control(fdim, property_v_rtp, &data,
+                                  dim, xmin, xmax,
+                                  maxEval, tol, 0,
+                                  val, err, &control);
+      }
+    }
+    else
+    {
+      xmin[0]=  0.;
+      xmax[0]=  pi;
+      xmin[1]=  0.;
+      xmax[1]=  2.0*pi;
+
+      adapt_integrate_v_control(fdim, property_v_tp, &data,
+                                dim, xmin, xmax,
+                                maxEval, tol, 0,
+                                val, err, &control);
+    }
 
-        double *xmin;
-        double *xmax;
-        xmin = (double *) malloc(dim * sizeof(double));
-        xmax = (double *) malloc(dim * sizeof(double));
+    free(xmin);
+    free(xmax);
 
-        const qreal pi=4.0*atan(1.0);
+    state.regions.resize(control.nRegions * REGION_SIZE(dim, fdim));
+    if( control.regions )
+    {
+      memcpy(state.regions.data(), control.regions, sizeof(double) * state.regions.size());
+    }
+    free(control.regions);
 
-        xmin[0]=  0.;
-        xmax[0]=  pi;
-        xmin[1]=  0.;
-        xmax[1]=  2.0*pi;
+    {
+      QMutexLocker locker(&m_mutex);
+      state.evaluations=m_states.value(basin).evaluations;
+      state.value=val[0];
+      state.error=err[0];
+      state.running=false;
+      state.converged=control.converged;
+      m_states.insert(basin, state);
+    }
 
-        QVariantList paramVariantList;
-        paramVariantList.append(m_temporaryFileName);
+    free(val);
+    free(err);
 
-        paramVariantList.append(m_ncpList.length()); // number of nuclear critical points
-        for( qint64 j=0 ; j < m_ncpList.length() ; ++j)
-        {
-          paramVariantList.append(m_ncpList.at(j).x() );
-          paramVariantList.append(m_ncpList.at(j).y() );
-          paramVariantList.append(m_ncpList.at(j).z() );
-        }
-        paramVariantList.append(0); // mode
-        paramVariantList.append( basins.at(i) ); // basin
+  }
 
-        adapt_integrate_v(fdim, property_v_tp, &paramVariantList,
-                          dim, xmin, xmax,
-                          maxEval, tol, 0,
-                          val, err);
+  int QTAIMCubature::basinCanceled(void *data)
+  {
+    BasinTask *task=(BasinTask *)data;
+    return task->cubature->isCanceled();
+  }
 
-        free(xmin);
-        free(xmax);
+  void QTAIMCubature::basinProgress(void *data, unsigned int numEval,
+                                    unsigned int /* fdim */, const double *val, const double *err)
+  {
+    BasinTask *task=(BasinTask *)data;
+    QMutexLocker locker(&task->cubature->m_mutex);
+    BasinState &state=task->cubature->m_states[task->basin];
+    state.value=val[0];
+    state.error=err[0];
+    state.evaluations=numEval;
+  }
 
+  QString QTAIMCubature::progressText() const
+  {
+    QMutexLocker locker(&m_mutex);
+
+    qint64 converged=0;
+    QString running;
+    for( qint64 i=0 ; i < m_basins.length() ; ++i )
+    {
+      const BasinState state=m_states.value(m_basins.at(i));
+      if( state.converged )
+      {
+        ++converged;
+      }
+      else if( state.running )
+      {
+        running += QString("\nBasin %1: %2 (error %3)")
+                   .arg(m_basins.at(i) + 1)
+                   .arg(state.value, 0, 'f', 6)
+                   .arg(state.error, 0, 'e', 2);
       }
+    }
 
-      qDebug() <<"basin=" << basins.at(i) + 1 <<  "value= " << val[0] << "err=" << err[0];
+    return QString("Atomic Basin Integration\n%1 of %2 basins converged")
+        .arg(converged).arg(m_basins.length()) + running;
+  }
 
-      QPair<qreal,qreal> thisPair;
-      thisPair.first=val[0];
-      thisPair.second=err[0];
+  QList<QList<QVariant> > QTAIMCubature::evaluate(QList<QVariant> (*kernel)(QList<QVariant>),
+                                                   const QList<QList<QVariant> > &inputList)
+  {
+    QFuture<QList<QVariant> > future;
+    {
+      QMutexLocker locker(&m_mutex);
+      if( isCanceled() )
+      {
+        return QList<QList<QVariant> >();
+      }
+      future=QtConcurrent::mapped(inputList, kernel);
+      m_futures.append(future);
+    }
 
-      value.append(thisPair);
+    // Runs the points itself if the pool has not started them yet
+    future.waitForFinished();
 
+    {
+      QMutexLocker locker(&m_mutex);
+      m_futures.removeOne(future);
     }
 
-    free(val);
-    free(err);
+    if( future.isCanceled() )
+    {
+      return QList<QList<QVariant> >();
+    }
+    return future.results();
+  }
 
-    return value;
+  void QTAIMCubature::cancel()
+  {
+    QMutexLocker locker(&m_mutex);
+    m_canceled.store(1);
+    for( qint64 i=0 ; i < m_futures.length() ; ++i )
+    {
+      m_futures[i].cancel();
+    }
+  }
 
+  bool QTAIMCubature::isCanceled() const
+  {
+    return m_canceled.load() != 0;
   }
 
-  QTAIMCubature::~QTAIMCubature()
+  bool QTAIMCubature::isConverged(qint64 basin) const
+  {
+    QMutexLocker locker(&m_mutex);
+    return m_states.value(basin).converged;
+  }
+
+  void QTAIMCubature::setCheckpointFileName(const QString &fileName)
+  {
+    m_checkpointFileName=fileName;
+  }
+
+  bool QTAIMCubature::saveCheckpoint(const QString &fileName) const
   {
-    if( QFile::exists(m_temporaryFileName) )
+    QFile file(fileName);
+    if( !file.open(QIODevice::WriteOnly) )
+    {
+      return false;
+    }
+
+    QDataStream out(&file);
+    out << CHECKPOINT_MAGIC << CHECKPOINT_VERSION;
+    out << m_fingerprint;
+
+    QMutexLocker locker(&m_mutex);
+    out << m_mode;
+    out << (qint64) m_states.size();
+    QMap<qint64,BasinState>::const_iterator it;
+    for( it=m_states.constBegin() ; it != m_states.constEnd() ; ++it )
     {
-      QFile::remove(m_temporaryFileName);
+      out << it.key();
+      out << it.value().regions;
+      out << it.value().value << it.value().error;
+      out << it.value().evaluations;
+      out << it.value().converged;
     }
+
+    return out.status() == QDataStream::Ok;
   }
 
-  void QTAIMCubature::setMode(qint64 mode)
+  bool QTAIMCubature::loadCheckpoint(const QString &fileName)
   {
+    QFile file(fileName);
+    if( !file.open(QIODevice::ReadOnly) )
+    {
+      return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic;
+    qint32 version;
+    QByteArray fingerprint;
+    in >> magic >> version >> fingerprint;
+    if( magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION
+        || fingerprint != m_fingerprint )
+    {
+      return false;
+    }
+
+    qint64 mode;
+    qint64 nbasins;
+    in >> mode >> nbasins;
+
+    QMap<qint64,BasinState> states;
+    for( qint64 i=0 ; i < nbasins && in.status() == QDataStream::Ok ; ++i )
+    {
+      qint64 basin;
+      BasinState state;
+      in >> basin;
+      in >> state.regions;
+      in >> state.value >> state.error;
+      in >> state.evaluations;
+      in >> state.converged;
+      states.insert(basin, state);
+    }
+    if( in.status() != QDataStream::Ok )
+    {
+      return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
     m_mode=mode;
+    m_states=states;
+    return true;
   }
 
-  QString QTAIMCubature::temporaryFileName()
+  QTAIMCubature::~QTAIMCubature()
   {
-    QTemporaryFile temporaryFile;
-    temporaryFile.open();
-    QString temporaryFileName=temporaryFile.fileName();
-    temporaryFile.close();
-    temporaryFile.remove();
-
-    // wait for temporary file to be deleted
-    QDir dir;
-    do
-    {
-      // Nothing
-    } while ( dir.exists(temporaryFileName) );
-
-    return temporaryFileName;
+    cancel();
+    m_basinPool.waitForDone();
   }
 
+  void QTAIMCubature::setMode(qint64 mode)
+  {
+    m_mode=mode;
+  }
 
 }
@@ -56,6 +56,15 @@
 #define QTAIMCUBATURE_H
 
 #include <QPair>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QFuture>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QThreadPool>
+#include <QVariant>
+#include <QVector>
 
 //#ifdef __cplusplus
 //extern "C"
@@ -114,6 +123,18 @@ int adapt_integrate_v(unsigned int fdim, integrand_v f, void *fdata,
 namespace Avogadro
 {
 
+  /**
+   * Integrates a property over the atomic basins.
+   *
+   * All basins are integrated at the same time. Each basin refines its
+   * own regions, and the cubature points of all of them are evaluated on
+   * the global thread pool, so that cores left idle by a basin waiting for
+   * its last points are used by the others.
+   *
+   * The integration can be canceled, and the state of each basin, converged
+   * or not, is kept in a checkpoint file so that the next integration of
+   * the same wavefunction resumes where this one stopped.
+   */
   class QTAIMCubature
   {
   public:
@@ -126,20 +147,102 @@ namespace Avogadro
     explicit QTAIMCubature(QTAIMWavefunction &wfn);
     ~QTAIMCubature();
 
+    /**
+     * Integrate @p mode over @p basins, showing the convergence of each
+     * basin in a progress dialog.
+     * @return The value and error estimate of each basin. If the
+     * integration was canceled, these are the partial results.
+     */
     QList<QPair<qreal,qreal> > integrate(qint64 mode, QList<qint64> basins );
 
     void setMode(qint64 mode);
 
+    /**
+     * Stop the integration as soon as possible. Safe to call from any
+     * thread.
+     */
+    void cancel();
+    bool isCanceled() const;
+
+    /**
+     * @return True if @p basin reached the requested error.
+     */
+    bool isConverged(qint64 basin) const;
+
+    /**
+     * The checkpoint is read at the start of integrate() and written when
+     * it finishes. By default it is kept in the cache directory, named
+     * after the wavefunction. An empty name disables checkpoints.
+     */
+    void setCheckpointFileName(const QString &fileName);
+    QString checkpointFileName() const { return m_checkpointFileName; }
+
+    bool saveCheckpoint(const QString &fileName) const;
+
+    /**
+     * @return False if there is no checkpoint in @p fileName for this
+     * wavefunction.
+     */
+    bool loadCheckpoint(const QString &fileName);
+
+    /**
+     * Evaluate @p kernel for each input on the global thread pool, used by
+     * the integrands. Returns an empty list if the integration is canceled.
+     */
+    QList<QList<QVariant> > evaluate(QList<QVariant> (*kernel)(QList<QVariant>),
+                                     const QList<QList<QVariant> > &inputList);
+
   private:
+    // The state of the integration of one basin
+    struct BasinState
+    {
+      BasinState() : value(0.0), error(0.0), evaluations(0),
+        running(false), converged(false) {}
+
+      QVector<double> regions; // the regions left to refine
+      qreal value;
+      qreal error;
+      qint64 evaluations;
+      bool running;
+      bool converged;
+    };
+
+    // What the integration callbacks need to know
+    struct BasinTask
+    {
+      QTAIMCubature *cubature;
+      qint64 basin;
+    };
+
+    void integrateBasin(qint64 basin);
+    QString progressText() const;
+
+    static int basinCanceled(void *data);
+    static void basinProgress(void *data, unsigned int numEval,
+                              unsigned int fdim, const double *val, const double *err);
+
     QTAIMWavefunction *m_wfn;
     qint64 m_mode;
     QList<qint64> m_basins;
 
-    QString m_temporaryFileName;
-    QString temporaryFileName();
+    // Copy of the wavefunction handed to the worker tasks
+    QTAIMSharedWavefunction m_sharedWfn;
 
     QList<QVector3D> m_ncpList;
 
+    // Identifies the wavefunction in checkpoints
+    QByteArray m_fingerprint;
+    QString m_checkpointFileName;
+
+    mutable QMutex m_mutex;
+    QMap<qint64,BasinState> m_states;
+    QList<QFuture<QList<QVariant> > > m_futures;
+    QAtomicInt m_canceled;
+
+    // Runs one integrateBasin() per basin, these mostly wait for points
+    QThreadPool m_basinPool;
+
+    Q_DISABLE_COPY(QTAIMCubature)
   };
 
 } /* namespace Avogadro */
@@ -36,6 +36,8 @@
 
 #include <QVariant>
 #include <QVariantList>
+#include <QSharedPointer>
+#include <QMetaType>
 
 #include <avogadro/molecule.h>
 
@@ -196,6 +198,15 @@ namespace Avogadro
 
   };
 
+  /**
+   * A wavefunction shared read-only by the worker tasks of the critical
+   * point search and the basin integration. Copying a QTAIMWavefunction
+   * only shares its arrays, so wrapping a copy is cheap.
+   */
+  typedef QSharedPointer<const QTAIMWavefunction> QTAIMSharedWavefunction;
+
 } // namespace Avogadro
 
+Q_DECLARE_METATYPE(Avogadro::QTAIMSharedWavefunction)
+
 #endif // QTAIMWAVEFUNCTION_H
@@ -23,38 +23,43 @@
  **********************************************************************/
 
 #include <cmath>
+#include <algorithm>
 
 #include "qtaimwavefunctionevaluator.h"
 
+#include <QThreadStorage>
+
 namespace Avogadro
 {
-  QTAIMWavefunctionEvaluator::QTAIMWavefunctionEvaluator(QTAIMWavefunction &wfn)
+  QTAIMWavefunctionEvaluator::QTAIMWavefunctionEvaluator(const QTAIMWavefunction &wfn) :
+    m_nmo(wfn.numberOfMolecularOrbitals()),
+    m_nprim(wfn.numberOfGaussianPrimitives()),
+    m_nnuc(wfn.numberOfNuclei()),
+    m_nucxcoord(wfn.xNuclearCoordinates(),m_nnuc),
+    m_nucycoord(wfn.yNuclearCoordinates(),m_nnuc),
+    m_nuczcoord(wfn.zNuclearCoordinates(),m_nnuc),
+    m_nucz(wfn.nuclearCharges(),m_nnuc),
+    m_X0(wfn.xGaussianPrimitiveCenterCoordinates(),m_nprim,1),
+    m_Y0(wfn.yGaussianPrimitiveCenterCoordinates(),m_nprim,1),
+    m_Z0(wfn.zGaussianPrimitiveCenterCoordinates(),m_nprim,1),
+    m_xamom(wfn.xGaussianPrimitiveAngularMomenta(),m_nprim,1),
+    m_yamom(wfn.yGaussianPrimitiveAngularMomenta(),m_nprim,1),
+    m_zamom(wfn.zGaussianPrimitiveAngularMomenta(),m_nprim,1),
+    m_alpha(wfn.gaussianPrimitiveExponentCoefficients(),m_nprim,1),
+    // TODO Implement screening for unoccupied molecular orbitals.
+    m_occno(wfn.molecularOrbitalOccupationNumbers(),m_nmo,1),
+    m_orbe(wfn.molecularOrbitalEigenvalues(),m_nmo,1),
+    m_coef(wfn.molecularOrbitalCoefficients(),m_nmo,m_nprim)
   {
 
-    m_nmo=wfn.numberOfMolecularOrbitals();
-    m_nprim=wfn.numberOfGaussianPrimitives();
-    m_nnuc=wfn.numberOfNuclei();
-
-    m_nucxcoord=Map<const Matrix<qreal,Dynamic,1> >(wfn.xNuclearCoordinates(),m_nnuc);
-    m_nucycoord=Map<const Matrix<qreal,Dynamic,1> >(wfn.yNuclearCoordinates(),m_nnuc);
-    m_nuczcoord=Map<const Matrix<qreal,Dynamic,1> >(wfn.zNuclearCoordinates(),m_nnuc);
-    m_nucz=Map<const Matrix<qint64,Dynamic,1> >(wfn.nuclearCharges(),m_nnuc);
-    m_X0=Map<const Matrix<qreal,Dynamic,1> >(wfn.xGaussianPrimitiveCenterCoordinates(),m_nprim,1);
-    m_Y0=Map<const Matrix<qreal,Dynamic,1> >(wfn.yGaussianPrimitiveCenterCoordinates(),m_nprim,1);
-    m_Z0=Map<const Matrix<qreal,Dynamic,1> >(wfn.zGaussianPrimitiveCenterCoordinates(),m_nprim,1);
-    m_xamom=Map<const Matrix<qint64,Dynamic,1> >(wfn.xGaussianPrimitiveAngularMomenta(),m_nprim,1);
-    m_yamom=Map<const Matrix<qint64,Dynamic,1> >(wfn.yGaussianPrimitiveAngularMomenta(),m_nprim,1);
-    m_zamom=Map<const Matrix<qint64,Dynamic,1> >(wfn.zGaussianPrimitiveAngularMomenta(),m_nprim,1);
-    m_alpha=Map<const Matrix<qreal,Dynamic,1> >(wfn.gaussianPrimitiveExponentCoefficients(),m_nprim,1);
-    // TODO Implement screening for unoccupied molecular orbitals.
-    m_occno=Map<const Matrix<qreal,Dynamic,1> >(wfn.molecularOrbitalOccupationNumbers(),m_nmo,1);
-    m_orbe=Map<const Matrix<qreal,Dynamic,1> >(wfn.molecularOrbitalEigenvalues(),m_nmo,1);
-    m_coef=Map<const Matrix<qreal,Dynamic,Dynamic,RowMajor> >(wfn.molecularOrbitalCoefficients(),m_nmo,m_nprim);
     m_totalEnergy=wfn.totalEnergy();
     m_virialRatio=wfn.virialRatio();
 
     m_cutoff=log(1.e-15);
 
+    m_grouped=false;
+    m_maxamom=0;
+
     m_cdg000.resize(m_nmo);
     m_cdg100.resize(m_nmo);
     m_cdg010.resize(m_nmo);
@@ -92,6 +97,27 @@ namespace Avogadro
     m_cdg004.resize(m_nmo);
   }
 
+  QTAIMWavefunctionEvaluator::QTAIMWavefunctionEvaluator(const QTAIMSharedWavefunction &wfn) :
+    QTAIMWavefunctionEvaluator(*wfn)
+  {
+    m_wfn=wfn;
+  }
+
+  QTAIMWavefunctionEvaluator &QTAIMWavefunctionEvaluator::threadEvaluator(const QTAIMSharedWavefunction &wfn)
+  {
+    static QThreadStorage<QTAIMWavefunctionEvaluator *> evaluators;
+
+    QTAIMWavefunctionEvaluator *eval=evaluators.localData();
+    if( !eval || eval->m_wfn != wfn )
+    {
+      // The previous evaluator, and its wavefunction, are released
+      eval=new QTAIMWavefunctionEvaluator(wfn);
+      evaluators.setLocalData(eval);
+    }
+
+    return *eval;
+  }
+
   qreal QTAIMWavefunctionEvaluator::molecularOrbital( const qint64 mo, const Matrix<qreal,3,1> xyz )
   {
 
@@ -126,538 +152,280 @@ namespace Avogadro
 
   qreal QTAIMWavefunctionEvaluator::electronDensity( const Matrix<qreal,3,1> xyz )
   {
+    evaluateMolecularOrbitals(xyz,0);
 
-    qreal value;
+    return m_occno.dot( m_orbitals.col(0).cwiseAbs2() );
+  }
 
-    m_cdg000.setZero();
-    for( qint64 p=0 ; p < m_nprim ; ++p )
-    {
-      qreal xx0 = xyz(0) - m_X0(p);
-      qreal yy0 = xyz(1) - m_Y0(p);
-      qreal zz0 = xyz(2) - m_Z0(p);
+  const Matrix<qreal,3,1> QTAIMWavefunctionEvaluator::gradientOfElectronDensity(Matrix<qreal,3,1> xyz)
+  {
+    evaluateMolecularOrbitals(xyz,1);
 
-      qreal b0arg = -m_alpha(p)*(xx0*xx0 + yy0*yy0 + zz0*zz0 );
+    return gradientFromMolecularOrbitals(0,1);
+  }
 
-      if( b0arg > m_cutoff )
-      {
-        qreal ax0 = ipow( xx0, m_xamom(p) );
-        qreal ay0 = ipow( yy0, m_yamom(p) );
-        qreal az0 = ipow( zz0, m_zamom(p) );
+  const Matrix<qreal,3,3> QTAIMWavefunctionEvaluator::hessianOfElectronDensity( const Matrix<qreal,3,1> xyz )
+  {
+    evaluateMolecularOrbitals(xyz,2);
 
-        qreal b0 = exp(b0arg);
+    return hessianFromMolecularOrbitals(0,1);
+  }
 
-        qreal dg000 = ax0*ay0*az0*b0;
+  const Matrix<qreal,3,4> QTAIMWavefunctionEvaluator::gradientAndHessianOfElectronDensity( const Matrix<qreal,3,1> xyz )
+  {
+    evaluateMolecularOrbitals(xyz,2);
 
-        for( qint64 m=0 ; m < m_nmo ; ++m )
-        {
-          m_cdg000(m) += m_coef(m,p) * dg000;
-        }
+    Matrix<qreal,3,4> value;
+    value.col(0)=gradientFromMolecularOrbitals(0,1);
+    value.rightCols<3>()=hessianFromMolecularOrbitals(0,1);
 
-      }
-    }
+    return value;
+  }
 
-    value=0.0;
-    for( qint64 m=0 ; m < m_nmo ; ++m )
+  const Matrix<qreal,Dynamic,1> QTAIMWavefunctionEvaluator::electronDensities( const Matrix<qreal,3,Dynamic> &xyz )
+  {
+    // Small blocks of points keep the intermediate matrices in cache
+    const qint64 blockSize=64;
+
+    Matrix<qreal,Dynamic,1> value(xyz.cols());
+    for( qint64 start=0 ; start < xyz.cols() ; start += blockSize )
     {
-      value += m_occno(m)*ipow(m_cdg000(m),2);
+      const qint64 npts=std::min(blockSize, (qint64) xyz.cols() - start);
+      evaluateMolecularOrbitals(xyz.middleCols(start,npts),0);
+      value.segment(start,npts)=m_orbitals.cwiseAbs2().transpose()*m_occno;
     }
 
     return value;
-
   }
 
-  const Matrix<qreal,3,1> QTAIMWavefunctionEvaluator::gradientOfElectronDensity(Matrix<qreal,3,1> xyz)
+  const Matrix<qreal,3,Dynamic> QTAIMWavefunctionEvaluator::gradientsOfElectronDensity( const Matrix<qreal,3,Dynamic> &xyz )
   {
+    const qint64 blockSize=64;
 
-    Matrix<qreal,3,1> value;
-
-    const qreal zero=0.0;
-    const qreal one =1.0;
-
-    m_cdg000.setZero();
-    m_cdg100.setZero();
-    m_cdg010.setZero();
-    m_cdg001.setZero();
-    for( qint64 p=0 ; p < m_nprim ; ++p )
+    Matrix<qreal,3,Dynamic> value(3,xyz.cols());
+    for( qint64 start=0 ; start < xyz.cols() ; start += blockSize )
     {
-      qreal xx0 = xyz(0) - m_X0(p);
-      qreal yy0 = xyz(1) - m_Y0(p);
-      qreal zz0 = xyz(2) - m_Z0(p);
-
-      qreal b0arg = -m_alpha(p)*(xx0*xx0 + yy0*yy0 + zz0*zz0 );
-
-      if( b0arg > m_cutoff )
+      const qint64 npts=std::min(blockSize, (qint64) xyz.cols() - start);
+      evaluateMolecularOrbitals(xyz.middleCols(start,npts),1);
+      for( qint64 i=0 ; i < npts ; ++i )
       {
-        qint64 aax0=1;
-        qint64 aay0=1;
-        qint64 aaz0=1;
-        qint64 aax1=m_xamom(p);
-        qint64 aay1=m_yamom(p);
-        qint64 aaz1=m_zamom(p);
-
-        qreal ax0 = aax0*ipow( xx0, m_xamom(p) );
-        qreal ay0 = aay0*ipow( yy0, m_yamom(p) );
-        qreal az0 = aaz0*ipow( zz0, m_zamom(p) );
-
-        qreal ax1;
-        qreal ay1;
-        qreal az1;
-        if     ( m_xamom(p) <  1 )
-        {
-          ax1=zero;
-        }
-        else if( m_xamom(p) == 1 )
-        {
-          ax1=one;
-        }
-        else
-        {
-          ax1=aax1*ipow(xx0,m_xamom(p)-1);
-        }
-
-        if     ( m_yamom(p) <  1 )
-        {
-          ay1=zero;
-        }
-        else if( m_yamom(p) == 1 )
-        {
-          ay1=one;
-        }
-        else
-        {
-          ay1=aay1*ipow(yy0,m_yamom(p)-1);
-        }
-
-        if     ( m_zamom(p) <  1 )
-        {
-          az1=zero;
-        }
-        else if( m_zamom(p) == 1 )
-        {
-          az1=one;
-        }
-        else
-        {
-          az1=aaz1*ipow(zz0,m_zamom(p)-1);
-        }
-
-        qreal b0 = exp(b0arg);
-
-        qreal bx1= -2*m_alpha(p)*xx0;
-        qreal by1= -2*m_alpha(p)*yy0;
-        qreal bz1= -2*m_alpha(p)*zz0;
-
-        qreal dg000 = ax0*ay0*az0*b0;
-        qreal dg100 = ay0*az0*b0*(ax1+ax0*bx1);
-        qreal dg010 = ax0*az0*b0*(ay1+ay0*by1);
-        qreal dg001 = ax0*ay0*b0*(az1+az0*bz1);
-
-        for( qint64 m=0 ; m < m_nmo ; ++m )
-        {
-          m_cdg000(m) += m_coef(m,p) * dg000;
-          m_cdg100(m) += m_coef(m,p) * dg100;
-          m_cdg010(m) += m_coef(m,p) * dg010;
-          m_cdg001(m) += m_coef(m,p) * dg001;
-        }
-
+        value.col(start+i)=gradientFromMolecularOrbitals(i,npts);
       }
     }
 
-    value.setZero();
-    for( qint64 m=0 ; m < m_nmo ; ++m )
-    {
-      value(0) += m_occno(m)*m_cdg100(m)*m_cdg000(m);
-      value(1) += m_occno(m)*m_cdg010(m)*m_cdg000(m);
-      value(2) += m_occno(m)*m_cdg001(m)*m_cdg000(m);
-    }
-
     return value;
-
   }
 
-  const Matrix<qreal,3,3> QTAIMWavefunctionEvaluator::hessianOfElectronDensity( const Matrix<qreal,3,1> xyz )
+  void QTAIMWavefunctionEvaluator::groupPrimitives()
   {
-
-    Matrix<qreal,3,3> value;
-
-    const qreal zero=0.0;
-    const qreal one =1.0;
-
-    m_cdg000.setZero();
-    m_cdg100.setZero();
-    m_cdg010.setZero();
-    m_cdg001.setZero();
-    m_cdg200.setZero();
-    m_cdg020.setZero();
-    m_cdg002.setZero();
-    m_cdg110.setZero();
-    m_cdg101.setZero();
-    m_cdg011.setZero();
+    std::vector<qint64> order(m_nprim);
     for( qint64 p=0 ; p < m_nprim ; ++p )
     {
-      qreal xx0 = xyz(0) - m_X0(p);
-      qreal yy0 = xyz(1) - m_Y0(p);
-      qreal zz0 = xyz(2) - m_Z0(p);
-
-      qreal b0arg = -m_alpha(p)*(xx0*xx0 + yy0*yy0 + zz0*zz0 );
+      order[p]=p;
+    }
 
-      if( b0arg > m_cutoff )
+    // Sort by center, then by exponent and angular momentum so that the
+    // primitives of a shell are next to each other and share the exponential
+    std::sort(order.begin(), order.end(), [this](qint64 a, qint64 b)
+    {
+      if( m_X0(a) != m_X0(b) ) return m_X0(a) < m_X0(b);
+      if( m_Y0(a) != m_Y0(b) ) return m_Y0(a) < m_Y0(b);
+      if( m_Z0(a) != m_Z0(b) ) return m_Z0(a) < m_Z0(b);
+      if( m_alpha(a) != m_alpha(b) ) return m_alpha(a) < m_alpha(b);
+      if( m_xamom(a) != m_xamom(b) ) return m_xamom(a) < m_xamom(b);
+      if( m_yamom(a) != m_yamom(b) ) return m_yamom(a) < m_yamom(b);
+      if( m_zamom(a) != m_zamom(b) ) return m_zamom(a) < m_zamom(b);
+      return a < b;
+    });
+
+    m_groupedXamom.resize(m_nprim);
+    m_groupedYamom.resize(m_nprim);
+    m_groupedZamom.resize(m_nprim);
+    m_groupedAlpha.resize(m_nprim);
+    m_groupedCoef.resize(m_nmo,m_nprim);
+
+    std::vector<qint64> centerStart;
+    std::vector<qreal> centerAlpha;
+    m_maxamom=0;
+    for( qint64 q=0 ; q < m_nprim ; ++q )
+    {
+      const qint64 p=order[q];
+      if( q == 0 || m_X0(p) != m_X0(order[q-1]) || m_Y0(p) != m_Y0(order[q-1])
+          || m_Z0(p) != m_Z0(order[q-1]) )
       {
-        qint64 aax0=1;
-        qint64 aay0=1;
-        qint64 aaz0=1;
-        qint64 aax1=m_xamom(p);
-        qint64 aay1=m_yamom(p);
-        qint64 aaz1=m_zamom(p);
-        qint64 aax2=m_xamom(p)*(m_xamom(p)-1);
-        qint64 aay2=m_yamom(p)*(m_yamom(p)-1);
-        qint64 aaz2=m_zamom(p)*(m_zamom(p)-1);
-
-        qreal ax0 = aax0*ipow( xx0, m_xamom(p) );
-        qreal ay0 = aay0*ipow( yy0, m_yamom(p) );
-        qreal az0 = aaz0*ipow( zz0, m_zamom(p) );
-
-        qreal ax1;
-        qreal ay1;
-        qreal az1;
-        if     ( m_xamom(p) <  1 )
-        {
-          ax1=zero;
-        }
-        else if( m_xamom(p) == 1 )
-        {
-          ax1=one;
-        }
-        else
-        {
-          ax1=aax1*ipow(xx0,m_xamom(p)-1);
-        }
-
-        if     ( m_yamom(p) <  1 )
-        {
-          ay1=zero;
-        }
-        else if( m_yamom(p) == 1 )
-        {
-          ay1=one;
-        }
-        else
-        {
-          ay1=aay1*ipow(yy0,m_yamom(p)-1);
-        }
-
-        if     ( m_zamom(p) <  1 )
-        {
-          az1=zero;
-        }
-        else if( m_zamom(p) == 1 )
-        {
-          az1=one;
-        }
-        else
-        {
-          az1=aaz1*ipow(zz0,m_zamom(p)-1);
-        }
-
-        qreal ax2;
-        qreal ay2;
-        qreal az2;
-        if     ( m_xamom(p) <  2 )
-        {
-          ax2=zero;
-        }
-        else if( m_xamom(p) == 2 )
-        {
-          ax2=one;
-        }
-        else
-        {
-          ax2=aax2*ipow(xx0,m_xamom(p)-2);
-        }
-
-        if     ( m_yamom(p) <  2 )
-        {
-          ay2=zero;
-        }
-        else if( m_yamom(p) == 2 )
-        {
-          ay2=one;
-        }
-        else
-        {
-          ay2=aay2*ipow(yy0,m_yamom(p)-2);
-        }
-
-        if     ( m_zamom(p) <  2 )
-        {
-          az2=zero;
-        }
-        else if( m_zamom(p) == 2 )
-        {
-          az2=one;
-        }
-        else
-        {
-          az2=aaz2*ipow(zz0,m_zamom(p)-2);
-        }
-
-        qreal b0 = exp(b0arg);
-
-        qreal bx1 = -2*m_alpha(p)*xx0;
-        qreal by1 = -2*m_alpha(p)*yy0;
-        qreal bz1 = -2*m_alpha(p)*zz0;
-        qreal bx2 = -2*m_alpha(p) + 4*(ipow(m_alpha(p),2) * ipow(xx0,2));
-        qreal by2 = -2*m_alpha(p) + 4*(ipow(m_alpha(p),2) * ipow(yy0,2));
-        qreal bz2 = -2*m_alpha(p) + 4*(ipow(m_alpha(p),2) * ipow(zz0,2));
-
-        qreal dg000 = ax0*ay0*az0*b0;
-        qreal dg100 = ay0*az0*b0*(ax1+ax0*bx1);
-        qreal dg010 = ax0*az0*b0*(ay1+ay0*by1);
-        qreal dg001 = ax0*ay0*b0*(az1+az0*bz1);
-        qreal dg200 = ay0*az0*b0*(ax2+2*ax1*bx1+ax0*bx2);
-        qreal dg020 = ax0*az0*b0*(ay2+2*ay1*by1+ay0*by2);
-        qreal dg002 = ax0*ay0*b0*(az2+2*az1*bz1+az0*bz2);
-        qreal dg110 = az0*b0*(ax1+ax0*bx1)*(ay1+ay0*by1);
-        qreal dg101 = ay0*b0*(ax1+ax0*bx1)*(az1+az0*bz1);
-        qreal dg011 = ax0*b0*(ay1+ay0*by1)*(az1+az0*bz1);
-
-        for( qint64 m=0 ; m < m_nmo ; ++m )
-        {
-          m_cdg000(m) += m_coef(m,p) * dg000;
-          m_cdg100(m) += m_coef(m,p) * dg100;
-          m_cdg010(m) += m_coef(m,p) * dg010;
-          m_cdg001(m) += m_coef(m,p) * dg001;
-          m_cdg200(m) += m_coef(m,p) * dg200;
-          m_cdg020(m) += m_coef(m,p) * dg020;
-          m_cdg002(m) += m_coef(m,p) * dg002;
-          m_cdg110(m) += m_coef(m,p) * dg110;
-          m_cdg101(m) += m_coef(m,p) * dg101;
-          m_cdg011(m) += m_coef(m,p) * dg011;
-        }
-
+        centerStart.push_back(q);
+        centerAlpha.push_back(m_alpha(p));
       }
+      centerAlpha.back()=std::min(centerAlpha.back(), m_alpha(p));
+
+      m_groupedXamom(q)=m_xamom(p);
+      m_groupedYamom(q)=m_yamom(p);
+      m_groupedZamom(q)=m_zamom(p);
+      m_groupedAlpha(q)=m_alpha(p);
+      m_groupedCoef.col(q)=m_coef.col(p);
+      m_maxamom=std::max(m_maxamom, std::max(m_xamom(p), std::max(m_yamom(p), m_zamom(p))));
     }
 
-    value.setZero();
-    for( qint64 m=0 ; m < m_nmo ; ++m )
+    const qint64 ncenters=centerStart.size();
+    m_centers.resize(3,ncenters);
+    m_centerStart.resize(ncenters+1);
+    m_centerRadius2.resize(ncenters);
+    for( qint64 c=0 ; c < ncenters ; ++c )
     {
-      value(0,0) += 2*m_occno(m)*(ipow(m_cdg100(m),2)+m_cdg000(m)*m_cdg200(m));
-      value(1,1) += 2*m_occno(m)*(ipow(m_cdg010(m),2)+m_cdg000(m)*m_cdg020(m));
-      value(2,2) += 2*m_occno(m)*(ipow(m_cdg001(m),2)+m_cdg000(m)*m_cdg002(m));
-      value(0,1) += 2*m_occno(m)*(m_cdg100(m)*m_cdg010(m)+m_cdg000(m)*m_cdg110(m));
-      value(0,2) += 2*m_occno(m)*(m_cdg100(m)*m_cdg001(m)+m_cdg000(m)*m_cdg101(m));
-      value(1,2) += 2*m_occno(m)*(m_cdg010(m)*m_cdg001(m)+m_cdg000(m)*m_cdg011(m));
+      const qint64 p=order[centerStart[c]];
+      m_centers.col(c) << m_X0(p), m_Y0(p), m_Z0(p);
+      m_centerStart(c)=centerStart[c];
+      // Beyond this distance even the most diffuse primitive is cut off
+      m_centerRadius2(c)= centerAlpha[c] > 0.0 ? m_cutoff/(-centerAlpha[c]) : HUGE_VAL;
     }
-    value(1,0)=value(0,1);
-    value(2,0)=value(0,2);
-    value(2,1)=value(1,2);
-
-    return value;
+    m_centerStart(ncenters)=m_nprim;
 
+    m_grouped=true;
   }
 
-  const Matrix<qreal,3,4> QTAIMWavefunctionEvaluator::gradientAndHessianOfElectronDensity( const Matrix<qreal,3,1> xyz )
+  void QTAIMWavefunctionEvaluator::evaluateMolecularOrbitals( const Matrix<qreal,3,Dynamic> &xyz, qint64 order )
   {
+    if( !m_grouped )
+    {
+      groupPrimitives();
+    }
 
-    Matrix<qreal,3,1> gValue;
-    Matrix<qreal,3,3> hValue;
-    Matrix<qreal,3,4> value;
+    const qint64 npts=xyz.cols();
+    const qint64 ncomp= order < 1 ? 1 : ( order < 2 ? 4 : 10 );
 
-    const qreal zero=0.0;
-    const qreal one =1.0;
+    m_orbitals.setZero(m_nmo,ncomp*npts);
 
-    m_cdg000.setZero();
-    m_cdg100.setZero();
-    m_cdg010.setZero();
-    m_cdg001.setZero();
-    m_cdg200.setZero();
-    m_cdg020.setZero();
-    m_cdg002.setZero();
-    m_cdg110.setZero();
-    m_cdg101.setZero();
-    m_cdg011.setZero();
-    for( qint64 p=0 ; p < m_nprim ; ++p )
+    Matrix<qreal,Dynamic,3> powers(m_maxamom+1,3);
+    for( qint64 c=0 ; c < m_centers.cols() ; ++c )
     {
-      qreal xx0 = xyz(0) - m_X0(p);
-      qreal yy0 = xyz(1) - m_Y0(p);
-      qreal zz0 = xyz(2) - m_Z0(p);
-
-      qreal b0arg = -m_alpha(p)*(xx0*xx0 + yy0*yy0 + zz0*zz0 );
+      const qint64 start=m_centerStart(c);
+      const qint64 nprim=m_centerStart(c+1)-start;
 
-      if( b0arg > m_cutoff )
+      bool nearby=false;
+      m_primitives.setZero(nprim,ncomp*npts);
+      for( qint64 i=0 ; i < npts ; ++i )
       {
-        qint64 aax0=1;
-        qint64 aay0=1;
-        qint64 aaz0=1;
-        qint64 aax1=m_xamom(p);
-        qint64 aay1=m_yamom(p);
-        qint64 aaz1=m_zamom(p);
-        qint64 aax2=m_xamom(p)*(m_xamom(p)-1);
-        qint64 aay2=m_yamom(p)*(m_yamom(p)-1);
-        qint64 aaz2=m_zamom(p)*(m_zamom(p)-1);
-
-        qreal ax0 = aax0*ipow( xx0, m_xamom(p) );
-        qreal ay0 = aay0*ipow( yy0, m_yamom(p) );
-        qreal az0 = aaz0*ipow( zz0, m_zamom(p) );
-
-        qreal ax1;
-        qreal ay1;
-        qreal az1;
-        if     ( m_xamom(p) <  1 )
-        {
-          ax1=zero;
-        }
-        else if( m_xamom(p) == 1 )
-        {
-          ax1=one;
-        }
-        else
-        {
-          ax1=aax1*ipow(xx0,m_xamom(p)-1);
-        }
-
-        if     ( m_yamom(p) <  1 )
-        {
-          ay1=zero;
-        }
-        else if( m_yamom(p) == 1 )
-        {
-          ay1=one;
-        }
-        else
-        {
-          ay1=aay1*ipow(yy0,m_yamom(p)-1);
-        }
-
-        if     ( m_zamom(p) <  1 )
-        {
-          az1=zero;
-        }
-        else if( m_zamom(p) == 1 )
-        {
-          az1=one;
-        }
-        else
-        {
-          az1=aaz1*ipow(zz0,m_zamom(p)-1);
-        }
-
-        qreal ax2;
-        qreal ay2;
-        qreal az2;
-        if     ( m_xamom(p) <  2 )
-        {
-          ax2=zero;
-        }
-        else if( m_xamom(p) == 2 )
-        {
-          ax2=one;
-        }
-        else
-        {
-          ax2=aax2*ipow(xx0,m_xamom(p)-2);
+        const Matrix<qreal,3,1> d=xyz.col(i)-m_centers.col(c);
+        const qreal r2=d.squaredNorm();
+        if( r2 >= m_centerRadius2(c) )
+        {
+          continue;
+        }
+        nearby=true;
+
+        powers.row(0).setOnes();
+        for( qint64 k=1 ; k <= m_maxamom ; ++k )
+        {
+          powers.row(k)=powers.row(k-1).cwiseProduct(d.transpose());
+        }
+
+        qreal lastAlpha=-1.0;
+        qreal b0=0.0;
+        for( qint64 q=0 ; q < nprim ; ++q )
+        {
+          const qreal alpha=m_groupedAlpha(start+q);
+          const qreal b0arg=-alpha*r2;
+          if( b0arg <= m_cutoff )
+          {
+            // The exponents increase within a center
+            break;
+          }
+          if( alpha != lastAlpha )
+          {
+            b0=exp(b0arg);
+            lastAlpha=alpha;
+          }
+
+          const qint64 l=m_groupedXamom(start+q);
+          const qint64 m=m_groupedYamom(start+q);
+          const qint64 n=m_groupedZamom(start+q);
+
+          const qreal ax0=powers(l,0);
+          const qreal ay0=powers(m,1);
+          const qreal az0=powers(n,2);
+
+          m_primitives(q,i)=ax0*ay0*az0*b0;
+          if( order < 1 )
+          {
+            continue;
+          }
+
+          const qreal ax1= l > 0 ? l*powers(l-1,0) : 0.0;
+          const qreal ay1= m > 0 ? m*powers(m-1,1) : 0.0;
+          const qreal az1= n > 0 ? n*powers(n-1,2) : 0.0;
+
+          const qreal bx1=-2*alpha*d(0);
+          const qreal by1=-2*alpha*d(1);
+          const qreal bz1=-2*alpha*d(2);
+
+          const qreal fx=ax1+ax0*bx1;
+          const qreal fy=ay1+ay0*by1;
+          const qreal fz=az1+az0*bz1;
+
+          m_primitives(q,  npts+i)=ay0*az0*b0*fx;
+          m_primitives(q,2*npts+i)=ax0*az0*b0*fy;
+          m_primitives(q,3*npts+i)=ax0*ay0*b0*fz;
+          if( order < 2 )
+          {
+            continue;
+          }
+
+          // Same factors as the scalar routines, which take 1 for the
+          // second derivative of the square
+          const qreal ax2= l > 2 ? l*(l-1)*powers(l-2,0) : ( l == 2 ? 1.0 : 0.0 );
+          const qreal ay2= m > 2 ? m*(m-1)*powers(m-2,1) : ( m == 2 ? 1.0 : 0.0 );
+          const qreal az2= n > 2 ? n*(n-1)*powers(n-2,2) : ( n == 2 ? 1.0 : 0.0 );
+
+          const qreal bx2=-2*alpha+4*alpha*alpha*d(0)*d(0);
+          const qreal by2=-2*alpha+4*alpha*alpha*d(1)*d(1);
+          const qreal bz2=-2*alpha+4*alpha*alpha*d(2)*d(2);
+
+          m_primitives(q,4*npts+i)=ay0*az0*b0*(ax2+2*ax1*bx1+ax0*bx2);
+          m_primitives(q,5*npts+i)=ax0*az0*b0*(ay2+2*ay1*by1+ay0*by2);
+          m_primitives(q,6*npts+i)=ax0*ay0*b0*(az2+2*az1*bz1+az0*bz2);
+          m_primitives(q,7*npts+i)=az0*b0*fx*fy;
+          m_primitives(q,8*npts+i)=ay0*b0*fx*fz;
+          m_primitives(q,9*npts+i)=ax0*b0*fy*fz;
         }
-
-        if     ( m_yamom(p) <  2 )
-        {
-          ay2=zero;
-        }
-        else if( m_yamom(p) == 2 )
-        {
-          ay2=one;
-        }
-        else
-        {
-          ay2=aay2*ipow(yy0,m_yamom(p)-2);
-        }
-
-        if     ( m_zamom(p) <  2 )
-        {
-          az2=zero;
-        }
-        else if( m_zamom(p) == 2 )
-        {
-          az2=one;
-        }
-        else
-        {
-          az2=aaz2*ipow(zz0,m_zamom(p)-2);
-        }
-
-        qreal b0 = exp(b0arg);
-
-        qreal bx1 = -2*m_alpha(p)*xx0;
-        qreal by1 = -2*m_alpha(p)*yy0;
-        qreal bz1 = -2*m_alpha(p)*zz0;
-        qreal bx2 = -2*m_alpha(p) + 4*(ipow(m_alpha(p),2) * ipow(xx0,2));
-        qreal by2 = -2*m_alpha(p) + 4*(ipow(m_alpha(p),2) * ipow(yy0,2));
-        qreal bz2 = -2*m_alpha(p) + 4*(ipow(m_alpha(p),2) * ipow(zz0,2));
-
-        qreal dg000 = ax0*ay0*az0*b0;
-        qreal dg100 = ay0*az0*b0*(ax1+ax0*bx1);
-        qreal dg010 = ax0*az0*b0*(ay1+ay0*by1);
-        qreal dg001 = ax0*ay0*b0*(az1+az0*bz1);
-        qreal dg200 = ay0*az0*b0*(ax2+2*ax1*bx1+ax0*bx2);
-        qreal dg020 = ax0*az0*b0*(ay2+2*ay1*by1+ay0*by2);
-        qreal dg002 = ax0*ay0*b0*(az2+2*az1*bz1+az0*bz2);
-        qreal dg110 = az0*b0*(ax1+ax0*bx1)*(ay1+ay0*by1);
-        qreal dg101 = ay0*b0*(ax1+ax0*bx1)*(az1+az0*bz1);
-        qreal dg011 = ax0*b0*(ay1+ay0*by1)*(az1+az0*bz1);
-
-        for( qint64 m=0 ; m < m_nmo ; ++m )
-        {
-          m_cdg000(m) += m_coef(m,p) * dg000;
-          m_cdg100(m) += m_coef(m,p) * dg100;
-          m_cdg010(m) += m_coef(m,p) * dg010;
-          m_cdg001(m) += m_coef(m,p) * dg001;
-          m_cdg200(m) += m_coef(m,p) * dg200;
-          m_cdg020(m) += m_coef(m,p) * dg020;
-          m_cdg002(m) += m_coef(m,p) * dg002;
-          m_cdg110(m) += m_coef(m,p) * dg110;
-          m_cdg101(m) += m_coef(m,p) * dg101;
-          m_cdg011(m) += m_coef(m,p) * dg011;
-        }
-
       }
-    }
 
-    gValue.setZero();
-    for( qint64 m=0 ; m < m_nmo ; ++m )
-    {
-      gValue(0) += m_occno(m)*m_cdg100(m)*m_cdg000(m);
-      gValue(1) += m_occno(m)*m_cdg010(m)*m_cdg000(m);
-      gValue(2) += m_occno(m)*m_cdg001(m)*m_cdg000(m);
+      if( nearby )
+      {
+        m_orbitals.noalias() += m_groupedCoef.middleCols(start,nprim)*m_primitives;
+      }
     }
+  }
 
-    hValue.setZero();
-    for( qint64 m=0 ; m < m_nmo ; ++m )
-    {
-      hValue(0,0) += 2*m_occno(m)*(ipow(m_cdg100(m),2)+m_cdg000(m)*m_cdg200(m));
-      hValue(1,1) += 2*m_occno(m)*(ipow(m_cdg010(m),2)+m_cdg000(m)*m_cdg020(m));
-      hValue(2,2) += 2*m_occno(m)*(ipow(m_cdg001(m),2)+m_cdg000(m)*m_cdg002(m));
-      hValue(0,1) += 2*m_occno(m)*(m_cdg100(m)*m_cdg010(m)+m_cdg000(m)*m_cdg110(m));
-      hValue(0,2) += 2*m_occno(m)*(m_cdg100(m)*m_cdg001(m)+m_cdg000(m)*m_cdg101(m));
-      hValue(1,2) += 2*m_occno(m)*(m_cdg010(m)*m_cdg001(m)+m_cdg000(m)*m_cdg011(m));
-    }
-    hValue(1,0)=hValue(0,1);
-    hValue(2,0)=hValue(0,2);
-    hValue(2,1)=hValue(1,2);
+  const Matrix<qreal,3,1> QTAIMWavefunctionEvaluator::gradientFromMolecularOrbitals( qint64 i, qint64 npts ) const
+  {
+    Matrix<qreal,Dynamic,1> weighted=m_occno.cwiseProduct(m_orbitals.col(i));
 
-    value(0,0) = gValue(0);
-    value(1,0) = gValue(1);
-    value(2,0) = gValue(2);
-    value(0,1) = hValue(0,0);
-    value(1,1) = hValue(1,0);
-    value(2,1) = hValue(2,0);
-    value(0,2) = hValue(0,1);
-    value(1,2) = hValue(1,1);
-    value(2,2) = hValue(2,1);
-    value(0,3) = hValue(0,2);
-    value(1,3) = hValue(1,2);
-    value(2,3) = hValue(2,2);
+    Matrix<qreal,3,1> value;
+    value(0)=weighted.dot(m_orbitals.col(  npts+i));
+    value(1)=weighted.dot(m_orbitals.col(2*npts+i));
+    value(2)=weighted.dot(m_orbitals.col(3*npts+i));
 
     return value;
+  }
+
+  const Matrix<qreal,3,3> QTAIMWavefunctionEvaluator::hessianFromMolecularOrbitals( qint64 i, qint64 npts ) const
+  {
+    Matrix<qreal,Dynamic,1> weighted=m_occno.cwiseProduct(m_orbitals.col(i));
+    Matrix<qreal,Dynamic,3> gradients(m_nmo,3);
+    gradients << m_orbitals.col(npts+i), m_orbitals.col(2*npts+i), m_orbitals.col(3*npts+i);
+
+    Matrix<qreal,3,3> value=gradients.transpose()*m_occno.asDiagonal()*gradients;
+    value(0,0) += weighted.dot(m_orbitals.col(4*npts+i));
+    value(1,1) += weighted.dot(m_orbitals.col(5*npts+i));
+    value(2,2) += weighted.dot(m_orbitals.col(6*npts+i));
+    value(0,1) += weighted.dot(m_orbitals.col(7*npts+i));
+    value(0,2) += weighted.dot(m_orbitals.col(8*npts+i));
+    value(1,2) += weighted.dot(m_orbitals.col(9*npts+i));
+    value(1,0)=value(0,1);
+    value(2,0)=value(0,2);
+    value(2,1)=value(1,2);
 
+    return 2*value;
   }
 
   qreal QTAIMWavefunctionEvaluator::laplacianOfElectronDensity( const Matrix<qreal,3,1> xyz )
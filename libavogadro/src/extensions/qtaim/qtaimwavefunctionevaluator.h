@@ -26,7 +26,22 @@ namespace Avogadro
   public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-    explicit QTAIMWavefunctionEvaluator(QTAIMWavefunction &wfn);
+    /**
+     * The evaluator reads the arrays of @p wfn in place, which must outlive
+     * it and stay unchanged.
+     */
+    explicit QTAIMWavefunctionEvaluator(const QTAIMWavefunction &wfn);
+    /**
+     * The evaluator keeps a reference to @p wfn.
+     */
+    explicit QTAIMWavefunctionEvaluator(const QTAIMSharedWavefunction &wfn);
+
+    /**
+     * @return An evaluator of @p wfn owned by the calling thread. Tasks
+     * running one after the other in a worker thread reuse it, so the
+     * scratch space is only allocated once per thread.
+     */
+    static QTAIMWavefunctionEvaluator &threadEvaluator(const QTAIMSharedWavefunction &wfn);
 
     qreal molecularOrbital(const qint64 mo, const Matrix<qreal,3,1> xyz);
     qreal electronDensity(const Matrix<qreal,3,1> xyz);
@@ -42,25 +57,35 @@ namespace Avogadro
     qreal kineticEnergyDensityK(const Matrix<qreal,3,1> xyz);
     const Matrix<qreal,3,3> quantumStressTensor(const Matrix<qreal,3,1> xyz);
 
+    /**
+     * Evaluate the electron density or its gradient at all the columns of
+     * @p xyz at once. The primitives are grouped by center, centers far
+     * from all the points are skipped, and the molecular orbitals are
+     * formed with one matrix product per center.
+     */
+    const Matrix<qreal,Dynamic,1> electronDensities(const Matrix<qreal,3,Dynamic> &xyz);
+    const Matrix<qreal,3,Dynamic> gradientsOfElectronDensity(const Matrix<qreal,3,Dynamic> &xyz);
+
   private:
     qint64 m_nmo;
     qint64 m_nprim;
     qint64 m_nnuc;
     //    qint64 m_noccmo; // number of (significantly) occupied molecular orbitals
-    Matrix<qreal,Dynamic,1> m_nucxcoord;
-    Matrix<qreal,Dynamic,1> m_nucycoord;
-    Matrix<qreal,Dynamic,1> m_nuczcoord;
-    Matrix<qint64,Dynamic,1> m_nucz;
-    Matrix<qreal,Dynamic,1> m_X0;
-    Matrix<qreal,Dynamic,1> m_Y0;
-    Matrix<qreal,Dynamic,1> m_Z0;
-    Matrix<qint64,Dynamic,1> m_xamom;
-    Matrix<qint64,Dynamic,1> m_yamom;
-    Matrix<qint64,Dynamic,1> m_zamom;
-    Matrix<qreal,Dynamic,1> m_alpha;
-    Matrix<qreal,Dynamic,1> m_occno;
-    Matrix<qreal,Dynamic,1> m_orbe;
-    Matrix<qreal,Dynamic,Dynamic,RowMajor> m_coef;
+    QTAIMSharedWavefunction m_wfn;
+    Map<const Matrix<qreal,Dynamic,1> > m_nucxcoord;
+    Map<const Matrix<qreal,Dynamic,1> > m_nucycoord;
+    Map<const Matrix<qreal,Dynamic,1> > m_nuczcoord;
+    Map<const Matrix<qint64,Dynamic,1> > m_nucz;
+    Map<const Matrix<qreal,Dynamic,1> > m_X0;
+    Map<const Matrix<qreal,Dynamic,1> > m_Y0;
+    Map<const Matrix<qreal,Dynamic,1> > m_Z0;
+    Map<const Matrix<qint64,Dynamic,1> > m_xamom;
+    Map<const Matrix<qint64,Dynamic,1> > m_yamom;
+    Map<const Matrix<qint64,Dynamic,1> > m_zamom;
+    Map<const Matrix<qreal,Dynamic,1> > m_alpha;
+    Map<const Matrix<qreal,Dynamic,1> > m_occno;
+    Map<const Matrix<qreal,Dynamic,1> > m_orbe;
+    Map<const Matrix<qreal,Dynamic,Dynamic,RowMajor> > m_coef;
     qreal m_totalEnergy;
     qreal m_virialRatio;
 
@@ -102,6 +127,30 @@ namespace Avogadro
     Matrix<qreal,Dynamic,1> m_cdg013;
     Matrix<qreal,Dynamic,1> m_cdg004;
 
+    void groupPrimitives();
+    void evaluateMolecularOrbitals(const Matrix<qreal,3,Dynamic> &xyz, qint64 order);
+    const Matrix<qreal,3,1> gradientFromMolecularOrbitals(qint64 i, qint64 npts) const;
+    const Matrix<qreal,3,3> hessianFromMolecularOrbitals(qint64 i, qint64 npts) const;
+
+    // The primitives sorted by center and angular momentum, set up on first
+    // use of evaluateMolecularOrbitals()
+    bool m_grouped;
+    qint64 m_maxamom;
+    Matrix<qreal,3,Dynamic> m_centers;
+    Matrix<qint64,Dynamic,1> m_centerStart;
+    Matrix<qreal,Dynamic,1> m_centerRadius2;
+    Matrix<qint64,Dynamic,1> m_groupedXamom;
+    Matrix<qint64,Dynamic,1> m_groupedYamom;
+    Matrix<qint64,Dynamic,1> m_groupedZamom;
+    Matrix<qreal,Dynamic,1> m_groupedAlpha;
+    Matrix<qreal,Dynamic,Dynamic> m_groupedCoef;
+
+    // Primitives and molecular orbitals at the points, the derivatives of
+    // point i in columns i + k*npts in the order 000, 100, 010, 001, 200,
+    // 020, 002, 110, 101, 011
+    Matrix<qreal,Dynamic,Dynamic> m_primitives;
+    Matrix<qreal,Dynamic,Dynamic> m_orbitals;
+
     static inline qreal ipow(qreal a, qint64 n)
     {
       return (qreal) pow( a, (int) n );
@@ -176,8 +176,8 @@ namespace Avogadro {
     if (ok && !pattern.isEmpty()) {
       OBSmartsPattern smarts;
       smarts.Init(pattern.toStdString());
-      OpenBabel::OBMol obmol = m_molecule->OBMol();
-      smarts.Match(obmol);
+      QSharedPointer<OpenBabel::OBMol> obmol = m_molecule->OBMolSnapshot();
+      smarts.Match(*obmol);
 
       // if we have matches, select them
       if(smarts.NumMatches() != 0) {
@@ -188,7 +188,7 @@ namespace Avogadro {
         vector<int>::iterator j; // atom ids in each match
         for (i = mapList.begin(); i != mapList.end(); ++i) {
           for (j = i->begin(); j != i->end(); ++j) {
-            matchedAtoms.append(m_molecule->atom(obmol.GetAtom(*j)->GetIdx()-1));
+            matchedAtoms.append(m_molecule->atom(obmol->GetAtom(*j)->GetIdx()-1));
           }
         }
 
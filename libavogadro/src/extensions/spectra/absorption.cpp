@@ -74,9 +74,9 @@ void OrcaAbsSpectra::readSettings() {
 
 bool OrcaAbsSpectra::checkForData(Molecule * mol) {
 
-    OpenBabel::OBMol obmol = mol->OBMol();
+    QSharedPointer<OpenBabel::OBMol> obmol = mol->OBMolSnapshot();
     //OpenBabel::OBOrcaSpecData *osd = static_cast<OpenBabel::OBOrcaSpecData*>(obmol.GetData("OrcaSpectraData"));
-    OpenBabel::OBOrcaSpecData *osd = static_cast<OpenBabel::OBOrcaSpecData*>(obmol.GetData(OpenBabel::OBGenericDataType::CustomData0));
+    OpenBabel::OBOrcaSpecData *osd = static_cast<OpenBabel::OBOrcaSpecData*>(obmol->GetData(OpenBabel::OBGenericDataType::CustomData0));
 
     if (!osd) return false;
     if (!osd->GetSpecData()) return false;
@@ -74,8 +74,8 @@ namespace Avogadro {
   }
 
   bool CDSpectra::checkForData(Molecule * mol) {
-    OpenBabel::OBMol obmol = mol->OBMol();
-    OpenBabel::OBElectronicTransitionData *etd = static_cast<OpenBabel::OBElectronicTransitionData*>(obmol.GetData("ElectronicTransitionData"));
+    QSharedPointer<OpenBabel::OBMol> obmol = mol->OBMolSnapshot();
+    OpenBabel::OBElectronicTransitionData *etd = static_cast<OpenBabel::OBElectronicTransitionData*>(obmol->GetData("ElectronicTransitionData"));
 
     if (!etd) return false;
     if ( etd->GetRotatoryStrengthsVelocity().size() == 0 &&
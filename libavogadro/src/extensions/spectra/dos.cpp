@@ -91,9 +91,9 @@ namespace Avogadro {
 
   bool DOSSpectra::checkForData(Molecule * mol)
   {
-    OpenBabel::OBMol obmol = mol->OBMol();
+    QSharedPointer<OpenBabel::OBMol> obmol = mol->OBMolSnapshot();
     //OpenBabel::OBDOSData *dos = static_cast<OpenBabel::OBDOSData*>(obmol.GetData(OpenBabel::OBGenericDataType::DOSData));
-    OpenBabel::OBDOSData *dos = static_cast<OpenBabel::OBDOSData*>(obmol.GetData("DOSData"));
+    OpenBabel::OBDOSData *dos = static_cast<OpenBabel::OBDOSData*>(obmol->GetData("DOSData"));
     if (!dos) return false;
 
     // OK, we have valid DOS, so store them for later
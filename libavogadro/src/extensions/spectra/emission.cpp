@@ -75,8 +75,8 @@ void OrcaEmissionSpectra::readSettings() {
 
 bool OrcaEmissionSpectra::checkForData(Molecule * mol) {
 
-    OpenBabel::OBMol obmol = mol->OBMol();
-    OpenBabel::OBOrcaSpecData *osd = static_cast<OpenBabel::OBOrcaSpecData*>(obmol.GetData("OrcaSpectraData"));
+    QSharedPointer<OpenBabel::OBMol> obmol = mol->OBMolSnapshot();
+    OpenBabel::OBOrcaSpecData *osd = static_cast<OpenBabel::OBOrcaSpecData*>(obmol->GetData("OrcaSpectraData"));
 
     if (!osd) return false;
     if (!osd->GetSpecData()) return false;
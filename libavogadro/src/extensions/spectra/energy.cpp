@@ -72,9 +72,9 @@ namespace Avogadro {
   }
 
   bool EnergySpectra::checkForData(Molecule * mol) {
-    OpenBabel::OBMol obmol = mol->OBMol();
+    QSharedPointer<OpenBabel::OBMol> obmol = mol->OBMolSnapshot();
 //    cout << obmol.HasData(OpenBabel::OBGenericDataType::ConformerData) << endl;
-    OpenBabel::OBConformerData *confData = static_cast<OpenBabel::OBConformerData*>(obmol.GetData(OpenBabel::OBGenericDataType::ConformerData));
+    OpenBabel::OBConformerData *confData = static_cast<OpenBabel::OBConformerData*>(obmol->GetData(OpenBabel::OBGenericDataType::ConformerData));
 
     if (!confData) return false;
     m_energy = confData->GetEnergies();
@@ -76,8 +76,8 @@ namespace Avogadro {
   }
 
   bool IRSpectra::checkForData(Molecule * mol) {
-    OpenBabel::OBMol obmol = mol->OBMol();
-    OpenBabel::OBVibrationData *vibrations = static_cast<OpenBabel::OBVibrationData*>(obmol.GetData(OpenBabel::OBGenericDataType::VibrationData));
+    QSharedPointer<OpenBabel::OBMol> obmol = mol->OBMolSnapshot();
+    OpenBabel::OBVibrationData *vibrations = static_cast<OpenBabel::OBVibrationData*>(obmol->GetData(OpenBabel::OBGenericDataType::VibrationData));
     if (!vibrations) return false;
 
     // OK, we have valid vibrations, so store them for later
@@ -86,7 +86,7 @@ namespace Avogadro {
     qDebug() << "has IR data " << wavenumbers.size();
 
     // check if there are also data from a nearIR spectrum
-    OpenBabel::OBOrcaNearIRData *ond = static_cast<OpenBabel::OBOrcaNearIRData*>(obmol.GetData("OrcaNearIRSpectraData"));
+    OpenBabel::OBOrcaNearIRData *ond = static_cast<OpenBabel::OBOrcaNearIRData*>(obmol->GetData("OrcaNearIRSpectraData"));
     if (ond) {
         qDebug() << "has also nearIR data " << wavenumbers.size();
 
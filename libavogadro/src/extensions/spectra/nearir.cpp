@@ -56,9 +56,9 @@ void NearIRSpectra::writeSettings()
 }
 
 bool NearIRSpectra::checkForData(Molecule * mol) {
-    OpenBabel::OBMol obmol = mol->OBMol();
+    QSharedPointer<OpenBabel::OBMol> obmol = mol->OBMolSnapshot();
 //    OpenBabel::OBVibrationData *vibrations = static_cast<OpenBabel::OBVibrationData*>(obmol.GetData(OpenBabel::OBGenericDataType::VibrationData));
-    OpenBabel::OBOrcaNearIRData *ond = static_cast<OpenBabel::OBOrcaNearIRData*>(obmol.GetData("OrcaNearIRSpectraData"));
+    OpenBabel::OBOrcaNearIRData *ond = static_cast<OpenBabel::OBOrcaNearIRData*>(obmol->GetData("OrcaNearIRSpectraData"));
 
     if (!ond) return false;
     if (!ond->GetNearIRData()) return false;
@@ -88,8 +88,8 @@ namespace Avogadro {
   }
 
   bool RamanSpectra::checkForData(Molecule * mol) {
-    OpenBabel::OBMol obmol = mol->OBMol();
-    OpenBabel::OBVibrationData *vibrations = static_cast<OpenBabel::OBVibrationData*>(obmol.GetData(OpenBabel::OBGenericDataType::VibrationData));
+    QSharedPointer<OpenBabel::OBMol> obmol = mol->OBMolSnapshot();
+    OpenBabel::OBVibrationData *vibrations = static_cast<OpenBabel::OBVibrationData*>(obmol->GetData(OpenBabel::OBGenericDataType::VibrationData));
     if (!vibrations) return false;
 
     // OK, we have valid vibrations, so store them for later
@@ -84,8 +84,8 @@ void UVSpectra::readSettings() {
 
 bool UVSpectra::checkForData(Molecule * mol) {
 
-    OpenBabel::OBMol obmol = mol->OBMol();
-    OpenBabel::OBElectronicTransitionData *etd = static_cast<OpenBabel::OBElectronicTransitionData*>(obmol.GetData("ElectronicTransitionData"));
+    QSharedPointer<OpenBabel::OBMol> obmol = mol->OBMolSnapshot();
+    OpenBabel::OBElectronicTransitionData *etd = static_cast<OpenBabel::OBElectronicTransitionData*>(obmol->GetData("ElectronicTransitionData"));
 
     if (!etd) return false;
     if (etd->GetEDipole().size() == 0) return false;
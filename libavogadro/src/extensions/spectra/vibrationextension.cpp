@@ -144,7 +144,7 @@ namespace Avogadro {
         
     if (m_dock) {
       if (molecule !=0) {
-        if (molecule->OBMol().GetData(OBGenericDataType::VibrationData)) {
+        if (molecule->OBMolSnapshot()->GetData(OBGenericDataType::VibrationData)) {
           //m_dock->show();
           m_dialog->setEnabled(true);
           if (!m_dock->toggleViewAction()->isChecked())
@@ -169,6 +169,7 @@ namespace Avogadro {
 
     // update m_vibrations
     if (!m_molecule) {
+      m_obmol.clear();
       m_vibrations = NULL;
       m_mode = -1;
     }
@@ -189,8 +190,9 @@ namespace Avogadro {
       return; // signal to end updates
     }
 
-    OBMol obmol = m_molecule->OBMol();
-    m_vibrations = static_cast<OBVibrationData*>(obmol.GetData(OBGenericDataType::VibrationData));
+    // Keep the snapshot, it owns m_vibrations
+    m_obmol = m_molecule->OBMolSnapshot();
+    m_vibrations = static_cast<OBVibrationData*>(m_obmol->GetData(OBGenericDataType::VibrationData));
     if (m_vibrations == NULL)
       return; // e.g., when destroying the molecule;
 
@@ -31,11 +31,13 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QList>
+#include <QtCore/QSharedPointer>
 #include <QtCore/QString>
 #include <QtWidgets/QDockWidget>
 #include <QtWidgets/QUndoCommand>
 
 namespace OpenBabel {
+  class OBMol;
   class OBVibrationData;
 }
 
@@ -74,6 +76,7 @@ namespace Avogadro {
     private:
       void updateForcesAndFrames(); // helper when settings change
 
+      QSharedPointer<OpenBabel::OBMol> m_obmol;
       OpenBabel::OBVibrationData *m_vibrations;
       int m_mode;
       VibrationWidget *m_dialog;
@@ -93,14 +93,16 @@ namespace Avogadro {
     // update table
     ui.vibrationTable->clearContents();
       if (molecule == 0){
+        m_obmol.clear();
+        m_vibrations = 0;
         ui.vibrationTable->setRowCount(0);
         ui.vibrationTable->horizontalHeader()->hide();
         return;
       }
     m_molecule = molecule;
 
-    OBMol obmol = molecule->OBMol();
-    m_vibrations = static_cast<OBVibrationData*>(obmol.GetData(OBGenericDataType::VibrationData));
+    m_obmol = molecule->OBMolSnapshot();
+    m_vibrations = static_cast<OBVibrationData*>(m_obmol->GetData(OBGenericDataType::VibrationData));
     if (!m_vibrations) {
       ui.vibrationTable->setRowCount(0);
       ui.vibrationTable->horizontalHeader()->hide();
@@ -331,8 +333,8 @@ namespace Avogadro {
       return;
     }
 
-    OBMol obmol = m_molecule->OBMol();
-    m_vibrations = static_cast<OBVibrationData*>(obmol.GetData(OBGenericDataType::VibrationData));
+    QSharedPointer<OBMol> obmol = m_molecule->OBMolSnapshot();
+    m_vibrations = static_cast<OBVibrationData*>(obmol->GetData(OBGenericDataType::VibrationData));
     if (!m_vibrations) {
       qWarning("No vibration data, but export button is enabled? Something is broken.");
       return;
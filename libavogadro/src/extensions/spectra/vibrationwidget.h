@@ -23,6 +23,7 @@
 #ifndef VIBRATIONWIDGET_H
 #define VIBRATIONWIDGET_H
 
+#include <QtCore/QSharedPointer>
 #include <QtWidgets/QWidget>
 
 #include <avogadro/primitive.h>
@@ -31,6 +32,7 @@
 #include "ui_vibrationwidget.h"
 
 namespace OpenBabel {
+  class OBMol;
   class OBVibrationData;
 }
 
@@ -82,6 +84,8 @@ namespace Avogadro {
 
       GLWidget *m_widget;
       Molecule *m_molecule;
+      // Keeps the snapshot m_vibrations points into alive
+      QSharedPointer<OpenBabel::OBMol> m_obmol;
       OpenBabel::OBVibrationData *m_vibrations;
       std::vector<double> m_frequencies;
       std::vector<double> m_intensities;
@@ -0,0 +1,295 @@
+/**********************************************************************
+  ESPMapper - Map the electrostatic potential of point charges on meshes
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "espmapper.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/mesh.h>
+
+#include <QtConcurrent/QtConcurrentMap>
+#include <QByteArray>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+
+using Eigen::Vector3d;
+using Eigen::Vector3f;
+using Eigen::Matrix3d;
+
+namespace Avogadro
+{
+  // Nodes with at most this many charges are not split
+  const int LEAF_SIZE = 8;
+  // Coincident charges are not split any further
+  const int MAX_DEPTH = 24;
+  // A node is used as a whole when its radius over its distance is less
+  // than this. On a neutral, protein-like set of charges the potential is
+  // then within 2% of the 0.1 e/A where the surface colors saturate.
+  const double THETA = 0.15;
+  // Number of vertices evaluated in each block
+  const unsigned int BLOCK_SIZE = 1024;
+  // Charges closer to a vertex are skipped, as in an atom center
+  const double MIN_DISTANCE2 = 1.0e-8;
+  // Potentials kept for this many meshes, e.g. both signs of an orbital
+  const int MAX_CACHED_MESHES = 4;
+
+  struct ESPBlock
+  {
+    const ESPMapper *mapper;
+    const Vector3f *vertices;
+    double *potentials;
+    unsigned int begin, end;
+  };
+
+  ESPMapper::ESPMapper()
+  {
+  }
+
+  ESPMapper::~ESPMapper()
+  {
+  }
+
+  void ESPMapper::setCharges(Molecule *mol)
+  {
+    QList<Atom *> atoms = mol->atoms();
+
+    // Check to see if molecule has hydrogens
+    bool hasHydrogens = false;
+    foreach (Atom *atom, atoms)
+      if (atom->atomicNumber() == 1) {
+        hasHydrogens = true;
+        break;
+      }
+
+    // The partial charges are calculated on first use, so get them here
+    // rather than from the worker threads
+    std::vector<double> input;
+    input.reserve(4 * atoms.size());
+    foreach (Atom *atom, atoms) {
+      const Vector3d *pos = atom->pos();
+      double charge = atom->partialCharge();
+      // Include formal charges when there are hydrogens
+      if (hasHydrogens)
+        charge += atom->formalCharge();
+      input.push_back(pos->x());
+      input.push_back(pos->y());
+      input.push_back(pos->z());
+      input.push_back(charge);
+    }
+    if (input == m_atoms && !m_nodes.empty())
+      return;
+
+    m_atoms.swap(input);
+    m_cache.clear();
+    m_nodes.clear();
+    m_positions.clear();
+    m_charges.clear();
+    for (size_t i = 0; i + 3 < m_atoms.size(); i += 4) {
+      // Neutral atoms add nothing
+      if (m_atoms[i + 3] == 0.0)
+        continue;
+      m_positions.push_back(Vector3d(m_atoms[i], m_atoms[i + 1],
+                                     m_atoms[i + 2]));
+      m_charges.push_back(m_atoms[i + 3]);
+    }
+    if (m_charges.empty())
+      return;
+
+    Node root;
+    root.begin = 0;
+    root.end = static_cast<int>(m_charges.size());
+    m_nodes.push_back(root);
+    buildNode(0, 0);
+  }
+
+  void ESPMapper::buildNode(int index, int depth)
+  {
+    // m_nodes grows below, so only refer to the node by index
+    const int begin = m_nodes[index].begin;
+    const int end = m_nodes[index].end;
+
+    Vector3d min = m_positions[begin];
+    Vector3d max = min;
+    for (int i = begin + 1; i < end; ++i) {
+      min = min.cwiseMin(m_positions[i]);
+      max = max.cwiseMax(m_positions[i]);
+    }
+    const Vector3d center = 0.5 * (min + max);
+
+    // Moments around the center of the bounding box
+    double radius2 = 0.0;
+    double charge = 0.0;
+    Vector3d dipole = Vector3d::Zero();
+    Matrix3d quadrupole = Matrix3d::Zero();
+    for (int i = begin; i < end; ++i) {
+      Vector3d d = m_positions[i] - center;
+      double q = m_charges[i];
+      double d2 = d.squaredNorm();
+      radius2 = std::max(radius2, d2);
+      charge += q;
+      dipole += q * d;
+      quadrupole += q * (3.0 * d * d.transpose() - d2 * Matrix3d::Identity());
+    }
+
+    Node &node = m_nodes[index];
+    node.center = center;
+    node.radius2 = radius2;
+    node.charge = charge;
+    node.dipole = dipole;
+    node.quadrupole = quadrupole;
+    node.firstChild = 0;
+    node.numChildren = 0;
+    if (end - begin <= LEAF_SIZE || depth >= MAX_DEPTH)
+      return;
+
+    // Sort the charges into the octants around the center
+    int counts[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    std::vector<int> octants(end - begin);
+    for (int i = begin; i < end; ++i) {
+      const Vector3d &p = m_positions[i];
+      int octant = (p.x() > center.x() ? 1 : 0) | (p.y() > center.y() ? 2 : 0)
+          | (p.z() > center.z() ? 4 : 0);
+      octants[i - begin] = octant;
+      ++counts[octant];
+    }
+    int starts[8];
+    int next[8];
+    starts[0] = begin;
+    for (int o = 1; o < 8; ++o)
+      starts[o] = starts[o - 1] + counts[o - 1];
+    std::copy(starts, starts + 8, next);
+    std::vector<Vector3d> positions(m_positions.begin() + begin,
+                                    m_positions.begin() + end);
+    std::vector<double> charges(m_charges.begin() + begin,
+                                m_charges.begin() + end);
+    for (int i = 0; i < end - begin; ++i) {
+      int k = next[octants[i]]++;
+      m_positions[k] = positions[i];
+      m_charges[k] = charges[i];
+    }
+
+    // The children are kept next to each other
+    const int firstChild = static_cast<int>(m_nodes.size());
+    int numChildren = 0;
+    for (int o = 0; o < 8; ++o) {
+      if (!counts[o])
+        continue;
+      Node child;
+      child.begin = starts[o];
+      child.end = starts[o] + counts[o];
+      m_nodes.push_back(child);
+      ++numChildren;
+    }
+    m_nodes[index].firstChild = firstChild;
+    m_nodes[index].numChildren = numChildren;
+    for (int c = 0; c < numChildren; ++c)
+      buildNode(firstChild + c, depth + 1);
+  }
+
+  double ESPMapper::potential(const Vector3d &point) const
+  {
+    if (m_nodes.empty())
+      return 0.0;
+
+    const double theta2 = THETA * THETA;
+    double energy = 0.0;
+    // Each level replaces one node with at most eight children
+    int stack[8 * (MAX_DEPTH + 1)];
+    int top = 0;
+    stack[top++] = 0;
+    while (top) {
+      const Node &node = m_nodes[stack[--top]];
+      Vector3d r = point - node.center;
+      double r2 = r.squaredNorm();
+      if (node.radius2 < theta2 * r2) {
+        // Far field, from the multipole expansion
+        double inv2 = 1.0 / r2;
+        energy += std::sqrt(inv2) * (node.charge + inv2 * (node.dipole.dot(r)
+            + 0.5 * inv2 * r.dot(node.quadrupole * r)));
+      }
+      else if (!node.numChildren) {
+        // Near field, charge by charge
+        for (int i = node.begin; i < node.end; ++i) {
+          double d2 = (point - m_positions[i]).squaredNorm();
+          if (d2 > MIN_DISTANCE2)
+            energy += m_charges[i] / std::sqrt(d2);
+        }
+      }
+      else {
+        for (int c = 0; c < node.numChildren; ++c)
+          stack[top++] = node.firstChild + c;
+      }
+    }
+    return energy;
+  }
+
+  void ESPMapper::processBlock(ESPBlock &block)
+  {
+    for (unsigned int i = block.begin; i < block.end; ++i)
+      block.potentials[i] =
+          block.mapper->potential(block.vertices[i].cast<double>());
+  }
+
+  const std::vector<double> & ESPMapper::calculate(const Mesh *mesh)
+  {
+    const std::vector<Vector3f> &vertices = mesh->vertices();
+    const unsigned int numVertices = static_cast<unsigned int>(vertices.size());
+    uint hash = 0;
+    if (numVertices)
+      hash = qHash(QByteArray::fromRawData(
+                     reinterpret_cast<const char *>(vertices[0].data()),
+                     static_cast<int>(numVertices * sizeof(Vector3f))));
+
+    if (!m_cache.contains(mesh->id()) && m_cache.size() >= MAX_CACHED_MESHES)
+      m_cache.clear();
+    CachedESP &cached = m_cache[mesh->id()];
+    if (cached.numVertices == numVertices && cached.hash == hash
+        && cached.potentials.size() == numVertices)
+      return cached.potentials;
+
+    cached.numVertices = numVertices;
+    cached.hash = hash;
+    cached.potentials.assign(numVertices, 0.0);
+    if (!numVertices || m_nodes.empty())
+      return cached.potentials;
+
+    QVector<ESPBlock> blocks;
+    blocks.reserve(numVertices / BLOCK_SIZE + 1);
+    for (unsigned int begin = 0; begin < numVertices; begin += BLOCK_SIZE) {
+      ESPBlock block;
+      block.mapper = this;
+      block.vertices = &vertices[0];
+      block.potentials = &cached.potentials[0];
+      block.begin = begin;
+      block.end = std::min(begin + BLOCK_SIZE, numVertices);
+      blocks.push_back(block);
+    }
+    QtConcurrent::blockingMap(blocks, ESPMapper::processBlock);
+
+    return cached.potentials;
+  }
+
+} // End namespace Avogadro
@@ -0,0 +1,107 @@
+/**********************************************************************
+  ESPMapper - Map the electrostatic potential of point charges on meshes
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef ESPMAPPER_H
+#define ESPMAPPER_H
+
+#include <Eigen/Core>
+
+#include <QHash>
+
+#include <vector>
+
+namespace Avogadro
+{
+  class Molecule;
+  class Mesh;
+  struct ESPBlock;
+
+  /**
+   * @class ESPMapper espmapper.h
+   * @brief Electrostatic potential of the atomic charges at mesh vertices.
+   *
+   * The charges are sorted into an octree. Each node stores the monopole,
+   * dipole and quadrupole moments of its charges, which are used for
+   * vertices far enough away, while the charges near a vertex are summed
+   * exactly (Barnes-Hut). There is no cutoff, so the potential includes
+   * every charge in the molecule.
+   *
+   * The vertices are evaluated in blocks with QtConcurrent. The potentials
+   * of each mesh are kept until the charges change.
+   */
+  class ESPMapper
+  {
+  public:
+    ESPMapper();
+    ~ESPMapper();
+
+    /**
+     * Take the positions and charges of the atoms in @p mol. Formal charges
+     * are added to the partial charges when the molecule has hydrogens.
+     * The tree is only rebuilt when the charges or positions changed.
+     */
+    void setCharges(Molecule *mol);
+
+    /**
+     * Calculate the electrostatic potential at each vertex of @p mesh, in
+     * e/Å.
+     */
+    const std::vector<double> & calculate(const Mesh *mesh);
+
+  private:
+    struct Node
+    {
+      Eigen::Vector3d center;     // the moments are taken around it
+      double radius2;             // squared, of the charges around center
+      double charge;
+      Eigen::Vector3d dipole;
+      Eigen::Matrix3d quadrupole; // traceless
+      int begin, end;             // charges in m_positions
+      int firstChild, numChildren;
+    };
+
+    struct CachedESP
+    {
+      CachedESP() : numVertices(0), hash(0) {}
+      unsigned int numVertices;
+      uint hash;
+      std::vector<double> potentials;
+    };
+
+    void buildNode(int index, int depth);
+    double potential(const Eigen::Vector3d &point) const;
+
+    /// Re-entrant block of vertices for QtConcurrent
+    static void processBlock(ESPBlock &block);
+
+    std::vector<double> m_atoms;              // x, y, z and charge of each atom
+    std::vector<Eigen::Vector3d> m_positions; // sorted by node
+    std::vector<double> m_charges;
+    std::vector<Node> m_nodes;                // the root is the first
+    QHash<unsigned long, CachedESP> m_cache;  // by mesh id
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -31,6 +31,15 @@ bool BasisSet::blockingCalculateCubeMO(Cube *cube, unsigned int mo)
   return true;
 }
 
+bool BasisSet::blockingCalculateCubesMO(const QList<Cube *> &cubes,
+                                        const QList<unsigned int> &mos)
+{
+  if (!this->calculateCubesMO(cubes, mos))
+    return false;
+  this->watcher().waitForFinished();
+  return true;
+}
+
 bool BasisSet::blockingCalculateCubeDensity(Cube *cube)
 {
   if (!this->calculateCubeDensity(cube))
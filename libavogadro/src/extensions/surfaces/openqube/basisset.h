@@ -23,6 +23,7 @@
 #include "molecule.h"
 
 #include <QtCore/QObject>
+#include <QtCore/QList>
 #include <QtCore/QFutureWatcher>
 
 namespace OpenQube
@@ -48,7 +49,7 @@ public:
   /**
    * Constructor.
    */
-  BasisSet() : m_electrons(0), m_valid(true) {}
+  BasisSet() : m_electrons(0), m_valid(true), m_screeningTolerance(1e-10) {}
 
   /**
    * Destructor.
@@ -125,6 +126,22 @@ public:
    */
   bool isValid() { return m_valid; }
 
+  /**
+   * Set the tolerance used to screen out basis functions when calculating
+   * cubes. Basis functions are not evaluated at points where their value is
+   * guaranteed to be smaller than this.
+   * @param tolerance The screening tolerance, zero disables screening.
+   */
+  void setScreeningTolerance(double tolerance)
+  {
+    m_screeningTolerance = tolerance;
+  }
+
+  /**
+   * @return The screening tolerance used when calculating cubes.
+   */
+  double screeningTolerance() const { return m_screeningTolerance; }
+
   /**
    * Calculate the MO over the entire range of the supplied Cube.
    * @param cube The cube to write the values of the MO into.
@@ -145,6 +162,30 @@ public:
    */
   virtual bool blockingCalculateCubeMO(Cube *cube, unsigned int mo = 1);
 
+  /**
+   * Calculate several MOs over the entire range of the supplied Cubes in one
+   * pass, the basis functions are only evaluated once for each point.
+   * @param cubes The cubes to write the values of the MOs into, they must all
+   * have the same limits and dimensions.
+   * @param mos The molecular orbital numbers to calculate, one for each cube.
+   * @note This function starts a threaded calculation. Use watcher() to
+   * monitor progress.
+   * @sa blockingCalculateCubesMO
+   * @return True if the calculation was successful.
+   */
+  virtual bool calculateCubesMO(const QList<Cube *> &cubes,
+                                const QList<unsigned int> &mos) = 0;
+
+  /**
+   * Calculate several MOs over the entire range of the supplied Cubes.
+   * @param cubes The cubes to write the values of the MOs into.
+   * @param mos The molecular orbital numbers to calculate, one for each cube.
+   * @sa calculateCubesMO
+   * @return True if the calculation was successful.
+   */
+  virtual bool blockingCalculateCubesMO(const QList<Cube *> &cubes,
+                                        const QList<unsigned int> &mos);
+
   /**
    * Calculate the electron density over the entire range of the supplied Cube.
    * @param cube The cube to write the values of the MO into.
@@ -183,6 +224,9 @@ protected:
    */
   bool m_valid;
 
+  /// Basis function values below this are neglected, zero disables screening
+  double m_screeningTolerance;
+
   /** The Molecule holds the atoms (and possibly bonds) read in from the output
    * file. Most basis sets have orbitals around these atoms, but this is not
    * necessarily the case.
@@ -25,6 +25,7 @@
 
 #include "cube.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include <QtConcurrent/QtConcurrentMap>
@@ -40,19 +41,41 @@ using Eigen::MatrixXd;
 
 namespace OpenQube
 {
-struct GaussianShell
+struct GaussianBlock
 {
-  GaussianSet *set;  // A pointer to the GaussianSet, cannot write to member vars
-  Cube *tCube;       // The target cube, used to initialise temp cubes too
-  unsigned int pos;  // The index ofposition of the point to calculate the MO for
-  unsigned int state;// The MO number to calculate
+  GaussianSet *set;   // A pointer to the GaussianSet, cannot write to member vars
+  Cube *tCube;        // The cube defining the grid, all targets share it
+  unsigned int first; // The index of the first point in the block
+  unsigned int size;  // The number of (contiguous) points in the block
 };
 
+// Per-block scratch space, the deltas are relative to the current atom
+struct GaussianPoints
+{
+  GaussianPoints(unsigned int n, double h = 0.0) : size(n), begin(0), end(n),
+    atom(-1), step(h), x(n), y(n), z(n), r2(n), gto(n) {}
+  unsigned int size;
+  unsigned int begin, end; // The range of points the current shell reaches
+  int atom;
+  double step;             // The spacing of the points along z
+  vector<double> x, y, z, r2;
+  vector<double> gto;
+};
+
+// The largest number of components in a shell we can evaluate (I13)
+static const unsigned int MAX_SHELL_COMPONENTS = 13;
+
+// The number of basis functions gathered before contracting them with the MO
+// coefficients, keeps the basis function values of a row in cache
+static const unsigned int BASIS_CHUNK_SIZE = 128;
+
+static unsigned int shellComponents(int type, bool orca);
+
 static const double BOHR_TO_ANGSTROM = 0.529177249;
 static const double ANGSTROM_TO_BOHR = 1.0 / BOHR_TO_ANGSTROM;
 
 GaussianSet::GaussianSet() : m_numMOs(0), m_numAtoms(0), m_init(false),
-  m_cube(0), m_gaussianShells(0), m_useOrcaNorm(false)
+  m_cellSize(1.0), m_cutoffTolerance(-1.0), m_gaussianBlocks(0), m_useOrcaNorm(false)
 {
 }
 
@@ -166,10 +189,23 @@ bool GaussianSet::setDensityMatrix(const Eigen::MatrixXd &m)
 }
 
 bool GaussianSet::calculateCubeMO(Cube *cube, unsigned int state)
+{
+  QList<Cube *> cubes;
+  cubes << cube;
+  QList<unsigned int> states;
+  states << state;
+  return calculateCubesMO(cubes, states);
+}
+
+bool GaussianSet::calculateCubesMO(const QList<Cube *> &cubes,
+                                   const QList<unsigned int> &states)
 {
   // Set up the calculation and ideally use the new QtConcurrent code to
   // multithread the calculation...
-  if (state < 1 || state > static_cast<unsigned int>(m_moMatrix.rows()))
+  if (cubes.isEmpty() || cubes.size() != states.size())
+    return false;
+  foreach (unsigned int state, states)
+    if (state < 1 || state > static_cast<unsigned int>(m_moMatrix.cols()))
       return false;
 
   // Must be called before calculations begin - use different init for Orca written data
@@ -178,24 +214,52 @@ bool GaussianSet::calculateCubeMO(Cube *cube, unsigned int state)
   } else {
       initCalculationForOrca();
   }
-  // Set up the points we want to calculate the density at
-  m_gaussianShells = new QVector<GaussianShell>(cube->data()->size());
-
-  for (int i = 0; i < m_gaussianShells->size(); ++i) {
-      (*m_gaussianShells)[i].set = this;
-      (*m_gaussianShells)[i].tCube = cube;
-      (*m_gaussianShells)[i].pos = i;
-      (*m_gaussianShells)[i].state = state;
+  initScreening();
+
+  Cube *cube = cubes.first();
+  if (cube->data()->empty())
+    return false;
+
+  // All of the cubes are calculated on the same grid of points
+  const Vector3i dim = cube->dimensions();
+  for (int i = 0; i < cubes.size(); ++i) {
+    if (cubes[i]->dimensions() != dim || cubes[i]->min() != cube->min()
+        || cubes[i]->spacing() != cube->spacing()
+        || cubes.count(cubes[i]) != 1) {
+      qDebug() << "Cannot calculate MOs -- cubes must be distinct and share"
+               << "the same grid.";
+      return false;
+    }
   }
 
-  // Lock the cube until we are done.
-  cube->lock()->lockForWrite();
+  // Gather the coefficients of the requested MOs, so that each row of points
+  // is contracted with all of them at once
+  m_moBlock.resize(m_moMatrix.rows(), states.size());
+  for (int i = 0; i < states.size(); ++i)
+    m_moBlock.col(i) = m_moMatrix.col(states[i] - 1);
+
+  // Set up the blocks of points we want to calculate the MOs at, one for each
+  // row along z as those points are contiguous in the cube data
+  m_gaussianBlocks = new QVector<GaussianBlock>(dim.x() * dim.y());
+
+  for (int i = 0; i < m_gaussianBlocks->size(); ++i) {
+    GaussianBlock &block = (*m_gaussianBlocks)[i];
+    block.set = this;
+    block.tCube = cube;
+    block.first = i * dim.z();
+    block.size = dim.z();
+  }
+
+  // Lock the cubes until we are done.
+  m_cubes = cubes;
+  foreach (Cube *target, m_cubes)
+    target->lock()->lockForWrite();
 
   // Watch for the future
   connect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
 
   // The main part of the mapped reduced function...
-  m_future = QtConcurrent::map(*m_gaussianShells, GaussianSet::processPoint);
+  m_future = QtConcurrent::map(*m_gaussianBlocks, GaussianSet::processBlock);
   // Connect our watcher to our future
   m_watcher.setFuture(m_future);
 
@@ -218,24 +282,47 @@ bool GaussianSet::calculateCubeDensity(Cube *cube)
   } else {
       initCalculationForOrca();
   }
+  initScreening();
+
+  if (cube->data()->empty())
+    return false;
 
-  // Set up the points we want to calculate the density at
-  m_gaussianShells = new QVector<GaussianShell>(cube->data()->size());
+  // Shells whose rows of the density matrix are all negligible do not
+  // contribute to the density anywhere
+  m_densityShells.resize(m_symmetry.size());
+  for (unsigned int i = 0; i < m_symmetry.size(); ++i) {
+    unsigned int components = shellComponents(m_symmetry[i], m_useOrcaNorm);
+    m_densityShells[i] = components > 0
+        && m_moIndices[i] + components
+           <= static_cast<unsigned int>(m_density.rows())
+        && !isSmall(m_density.middleRows(m_moIndices[i], components)
+                    .cwiseAbs().maxCoeff());
+  }
 
-  for (int i = 0; i < m_gaussianShells->size(); ++i) {
-    (*m_gaussianShells)[i].set = this;
-    (*m_gaussianShells)[i].tCube = cube;
-    (*m_gaussianShells)[i].pos = i;
+  // Set up the blocks of points we want to calculate the density at, one for
+  // each row along z as those points are contiguous in the cube data
+  const Vector3i dim = cube->dimensions();
+  m_gaussianBlocks = new QVector<GaussianBlock>(dim.x() * dim.y());
+
+  for (int i = 0; i < m_gaussianBlocks->size(); ++i) {
+    GaussianBlock &block = (*m_gaussianBlocks)[i];
+    block.set = this;
+    block.tCube = cube;
+    block.first = i * dim.z();
+    block.size = dim.z();
   }
 
   // Lock the cube until we are done.
+  m_cubes.clear();
+  m_cubes << cube;
   cube->lock()->lockForWrite();
 
   // Watch for the future
   connect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
 
   // The main part of the mapped reduced function...
-  m_future = QtConcurrent::map(*m_gaussianShells, GaussianSet::processDensity);
+  m_future = QtConcurrent::map(*m_gaussianBlocks,
+                               GaussianSet::processDensityBlock);
   // Connect our watcher to our future
   m_watcher.setFuture(m_future);
 
@@ -261,6 +348,7 @@ BasisSet * GaussianSet::clone()
   result->m_numAtoms = this->m_numAtoms;
   result->m_init = this->m_init;
   result->m_useOrcaNorm = this->m_useOrcaNorm;
+  result->m_screeningTolerance = this->m_screeningTolerance;
 
 
   // Skip tmp vars
@@ -270,9 +358,11 @@ BasisSet * GaussianSet::clone()
 void GaussianSet::calculationComplete()
 {
   disconnect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
-  (*m_gaussianShells)[0].tCube->lock()->unlock();
-  delete m_gaussianShells;
-  m_gaussianShells = 0;
+  foreach (Cube *cube, m_cubes)
+    cube->lock()->unlock();
+  m_cubes.clear();
+  delete m_gaussianBlocks;
+  m_gaussianBlocks = 0;
   emit finished();
 }
 
@@ -745,1313 +835,653 @@ void GaussianSet::initCalculationForOrca()
   m_init = true;
 //  outputAll();
 }
-/// This is the stuff we actually use right now - porting to new data structure
-void GaussianSet::processPoint(GaussianShell &shell)
+/// The number of components of a shell type, zero if it is not handled
+static unsigned int shellComponents(int type, bool orca)
 {
-  GaussianSet *set = shell.set;
-  unsigned int atomsSize = set->m_numAtoms;
-  unsigned int basisSize = set->m_symmetry.size();
-  std::vector<int> &basis = set->m_symmetry;
-  vector<Vector3d> deltas;
-  vector<double> dr2;
-  deltas.reserve(atomsSize);
-  dr2.reserve(atomsSize);
-
-  unsigned int indexMO = shell.state-1;
-
-  // Calculate our position
-  Vector3d pos = shell.tCube->position(shell.pos) * ANGSTROM_TO_BOHR;
-
-  // Calculate the deltas for the position
-  for (unsigned int i = 0; i < atomsSize; ++i) {
-    deltas.push_back(pos - set->m_molecule.atomPos(i));
-    dr2.push_back(deltas[i].squaredNorm());
-  }
-
-  // Now calculate the value at this point in space
-  double tmp = 0.0;
-  if (!set->m_useOrcaNorm) {
-      for (unsigned int i = 0; i < basisSize; ++i) {
-          switch(basis[i]) {
-          case S:
-              tmp += pointS(shell.set, i,
-                            dr2[set->m_atomIndices[i]], indexMO);
-              break;
-          case P:
-              tmp += pointP(shell.set, i, deltas[set->m_atomIndices[i]],
-                      dr2[set->m_atomIndices[i]], indexMO);
-              break;
-          case D:
-              tmp += pointD(shell.set, i, deltas[set->m_atomIndices[i]],
-                      dr2[set->m_atomIndices[i]], indexMO);
-              break;
-          case D5:
-              tmp += pointD5(shell.set, i, deltas[set->m_atomIndices[i]],
-                      dr2[set->m_atomIndices[i]], indexMO);
-              break;
-          case F:
-              tmp += pointF(shell.set, i, deltas[set->m_atomIndices[i]],
-                      dr2[set->m_atomIndices[i]], indexMO);
-              break;
-          case F7:
-              tmp += pointF7(shell.set, i, deltas[set->m_atomIndices[i]],
-                      dr2[set->m_atomIndices[i]], indexMO);
-              break;
-          default:
-              // Not handled - return a zero contribution
-              ;
-          }
-      }
-  } else {
-      for (unsigned int i = 0; i < basisSize; ++i) {
-        switch(basis[i]) {
-        case S:
-          tmp += pointS(shell.set, i,
-                        dr2[set->m_atomIndices[i]], indexMO);
-          break;
-        case P:
-          tmp += pointP(shell.set, i, deltas[set->m_atomIndices[i]],
-                        dr2[set->m_atomIndices[i]], indexMO);
-          break;
-        case D5:
-          tmp += pointOrcaD5(shell.set, i, deltas[set->m_atomIndices[i]],
-                         dr2[set->m_atomIndices[i]], indexMO);
-          break;
-        case F7:
-          tmp += pointOrcaF7(shell.set, i, deltas[set->m_atomIndices[i]],
-                         dr2[set->m_atomIndices[i]], indexMO);
-          break;
-        case G9:
-          tmp += pointOrcaG9(shell.set, i, deltas[set->m_atomIndices[i]],
-                         dr2[set->m_atomIndices[i]], indexMO);
-          break;
-        case H11:
-          tmp += pointOrcaH11(shell.set, i, deltas[set->m_atomIndices[i]],
-                         dr2[set->m_atomIndices[i]], indexMO);
-          break;
-        case I13:
-          tmp += pointOrcaI13(shell.set, i, deltas[set->m_atomIndices[i]],
-                         dr2[set->m_atomIndices[i]], indexMO);
-          break;
-        default:
-          // Not handled - return a zero contribution
-          ;
-        }
-      }
-  }
-
-  // Set the value
-  shell.tCube->setValue(shell.pos, tmp);
-}
-
-void GaussianSet::processDensity(GaussianShell &shell)
-{
-  GaussianSet *set = shell.set;
-  unsigned int atomsSize = set->m_numAtoms;
-  unsigned int basisSize = set->m_symmetry.size();
-  unsigned int matrixSize = set->m_density.rows();
-  std::vector<int> &basis = set->m_symmetry;
-  vector<Vector3d> deltas;
-  vector<double> dr2;
-  deltas.reserve(atomsSize);
-  dr2.reserve(atomsSize);
-
-  // Calculate our position
-  Vector3d pos = shell.tCube->position(shell.pos) * ANGSTROM_TO_BOHR;
-  // Calculate the deltas for the position
-  for (unsigned int i = 0; i < atomsSize; ++i) {
-    deltas.push_back(pos - set->m_molecule.atomPos(i));
-    dr2.push_back(deltas[i].squaredNorm());
-  }
-
-  // Calculate the basis set values at this point
-  MatrixXd values(matrixSize, 1);
-  if (!set->m_useOrcaNorm) {
-      for (unsigned int i = 0; i < basisSize; ++i) {
-          unsigned int cAtom = set->m_atomIndices[i];
-          switch(basis[i]) {
-          case S:
-              pointS(shell.set, dr2[cAtom], i, values);
-              break;
-          case P:
-              pointP(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-              break;
-          case D:
-              pointD(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-              break;
-          case D5:
-              pointD5(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-              break;
-          case F:
-              pointF(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-              break;
-          case F7:
-              pointF7(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-              break;
-          default:
-              qDebug() << " unhandled function !!!! ";
-              // Not handled - return a zero contribution
-              ;
-          }
-      }
+  if (!orca) {
+    switch (type) {
+    case S:
+      return 1;
+    case P:
+      return 3;
+    case D:
+      return 6;
+    case D5:
+      return 5;
+    case F:
+      return 10;
+    case F7:
+      return 7;
+    default:
+      return 0;
+    }
   } else {
-      for (unsigned int i = 0; i < basisSize; ++i) {
-          unsigned int cAtom = set->m_atomIndices[i];
-          switch(basis[i]) {
-          case S:
-              pointS(shell.set, dr2[cAtom], i, values);
-              break;
-          case P:
-              pointP(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-              break;
-          case D5:
-              pointOrcaD5(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-              break;
-          case F7:
-              pointOrcaF7(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-              break;
-          case G9:
-              pointOrcaG9(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-              break;
-          case H11:
-              pointOrcaH11(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-              break;
-          case I13:
-              pointOrcaI13(shell.set, deltas[cAtom], dr2[cAtom], i, values);
-              break;
-          default:
-              qDebug() << " unhandled function !!!! ";
-              // Not handled - return a zero contribution
-              ;
-          }
-      }
-  }
-
-  // Now calculate the value of the density at this point in space
-  double rho = 0.0;
-  for (unsigned int i = 0; i < matrixSize; ++i) {
-    // Calculate the off-diagonal parts of the matrix
-    for (unsigned int j = 0; j < i; ++j) {
-      rho += 2.0 * set->m_density.coeffRef(i, j)
-          * (values.coeffRef(i, 0) * values.coeffRef(j, 0));
+    switch (type) {
+    case S:
+      return 1;
+    case P:
+      return 3;
+    case D5:
+      return 5;
+    case F7:
+      return 7;
+    case G9:
+      return 9;
+    case H11:
+      return 11;
+    case I13:
+      return 13;
+    default:
+      return 0;
     }
-    // Now calculate the matrix diagonal
-    rho += set->m_density.coeffRef(i, i)
-        * (values.coeffRef(i, 0) * values.coeffRef(i, 0));
-  }
-
-  // Set the value
-  shell.tCube->setValue(shell.pos, rho);
-}
-
-inline double GaussianSet::pointS(GaussianSet *set, unsigned int moIndex,
-                                  double dr2, unsigned int indexMO)
-{
-  // If the MO coefficient is very small skip it
-  if (isSmall(set->m_moMatrix.coeffRef(set->m_moIndices[moIndex], indexMO))) {
-    return 0.0;
-  }
-
-  // S type orbitals - the simplest of the calculations with one component
-  double tmp = 0.0;
-  unsigned int cIndex = set->m_cIndices[moIndex];
-  for (unsigned int i = set->m_gtoIndices[moIndex];
-       i < set->m_gtoIndices[moIndex+1]; ++i) {
-    tmp += set->m_gtoCN[cIndex++] * exp(-set->m_gtoA[i] * dr2);
   }
-  // There is one MO coefficient per S shell basis
-  return tmp * set->m_moMatrix.coeffRef(set->m_moIndices[moIndex], indexMO);
 }
 
-inline double GaussianSet::pointP(GaussianSet *set, unsigned int moIndex,
-                                  const Vector3d &delta,
-                                  double dr2, unsigned int indexMO)
+/// The angular momentum of a shell type
+static int shellAngularMomentum(int type)
 {
-  // P type orbitals have three components and each component has a different
-  // independent MO weighting. Many things can be cached to save time though
-  unsigned int baseIndex = set->m_moIndices[moIndex];
-  double x = 0.0, y = 0.0, z = 0.0;
-
-  // Now iterate through the P type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[moIndex];
-  for (unsigned int i = set->m_gtoIndices[moIndex];
-       i < set->m_gtoIndices[moIndex+1]; ++i) {
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    x += set->m_gtoCN[cIndex++] * delta.x() * tmpGTO;
-    y += set->m_gtoCN[cIndex++] * delta.y() * tmpGTO;
-    z += set->m_gtoCN[cIndex++] * delta.z() * tmpGTO;
+  switch (type) {
+  case S:
+    return 0;
+  case P:
+    return 1;
+  case D:
+  case D5:
+    return 2;
+  case F:
+  case F7:
+    return 3;
+  case G:
+  case G9:
+    return 4;
+  case H:
+  case H11:
+    return 5;
+  case I:
+  case I13:
+    return 6;
+  default:
+    return 0;
   }
-
-  // Calculate the prefactors for Px, Py and Pz
-  double Px = set->m_moMatrix.coeffRef(baseIndex  , indexMO);
-  double Py = set->m_moMatrix.coeffRef(baseIndex+1, indexMO);
-  double Pz = set->m_moMatrix.coeffRef(baseIndex+2, indexMO);
-
-  return Px*x + Py*y + Pz*z;
 }
 
-inline double GaussianSet::pointD(GaussianSet *set, unsigned int moIndex,
-                                  const Vector3d &delta,
-                                  double dr2, unsigned int indexMO)
+/// Multiply in the angular part of each component of a shell. The Cartesian
+/// and pure (real solid harmonic) normalizations are in the contraction
+/// coefficients from initCalculation() and initCalculationForOrca(), apart
+/// from the 1/sqrt(6), 1/sqrt(60) and 1/sqrt(360) of the F7 components
+/// applied here
+static void multiplyAngular(int type, bool orca, const GaussianPoints &points,
+                            double *v)
 {
-  // D type orbitals have six components and each component has a different
-  // independent MO weighting. Many things can be cached to save time though
-  unsigned int baseIndex = set->m_moIndices[moIndex];
-  double xx = 0.0, yy = 0.0, zz = 0.0, xy = 0.0, xz = 0.0, yz = 0.0;
-
-  // Now iterate through the D type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[moIndex];
-  for (unsigned int i = set->m_gtoIndices[moIndex];
-       i < set->m_gtoIndices[moIndex+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    xx += set->m_gtoCN[cIndex++] * tmpGTO; // Dxx
-    yy += set->m_gtoCN[cIndex++] * tmpGTO; // Dyy
-    zz += set->m_gtoCN[cIndex++] * tmpGTO; // Dzz
-    xy += set->m_gtoCN[cIndex++] * tmpGTO; // Dxy
-    xz += set->m_gtoCN[cIndex++] * tmpGTO; // Dxz
-    yz += set->m_gtoCN[cIndex++] * tmpGTO; // Dyz
-  }
-
-  // Calculate the prefactors
-  double Dxx = set->m_moMatrix.coeffRef(baseIndex  , indexMO) * delta.x()
-      * delta.x();
-  double Dyy = set->m_moMatrix.coeffRef(baseIndex+1, indexMO) * delta.y()
-      * delta.y();
-  double Dzz = set->m_moMatrix.coeffRef(baseIndex+2, indexMO) * delta.z()
-      * delta.z();
-  double Dxy = set->m_moMatrix.coeffRef(baseIndex+3, indexMO) * delta.x()
-      * delta.y();
-  double Dxz = set->m_moMatrix.coeffRef(baseIndex+4, indexMO) * delta.x()
-      * delta.z();
-  double Dyz = set->m_moMatrix.coeffRef(baseIndex+5, indexMO) * delta.y()
-      * delta.z();
-  return Dxx*xx + Dyy*yy + Dzz*zz + Dxy*xy + Dxz*xz + Dyz*yz;
-}
+  const unsigned int n = points.size;
+  const unsigned int kBegin = points.begin;
+  const unsigned int kEnd = points.end;
+  const double *x = &points.x[0];
+  const double *y = &points.y[0];
+  const double *z = &points.z[0];
+  const double *r2 = &points.r2[0];
 
-inline double GaussianSet::pointF(GaussianSet *set, unsigned int moIndex,
-                                  const Vector3d &delta,
-                                  double dr2, unsigned int indexMO)
-{
-  // F type orbitals have 10 components and each component has a different
-  // independent MO weighting. Many things can be cached to save time though
-  unsigned int baseIndex = set->m_moIndices[moIndex];
-  double xxx = 0.0;
-  double xxy = 0.0;
-  double xxz = 0.0;
-  double xyy = 0.0;
-  double xyz = 0.0;
-  double xzz = 0.0;
-  double yyy = 0.0;
-  double yyz = 0.0;
-  double yzz = 0.0;
-  double zzz = 0.0;
-
-  // Now iterate through the D type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[moIndex];
-  for (unsigned int i = set->m_gtoIndices[moIndex];
-       i < set->m_gtoIndices[moIndex+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    xxx += set->m_gtoCN[cIndex++] * tmpGTO;
-    xxy += set->m_gtoCN[cIndex++] * tmpGTO;
-    xxz += set->m_gtoCN[cIndex++] * tmpGTO;
-    xyy += set->m_gtoCN[cIndex++] * tmpGTO;
-    xyz += set->m_gtoCN[cIndex++] * tmpGTO;
-    xzz += set->m_gtoCN[cIndex++] * tmpGTO;
-    yyy += set->m_gtoCN[cIndex++] * tmpGTO;
-    yyz += set->m_gtoCN[cIndex++] * tmpGTO;
-    yzz += set->m_gtoCN[cIndex++] * tmpGTO;
-    zzz += set->m_gtoCN[cIndex++] * tmpGTO;
+  switch (type) {
+  case S:
+    break;
+  case P:
+    for (unsigned int k = kBegin; k < kEnd; ++k) {
+      v[k]       *= x[k];
+      v[n + k]   *= y[k];
+      v[2*n + k] *= z[k];
+    }
+    break;
+  case D:
+    for (unsigned int k = kBegin; k < kEnd; ++k) {
+      v[k]       *= x[k] * x[k];
+      v[n + k]   *= y[k] * y[k];
+      v[2*n + k] *= z[k] * z[k];
+      v[3*n + k] *= x[k] * y[k];
+      v[4*n + k] *= x[k] * z[k];
+      v[5*n + k] *= y[k] * z[k];
+    }
+    break;
+  case D5:
+    for (unsigned int k = kBegin; k < kEnd; ++k) {
+      v[k]       *= 3.0 * z[k] * z[k] - r2[k];
+      v[n + k]   *= x[k] * z[k];
+      v[2*n + k] *= y[k] * z[k];
+      v[3*n + k] *= x[k] * x[k] - y[k] * y[k];
+      v[4*n + k] *= x[k] * y[k];
+    }
+    break;
+  case F:
+    for (unsigned int k = kBegin; k < kEnd; ++k) {
+      double xx = x[k] * x[k], yy = y[k] * y[k], zz = z[k] * z[k];
+      v[k]       *= xx * x[k];
+      v[n + k]   *= xx * y[k];
+      v[2*n + k] *= xx * z[k];
+      v[3*n + k] *= x[k] * yy;
+      v[4*n + k] *= x[k] * y[k] * z[k];
+      v[5*n + k] *= x[k] * zz;
+      v[6*n + k] *= yy * y[k];
+      v[7*n + k] *= yy * z[k];
+      v[8*n + k] *= y[k] * zz;
+      v[9*n + k] *= zz * z[k];
+    }
+    break;
+  case F7:
+    if (!orca) {
+      const double root6 = 2.449489742783178;
+      const double root60 = 7.745966692414834;
+      const double root360 = 18.973665961010276;
+      for (unsigned int k = kBegin; k < kEnd; ++k) {
+        double xx = x[k] * x[k], yy = y[k] * y[k], zz = z[k] * z[k];
+        double xxx = xx * x[k], xxy = xx * y[k], xxz = xx * z[k];
+        double xyy = x[k] * yy, xzz = x[k] * zz, yyy = yy * y[k];
+        double yyz = yy * z[k], yzz = y[k] * zz, zzz = zz * z[k];
+        v[k]       *= zzz - 3.0/2.0 * (xxz + yyz);
+        v[n + k]   *= (6.0 * xzz - 3.0/2.0 * (xxx + xyy)) / root6;
+        v[2*n + k] *= (6.0 * yzz - 3.0/2.0 * (xxy + yyy)) / root6;
+        v[3*n + k] *= (15.0 * (xxz - yyz)) / root60;
+        v[4*n + k] *= (30.0 * x[k] * y[k] * z[k]) / root60;
+        v[5*n + k] *= (15.0 * xxx - 45.0 * xyy) / root360;
+        v[6*n + k] *= (45.0 * xxy - 15.0 * yyy) / root360;
+      }
+    } else {
+      for (unsigned int k = kBegin; k < kEnd; ++k) {
+        double xx = x[k] * x[k], yy = y[k] * y[k], zz = z[k] * z[k];
+        v[k]       *= -3.0 * xx * z[k] - 3.0 * yy * z[k] + 2.0 * zz * z[k];
+        v[n + k]   *= x[k] * (-xx - yy + 4.0 * zz);
+        v[2*n + k] *= y[k] * (-xx - yy + 4.0 * zz);
+        v[3*n + k] *= (xx - yy) * z[k];
+        v[4*n + k] *= x[k] * y[k] * z[k];
+        v[5*n + k] *= x[k] * (-xx + 3.0 * yy);
+        v[6*n + k] *= y[k] * (-3.0 * xx + yy);
+      }
+    }
+    break;
+  case G9:
+    for (unsigned int k = kBegin; k < kEnd; ++k) {
+      double xx = x[k] * x[k], yy = y[k] * y[k], zz = z[k] * z[k];
+      double xy = x[k] * y[k], xz = x[k] * z[k], yz = y[k] * z[k];
+      double dr2 = r2[k];
+      double G1tmp = 7.0 * zz - 3.0 * dr2;
+      double G2tmp = 7.0 * zz - dr2;
+      v[k]       *= 35.0 * zz * zz - 30.0 * zz * dr2 + 3.0 * dr2 * dr2;
+      v[n + k]   *= G1tmp * xz;
+      v[2*n + k] *= G1tmp * yz;
+      v[3*n + k] *= (xx - yy) * G2tmp;
+      v[4*n + k] *= xy * G2tmp;
+      v[5*n + k] *= (xx - 3.0 * yy) * xz;
+      v[6*n + k] *= (3.0 * xx - yy) * yz;
+      v[7*n + k] *= xx * xx - 6.0 * xx * yy + yy * yy;
+      v[8*n + k] *= (xx - yy) * xy;
+    }
+    break;
+  case H11:
+    for (unsigned int k = kBegin; k < kEnd; ++k) {
+      double xx = x[k] * x[k], yy = y[k] * y[k], zz = z[k] * z[k];
+      double xxxx = xx * xx, yyyy = yy * yy, xxyy = xx * yy;
+      double xyz = x[k] * y[k] * z[k];
+      double dr2 = r2[k];
+      double H1tmp = 21.0 * zz * zz - 14.0 * zz * dr2 + dr2 * dr2;
+      double H2tmp = 3.0 * zz - dr2;
+      double H3tmp = 9.0 * zz - dr2;
+      v[k]        *= z[k] * (63.0 * zz * zz - 70.0 * zz * dr2
+                             + 15.0 * dr2 * dr2);
+      v[n + k]    *= x[k] * H1tmp;
+      v[2*n + k]  *= y[k] * H1tmp;
+      v[3*n + k]  *= z[k] * (xx - yy) * H2tmp;
+      v[4*n + k]  *= xyz * H2tmp;
+      v[5*n + k]  *= x[k] * (xx - 3.0 * yy) * H3tmp;
+      v[6*n + k]  *= y[k] * (3.0 * xx - yy) * H3tmp;
+      v[7*n + k]  *= z[k] * (xxxx - 6.0 * xxyy + yyyy);
+      v[8*n + k]  *= xyz * (xx - yy);
+      v[9*n + k]  *= x[k] * (xxxx - 10.0 * xxyy + 5.0 * yyyy);
+      v[10*n + k] *= y[k] * (5.0 * xxxx - 10.0 * xxyy + yyyy);
+    }
+    break;
+  case I13:
+    for (unsigned int k = kBegin; k < kEnd; ++k) {
+      double xx = x[k] * x[k], yy = y[k] * y[k], zz = z[k] * z[k];
+      double xy = x[k] * y[k], xz = x[k] * z[k], yz = y[k] * z[k];
+      double x4 = xx * xx, y4 = yy * yy, z4 = zz * zz;
+      double dr2 = r2[k];
+      double I1tmp = 33.0 * z4 - 30.0 * zz * dr2 + 5.0 * dr2 * dr2;
+      double I2tmp = 33.0 * z4 - 18.0 * zz * dr2 + dr2 * dr2;
+      double I3tmp = 11.0 * zz - 3.0 * dr2;
+      double I4tmp = 11.0 * zz - dr2;
+      double I5tmp = 5.0 * x4 - 10.0 * xx * yy + y4;
+      v[k]        *= 231.0 * z4 * zz - 315.0 * z4 * dr2
+          + 105.0 * zz * dr2 * dr2 - 5.0 * dr2 * dr2 * dr2;
+      v[n + k]    *= xz * I1tmp;
+      v[2*n + k]  *= yz * I1tmp;
+      v[3*n + k]  *= (xx - yy) * I2tmp;
+      v[4*n + k]  *= xy * I2tmp;
+      v[5*n + k]  *= xz * (3.0 * xx - yy) * I3tmp;
+      v[6*n + k]  *= yz * (xx - 3.0 * yy) * I3tmp;
+      v[7*n + k]  *= (x4 - 6.0 * xx * yy + y4) * I4tmp;
+      v[8*n + k]  *= xy * (xx - yy) * I4tmp;
+      v[9*n + k]  *= xz * I5tmp;
+      v[10*n + k] *= yz * I5tmp;
+      v[11*n + k] *= x4 * xx - 15.0 * x4 * yy + 15.0 * xx * y4 - y4 * yy;
+      v[12*n + k] *= xy * (3.0 * x4 - 10.0 * xx * yy + 3.0 * y4);
+    }
+    break;
+  default:
+    ;
   }
-
-  // Calculate the prefactors
-  double Fxxx = set->m_moMatrix.coeffRef(baseIndex  , indexMO) * \
-                delta.x() * delta.x() * delta.x();
-  double Fxxy = set->m_moMatrix.coeffRef(baseIndex+1, indexMO) * \
-                delta.x() * delta.x() * delta.y();
-  double Fxxz = set->m_moMatrix.coeffRef(baseIndex+2, indexMO) * \
-                delta.x() * delta.x() * delta.z();
-  double Fxyy = set->m_moMatrix.coeffRef(baseIndex+3, indexMO) * \
-                delta.x() * delta.y() * delta.y();
-  double Fxyz = set->m_moMatrix.coeffRef(baseIndex+4, indexMO) * \
-                delta.x() * delta.y() * delta.z();
-  double Fxzz = set->m_moMatrix.coeffRef(baseIndex+5, indexMO) * \
-                delta.x() * delta.z() * delta.z();
-  double Fyyy = set->m_moMatrix.coeffRef(baseIndex+6, indexMO) * \
-                delta.y() * delta.y() * delta.y();
-  double Fyyz = set->m_moMatrix.coeffRef(baseIndex+7, indexMO) * \
-                delta.y() * delta.y() * delta.z();
-  double Fyzz = set->m_moMatrix.coeffRef(baseIndex+8, indexMO) * \
-                delta.y() * delta.z() * delta.z();
-  double Fzzz = set->m_moMatrix.coeffRef(baseIndex+9, indexMO) * \
-                delta.z() * delta.z() * delta.z();
-
-  return Fxxx*xxx + Fxxy*xxy + Fxxz*xxz + Fxyy*xyy + Fxyz*xyz \
-        +Fxzz*xzz + Fyyy*yyy + Fyyz*yyz + Fyzz*yzz + Fzzz*zzz;
 }
 
-inline double GaussianSet::pointD5(GaussianSet *set, unsigned int moIndex,
-                                   const Vector3d &delta,
-                                   double dr2, unsigned int indexMO)
+unsigned int GaussianSet::evaluateShell(GaussianSet *set, unsigned int basis,
+                                        GaussianPoints &points, double *v)
 {
-  // D type orbitals have five components and each component has a different
-  // MO weighting. Many things can be cached to save time
-  unsigned int baseIndex = set->m_moIndices[moIndex];
-  double d0 = 0.0, d1p = 0.0, d1n = 0.0, d2p = 0.0, d2n = 0.0;
-
-  // Now iterate through the D type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[moIndex];
-  for (unsigned int i = set->m_gtoIndices[moIndex];
-       i < set->m_gtoIndices[moIndex+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    d0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    d1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    d1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    d2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    d2n += set->m_gtoCN[cIndex++] * tmpGTO;
+  int type = set->m_symmetry[basis];
+  unsigned int components = shellComponents(type, set->m_useOrcaNorm);
+  if (!components) // Not handled - return a zero contribution
+    return 0;
+
+  const unsigned int n = points.size;
+  const unsigned int kBegin = points.begin;
+  const unsigned int kEnd = points.end;
+  const double *z = &points.z[0];
+  const double *r2 = &points.r2[0];
+  const double h = points.step;
+  double *gto = &points.gto[0];
+
+  // Components with the same contraction coefficients as the one before them
+  // share its radial part, e.g. all three of a P shell
+  unsigned int cStart = set->m_cIndices[basis];
+  unsigned int gStart = set->m_gtoIndices[basis];
+  unsigned int gEnd = set->m_gtoIndices[basis+1];
+  bool shared[MAX_SHELL_COMPONENTS];
+  shared[0] = false;
+  for (unsigned int c = 1; c < components; ++c) {
+    shared[c] = true;
+    for (unsigned int j = 0; j < gEnd - gStart; ++j) {
+      unsigned int cIndex = cStart + j * components + c;
+      if (set->m_gtoCN[cIndex] != set->m_gtoCN[cIndex - 1]) {
+        shared[c] = false;
+        break;
+      }
+    }
   }
 
-  // Calculate the prefactors
-  double xx = delta.x() * delta.x();
-  double yy = delta.y() * delta.y();
-  double zz = delta.z() * delta.z();
-  double xy = delta.x() * delta.y();
-  double xz = delta.x() * delta.z();
-  double yz = delta.y() * delta.z();
-
-//  double D0  = set->m_moMatrix.coeffRef(baseIndex  , indexMO) * (zz - dr2);    <----- wrong formula - changed to 3*z^2 - r^2   by Dagmar Lenk
-  double D0  = set->m_moMatrix.coeffRef(baseIndex  , indexMO) * (3*zz - dr2);
-
-  double D1p = set->m_moMatrix.coeffRef(baseIndex+1, indexMO) * xz;
-  double D1n = set->m_moMatrix.coeffRef(baseIndex+2, indexMO) * yz;
-  double D2p = set->m_moMatrix.coeffRef(baseIndex+3, indexMO) * (xx - yy);
-  double D2n = set->m_moMatrix.coeffRef(baseIndex+4, indexMO) * xy;
-
-  return D0*d0 + D1p*d1p + D1n*d1n + D2p*d2p + D2n*d2n;
-}
-
-inline double GaussianSet::pointF7(GaussianSet *set, unsigned int moIndex,
-                                   const Vector3d &delta,
-                                   double dr2, unsigned int indexMO)
-{
-  // Spherical F type orbitals have 7 components and each component has a different
-  // MO weighting. Many things can be cached to save time
-  unsigned int baseIndex = set->m_moIndices[moIndex];
-  double f0 = 0.0, f1p = 0.0, f1n = 0.0, f2p = 0.0, f2n = 0.0, f3p = 0.0, f3n = 0.0;
-
-  // Now iterate through the F type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[moIndex];
-  for (unsigned int i = set->m_gtoIndices[moIndex];
-       i < set->m_gtoIndices[moIndex+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    f0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    f1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    f1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    f2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    f2n += set->m_gtoCN[cIndex++] * tmpGTO;
-    f3p += set->m_gtoCN[cIndex++] * tmpGTO;
-    f3n += set->m_gtoCN[cIndex++] * tmpGTO;
+  for (unsigned int c = 0; c < components; ++c)
+    if (!shared[c])
+      for (unsigned int k = kBegin; k < kEnd; ++k)
+        v[c * n + k] = 0.0;
+
+  // Only z changes along the row, so the exponential can be stepped outwards
+  // from the point closest to the centre with one multiplication per point
+  double kNearest = floor(-z[0] / h + 0.5);
+  unsigned int kMid = static_cast<unsigned int>(
+        std::min(std::max(kNearest, double(kBegin)), double(kEnd - 1)));
+
+  // The contracted radial part of each component
+  unsigned int cIndex = cStart;
+  for (unsigned int i = gStart; i < gEnd; ++i) {
+    double alpha = set->m_gtoA[i];
+    double factor = exp(-2.0 * alpha * h * h);
+    gto[kMid] = exp(-alpha * r2[kMid]);
+    double ratio = exp(-alpha * (2.0 * z[kMid] * h + h * h));
+    for (unsigned int k = kMid + 1; k < kEnd; ++k) {
+      gto[k] = gto[k-1] * ratio;
+      ratio *= factor;
+    }
+    ratio = exp(-alpha * (h * h - 2.0 * z[kMid] * h));
+    for (unsigned int k = kMid; k > kBegin; --k) {
+      gto[k-1] = gto[k] * ratio;
+      ratio *= factor;
+    }
+    for (unsigned int c = 0; c < components; ++c) {
+      double cn = set->m_gtoCN[cIndex++];
+      if (shared[c])
+        continue;
+      double *vc = v + c * n;
+      for (unsigned int k = kBegin; k < kEnd; ++k)
+        vc[k] += cn * gto[k];
+    }
   }
+  for (unsigned int c = 1; c < components; ++c)
+    if (shared[c])
+      for (unsigned int k = kBegin; k < kEnd; ++k)
+        v[c * n + k] = v[(c - 1) * n + k];
 
-  // Calculate the prefactors
-  double xxx = delta.x() * delta.x() * delta.x();
-  double xxy = delta.x() * delta.x() * delta.y();
-  double xxz = delta.x() * delta.x() * delta.z();
-  double xyy = delta.x() * delta.y() * delta.y();
-  double xyz = delta.x() * delta.y() * delta.z();
-  double xzz = delta.x() * delta.z() * delta.z();
-  double yyy = delta.y() * delta.y() * delta.y();
-  double yyz = delta.y() * delta.y() * delta.z();
-  double yzz = delta.y() * delta.z() * delta.z();
-  double zzz = delta.z() * delta.z() * delta.z();
-
-  double root6 = 2.449489742783178;
-  double root60 = 7.745966692414834;
-  double root360 = 18.973665961010276;
-
-  double F0  = set->m_moMatrix.coeffRef(baseIndex  , indexMO) *  \
-    (zzz - 3.0/2.0 * (xxz + yyz));
-  double F1p = set->m_moMatrix.coeffRef(baseIndex+1, indexMO) *  \
-    ((6.0 * xzz - 3.0/2.0 * (xxx + xyy))/root6);
-  double F1n = set->m_moMatrix.coeffRef(baseIndex+2, indexMO) *  \
-    ((6.0 * yzz - 3.0/2.0 * (xxy + yyy))/root6);
-  double F2p = set->m_moMatrix.coeffRef(baseIndex+3, indexMO) *  \
-    ((15.0 * (xxz - yyz))/root60);
-  double F2n = set->m_moMatrix.coeffRef(baseIndex+4, indexMO) *  \
-    ((30.0 * xyz)/root60);
-  double F3p = set->m_moMatrix.coeffRef(baseIndex+5, indexMO) *  \
-    ((15.0 * xxx - 45.0 * xyy)/root360);
-  double F3n = set->m_moMatrix.coeffRef(baseIndex+6, indexMO) *  \
-    ((45.0 * xxy - 15.0 * yyy)/root360);
-
-  return  F0*f0 + F1p*f1p + F1n*f1n + F2p*f2p + F2n*f2n + F3p*f3p + F3n*f3n;
-}
-
-inline double GaussianSet::pointOrcaD5(GaussianSet *set, unsigned int moIndex,
-                                   const Vector3d &delta,
-                                   double dr2, unsigned int indexMO)
-{
-  // D type orbitals have five components and each component has a different
-  // MO weighting. Many things can be cached to save time
-  unsigned int baseIndex = set->m_moIndices[moIndex];
-  double d0 = 0.0, d1p = 0.0, d1n = 0.0, d2p = 0.0, d2n = 0.0;
-
-  // Now iterate through the D type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[moIndex];
-  for (unsigned int i = set->m_gtoIndices[moIndex];
-       i < set->m_gtoIndices[moIndex+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    d0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    d1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    d1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    d2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    d2n += set->m_gtoCN[cIndex++] * tmpGTO;
-  }
+  multiplyAngular(type, set->m_useOrcaNorm, points, v);
 
-  // Calculate the prefactors
-  double xx = delta.x() * delta.x();
-  double yy = delta.y() * delta.y();
-  double zz = delta.z() * delta.z();
-  double xy = delta.x() * delta.y();
-  double xz = delta.x() * delta.z();
-  double yz = delta.y() * delta.z();
-
-  double D0  = set->m_moMatrix.coeffRef(baseIndex  , indexMO) * (3*zz - dr2);
-  double D1p = set->m_moMatrix.coeffRef(baseIndex+1, indexMO) * xz;
-  double D1n = set->m_moMatrix.coeffRef(baseIndex+2, indexMO) * yz;
-  double D2p = set->m_moMatrix.coeffRef(baseIndex+3, indexMO) * (xx - yy);
-  double D2n = set->m_moMatrix.coeffRef(baseIndex+4, indexMO) * xy;
-
-  return D0*d0 + D1p*d1p + D1n*d1n + D2p*d2p + D2n*d2n;
+  return components;
 }
 
-inline double GaussianSet::pointOrcaF7(GaussianSet *set, unsigned int moIndex,
-                                   const Vector3d &delta,
-                                   double dr2, unsigned int indexMO)
+void GaussianSet::processBlock(GaussianBlock &block)
 {
-  // F type orbitals have 7 components and each component has a different
-  // MO weighting. Many things can be cached to save time
-  unsigned int baseIndex = set->m_moIndices[moIndex];
-  double f0 = 0.0, f1p = 0.0, f1n = 0.0, f2p = 0.0, f2n = 0.0, f3p = 0.0, f3n = 0.0;
-
-  // Now iterate through the F type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[moIndex];
-  for (unsigned int i = set->m_gtoIndices[moIndex];
-       i < set->m_gtoIndices[moIndex+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    f0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    f1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    f1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    f2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    f2n += set->m_gtoCN[cIndex++] * tmpGTO;
-    f3p += set->m_gtoCN[cIndex++] * tmpGTO;
-    f3n += set->m_gtoCN[cIndex++] * tmpGTO;
+  GaussianSet *set = block.set;
+  const unsigned int n = block.size;
+  const unsigned int numMOs = set->m_moBlock.cols();
+
+  // Calculate the position of the first point and the step along the row
+  Vector3d origin = block.tCube->position(block.first) * ANGSTROM_TO_BOHR;
+  double step = block.tCube->spacing().z() * ANGSTROM_TO_BOHR;
+
+  // All scratch space is allocated once per block, not once per point
+  GaussianPoints points(n, step);
+
+  // The values of a chunk of basis functions along the row, one per column,
+  // and the matching rows of the MO coefficients
+  MatrixXd phi(n, BASIS_CHUNK_SIZE + MAX_SHELL_COMPONENTS);
+  MatrixXd coeffs(BASIS_CHUNK_SIZE + MAX_SHELL_COMPONENTS, numMOs);
+  MatrixXd result = MatrixXd::Zero(n, numMOs);
+  unsigned int used = 0;
+
+  // Only visit the shells that reach this row
+  vector<unsigned int> shells;
+  set->shellsNearRow(origin, step, n, shells);
+
+  for (unsigned int s = 0; s < shells.size(); ++s) {
+    unsigned int i = shells[s];
+    unsigned int baseIndex = set->m_moIndices[i];
+    unsigned int components = shellComponents(set->m_symmetry[i],
+                                              set->m_useOrcaNorm);
+    // If the MO coefficients are all very small skip the shell
+    if (!components || isSmall(set->m_moBlock.middleRows(baseIndex,
+                                                         components)
+                               .cwiseAbs().maxCoeff()))
+      continue;
+    if (!set->setPoints(i, origin, step, points))
+      continue;
+
+    // The shell is evaluated straight into the next columns of the chunk
+    double *v = &phi.coeffRef(0, used);
+    evaluateShell(set, i, points, v);
+    for (unsigned int c = 0; c < components; ++c) {
+      for (unsigned int k = 0; k < points.begin; ++k)
+        v[c * n + k] = 0.0;
+      for (unsigned int k = points.end; k < n; ++k)
+        v[c * n + k] = 0.0;
+    }
+    coeffs.middleRows(used, components) =
+        set->m_moBlock.middleRows(baseIndex, components);
+    used += components;
+
+    // Contract the chunk with the MO coefficients once it is full
+    if (used >= BASIS_CHUNK_SIZE) {
+      result.noalias() += phi.leftCols(used) * coeffs.topRows(used);
+      used = 0;
+    }
   }
-
-  // Calculate the prefactors
-  double xyz = delta.x() * delta.y() * delta.z();
-  double xxx = delta.x() * delta.x() * delta.x();
-  double yyy = delta.y() * delta.y() * delta.y();
-  double zzz = delta.z() * delta.z() * delta.z();
-
-  double xxz = delta.x() * delta.x() * delta.z();
-  double xxy = delta.x() * delta.x() * delta.y();
-
-  double yyz = delta.y() * delta.y() * delta.z();
-  double yyx = delta.y() * delta.y() * delta.x();
-
-  double zzx = delta.z() * delta.z() * delta.x();
-  double zzy = delta.z() * delta.z() * delta.y();
-
-  double F0  = set->m_moMatrix.coeffRef(baseIndex  , indexMO) * (-3*xxz - 3*yyz + 2*zzz);
-  double F1p = set->m_moMatrix.coeffRef(baseIndex+1, indexMO) * (-xxx - yyx + 4*zzx);
-  double F1n = set->m_moMatrix.coeffRef(baseIndex+2, indexMO) * (-xxy -yyy + 4*zzy);
-  double F2p = set->m_moMatrix.coeffRef(baseIndex+3, indexMO) * (-yyz +xxz);
-  double F2n = set->m_moMatrix.coeffRef(baseIndex+4, indexMO) * xyz;
-  double F3p = set->m_moMatrix.coeffRef(baseIndex+5, indexMO) * (-xxx + 3*yyx);
-  double F3n = set->m_moMatrix.coeffRef(baseIndex+6, indexMO) *(-3*xxy + yyy);
-
-  return  F0*f0 + F1p*f1p + F1n*f1n + F2p*f2p + F2n*f2n + F3p*f3p + F3n*f3n;
-}
-
-inline double GaussianSet::pointOrcaG9(GaussianSet *set, unsigned int moIndex,
-                                   const Vector3d &delta,
-                                   double dr2, unsigned int indexMO)
-{
-  // G type orbitals have 9 components and each component has a different
-  // MO weighting. Many things can be cached to save time
-  unsigned int baseIndex = set->m_moIndices[moIndex];
-  double g0 = 0.0, g1p = 0.0, g1n = 0.0, g2p = 0.0, g2n = 0.0, g3p = 0.0, g3n = 0.0, g4p = 0.0, g4n = 0.0;
-
-  // Now iterate through the G type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[moIndex];
-  for (unsigned int i = set->m_gtoIndices[moIndex];
-       i < set->m_gtoIndices[moIndex+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    g0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    g1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    g1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    g2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    g2n += set->m_gtoCN[cIndex++] * tmpGTO;
-    g3p += set->m_gtoCN[cIndex++] * tmpGTO;
-    g3n += set->m_gtoCN[cIndex++] * tmpGTO;
-    g4p += set->m_gtoCN[cIndex++] * tmpGTO;
-    g4n += set->m_gtoCN[cIndex++] * tmpGTO;
+  if (used)
+    result.noalias() += phi.leftCols(used) * coeffs.topRows(used);
+
+  // The block is a row along z, write the results straight into the cubes
+  for (unsigned int m = 0; m < numMOs; ++m) {
+    double *out = &(*set->m_cubes[m]->data())[block.first];
+    for (unsigned int k = 0; k < n; ++k)
+      out[k] = result.coeff(k, m);
   }
-
-  // Calculate the prefactors
-
-  double xx = delta.x() * delta.x();
-  double yy = delta.y() * delta.y();
-  double zz = delta.z() * delta.z();
-
-  double xxxx = xx*xx;
-  double yyyy = yy*yy;
-  double zzzz = zz*zz;
-
-  double xz = delta.x() * delta.z();
-  double xy = delta.x() * delta.y();
-  double yz = delta.y() * delta.z();
-
-  // NormG0 * (35*z^4 - 30*z^2*r^2 +3*r^4) *exp(-alpha*r^2)
-  double G0  = set->m_moMatrix.coeffRef(baseIndex  , indexMO) * (35*zzzz - 30*zz*dr2 +3*dr2*dr2);
-
-  // NormG1p * x*z * (7*z^2 - 3*r^2) *exp(-alpha*r^2)
-  // NormG1n * y*z * (7*z^2 - 3*r^2) *exp(-alpha*r^2)
-  double G1tmp = (7*zz - 3*dr2);
-  double G1p = set->m_moMatrix.coeffRef(baseIndex+1, indexMO) * G1tmp * xz;
-  double G1n = set->m_moMatrix.coeffRef(baseIndex+2, indexMO) * G1tmp * yz;
-
-  // NormG2p * (x^2 - y^2) * (7*z^2 - r^2) *exp(-alpha*r^2)
-  // NormG2n * x * y * (7*z^2 - r^2) *exp(-alpha*r^2)
-  double G2tmp = (7*zz - dr2);
-  double G2p = set->m_moMatrix.coeffRef(baseIndex+3, indexMO) * (xx - yy) * G2tmp;
-  double G2n = set->m_moMatrix.coeffRef(baseIndex+4, indexMO) * xy * G2tmp;
-
-  // NormG3p * ... *exp(-alpha*r^2)
-  // NormG3n * ... *exp(-alpha*r^2)
-  double G3p = set->m_moMatrix.coeffRef(baseIndex+5, indexMO) * (xx - 3*yy) * xz;
-  double G3n = set->m_moMatrix.coeffRef(baseIndex+6, indexMO) * (3*xx - yy) * yz;
-
-  // NormG4p * (x^4 - 6*x^2*y^2 + y^4) *exp(-alpha*r^2)
-  // NormG4n * x * y * (x^2 - y^2) *exp(-alpha*r^2)
-  double G4p = set->m_moMatrix.coeffRef(baseIndex+7, indexMO) * (xxxx - 6*xx*yy + yyyy);
-  double G4n = set->m_moMatrix.coeffRef(baseIndex+8, indexMO) * (xx - yy) * xy;
-
-  return  G0*g0 + G1p*g1p + G1n*g1n + G2p*g2p + G2n*g2n + G3p*g3p + G3n*g3n + G4p*g4p + G4n*g4n;
 }
 
-inline double GaussianSet::pointOrcaH11(GaussianSet *set, unsigned int moIndex,
-                                   const Vector3d &delta,
-                                   double dr2, unsigned int indexMO)
+void GaussianSet::processDensityBlock(GaussianBlock &block)
 {
-  // H type orbitals have 11 components and each component has a different
-  // MO weighting. Many things can be cached to save time
-  unsigned int baseIndex = set->m_moIndices[moIndex];
-  double h0 = 0.0, h1p = 0.0, h1n = 0.0, h2p = 0.0, h2n = 0.0, h3p = 0.0, h3n = 0.0, h4p = 0.0, h4n = 0.0, h5p = 0.0, h5n = 0.0;
-
-  // Now iterate through the H type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[moIndex];
-  for (unsigned int i = set->m_gtoIndices[moIndex];
-       i < set->m_gtoIndices[moIndex+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    h0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    h1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    h1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    h2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    h2n += set->m_gtoCN[cIndex++] * tmpGTO;
-    h3p += set->m_gtoCN[cIndex++] * tmpGTO;
-    h3n += set->m_gtoCN[cIndex++] * tmpGTO;
-    h4p += set->m_gtoCN[cIndex++] * tmpGTO;
-    h4n += set->m_gtoCN[cIndex++] * tmpGTO;
-    h5p += set->m_gtoCN[cIndex++] * tmpGTO;
-    h5n += set->m_gtoCN[cIndex++] * tmpGTO;
+  GaussianSet *set = block.set;
+  const unsigned int n = block.size;
+
+  // Calculate the position of the first point and the step along the row
+  Vector3d origin = block.tCube->position(block.first) * ANGSTROM_TO_BOHR;
+  double step = block.tCube->spacing().z() * ANGSTROM_TO_BOHR;
+
+  GaussianPoints points(n, step);
+
+  // Only visit the shells that reach this row
+  vector<unsigned int> shells;
+  set->shellsNearRow(origin, step, n, shells);
+  unsigned int size = 0;
+  for (unsigned int s = 0; s < shells.size(); ++s)
+    if (set->m_densityShells[shells[s]])
+      size += shellComponents(set->m_symmetry[shells[s]], set->m_useOrcaNorm);
+
+  // The values of the basis functions along the row, one per column, and
+  // their indices in the density matrix
+  MatrixXd phi(n, size);
+  vector<unsigned int> indices;
+  indices.reserve(size);
+
+  for (unsigned int s = 0; s < shells.size(); ++s) {
+    unsigned int i = shells[s];
+    if (!set->m_densityShells[i] || !set->setPoints(i, origin, step, points))
+      continue;
+
+    double *v = &phi.coeffRef(0, indices.size());
+    unsigned int components = evaluateShell(set, i, points, v);
+    for (unsigned int c = 0; c < components; ++c) {
+      for (unsigned int k = 0; k < points.begin; ++k)
+        v[c * n + k] = 0.0;
+      for (unsigned int k = points.end; k < n; ++k)
+        v[c * n + k] = 0.0;
+      indices.push_back(set->m_moIndices[i] + c);
+    }
   }
+  const unsigned int used = indices.size();
 
-  // Calculate the prefactors
-
-  double xx = delta.x() * delta.x();
-  double yy = delta.y() * delta.y();
-  double zz = delta.z() * delta.z();
-
-  double xxxx = xx*xx;
-  double yyyy = yy*yy;
-  double zzzz = zz*zz;
-  double xxyy = xx*yy;
-//  double yyzz = yy*zz;
-//  double xxzz = xx*zz;
-
-  double x = delta.x();
-  double y = delta.y();
-  double z = delta.z();
-  double xyz = x*y*z;
-
-  // NormH0 * z * (63*z^4 - 70*z^2*r^2 + 15*r^4) *exp(-alpha*r^2)
-  double H0  = set->m_moMatrix.coeffRef(baseIndex  , indexMO) * z * (63*zzzz - 70*zz*dr2 +15*dr2*dr2);
-
-  // NormH1p * x * (21*z^4 -14*z^2*r^2 + r^4) *exp(-alpha*r^2)
-  // NormH1n * y * (21*z^4 -14*z^2*r^2 + r^4) *exp(-alpha*r^2)
-  double H1tmp = 21*zzzz -14*zz*dr2 + dr2*dr2;
-  double H1p = set->m_moMatrix.coeffRef(baseIndex+1, indexMO) * x * H1tmp;
-  double H1n = set->m_moMatrix.coeffRef(baseIndex+2, indexMO) * y * H1tmp;
-
-  // NormH2p * z * (x^2 - y^2) * (3*z^2 - r^2) *exp(-alpha*r^2)
-  // NormH2n * x*y*z * (3*z^2 - r^2) *exp(-alpha*r^2)
-  double H2tmp = (3*zz - dr2);
-  double H2p = set->m_moMatrix.coeffRef(baseIndex+3, indexMO) * z * (xx - yy) * H2tmp;
-  double H2n = set->m_moMatrix.coeffRef(baseIndex+4, indexMO) * xyz * H2tmp;
-
-  // NormH3p * x * (x^2 - 3*y^2) * (9*z^2 - r^2) *exp(-alpha*r^2)
-  // NormH3n * y * (3*x^2 - y^2) * (9*z^2 - r^2) *exp(-alpha*r^2)
-  double H3tmp = (9*zz - dr2);
-  double H3p = set->m_moMatrix.coeffRef(baseIndex+5, indexMO) * x * (xx - 3*yy) * H3tmp;
-  double H3n = set->m_moMatrix.coeffRef(baseIndex+6, indexMO) * y * (3*xx - yy) * H3tmp;
-
-  // NormH4p * z * (x^4 - 6*x^2*y^2 + y^4) *exp(-alpha*r^2)
-  // NormH4n * x*y*z * (x^2 - y^2) *exp(-alpha*r^2)
-  double H4p = set->m_moMatrix.coeffRef(baseIndex+7, indexMO) * z*(xxxx - 6*xxyy + yyyy);
-  double H4n = set->m_moMatrix.coeffRef(baseIndex+8, indexMO) * xyz*(xx - yy);
-
-  // NormH5p * x * (x^4 - 10*x^2*y^2 + 5*y^4) *exp(-alpha*r^2)
-  // NormH5n * y * (5*x^4 - 10*x^2*y^2 + y^4) *exp(-alpha*r^2)
-  double H5p = set->m_moMatrix.coeffRef(baseIndex+9, indexMO) * x * (xxxx - 10*xxyy + 5*yyyy);
-  double H5n = set->m_moMatrix.coeffRef(baseIndex+10, indexMO) * y * (5*xxxx - 10*xxyy + yyyy);
-
-  return  H0*h0 + H1p*h1p + H1n*h1n + H2p*h2p + H2n*h2n + H3p*h3p + H3n*h3n + H4p*h4p + H4n*h4n + H5p*h5p + H5n*h5n;
-}
-
-
-inline double GaussianSet::pointOrcaI13(GaussianSet *set, unsigned int moIndex,
-                                   const Vector3d &delta,
-                                   double dr2, unsigned int indexMO)
-{
-  // I type orbitals have 13 components and each component has a different
-  // MO weighting. Many things can be cached to save time
-  unsigned int baseIndex = set->m_moIndices[moIndex];
-  double i0 = 0.0, i1p = 0.0, i1n = 0.0, i2p = 0.0, i2n = 0.0, i3p = 0.0, i3n = 0.0, i4p = 0.0, i4n = 0.0, i5p = 0.0, i5n = 0.0, i6p = 0.0, i6n = 0.0;
-
-  // Now iterate through the I type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[moIndex];
-  for (unsigned int i = set->m_gtoIndices[moIndex];
-       i < set->m_gtoIndices[moIndex+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    i0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    i1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    i1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    i2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    i2n += set->m_gtoCN[cIndex++] * tmpGTO;
-    i3p += set->m_gtoCN[cIndex++] * tmpGTO;
-    i3n += set->m_gtoCN[cIndex++] * tmpGTO;
-    i4p += set->m_gtoCN[cIndex++] * tmpGTO;
-    i4n += set->m_gtoCN[cIndex++] * tmpGTO;
-    i5p += set->m_gtoCN[cIndex++] * tmpGTO;
-    i5n += set->m_gtoCN[cIndex++] * tmpGTO;
-    i6p += set->m_gtoCN[cIndex++] * tmpGTO;
-    i6n += set->m_gtoCN[cIndex++] * tmpGTO;
+  // The block is a row along z, write the results straight into the cube
+  double *out = &(*set->m_cubes[0]->data())[block.first];
+  if (!used) {
+    for (unsigned int k = 0; k < n; ++k)
+      out[k] = 0.0;
+    return;
   }
 
-  // Calculate the prefactors
-
-  double xx = delta.x() * delta.x();
-  double yy = delta.y() * delta.y();
-  double zz = delta.z() * delta.z();
-
-  double xy = delta.x() * delta.y();
-  double xz = delta.x() * delta.z();
-  double yz = delta.y() * delta.z();
-
-  double x4 = xx*xx;
-  double x6 = x4*xx;
-  double y4 = yy*yy;
-  double y6 = y4*yy;
-
-  double z4 = zz*zz;
-  double z6 = z4 * zz;
-  double xxyy = xx*yy;
-
-
-  // NormI0 * (231*z^6 - 315*z^4*r^2 + 105*z^2*r^4 -5*r^6) *exp(-alpha*r^2)
-  double I0  = set->m_moMatrix.coeffRef(baseIndex  , indexMO) * (231*z6 - 315*z4*dr2 + 105*zz*dr2*dr2 - 5*dr2*dr2*dr2);
-
-  // NormI1p * x*z*(33z^4 - 30z^2*r^2 + 5*r^4) *exp(-alpha*r^2)
-  // NormI1n * y*z*(33z^4 - 30z^2*r^2 + 5*r^4) *exp(-alpha*r^2)
-  double I1tmp = 33.*z4 - 30.*zz*dr2 + 5.*dr2*dr2;
-  double I1p = set->m_moMatrix.coeffRef(baseIndex+1, indexMO) * xz * I1tmp;
-  double I1n = set->m_moMatrix.coeffRef(baseIndex+2, indexMO) * yz * I1tmp;
-
-  // NormI2p * ((x^2-y^2)(33*z4 -18*zz*r^2 +r^4)) *exp(-alpha*r^2)
-  // NormI2n * x*y*(33*z^4 - 18z^r^2 +r^4) *exp(-alpha*r^2)
-
-  double I2tmp = 33*z4 - 18*zz*dr2 + dr2*dr2;
-  double I2p = set->m_moMatrix.coeffRef(baseIndex+3, indexMO) * (xx - yy) * I2tmp;
-  double I2n = set->m_moMatrix.coeffRef(baseIndex+4, indexMO) * xy * I2tmp;
-
-  // NormI3p * x*z*(x^2 - 3y^2)*(11z^2 - 3r^2) *exp(-alpha*r^2)
-  // NormI3n * y*z*(3x^2 - y^2)*(11z^2 - 3r^2) *exp(-alpha*r^2)
-  double I3tmp = 11*zz - 3*dr2;
-  double I3p = set->m_moMatrix.coeffRef(baseIndex+5, indexMO) * xz * (3*xx - yy) * I3tmp;
-  double I3n = set->m_moMatrix.coeffRef(baseIndex+6, indexMO) * yz * (xx - 3*yy) * I3tmp;
-
-  // NormI4p * (x^4 - 6*x^2*y^2 +y^4)*(11z^2 - r^2)*exp(-alpha*r^2)
-  // NormI4n * x*y*(x^2 - y^2)(11z^2 - r^2) *exp(-alpha*r^2)
-  double I4tmp = 11*zz - dr2;
-  double I4p = set->m_moMatrix.coeffRef(baseIndex+7, indexMO) * (x4 - 6*xxyy +y4) * I4tmp;
-  double I4n = set->m_moMatrix.coeffRef(baseIndex+8, indexMO) * xy*(xx - yy) * I4tmp;
-
-  // NormI5p * xz(5x^4 - 10x^2*y^2 +y^4) *exp(-alpha*r^2)
-  // NormI5n * y*z*(5x^4 - 10x^2*y^2 +y^4) *exp(-alpha*r^2)
-  double I5tmp = 5*x4 - 10*xx*yy + y4;
-  double I5p = set->m_moMatrix.coeffRef(baseIndex+9, indexMO) * xz * I5tmp;
-  double I5n = set->m_moMatrix.coeffRef(baseIndex+10, indexMO) * yz * I5tmp;
-
-  // NormI6p * (x^6 - 15x^4*y^2 + 15x^2y^4 - y^6) *exp(-alpha*r^2)
-  // NormI6n * xy(3x^4 - 10x^2y^2 + 3y^4) *exp(-alpha*r^2)
-  double I6p = set->m_moMatrix.coeffRef(baseIndex+11, indexMO) * (x6 - 15*x4*yy + 15*xx*y4 - y6);
-  double I6n = set->m_moMatrix.coeffRef(baseIndex+12, indexMO) * xy * (3*x4 - 10*xx*yy + 3*y4);
-
-  return  I0*i0 + I1p*i1p + I1n*i1n + I2p*i2p + I2n*i2n + I3p*i3p + I3n*i3n + I4p*i4p + I4n*i4n + I5p*i5p + I5n*i5n + I6p*i6p + I6n* i6n;
+  // Gather the lower triangle of the density matrix for these basis
+  // functions, the indices are in ascending order
+  MatrixXd density(used, used);
+  for (unsigned int j = 0; j < used; ++j)
+    for (unsigned int i = j; i < used; ++i)
+      density.coeffRef(i, j) = set->m_density.coeff(indices[i], indices[j]);
+
+  // rho = diag(phi D phi^T), D is symmetric so only its lower triangle is used
+  MatrixXd phiD(n, used);
+  phiD.noalias() = phi.leftCols(used)
+      * density.selfadjointView<Eigen::Lower>();
+  Eigen::VectorXd rho = (phiD.array() * phi.leftCols(used).array())
+      .rowwise().sum();
+  for (unsigned int k = 0; k < n; ++k)
+    out[k] = rho[k];
 }
 
-
-
-
-inline void GaussianSet::pointS(GaussianSet *set, double dr2, int basis,
-                                Eigen::MatrixXd &out)
+void GaussianSet::initScreening()
 {
-  // S type orbitals - the simplest of the calculations with one component
-  double tmp = 0.0;
-  unsigned int cIndex = set->m_cIndices[basis];
-  for (unsigned int i = set->m_gtoIndices[basis];
-       i < set->m_gtoIndices[basis+1]; ++i) {
-    tmp += set->m_gtoCN[cIndex++] * exp(-set->m_gtoA[i] * dr2);
-  }
-  out.coeffRef(set->m_moIndices[basis], 0) = tmp;
-}
+  if (m_cutoffTolerance == m_screeningTolerance
+      && m_cutoffs.size() == m_symmetry.size())
+    return;
+  m_cutoffTolerance = m_screeningTolerance;
+  m_cutoffs.clear();
+  m_cellShells.clear();
+  if (m_cutoffTolerance <= 0.0 || m_symmetry.empty())
+    return;
 
-inline void GaussianSet::pointP(GaussianSet *set, const Vector3d &delta,
-                                double dr2, int basis,
-                                Eigen::MatrixXd &out)
-{
-  double x = 0.0, y = 0.0, z = 0.0;
-
-  // Now iterate through the P type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[basis];
-  for (unsigned int i = set->m_gtoIndices[basis];
-       i < set->m_gtoIndices[basis+1]; ++i) {
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    x += set->m_gtoCN[cIndex++] * tmpGTO;
-    y += set->m_gtoCN[cIndex++] * tmpGTO;
-    z += set->m_gtoCN[cIndex++] * tmpGTO;
+  // The angular parts are homogeneous polynomials, so find the largest value
+  // of each component on the unit sphere once per shell type
+  const unsigned int thetaSteps = 64, phiSteps = 128;
+  GaussianPoints sphere(thetaSteps * phiSteps);
+  for (unsigned int t = 0; t < thetaSteps; ++t) {
+    double theta = M_PI * (t + 0.5) / thetaSteps;
+    for (unsigned int p = 0; p < phiSteps; ++p) {
+      double phi = 2.0 * M_PI * p / phiSteps;
+      unsigned int k = t * phiSteps + p;
+      sphere.x[k] = sin(theta) * cos(phi);
+      sphere.y[k] = sin(theta) * sin(phi);
+      sphere.z[k] = cos(theta);
+      sphere.r2[k] = 1.0;
+    }
   }
+  vector<vector<double> > angularMax(UU + 1);
+  vector<double> values(MAX_SHELL_COMPONENTS * sphere.size);
+
+  // Now the cutoff radius of each shell, where the envelope of every
+  // component drops below the tolerance
+  m_cutoffs.resize(m_symmetry.size(), 0.0);
+  double maxCutoff = 0.0;
+  for (unsigned int i = 0; i < m_symmetry.size(); ++i) {
+    int type = m_symmetry[i];
+    unsigned int components = shellComponents(type, m_useOrcaNorm);
+    if (!components)
+      continue;
+    vector<double> &pmax = angularMax[type];
+    if (pmax.empty()) {
+      std::fill(values.begin(), values.end(), 1.0);
+      multiplyAngular(type, m_useOrcaNorm, sphere, &values[0]);
+      pmax.resize(components, 0.0);
+      for (unsigned int c = 0; c < components; ++c)
+        for (unsigned int k = 0; k < sphere.size; ++k)
+          pmax[c] = std::max(pmax[c], fabs(values[c * sphere.size + k]));
+      // Allow for the maximum falling between the sampled directions
+      for (unsigned int c = 0; c < components; ++c)
+        pmax[c] *= 1.05;
+    }
 
-  // Save values to the matrix
-  int baseIndex = set->m_moIndices[basis];
-  out.coeffRef(baseIndex  , 0) = x * delta.x();
-  out.coeffRef(baseIndex+1, 0) = y * delta.y();
-  out.coeffRef(baseIndex+2, 0) = z * delta.z();
-}
-
-inline void GaussianSet::pointD(GaussianSet *set, const Eigen::Vector3d &delta,
-                                double dr2, int basis,
-                                Eigen::MatrixXd &out)
-{
-  // D type orbitals have six components and each component has a different
-  // independent MO weighting. Many things can be cached to save time though
-  double xx = 0.0, yy = 0.0, zz = 0.0, xy = 0.0, xz = 0.0, yz = 0.0;
-
-  // Now iterate through the D type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[basis];
-  for (unsigned int i = set->m_gtoIndices[basis];
-       i < set->m_gtoIndices[basis+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    xx += set->m_gtoCN[cIndex++] * tmpGTO; // Dxx
-    yy += set->m_gtoCN[cIndex++] * tmpGTO; // Dyy
-    zz += set->m_gtoCN[cIndex++] * tmpGTO; // Dzz
-    xy += set->m_gtoCN[cIndex++] * tmpGTO; // Dxy
-    xz += set->m_gtoCN[cIndex++] * tmpGTO; // Dxz
-    yz += set->m_gtoCN[cIndex++] * tmpGTO; // Dyz
+    int l = shellAngularMomentum(type);
+    // Beyond the outermost peak of r^l exp(-a r^2) the envelope decreases
+    double rPeak = 0.0;
+    for (unsigned int j = m_gtoIndices[i]; j < m_gtoIndices[i+1]; ++j)
+      rPeak = std::max(rPeak, sqrt(0.5 * l / m_gtoA[j]));
+
+    double cutoff = 0.0;
+    for (unsigned int c = 0; c < components; ++c) {
+      double rLow = rPeak;
+      if (shellEnvelope(i, c, components, l, pmax[c], rLow)
+          < m_cutoffTolerance) {
+        cutoff = std::max(cutoff, rLow);
+        continue;
+      }
+      double rHigh = rLow + 1.0;
+      while (shellEnvelope(i, c, components, l, pmax[c], rHigh)
+             >= m_cutoffTolerance)
+        rHigh *= 2.0;
+      // Bisect to within a hundredth of a Bohr
+      while (rHigh - rLow > 0.01) {
+        double r = 0.5 * (rLow + rHigh);
+        if (shellEnvelope(i, c, components, l, pmax[c], r)
+            >= m_cutoffTolerance)
+          rLow = r;
+        else
+          rHigh = r;
+      }
+      cutoff = std::max(cutoff, rHigh);
+    }
+    m_cutoffs[i] = cutoff * cutoff;
+    maxCutoff = std::max(maxCutoff, cutoff);
   }
 
-  // Save values to the matrix
-  int baseIndex = set->m_moIndices[basis];
-  out.coeffRef(baseIndex  , 0) = delta.x() * delta.x() * xx;
-  out.coeffRef(baseIndex+1, 0) = delta.y() * delta.y() * yy;
-  out.coeffRef(baseIndex+2, 0) = delta.z() * delta.z() * zz;
-  out.coeffRef(baseIndex+3, 0) = delta.x() * delta.y() * xy;
-  out.coeffRef(baseIndex+4, 0) = delta.x() * delta.z() * xz;
-  out.coeffRef(baseIndex+5, 0) = delta.y() * delta.z() * yz;
-}
-
-inline void GaussianSet::pointF(GaussianSet *set, const Eigen::Vector3d &delta,
-                                double dr2, int basis,
-                                Eigen::MatrixXd &out)
-{
-  // F type orbitals have 10 components and each component has a different
-  // independent MO weighting. Many things can be cached to save time though
-  double xxx = 0.0;
-  double xxy = 0.0;
-  double xxz = 0.0;
-  double xyy = 0.0;
-  double xyz = 0.0;
-  double xzz = 0.0;
-  double yyy = 0.0;
-  double yyz = 0.0;
-  double yzz = 0.0;
-  double zzz = 0.0;
-
-  // Now iterate through the D type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[basis];
-  for (unsigned int i = set->m_gtoIndices[basis];
-       i < set->m_gtoIndices[basis+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    xxx += set->m_gtoCN[cIndex++] * tmpGTO;
-    xxy += set->m_gtoCN[cIndex++] * tmpGTO;
-    xxz += set->m_gtoCN[cIndex++] * tmpGTO;
-    xyy += set->m_gtoCN[cIndex++] * tmpGTO;
-    xyz += set->m_gtoCN[cIndex++] * tmpGTO;
-    xzz += set->m_gtoCN[cIndex++] * tmpGTO;
-    yyy += set->m_gtoCN[cIndex++] * tmpGTO;
-    yyz += set->m_gtoCN[cIndex++] * tmpGTO;
-    yzz += set->m_gtoCN[cIndex++] * tmpGTO;
-    zzz += set->m_gtoCN[cIndex++] * tmpGTO;
+  // Build a cell list of the shells by the position of their atom, using the
+  // largest cutoff as the cell size so a row only needs to look at the cells
+  // within one cell of it
+  m_cellSize = std::max(maxCutoff, 1.0);
+  Vector3d min = m_molecule.atomPos(0), max = min;
+  for (size_t i = 1; i < m_molecule.numAtoms(); ++i) {
+    min = min.cwiseMin(m_molecule.atomPos(i));
+    max = max.cwiseMax(m_molecule.atomPos(i));
   }
-
-  // Save values to the matrix
-  int baseIndex = set->m_moIndices[basis];
-  out.coeffRef(baseIndex  , 0) = delta.x() * delta.x() * delta.x() * xxx;
-  out.coeffRef(baseIndex+1, 0) = delta.x() * delta.x() * delta.y() * xxy;
-  out.coeffRef(baseIndex+2, 0) = delta.x() * delta.x() * delta.z() * xxz;
-  out.coeffRef(baseIndex+3, 0) = delta.x() * delta.y() * delta.y() * xyy;
-  out.coeffRef(baseIndex+4, 0) = delta.x() * delta.y() * delta.z() * xyz;
-  out.coeffRef(baseIndex+5, 0) = delta.x() * delta.z() * delta.z() * xzz;
-  out.coeffRef(baseIndex+6, 0) = delta.y() * delta.y() * delta.y() * yyy;
-  out.coeffRef(baseIndex+7, 0) = delta.y() * delta.y() * delta.z() * yyz;
-  out.coeffRef(baseIndex+8, 0) = delta.y() * delta.z() * delta.z() * yzz;
-  out.coeffRef(baseIndex+9, 0) = delta.z() * delta.z() * delta.z() * zzz;
-}
-
-inline void GaussianSet::pointD5(GaussianSet *set, const Eigen::Vector3d &delta,
-                                 double dr2, int basis,
-                                 Eigen::MatrixXd &out)
-{
-  // spherical D type orbitals have 5 components and each component has a different
-  // independent MO weighting. Many things can be cached to save time though
-  double d0 = 0.0, d1p = 0.0, d1n = 0.0, d2p = 0.0, d2n = 0.0;
-
-  // Now iterate through the D type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[basis];
-  for (unsigned int i = set->m_gtoIndices[basis];
-       i < set->m_gtoIndices[basis+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    d0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    d1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    d1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    d2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    d2n += set->m_gtoCN[cIndex++] * tmpGTO;
+  m_cellOrigin = min;
+  m_cellDims = Vector3i(int((max.x() - min.x()) / m_cellSize) + 1,
+                        int((max.y() - min.y()) / m_cellSize) + 1,
+                        int((max.z() - min.z()) / m_cellSize) + 1);
+  m_cellShells.resize(m_cellDims.x() * m_cellDims.y() * m_cellDims.z());
+  for (unsigned int i = 0; i < m_symmetry.size(); ++i) {
+    if (m_cutoffs[i] == 0.0)
+      continue;
+    Vector3d pos = m_molecule.atomPos(m_atomIndices[i]) - m_cellOrigin;
+    int cx = int(pos.x() / m_cellSize);
+    int cy = int(pos.y() / m_cellSize);
+    int cz = int(pos.z() / m_cellSize);
+    m_cellShells[(cx * m_cellDims.y() + cy) * m_cellDims.z() + cz].push_back(i);
   }
-
-  // Calculate the prefactors
-  double xx = delta.x() * delta.x();
-  double yy = delta.y() * delta.y();
-  double zz = delta.z() * delta.z();
-  double xy = delta.x() * delta.y();
-  double xz = delta.x() * delta.z();
-  double yz = delta.y() * delta.z();
-
-  // Save values to the matrix
-  int baseIndex = set->m_moIndices[basis];
-  //  out.coeffRef(baseIndex  , 0) = (zz - dr2) * d0; <-- wrong formula - changed to 3*z^2 - r^2   by Dagmar Lenk
-  out.coeffRef(baseIndex  , 0) = (3*zz - dr2) * d0;
-  out.coeffRef(baseIndex+1, 0) = xz * d1p;
-  out.coeffRef(baseIndex+2, 0) = yz * d1n;
-  out.coeffRef(baseIndex+3, 0) = (xx - yy) * d2p;
-  out.coeffRef(baseIndex+4, 0) = xy * d2n;
 }
 
-inline void GaussianSet::pointF7(GaussianSet *set, const Eigen::Vector3d &delta,
-                                 double dr2, int basis,
-                                 Eigen::MatrixXd &out)
+double GaussianSet::shellEnvelope(unsigned int basis, unsigned int component,
+                                  unsigned int components, int l,
+                                  double angularMax, double r) const
 {
-  // spherical F type orbitals have 7 components and each component has a different
-  // independent MO weighting. Many things can be cached to save time though
-  double f0 = 0.0, f1p = 0.0, f1n = 0.0, f2p = 0.0, f2n = 0.0, f3p = 0.0, f3n = 0.0;
-
-  // Now iterate through the D type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[basis];
-  for (unsigned int i = set->m_gtoIndices[basis];
-       i < set->m_gtoIndices[basis+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    f0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    f1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    f1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    f2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    f2n += set->m_gtoCN[cIndex++] * tmpGTO;
-    f3p += set->m_gtoCN[cIndex++] * tmpGTO;
-    f3n += set->m_gtoCN[cIndex++] * tmpGTO;
+  double radial = 0.0;
+  unsigned int cIndex = m_cIndices[basis] + component;
+  for (unsigned int j = m_gtoIndices[basis]; j < m_gtoIndices[basis+1]; ++j) {
+    radial += fabs(m_gtoCN[cIndex]) * exp(-m_gtoA[j] * r * r);
+    cIndex += components;
   }
-
-  // Calculate the prefactors
-  double xxx = delta.x() * delta.x() * delta.x();
-  double xxy = delta.x() * delta.x() * delta.y();
-  double xxz = delta.x() * delta.x() * delta.z();
-  double xyy = delta.x() * delta.y() * delta.y();
-  double xyz = delta.x() * delta.y() * delta.z();
-  double xzz = delta.x() * delta.z() * delta.z();
-  double yyy = delta.y() * delta.y() * delta.y();
-  double yyz = delta.y() * delta.y() * delta.z();
-  double yzz = delta.y() * delta.z() * delta.z();
-  double zzz = delta.z() * delta.z() * delta.z();
-
-  double root6 = 2.449489742783178;
-  double root60 = 7.745966692414834;
-  double root360 = 18.973665961010276;
-
-  // Save values to the matrix
-  int baseIndex = set->m_moIndices[basis];
-  out.coeffRef(baseIndex  , 0) = f0*(zzz - 3.0/2.0 * (xxz + yyz));
-  out.coeffRef(baseIndex+1, 0) = f1p*((6.0 * xzz - 3.0/2.0 * (xxx + xyy))/root6);
-  out.coeffRef(baseIndex+2, 0) = f1n*((6.0 * yzz - 3.0/2.0 * (xxy + yyy))/root6);
-  out.coeffRef(baseIndex+3, 0) = f2p*((15.0 * (xxz - yyz))/root60);
-  out.coeffRef(baseIndex+4, 0) = f2n*((30.0 * xyz)/root60);
-  out.coeffRef(baseIndex+5, 0) = f3p*((15.0 * xxx - 45.0 * xyy)/root360);
-  out.coeffRef(baseIndex+6, 0) = f3n*((45.0 * xxy - 15.0 * yyy)/root360);
+  return angularMax * pow(r, l) * radial;
 }
 
-inline void GaussianSet::pointOrcaD5(GaussianSet *set, const Eigen::Vector3d &delta,
-                                 double dr2, int basis,
-                                 Eigen::MatrixXd &out)
+void GaussianSet::shellsNearRow(const Vector3d &origin, double step,
+                                unsigned int n,
+                                vector<unsigned int> &shells) const
 {
-  // D type orbitals have 5 components and each component has a different
-  // independent MO weighting. Many things can be cached to save time though
-  double d0 = 0.0, d1p = 0.0, d1n = 0.0, d2p = 0.0, d2n = 0.0;
-
-  // Now iterate through the D type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[basis];
-  for (unsigned int i = set->m_gtoIndices[basis];
-       i < set->m_gtoIndices[basis+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    d0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    d1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    d1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    d2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    d2n += set->m_gtoCN[cIndex++] * tmpGTO;
+  shells.clear();
+  if (m_cutoffs.empty()) {
+    // No screening, every shell contributes
+    shells.reserve(m_symmetry.size());
+    for (unsigned int i = 0; i < m_symmetry.size(); ++i)
+      shells.push_back(i);
+    return;
   }
 
-  // Calculate the prefactors
-  double xx = delta.x() * delta.x();
-  double yy = delta.y() * delta.y();
-  double zz = delta.z() * delta.z();
-  double xy = delta.x() * delta.y();
-  double xz = delta.x() * delta.z();
-  double yz = delta.y() * delta.z();
-
-  // Save values to the matrix
-  int baseIndex = set->m_moIndices[basis];
-
-  out.coeffRef(baseIndex  , 0) = (3*zz - dr2) * d0;
-  out.coeffRef(baseIndex+1, 0) = xz * d1p;
-  out.coeffRef(baseIndex+2, 0) = yz * d1n;
-  out.coeffRef(baseIndex+3, 0) = (xx - yy) * d2p;
-  out.coeffRef(baseIndex+4, 0) = xy * d2n;
-}
-inline void GaussianSet::pointOrcaF7(GaussianSet *set, const Eigen::Vector3d &delta,
-                    double dr2, int basis, Eigen::MatrixXd &out)
-{
-  // F type orbitals have 7 components and each component has a different
-  // MO weighting. Many things can be cached to save time
-
-  double f0 = 0.0, f1p = 0.0, f1n = 0.0, f2p = 0.0, f2n = 0.0, f3p = 0.0, f3n = 0.0;
-
-  // Now iterate through the F type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[basis];
-  for (unsigned int i = set->m_gtoIndices[basis];
-       i < set->m_gtoIndices[basis+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    f0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    f1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    f1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    f2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    f2n += set->m_gtoCN[cIndex++] * tmpGTO;
-    f3p += set->m_gtoCN[cIndex++] * tmpGTO;
-    f3n += set->m_gtoCN[cIndex++] * tmpGTO;
+  // The row runs from origin along z, look at all the cells within one cell
+  // size of it
+  Vector3d low = origin - m_cellOrigin;
+  Vector3d high = low + Vector3d(0.0, 0.0, (n - 1) * step);
+  int cMin[3], cMax[3];
+  for (int d = 0; d < 3; ++d) {
+    cMin[d] = std::max(int(floor(low[d] / m_cellSize)) - 1, 0);
+    cMax[d] = std::min(int(floor(high[d] / m_cellSize)) + 1,
+                       m_cellDims[d] - 1);
+    if (cMin[d] > cMax[d])
+      return;
   }
-
-  // Calculate the prefactors
-  double xyz = delta.x() * delta.y() * delta.z();
-  double xxx = delta.x() * delta.x() * delta.x();
-  double yyy = delta.y() * delta.y() * delta.y();
-  double zzz = delta.z() * delta.z() * delta.z();
-
-  double xxz = delta.x() * delta.x() * delta.z();
-  double xxy = delta.x() * delta.x() * delta.y();
-
-  double yyz = delta.y() * delta.y() * delta.z();
-  double yyx = delta.y() * delta.y() * delta.x();
-
-  double zzx = delta.z() * delta.z() * delta.x();
-  double zzy = delta.z() * delta.z() * delta.y();
-
-  // Save values to the matrix
-  unsigned int baseIndex = set->m_moIndices[basis];
-  out.coeffRef(baseIndex  , 0) = (-3*xxz - 3*yyz + 2*zzz) * f0;
-  out.coeffRef(baseIndex+1, 0) = (-xxx - yyx + 4*zzx) *f1p;
-  out.coeffRef(baseIndex+2, 0) = (-xxy -yyy + 4*zzy) *f1n;
-  out.coeffRef(baseIndex+3, 0) = (-yyz +xxz) * f2p;
-  out.coeffRef(baseIndex+4, 0) = xyz * f2n;
-  out.coeffRef(baseIndex+5, 0) = (-xxx + 3*yyx) * f3p;
-  out.coeffRef(baseIndex+6, 0) = (-3*xxy + yyy) *f3n;
-
-}
-
-inline void GaussianSet::pointOrcaG9(GaussianSet *set, const Eigen::Vector3d &delta,
-                    double dr2, int basis, Eigen::MatrixXd &out)
-{
-  // G type orbitals have 9 components and each component has a different
-  // MO weighting. Many things can be cached to save time
-  unsigned int baseIndex = set->m_moIndices[basis];
-  double g0 = 0.0, g1p = 0.0, g1n = 0.0, g2p = 0.0, g2n = 0.0, g3p = 0.0, g3n = 0.0, g4p = 0.0, g4n = 0.0;
-
-  // Now iterate through the G type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[basis];
-  for (unsigned int i = set->m_gtoIndices[basis];
-       i < set->m_gtoIndices[basis+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    g0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    g1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    g1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    g2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    g2n += set->m_gtoCN[cIndex++] * tmpGTO;
-    g3p += set->m_gtoCN[cIndex++] * tmpGTO;
-    g3n += set->m_gtoCN[cIndex++] * tmpGTO;
-    g4p += set->m_gtoCN[cIndex++] * tmpGTO;
-    g4n += set->m_gtoCN[cIndex++] * tmpGTO;
+  for (int cx = cMin[0]; cx <= cMax[0]; ++cx) {
+    for (int cy = cMin[1]; cy <= cMax[1]; ++cy) {
+      for (int cz = cMin[2]; cz <= cMax[2]; ++cz) {
+        const vector<unsigned int> &cell =
+            m_cellShells[(cx * m_cellDims.y() + cy) * m_cellDims.z() + cz];
+        shells.insert(shells.end(), cell.begin(), cell.end());
+      }
+    }
   }
-
-  // Calculate the prefactors
-
-  double xx = delta.x() * delta.x();
-  double yy = delta.y() * delta.y();
-  double zz = delta.z() * delta.z();
-
-  double xxxx = xx*xx;
-  double yyyy = yy*yy;
-  double zzzz = zz*zz;
-
-  double xz = delta.x() * delta.z();
-  double xy = delta.x() * delta.y();
-  double yz = delta.y() * delta.z();
-
-  // NormG0 * (35*z^4 - 30*z^2*r^2 +3*r^4) *exp(-alpha*r^2)
-  out.coeffRef(baseIndex  , 0) = (35*zzzz - 30*zz*dr2 +3*dr2*dr2) *g0;
-
-  // NormG1p * x*z * (7*z^2 - 3*r^2) *exp(-alpha*r^2)
-  // NormG1n * y*z * (7*z^2 - 3*r^2) *exp(-alpha*r^2)
-  double G1tmp = (7*zz - 3*dr2);
-  out.coeffRef(baseIndex+1, 0) = G1tmp * xz * g1p;
-  out.coeffRef(baseIndex+2, 0) = G1tmp * yz * g1n;
-
-  // NormG2p * (x^2 - y^2) * (7*z^2 - r^2) *exp(-alpha*r^2)
-  // NormG2n * x * y * (7*z^2 - r^2) *exp(-alpha*r^2)
-  double G2tmp = (7*zz - dr2);
-  out.coeffRef(baseIndex+3, 0) = (xx - yy) * G2tmp * g2p;
-  out.coeffRef(baseIndex+4, 0) = xy * G2tmp * g2n;
-
-  // NormG3p * ... *exp(-alpha*r^2)
-  // NormG3n * ... *exp(-alpha*r^2)
-  out.coeffRef(baseIndex+5, 0) = (xx - 3*yy) * xz * g3p;
-  out.coeffRef(baseIndex+6, 0) = (3*xx - yy) * yz * g3n;
-
-  // NormG4p * (x^4 - 6*x^2*y^2 + y^4) *exp(-alpha*r^2)
-  // NormG4n * x * y * (x^2 - y^2) *exp(-alpha*r^2)
-  out.coeffRef(baseIndex+7, 0) = (xxxx - 6*xx*yy + yyyy) * g4p;
-  out.coeffRef(baseIndex+8, 0) = (xx - yy) * xy * g4n;
+  // Keep the shells in basis order so deltas can be shared between the
+  // shells of each atom
+  std::sort(shells.begin(), shells.end());
 }
 
-inline void GaussianSet::pointOrcaH11(GaussianSet *set, const Eigen::Vector3d &delta,
-                                   double dr2, int basis, Eigen::MatrixXd &out)
+bool GaussianSet::setPoints(unsigned int basis, const Vector3d &origin,
+                            double step, GaussianPoints &points) const
 {
-  // H type orbitals have 11 components and each component has a different
-  // MO weighting. Many things can be cached to save time
-  unsigned int baseIndex = set->m_moIndices[basis];
-  double h0 = 0.0, h1p = 0.0, h1n = 0.0, h2p = 0.0, h2n = 0.0, h3p = 0.0, h3n = 0.0, h4p = 0.0, h4n = 0.0, h5p = 0.0, h5n = 0.0;
-
-  // Now iterate through the H type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[basis];
-  for (unsigned int i = set->m_gtoIndices[basis];
-       i < set->m_gtoIndices[basis+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    h0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    h1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    h1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    h2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    h2n += set->m_gtoCN[cIndex++] * tmpGTO;
-    h3p += set->m_gtoCN[cIndex++] * tmpGTO;
-    h3n += set->m_gtoCN[cIndex++] * tmpGTO;
-    h4p += set->m_gtoCN[cIndex++] * tmpGTO;
-    h4n += set->m_gtoCN[cIndex++] * tmpGTO;
-    h5p += set->m_gtoCN[cIndex++] * tmpGTO;
-    h5n += set->m_gtoCN[cIndex++] * tmpGTO;
+  const unsigned int n = points.size;
+  int atom = static_cast<int>(m_atomIndices[basis]);
+  Vector3d delta = origin - m_molecule.atomPos(atom);
+
+  // Find the range of points on the row that are within the cutoff
+  points.begin = 0;
+  points.end = n;
+  if (!m_cutoffs.empty()) {
+    double dxy2 = delta.x() * delta.x() + delta.y() * delta.y();
+    if (dxy2 >= m_cutoffs[basis])
+      return false;
+    double half = sqrt(m_cutoffs[basis] - dxy2);
+    double kLow = ceil((-half - delta.z()) / step);
+    double kHigh = floor((half - delta.z()) / step) + 1.0;
+    points.begin = static_cast<unsigned int>(std::max(kLow, 0.0));
+    points.end = static_cast<unsigned int>(std::min(kHigh, double(n)));
+    if (points.begin >= points.end)
+      return false;
   }
 
-  // Calculate the prefactors
-
-  double xx = delta.x() * delta.x();
-  double yy = delta.y() * delta.y();
-  double zz = delta.z() * delta.z();
-
-  double xxxx = xx*xx;
-  double yyyy = yy*yy;
-  double zzzz = zz*zz;
-  double xxyy = xx*yy;
-//  double yyzz = yy*zz;
-//  double xxzz = xx*zz;
-
-  double x = delta.x();
-  double y = delta.y();
-  double z = delta.z();
-  double xyz = x*y*z;
-
-  // NormH0 * z * (63*z^4 - 70*z^2*r^2 + 15*r^4) *exp(-alpha*r^2)
-  out.coeffRef(baseIndex  , 0) = z * (63*zzzz - 70*zz*dr2 +15*dr2*dr2) * h0;
-
-  // NormH1p * x * (21*z^4 -14*z^2*r^2 + r^4) *exp(-alpha*r^2)
-  // NormH1n * y * (21*z^4 -14*z^2*r^2 + r^4) *exp(-alpha*r^2)
-  double H1tmp = 21*zzzz -14*zz*dr2 + dr2*dr2;
-  out.coeffRef(baseIndex+1, 0) = x * H1tmp * h1p;
-  out.coeffRef(baseIndex+2, 0) = y * H1tmp * h1n;
-
-  // NormH2p * z * (x^2 - y^2) * (3*z^2 - r^2) *exp(-alpha*r^2)
-  // NormH2n * x*y*z * (3*z^2 - r^2) *exp(-alpha*r^2)
-  double H2tmp = (3*zz - dr2);
-  out.coeffRef(baseIndex+3, 0) = z * (xx - yy) * H2tmp * h2p;
-  out.coeffRef(baseIndex+4, 0) = xyz * H2tmp * h2n;
-
-  // NormH3p * x * (x^2 - 3*y^2) * (9*z^2 - r^2) *exp(-alpha*r^2)
-  // NormH3n * y * (3*x^2 - y^2) * (9*z^2 - r^2) *exp(-alpha*r^2)
-  double H3tmp = (9*zz - dr2);
-  out.coeffRef(baseIndex+5, 0) = x * (xx - 3*yy) * H3tmp * h3p;
-  out.coeffRef(baseIndex+6, 0) = y * (3*xx - yy) * H3tmp * h3n;
-
-  // NormH4p * z * (x^4 - 6*x^2*y^2 + y^4) *exp(-alpha*r^2)
-  // NormH4n * x*y*z * (x^2 - y^2) *exp(-alpha*r^2)
-  out.coeffRef(baseIndex+7, 0) = z*(xxxx - 6*xxyy + yyyy) * h4p;
-  out.coeffRef(baseIndex+8, 0) = xyz*(xx - yy) * h4n;
-
-  // NormH5p * x * (x^4 - 10*x^2*y^2 + 5*y^4) *exp(-alpha*r^2)
-  // NormH5n * y * (5*x^4 - 10*x^2*y^2 + y^4) *exp(-alpha*r^2)
-  out.coeffRef(baseIndex+9, 0) = x * (xxxx - 10*xxyy + 5*yyyy) * h5p;
-  out.coeffRef(baseIndex+10, 0) = y * (5*xxxx - 10*xxyy + yyyy) * h5n;
-
- }
-
-inline void GaussianSet::pointOrcaI13(GaussianSet *set, const Eigen::Vector3d &delta,
-                                  double dr2, int basis, Eigen::MatrixXd &out)
-{
-  // I type orbitals have 13 components and each component has a different
-  // MO weighting. Many things can be cached to save time
-  unsigned int baseIndex = set->m_moIndices[basis];
-  double i0 = 0.0, i1p = 0.0, i1n = 0.0, i2p = 0.0, i2n = 0.0, i3p = 0.0, i3n = 0.0, i4p = 0.0, i4n = 0.0, i5p = 0.0, i5n = 0.0, i6p = 0.0, i6n = 0.0;
-
-  // Now iterate through the I type GTOs and sum their contributions
-  unsigned int cIndex = set->m_cIndices[basis];
-  for (unsigned int i = set->m_gtoIndices[basis];
-       i < set->m_gtoIndices[basis+1]; ++i) {
-    // Calculate the common factor
-    double tmpGTO = exp(-set->m_gtoA[i] * dr2);
-    i0  += set->m_gtoCN[cIndex++] * tmpGTO;
-    i1p += set->m_gtoCN[cIndex++] * tmpGTO;
-    i1n += set->m_gtoCN[cIndex++] * tmpGTO;
-    i2p += set->m_gtoCN[cIndex++] * tmpGTO;
-    i2n += set->m_gtoCN[cIndex++] * tmpGTO;
-    i3p += set->m_gtoCN[cIndex++] * tmpGTO;
-    i3n += set->m_gtoCN[cIndex++] * tmpGTO;
-    i4p += set->m_gtoCN[cIndex++] * tmpGTO;
-    i4n += set->m_gtoCN[cIndex++] * tmpGTO;
-    i5p += set->m_gtoCN[cIndex++] * tmpGTO;
-    i5n += set->m_gtoCN[cIndex++] * tmpGTO;
-    i6p += set->m_gtoCN[cIndex++] * tmpGTO;
-    i6n += set->m_gtoCN[cIndex++] * tmpGTO;
+  // Shells on the same atom are adjacent, only recalculate the deltas when
+  // the atom changes
+  if (atom != points.atom) {
+    for (unsigned int k = 0; k < n; ++k) {
+      points.x[k] = delta.x();
+      points.y[k] = delta.y();
+      points.z[k] = delta.z() + k * step;
+      points.r2[k] = points.x[k] * points.x[k] + points.y[k] * points.y[k]
+          + points.z[k] * points.z[k];
+    }
+    points.atom = atom;
   }
-
-  // Calculate the prefactors
-
-  double xx = delta.x() * delta.x();
-  double yy = delta.y() * delta.y();
-  double zz = delta.z() * delta.z();
-
-  double xy = delta.x() * delta.y();
-  double xz = delta.x() * delta.z();
-  double yz = delta.y() * delta.z();
-
-  double x4 = xx*xx;
-  double x6 = x4*xx;
-  double y4 = yy*yy;
-  double y6 = y4*yy;
-
-  double z4 = zz*zz;
-  double z6 = z4 * zz;
-  double xxyy = xx*yy;
-
-
-  // NormI0 * (231*z^6 - 315*z^4*r^2 + 105*z^2*r^4 -5*r^6) *exp(-alpha*r^2)
-  out.coeffRef(baseIndex  , 0) = (231*z6 - 315*z4*dr2 + 105*zz*dr2*dr2 - 5*dr2*dr2*dr2) * i0;
-
-  // NormI1p * x*z*(33z^4 - 30z^2*r^2 + 5*r^4) *exp(-alpha*r^2)
-  // NormI1n * y*z*(33z^4 - 30z^2*r^2 + 5*r^4) *exp(-alpha*r^2)
-  double I1tmp = 33.*z4 - 30.*zz*dr2 + 5.*dr2*dr2;
-  out.coeffRef(baseIndex+1, 0) = xz * I1tmp * i1p;
-  out.coeffRef(baseIndex+2, 0) = yz * I1tmp * i1n;
-
-  // NormI2p * ((x^2-y^2)(33*z4 -18*zz*r^2 +r^4)) *exp(-alpha*r^2)
-  // NormI2n * x*y*(33*z^4 - 18z^r^2 +r^4) *exp(-alpha*r^2)
-
-  double I2tmp = 33*z4 - 18*zz*dr2 + dr2*dr2;
-  out.coeffRef(baseIndex+3, 0) = (xx - yy) * I2tmp * i2p;
-  out.coeffRef(baseIndex+4, 0) = xy * I2tmp * i2n;
-
-  // NormI3p * x*z*(x^2 - 3y^2)*(11z^2 - 3r^2) *exp(-alpha*r^2)
-  // NormI3n * y*z*(3x^2 - y^2)*(11z^2 - 3r^2) *exp(-alpha*r^2)
-  double I3tmp = 11*zz - 3*dr2;
-  out.coeffRef(baseIndex+5, 0) = xz * (3*xx - yy) * I3tmp * i3p;
-  out.coeffRef(baseIndex+6, 0) = yz * (xx - 3*yy) * I3tmp * i3n;
-
-  // NormI4p * (x^4 - 6*x^2*y^2 +y^4)*(11z^2 - r^2)*exp(-alpha*r^2)
-  // NormI4n * x*y*(x^2 - y^2)(11z^2 - r^2) *exp(-alpha*r^2)
-  double I4tmp = 11*zz - dr2;
-  out.coeffRef(baseIndex+7, 0) = (x4 - 6*xxyy +y4) * I4tmp * i4p;
-  out.coeffRef(baseIndex+8, 0) = xy*(xx - yy) * I4tmp * i4n;
-
-  // NormI5p * xz(5x^4 - 10x^2*y^2 +y^4) *exp(-alpha*r^2)
-  // NormI5n * y*z*(5x^4 - 10x^2*y^2 +y^4) *exp(-alpha*r^2)
-  double I5tmp = 5*x4 - 10*xx*yy + y4;
-  out.coeffRef(baseIndex+9, 0) = xz * I5tmp * i5p;
-  out.coeffRef(baseIndex+10, 0) = yz * I5tmp * i5n;
-
-  // NormI6p * (x^6 - 15x^4*y^2 + 15x^2y^4 - y^6) *exp(-alpha*r^2)
-  // NormI6n * xy(3x^4 - 10x^2y^2 + 3y^4) *exp(-alpha*r^2)
-  out.coeffRef(baseIndex+11, 0) = (x6 - 15*x4*yy + 15*xx*y4 - y6) * i6p;
-  out.coeffRef(baseIndex+12, 0) = xy * (3*x4 - 10*xx*yy + 3*y4) * i6n;
-
+  return true;
 }
 
-
-
 unsigned int GaussianSet::numMOs()
 {
   // Return the total number of MOs
@@ -32,7 +32,8 @@
 namespace OpenQube
 {
 
-struct GaussianShell;
+struct GaussianBlock;
+struct GaussianPoints;
 
 /**
  * Enumeration of the Gaussian type orbitals.
@@ -141,6 +142,21 @@ public:
    */
   bool calculateCubeMO(Cube *cube, unsigned int state = 1);
 
+  /**
+   * Calculate several MOs over the entire range of the supplied Cubes in one
+   * pass. The basis functions are evaluated once for each row of points and
+   * contracted with all of the requested MO coefficients at once.
+   * @param cubes The cubes to write the values of the MOs into, they must all
+   * have the same limits and dimensions.
+   * @param states The MO numbers to calculate, one for each cube.
+   * @note This function starts a threaded calculation. Use watcher()
+   * to monitor progress.
+   * @sa BasisSet::blockingCalculateCubesMO
+   * @return True if the calculation was successful.
+   */
+  bool calculateCubesMO(const QList<Cube *> &cubes,
+                        const QList<unsigned int> &states);
+
   /**
    * Calculate the electron density over the entire range of the supplied Cube.
    * @param cube The cube to write the values of the MO into.
@@ -186,16 +202,26 @@ private:
   std::vector<double> m_gtoCN;             //! The GTO contraction coefficient (normalized)
   Eigen::MatrixXd m_moMatrix;              //! MO coefficient matrix
   Eigen::MatrixXd m_density;               //! Density matrix
+  std::vector<double> m_cutoffs;           //! Squared cutoff radius of each basis
+  std::vector<bool> m_densityShells;       //! Bases with non-negligible density
 
   unsigned int m_numMOs;    //! The number of GTOs
   unsigned int m_numAtoms;  //! Total number of atoms in the basis set
   bool m_init;              //! Has the calculation been initialised?
 
+  // Cell list of the basis functions by atom position, used for screening
+  Eigen::Vector3d m_cellOrigin;
+  Eigen::Vector3i m_cellDims;
+  double m_cellSize;
+  std::vector<std::vector<unsigned int> > m_cellShells;
+  double m_cutoffTolerance; //! Tolerance the cutoffs were calculated for
+
 
   QFuture<void> m_future;
   QFutureWatcher<void> m_watcher;
-  Cube *m_cube; //! Cube to put the results into
-  QVector<GaussianShell> *m_gaussianShells;
+  QList<Cube *> m_cubes; //! Cubes to put the results into
+  Eigen::MatrixXd m_moBlock; //! MO coefficients of the MOs being calculated
+  QVector<GaussianBlock> *m_gaussianBlocks;
 
   bool m_useOrcaNorm;       //! if the data come from Orca use different calculations/normalizations
 
@@ -203,64 +229,28 @@ private:
 
   void initCalculation();  //! Perform initialisation before any calculations
   void initCalculationForOrca();  //! Perform initialisation before any calculations for Orca output files or Orca written molden files
-  /// Re-entrant single point forms of the calculations
-  static void processPoint(GaussianShell &shell);
-  static void processDensity(GaussianShell &shell);
-  static double pointS(GaussianSet *set, unsigned int moIndex,
-                       double dr2, unsigned int indexMO);
-  static double pointP(GaussianSet *set, unsigned int moIndex,
-                       const Eigen::Vector3d &delta,
-                       double dr2, unsigned int indexMO);
-  static double pointD(GaussianSet *set, unsigned int moIndex,
-                       const Eigen::Vector3d &delta,
-                       double dr2, unsigned int indexMO);
-  static double pointD5(GaussianSet *set, unsigned int moIndex,
-                        const Eigen::Vector3d &delta,
-                        double dr2, unsigned int indexMO);
-  static double pointF(GaussianSet *set, unsigned int moIndex,
-                        const Eigen::Vector3d &delta,
-                        double dr2, unsigned int indexMO);
-  static double pointF7(GaussianSet *set, unsigned int moIndex,
-                        const Eigen::Vector3d &delta,
-                        double dr2, unsigned int indexMO);
-  static double pointOrcaD5(GaussianSet *set, unsigned int moIndex,
-                        const Eigen::Vector3d &delta,
-                        double dr2, unsigned int indexMO);
-  static double pointOrcaF7(GaussianSet *set, unsigned int moIndex,
-                        const Eigen::Vector3d &delta,
-                        double dr2, unsigned int indexMO);
-  static double pointOrcaG9(GaussianSet *set, unsigned int moIndex,
-                        const Eigen::Vector3d &delta,
-                        double dr2, unsigned int indexMO);
-  static double pointOrcaH11(GaussianSet *set, unsigned int moIndex,
-                        const Eigen::Vector3d &delta,
-                        double dr2, unsigned int indexMO);
-  static double pointOrcaI13(GaussianSet *set, unsigned int moIndex,
-                        const Eigen::Vector3d &delta,
-                        double dr2, unsigned int indexMO);
-  /// Calculate the basis for the density
-  static void pointS(GaussianSet *set, double dr2, int basis,
-                     Eigen::MatrixXd &out);
-  static void pointP(GaussianSet *set, const Eigen::Vector3d &delta,
-                     double dr2, int basis, Eigen::MatrixXd &out);
-  static void pointD(GaussianSet *set, const Eigen::Vector3d &delta,
-                     double dr2, int basis, Eigen::MatrixXd &out);
-  static void pointD5(GaussianSet *set, const Eigen::Vector3d &delta,
-                      double dr2, int basis, Eigen::MatrixXd &out);
-  static void pointF(GaussianSet *set, const Eigen::Vector3d &delta,
-                      double dr2, int basis, Eigen::MatrixXd &out);
-  static void pointF7(GaussianSet *set, const Eigen::Vector3d &delta,
-                      double dr2, int basis, Eigen::MatrixXd &out);
-  static void pointOrcaD5(GaussianSet *set, const Eigen::Vector3d &delta,
-                      double dr2, int basis, Eigen::MatrixXd &out);
-  static void pointOrcaF7(GaussianSet *set, const Eigen::Vector3d &delta,
-                      double dr2, int basis, Eigen::MatrixXd &out);
-  static void pointOrcaG9(GaussianSet *set, const Eigen::Vector3d &delta,
-                      double dr2, int basis, Eigen::MatrixXd &out);
-  static void pointOrcaH11(GaussianSet *set, const Eigen::Vector3d &delta,
-                      double dr2, int basis, Eigen::MatrixXd &out);
-  static void pointOrcaI13(GaussianSet *set, const Eigen::Vector3d &delta,
-                      double dr2, int basis, Eigen::MatrixXd &out);
+  void initScreening();  //! Calculate the cutoff radii and cell list, after initCalculation
+  /// Upper bound on the magnitude of one component of a basis at radius r
+  double shellEnvelope(unsigned int basis, unsigned int component,
+                       unsigned int components, int l, double angularMax,
+                       double r) const;
+  /// The basis functions that may reach a row of n points along z
+  void shellsNearRow(const Eigen::Vector3d &origin, double step,
+                     unsigned int n, std::vector<unsigned int> &shells) const;
+  /// Set up the points of a row for a basis, false if it is out of range
+  bool setPoints(unsigned int basis, const Eigen::Vector3d &origin,
+                 double step, GaussianPoints &points) const;
+  /// Re-entrant block forms of the calculations, one row of the cube per call
+  static void processBlock(GaussianBlock &block);
+  static void processDensityBlock(GaussianBlock &block);
+  /**
+   * Evaluate all components of one shell over a block of points.
+   * @param values Written as components x points, component major.
+   * @return The number of components written, zero if the shell type is not
+   * handled.
+   */
+  static unsigned int evaluateShell(GaussianSet *set, unsigned int basis,
+                                    GaussianPoints &points, double *values);
 };
 
 } // End namespace
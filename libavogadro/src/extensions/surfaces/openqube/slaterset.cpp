@@ -48,9 +48,8 @@ namespace OpenQube
 struct SlaterShell
 {
   SlaterSet *set;    // A pointer to the SlaterSet, cannot write to member vars
-  Cube *cube;        // The target cube, used to initialise temp cubes too
+  Cube *cube;        // The cube defining the grid, all targets share it
   unsigned int pos;  // The index of position of the point to calculate the MO for
-  unsigned int state;// The MO number to calculate
 };
 
 using std::vector;
@@ -144,31 +143,75 @@ void SlaterSet::outputAll()
 }
 
 bool SlaterSet::calculateCubeMO(Cube *cube, unsigned int state)
+{
+  QList<Cube *> cubes;
+  cubes << cube;
+  QList<unsigned int> states;
+  states << state;
+  return calculateCubesMO(cubes, states);
+}
+
+bool SlaterSet::calculateCubesMO(const QList<Cube *> &cubes,
+                                 const QList<unsigned int> &states)
 {
   // Set up the calculation and ideally use the new QtConcurrent code to
   // multithread the calculation...
-  if (state < 1 || static_cast<int>(state) > m_overlap.rows())
+  if (cubes.isEmpty() || cubes.size() != states.size())
     return false;
+  foreach (unsigned int state, states)
+    if (state < 1 || static_cast<int>(state) > m_overlap.rows())
+      return false;
+
+  Cube *cube = cubes.first();
+  for (int i = 0; i < cubes.size(); ++i) {
+    if (cubes[i]->dimensions() != cube->dimensions()
+        || cubes[i]->min() != cube->min()
+        || cubes[i]->spacing() != cube->spacing()
+        || cubes.count(cubes[i]) != 1) {
+      qDebug() << "Cannot calculate MOs -- cubes must be distinct and share"
+               << "the same grid.";
+      return false;
+    }
+  }
 
   if (!m_initialized)
     initialize();
 
+  // Gather the coefficients of the requested MOs, leaving out the basis
+  // functions that do not contribute to any of them
+  m_moBasis.clear();
+  for (unsigned int i = 0; i < m_zetas.size(); ++i) {
+    for (int j = 0; j < states.size(); ++j) {
+      if (!isSmall(m_normalized.coeffRef(i, states[j] - 1))) {
+        m_moBasis.push_back(i);
+        break;
+      }
+    }
+  }
+  m_moBlock.resize(m_moBasis.size(), states.size());
+  for (unsigned int i = 0; i < m_moBasis.size(); ++i)
+    for (int j = 0; j < states.size(); ++j)
+      m_moBlock.coeffRef(i, j) = m_normalized.coeffRef(m_moBasis[i],
+                                                       states[j] - 1);
+
   // It is more efficient to process each shell over the entire cube than it
   // is to process each MO at each point in the cube. This is probably the best
   // point at which to multithread too - QtConcurrent!
   m_slaterShells.resize(cube->data()->size());
 
-  qDebug() << "Number of points:" << m_slaterShells.size();
+  qDebug() << "Number of points:" << m_slaterShells.size()
+           << "MOs:" << states.size();
 
   for (int i = 0; i < m_slaterShells.size(); ++i) {
     m_slaterShells[i].set = this;
     m_slaterShells[i].cube = cube;
     m_slaterShells[i].pos = i;
-    m_slaterShells[i].state = state;
   }
 
-  // Lock the cube until we are done.
-  cube->lock()->lockForWrite();
+  // Lock the cubes until we are done.
+  m_cubes = cubes;
+  foreach (Cube *target, m_cubes)
+    target->lock()->lockForWrite();
 
   // Watch for the future
   connect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
@@ -199,10 +242,11 @@ bool SlaterSet::calculateCubeDensity(Cube *cube)
     m_slaterShells[i].set = this;
     m_slaterShells[i].cube = cube;
     m_slaterShells[i].pos = i;
-    m_slaterShells[i].state = 0;
   }
 
   // Lock the cube until we are done.
+  m_cubes.clear();
+  m_cubes << cube;
   cube->lock()->lockForWrite();
 
   // Watch for the future
@@ -239,9 +283,10 @@ BasisSet * SlaterSet::clone()
 void SlaterSet::calculationComplete()
 {
   disconnect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
-  qDebug() << m_slaterShells[0].cube->data()->at(0) << m_slaterShells[0].cube->data()->at(1);
   qDebug() << "Calculation complete - cube map...";
-  m_slaterShells[0].cube->lock()->unlock();
+  foreach (Cube *cube, m_cubes)
+    cube->lock()->unlock();
+  m_cubes.clear();
 }
 
 bool SlaterSet::initialize()
@@ -317,16 +362,13 @@ void SlaterSet::processPoint(SlaterShell &shell)
 {
   SlaterSet *set = shell.set;
   unsigned int atomsSize = set->m_atomPos.size();
-  unsigned int basisSize = set->m_zetas.size();
+  unsigned int basisSize = set->m_moBasis.size();
 
   vector<Vector3d> deltas;
   vector<double> dr;
   deltas.reserve(atomsSize);
   dr.reserve(atomsSize);
 
-  // Simply the row of the matrix to operate on
-  unsigned int indexMO = shell.state - 1;
-
   // Calculate our position
   Vector3d pos = shell.cube->position(shell.pos);// * ANGSTROM_TO_BOHR;
 
@@ -336,14 +378,18 @@ void SlaterSet::processPoint(SlaterShell &shell)
     dr.push_back(deltas[i].norm());
   }
 
-  // Now calculate the value at this point in space
-  double tmp = 0.0;
+  // Evaluate each contributing basis function once at this point
+  Eigen::RowVectorXd values(basisSize);
   for (unsigned int i = 0; i < basisSize; ++i) {
-    tmp += pointSlater(shell.set, deltas[set->m_slaterIndices[i]],
-                       dr[set->m_slaterIndices[i]], i, indexMO);
+    unsigned int slater = set->m_moBasis[i];
+    values[i] = calcSlater(set, deltas[set->m_slaterIndices[slater]],
+                           dr[set->m_slaterIndices[slater]], slater);
   }
-  // Set the value
-  shell.cube->setValue(shell.pos, tmp);
+
+  // Now contract them with the coefficients of all of the MOs
+  Eigen::RowVectorXd mos = values * set->m_moBlock;
+  for (int i = 0; i < set->m_cubes.size(); ++i)
+    set->m_cubes[i]->setValue(shell.pos, mos[i]);
 }
 
 void SlaterSet::processDensity(SlaterShell &shell)
@@ -396,95 +442,6 @@ void SlaterSet::processDensity(SlaterShell &shell)
   shell.cube->setValue(shell.pos, rho);
 }
 
-inline double SlaterSet::pointSlater(SlaterSet *set, const Eigen::Vector3d &delta,
-                                     double dr, unsigned int slater,
-                                     unsigned int indexMO)
-{
-  if (isSmall(set->m_normalized.coeffRef(slater, indexMO)))
-    return 0.0;
-  double tmp = set->m_normalized.coeffRef(slater, indexMO) *
-      set->m_factors[slater] * exp(- set->m_zetas[slater] * dr);
-  // Radial part with effective PQNs
-  for (int i = 0; i < set->m_PQNs[slater]; ++i)
-    tmp *= dr;
-  switch (set->m_slaterTypes[slater]) {
-  case S:
-    break;
-  case PX:
-    tmp *= delta.x();
-    break;
-  case PY:
-    tmp *= delta.y();
-    break;
-  case PZ:
-    tmp *= delta.z();
-    break;
-  case X2: // (x^2 - y^2)r^n
-    tmp *= delta.x() * delta.x() - delta.y() * delta.y();
-    break;
-  case XZ: // xzr^n
-    tmp *= delta.x() * delta.z();
-    break;
-  case Z2: // (2z^2 - x^2 - y^2)r^n
-    tmp *= 2.0 * delta.z() * delta.z() - delta.x() * delta.x()
-        - delta.y() * delta.y();
-    break;
-  case YZ: // yzr^n
-    tmp *= delta.y() * delta.z();
-    break;
-  case XY: // xyr^n
-    tmp *= delta.x() * delta.y();
-    break;
-  default:
-    return 0.0;
-  }
-  return tmp;
-}
-
-inline double SlaterSet::pointSlater(SlaterSet *set, const Eigen::Vector3d &delta,
-                                     double dr, unsigned int slater,
-                                     unsigned int indexMO, double expZeta)
-{
-  if (isSmall(set->m_normalized.coeffRef(slater, indexMO)))
-    return 0.0;
-  double tmp = set->m_normalized.coeffRef(slater, indexMO) * expZeta;
-  // Radial part with effective PQNs
-  for (int i = 0; i < set->m_PQNs[slater]; ++i)
-    tmp *= dr;
-  switch (set->m_slaterTypes[slater]) {
-  case S:
-    break;
-  case PX:
-    tmp *= delta.x();
-    break;
-  case PY:
-    tmp *= delta.y();
-    break;
-  case PZ:
-    tmp *= delta.z();
-    break;
-  case X2: // (x^2 - y^2)r^n
-    tmp *= delta.x() * delta.x() - delta.y() * delta.y();
-    break;
-  case XZ: // xzr^n
-    tmp *= delta.x() * delta.z();
-    break;
-  case Z2: // (2z^2 - x^2 - y^2)r^n
-    tmp *= 2.0 * delta.z() * delta.z() - delta.x() * delta.x()
-        - delta.y() * delta.y();
-    break;
-  case YZ: // yzr^n
-    tmp *= delta.y() * delta.z();
-    break;
-  case XY: // xyr^n
-    tmp *= delta.x() * delta.y();
-    break;
-  default:
-    return 0.0;
-  }
-  return tmp;
-}
-
 inline double SlaterSet::calcSlater(SlaterSet *set, const Eigen::Vector3d &delta,
                                     double dr, unsigned int slater)
 {
@@ -128,6 +128,17 @@ public:
 
   bool calculateCubeMO(Cube *cube, unsigned int state = 1);
 
+  /**
+   * Calculate several MOs over the entire range of the supplied Cubes in one
+   * pass, the basis functions are evaluated once for each point.
+   * @param cubes The cubes to write the values of the MOs into, they must all
+   * have the same limits and dimensions.
+   * @param states The MO numbers to calculate, one for each cube.
+   * @return True if the calculation was successful.
+   */
+  bool calculateCubesMO(const QList<Cube *> &cubes,
+                        const QList<unsigned int> &states);
+
   bool calculateCubeDensity(Cube *cube);
 
   QFutureWatcher<void> & watcher() { return m_watcher; }
@@ -159,7 +170,9 @@ private:
 
   QFuture<void> m_future;
   QFutureWatcher<void> m_watcher;
-  Cube *m_cube; // Cube to put the results into
+  QList<Cube *> m_cubes; // Cubes to put the results into
+  Eigen::MatrixXd m_moBlock; // Coefficients of the MOs being calculated
+  std::vector<unsigned int> m_moBasis; // The basis functions in m_moBlock
   QVector<SlaterShell> m_slaterShells;
 
   bool initialize();
@@ -169,12 +182,6 @@ private:
 
   static void processPoint(SlaterShell &shell);
   static void processDensity(SlaterShell &shell);
-  static double pointSlater(SlaterSet *set, const Eigen::Vector3d &delta,
-                            double dr2, unsigned int slater,
-                            unsigned int indexMO);
-  static double pointSlater(SlaterSet *set, const Eigen::Vector3d &delta,
-                            double dr2, unsigned int slater,
-                            unsigned int indexMO, double expZeta);
   static double calcSlater(SlaterSet *set, const Eigen::Vector3d &delta,
                            double dr2, unsigned int slater);
 };
@@ -54,6 +54,9 @@ using OpenQube::GAMESSUSOutput;
 namespace Avogadro
 {
 
+  // The most orbitals calculated together in one pass over a grid
+  static const int maxBatchedOrbitals = 16;
+
   OrbitalExtension::OrbitalExtension(QObject* parent) :
     DockExtension(parent),
     m_dock(0),
@@ -62,8 +65,7 @@ namespace Avogadro
     m_currentRunningCalculation(-1),
     m_meshGen(0),
     m_basis(0),
-    m_molecule(0),
-    m_qube(0)
+    m_molecule(0)
   {
     QAction* action = new QAction(this);
     action->setText(tr("Molecular Orbitals..."));
@@ -460,6 +462,9 @@ namespace Avogadro
     newCalc.isovalue = isovalue;
     newCalc.priority = priority;
     newCalc.state = NotStarted;
+    newCalc.cube = 0;
+    newCalc.posMesh = 0;
+    newCalc.negMesh = 0;
 
     // Add new calculation
     m_queue.append(newCalc);
@@ -502,6 +507,13 @@ namespace Avogadro
 
     info->state = Running;
 
+    // The cube may have been calculated along with an earlier orbital
+    if (info->cube) {
+      qDebug() << info->orbital << " Cube already calculated.";
+      calculatePosMesh();
+      return;
+    }
+
     // Check if the cube we want already exists
     for (int i = 0; i < m_queue.size(); i++) {
       calcInfo *cI = &m_queue[i];
@@ -522,15 +534,48 @@ namespace Avogadro
     info->cube = cube;
     cube->setLimits(m_molecule, info->resolution, 2.5);
 
-    if (m_qube) {
-      delete m_qube;
-      m_qube = 0;
+    qDeleteAll(m_qubes);
+    m_qubes.clear();
+    m_qubeIndices.clear();
+
+    // Calculate the other queued orbitals on the same grid in the same pass,
+    // the basis functions are then only evaluated once for all of them
+    QList<unsigned int> orbitals;
+    orbitals.append(info->orbital);
+    m_qubeIndices.append(m_currentRunningCalculation);
+    for (int i = 0; i < m_queue.size(); i++) {
+      if (orbitals.size() >= maxBatchedOrbitals)
+        break;
+      calcInfo *cI = &m_queue[i];
+      if (cI->state != NotStarted || cI->cube ||
+          cI->resolution != info->resolution ||
+          orbitals.contains(cI->orbital))
+        continue;
+      bool completed = false;
+      for (int j = 0; j < m_queue.size(); j++) {
+        if (m_queue[j].state == Completed &&
+            m_queue[j].orbital == cI->orbital &&
+            m_queue[j].resolution == cI->resolution) {
+          completed = true;
+          break;
+        }
+      }
+      if (completed)
+        continue;
+      cI->cube = m_molecule->addCube();
+      cI->cube->setLimits(m_molecule, cI->resolution, 2.5);
+      orbitals.append(cI->orbital);
+      m_qubeIndices.append(i);
     }
 
-    m_qube = new OpenQube::Cube;
-    m_qube->setLimits(cube->min(), cube->max(), cube->dimensions());
+    for (int i = 0; i < m_qubeIndices.size(); i++) {
+      OpenQube::Cube *qube = new OpenQube::Cube;
+      qube->setLimits(cube->min(), cube->max(), cube->dimensions());
+      m_qubes.append(qube);
+    }
 
-    m_basis->calculateCubeMO(m_qube, info->orbital);
+    m_basis->setScreeningTolerance(m_widget->screeningTolerance());
+    m_basis->calculateCubesMO(m_qubes, orbitals);
     connect(&m_basis->watcher(), SIGNAL(finished()),
             this, SLOT(calculateCubeDone()));
 
@@ -542,7 +587,8 @@ namespace Avogadro
     connect(&m_basis->watcher(), SIGNAL(progressValueChanged(int)),
             this, SLOT(updateProgress(int)));
 
-    qDebug() << info->orbital << " Cube calculation started.";
+    qDebug() << info->orbital << " Cube calculation started with"
+             << orbitals.size() - 1 << "other orbitals.";
   }
 
   void OrbitalExtension::calculateCubeDone()
@@ -555,11 +601,13 @@ namespace Avogadro
                this, 0);
 
     // Convert the cube data
-    if (m_qube) {
-      info->cube->setData(*m_qube->data());
-      delete m_qube;
-      m_qube = 0;
+    for (int i = 0; i < m_qubes.size(); i++) {
+      if (m_qubeIndices[i] < m_queue.size())
+        m_queue[m_qubeIndices[i]].cube->setData(*m_qubes[i]->data());
     }
+    qDeleteAll(m_qubes);
+    m_qubes.clear();
+    m_qubeIndices.clear();
 
     calculatePosMesh();
   }
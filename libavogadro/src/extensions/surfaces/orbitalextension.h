@@ -177,7 +177,8 @@ namespace Avogadro
     OpenQube::BasisSet *m_basis;
     QList<QAction *> m_actions;
     Molecule *m_molecule;
-    OpenQube::Cube *m_qube;
+    QList<OpenQube::Cube *> m_qubes;  // Cubes being calculated together
+    QList<int> m_qubeIndices;         // Their calculations in the queue
     QTime m_time;
   };
 
@@ -28,6 +28,10 @@
 
 namespace Avogadro {
 
+  // The screening tolerances offered, in the order of the combo box
+  static const double screeningTolerances[] = { 0.0, 1e-12, 1e-10, 1e-8, 1e-6 };
+  static const int numScreeningTolerances = 5;
+
   OrbitalSettingsDialog::OrbitalSettingsDialog(OrbitalWidget* parent,
                                                Qt::WindowFlags f)
     : QDialog(parent, f),
@@ -35,7 +39,8 @@ namespace Avogadro {
       m_isoval(0.02),
       m_HOMOFirst(false),
       m_limit_precalc(true),
-      m_precalc_range(10)
+      m_precalc_range(10),
+      m_screening_tolerance(1e-10)
   {
     ui.setupUi(this);
 
@@ -48,6 +53,8 @@ namespace Avogadro {
             parent, SLOT(setDefaults(OrbitalWidget::OrbitalQuality, double, bool)));
     connect(this, SIGNAL(precalcSettingsUpdated(bool,int)),
             parent, SLOT(setPrecalcSettings(bool,int)));
+    connect(this, SIGNAL(screeningToleranceUpdated(double)),
+            parent, SLOT(setScreeningTolerance(double)));
   }
 
   OrbitalSettingsDialog::~OrbitalSettingsDialog()
@@ -84,6 +91,20 @@ namespace Avogadro {
     m_precalc_range = r;
   }
 
+  void OrbitalSettingsDialog::setScreeningTolerance(double t)
+  {
+    // Pick the closest of the tolerances we offer
+    int index = 0;
+    for (int i = 1; i < numScreeningTolerances; ++i) {
+      if (t >= screeningTolerances[i] * 0.5)
+        index = i;
+    }
+    if (t <= 0.0)
+      index = 0;
+    ui.combo_tolerance->setCurrentIndex(index);
+    m_screening_tolerance = screeningTolerances[index];
+  }
+
   void OrbitalSettingsDialog::updateDefaults()
   {
     m_quality = OrbitalWidget::OrbitalQuality(ui.combo_quality->currentIndex());
@@ -99,10 +120,20 @@ namespace Avogadro {
     emit precalcSettingsUpdated(m_limit_precalc, m_precalc_range);
   }
 
+  void OrbitalSettingsDialog::updateScreeningTolerance()
+  {
+    int index = ui.combo_tolerance->currentIndex();
+    if (index < 0 || index >= numScreeningTolerances)
+      return;
+    m_screening_tolerance = screeningTolerances[index];
+    emit screeningToleranceUpdated(m_screening_tolerance);
+  }
+
   void OrbitalSettingsDialog::accept()
   {
     updateDefaults();
     updatePrecalcSettings();
+    updateScreeningTolerance();
     hide();
   }
 
@@ -111,12 +142,14 @@ namespace Avogadro {
     setDefaultQuality(m_quality);
     setIsoValue(m_isoval);
     setHOMOFirst(m_HOMOFirst);
+    setScreeningTolerance(m_screening_tolerance);
     hide();
   }
 
   void OrbitalSettingsDialog::calculateAllClicked()
   {
     updateDefaults();
+    updateScreeningTolerance();
     emit calculateAll();
   }
 
@@ -47,8 +47,10 @@ namespace Avogadro
     void setHOMOFirst(bool);
     void setLimitPrecalc(bool);
     void setPrecalcRange(int);
+    void setScreeningTolerance(double);
     void updateDefaults();
     void updatePrecalcSettings();
+    void updateScreeningTolerance();
     void accept();
     void reject();
 
@@ -57,6 +59,7 @@ namespace Avogadro
     void defaultsUpdated(OrbitalWidget::OrbitalQuality quality, double isoval,
                          bool HOMOFirst);
     void precalcSettingsUpdated(bool limit, int range);
+    void screeningToleranceUpdated(double tolerance);
 
   private slots:
     void calculateAllClicked();
@@ -68,6 +71,7 @@ namespace Avogadro
     bool m_HOMOFirst;
     bool m_limit_precalc;
     int m_precalc_range;
+    double m_screening_tolerance;
   };
 
 } // End namespace Avogadro
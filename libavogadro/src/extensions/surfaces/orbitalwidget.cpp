@@ -32,6 +32,7 @@ namespace Avogadro {
     m_isovalue(0.02),
     m_precalc_limit(true),
     m_precalc_range(10),
+    m_screening_tolerance(1e-10),
     m_tableModel(new OrbitalTableModel (this)),
     m_sortedTableModel(new OrbitalSortingProxyModel (this))
   {
@@ -68,6 +69,7 @@ namespace Avogadro {
     m_sortedTableModel->HOMOFirst(     settings.value("HOMOFirst", false).toBool());
     m_precalc_limit =                  settings.value("precalc/limit", true).toBool();
     m_precalc_range =                  settings.value("precalc/range", 10).toInt();
+    m_screening_tolerance =            settings.value("screeningTolerance", 1e-10).toDouble();
     settings.endGroup();
   }
 
@@ -81,6 +83,7 @@ namespace Avogadro {
     settings.setValue("HOMOFirst", m_sortedTableModel->isHOMOFirst());
     settings.setValue("precalc/limit", m_precalc_limit);
     settings.setValue("precalc/range", m_precalc_range);
+    settings.setValue("screeningTolerance", m_screening_tolerance);
     settings.endGroup();
   }
 
@@ -99,6 +102,7 @@ namespace Avogadro {
     m_settings->setHOMOFirst(m_sortedTableModel->isHOMOFirst());
     m_settings->setLimitPrecalc(m_precalc_limit);
     m_settings->setPrecalcRange(m_precalc_range);
+    m_settings->setScreeningTolerance(m_screening_tolerance);
     m_settings->show();
   }
 
@@ -209,6 +213,11 @@ namespace Avogadro {
     m_precalc_range = range;
   }
 
+  void OrbitalWidget::setScreeningTolerance(double tolerance)
+  {
+    m_screening_tolerance = tolerance;
+  }
+
   void OrbitalWidget::initializeProgress(int orbital, int min, int max, int stage, int totalStages)
   {
     m_tableModel->setOrbitalProgressRange(orbital, min, max, stage, totalStages);
@@ -57,6 +57,8 @@ namespace Avogadro {
       bool precalcLimit() {return m_precalc_limit;}
       int precalcRange() {return m_precalc_range;}
 
+      double screeningTolerance() {return m_screening_tolerance;}
+
       static double OrbitalQualityToDouble(OrbitalQuality q);
       static double OrbitalQualityToDouble(int i) {
         return OrbitalQualityToDouble(OrbitalQuality(i));};
@@ -70,6 +72,7 @@ namespace Avogadro {
       void selectOrbital(unsigned int orbital);
       void setDefaults(OrbitalWidget::OrbitalQuality quality, double isovalue, bool HOMOFirst);
       void setPrecalcSettings(bool limit, int range);
+      void setScreeningTolerance(double tolerance);
       void initializeProgress(int orbital, int min, int max, int stage, int totalStages);
       void nextProgressStage(int orbital, int newmin, int newmax);
       void updateProgress(int orbital, int current);
@@ -95,6 +98,8 @@ namespace Avogadro {
       bool m_precalc_limit;
       int m_precalc_range;
 
+      double m_screening_tolerance;
+
       OrbitalTableModel *m_tableModel;
       OrbitalSortingProxyModel *m_sortedTableModel;
   };
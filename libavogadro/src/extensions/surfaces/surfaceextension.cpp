@@ -31,6 +31,7 @@
 #include <openqube/cube.h>
 
 #include "vdwsurface.h"
+#include "espmapper.h"
 #include "surfacedialog.h"
 
 #include <vector>
@@ -42,7 +43,6 @@
 #include <avogadro/color3f.h>
 #include <avogadro/meshgenerator.h>
 #include <avogadro/engine.h>
-#include <avogadro/neighborlist.h>
 #include <avogadro/glwidget.h>
 
 #include <Eigen/Core>
@@ -64,10 +64,14 @@ using namespace OpenQube;
 
 namespace Avogadro
 {
+  // The ESP colors are saturated at this potential, in e/Å (about 0.05
+  // hartree/e)
+  const double ESP_SATURATION = 0.1;
+
   SurfaceExtension::SurfaceExtension(QObject* parent) : Extension(parent),
     m_glwidget(0), m_surfaceDialog(0), m_molecule(0), m_basis(0), m_progress(0),
     m_mesh1(0), m_mesh2(0), m_meshGen1(0), m_meshGen2(0), m_VdWsurface(0),
-    m_cube(0), m_qube(0), m_cubeColor(0)
+    m_espMapper(0), m_cube(0), m_qube(0), m_cubeColor(0)
   {
     QAction* action = new QAction(this);
     action->setText(tr("Create Surfaces..."));
@@ -84,6 +88,8 @@ namespace Avogadro
     m_meshGen2 = 0;
     delete m_VdWsurface;
     m_VdWsurface = 0;
+    delete m_espMapper;
+    m_espMapper = 0;
   }
 
   QList<QAction *> SurfaceExtension::actions() const
@@ -125,6 +131,8 @@ namespace Avogadro
     m_basis = 0;
     delete m_VdWsurface;
     m_VdWsurface = 0;
+    delete m_espMapper;
+    m_espMapper = 0;
     m_loadedFileName = QString();
     m_cubes.clear();
     m_cubes << FALSE_ID << FALSE_ID;
@@ -203,35 +211,15 @@ namespace Avogadro
     if (!m_molecule)
       return;
 
-    // Check to see if molecule has hydrogens
-    bool hasHydrogens = false;
-    foreach (Atom *atom, m_molecule->atoms())
-      if (atom->atomicNumber() == 1) {
-        hasHydrogens = true;
-        break;
-      }
-
-    NeighborList *nbrList = new NeighborList(m_molecule, 7.0, false, 2);
+    if (!m_espMapper)
+      m_espMapper = new ESPMapper;
+    m_espMapper->setCharges(m_molecule);
+    const std::vector<double> &potentials = m_espMapper->calculate(mesh);
 
     std::vector<Color3f> colors;
-    for(unsigned int i=0; i < mesh->vertices().size(); ++i) {
-      const Vector3f *v = mesh->vertex(i);
-
-      double energy = 0.0;
-
-      QList<Atom*> nbrAtoms = nbrList->nbrs(v);
-      // Include formal charges when there are hydrogens
-      if (hasHydrogens) {
-        foreach(Atom *a, nbrAtoms) {
-          Vector3f dist = a->pos()->cast<float>() - v->cast<float>();
-          energy += (a->formalCharge() + a->partialCharge()) / dist.squaredNorm();
-        }
-      } else {
-        foreach(Atom *a, nbrAtoms) {
-          Vector3f dist = a->pos()->cast<float>() - v->cast<float>();
-          energy += a->partialCharge() / dist.squaredNorm();
-        }
-      }
+    colors.reserve(potentials.size());
+    for(unsigned int i=0; i < potentials.size(); ++i) {
+      double energy = potentials[i] / ESP_SATURATION;
 
       // Chemistry convention: red = negative, blue = positive
       //
@@ -244,15 +232,12 @@ namespace Avogadro
 
       if (energy < 0.0) {
         hue = red_hue;
-        saturation = -255 * 5 * energy;
+        saturation = qMin(-255.0 * energy, 255.0);
       } else if (energy > 0.0) {
         hue = blue_hue;
-        saturation = 255 * 5 * energy;
+        saturation = qMin(255.0 * energy, 255.0);
       }
 
-      if (saturation > 255)
-        saturation = 255;
-
       QColor qcolor(QColor::fromHsv(hue, saturation, value));
       Color3f color(qcolor.red(), qcolor.green(), qcolor.blue());
       colors.push_back(color);
@@ -46,6 +46,7 @@ namespace Avogadro
   class Mesh;
   class MeshGenerator;
   class VdWSurface;
+  class ESPMapper;
   class SurfaceDialog;
 
   class SurfaceExtension : public Extension
@@ -83,6 +84,7 @@ namespace Avogadro
     MeshGenerator *m_meshGen2;
 
     VdWSurface *m_VdWsurface;
+    ESPMapper *m_espMapper;
 
     Cube *m_cube;
     OpenQube::Cube *m_qube;
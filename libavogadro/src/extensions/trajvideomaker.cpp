@@ -65,7 +65,7 @@ namespace Avogadro {
     //start the progress dialog
     QProgressDialog progDialog(QObject::tr("Building video "),
                                QObject::tr("Cancel"), 0,
-                               molecule->numConformers()*2);
+                               animation->numFrames()*2);
     progDialog.setMinimumDuration(1);
     progDialog.setValue(0);
 
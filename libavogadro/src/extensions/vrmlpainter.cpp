@@ -268,10 +268,16 @@ namespace Avogadro
 			verts << t[i].x()*this->scale << " " << t[i].y()*this->scale << " " << t[i].z()*this->scale << ",\n";
 			colors << c[i].red() << " " << c[i].green() << " " << c[i].blue() << ", ";
 		}
-		// Now to write out the indices
-		for (unsigned int i = 0; i < t.size(); i += 3) {
-			iverts << i << ", " << i + 1 << ", " << i + 2 << ", -1,\n";
-
+		// Now to write out the indices, non-indexed meshes use three
+		// consecutive vertices for each triangle
+		const std::vector<unsigned int> &ind = mesh.indices();
+		if (ind.empty()) {
+			for (unsigned int i = 0; i < t.size(); i += 3)
+				iverts << i << ", " << i + 1 << ", " << i + 2 << ", -1,\n";
+		}
+		else {
+			for (unsigned int i = 0; i < ind.size(); i += 3)
+				iverts << ind[i] << ", " << ind[i + 1] << ", " << ind[i + 2] << ", -1,\n";
 		}
 
 		// Now to write out the full mesh - could be pretty big...
@@ -310,10 +316,16 @@ namespace Avogadro
 			verts << t[i].x()*this->scale << " " << t[i].y()*this->scale << " " << t[i].z()*this->scale << ",\n";
 			colors << c[i].red() << " " << c[i].green() << " " << c[i].blue() << ", ";
 		}
-		// Now to write out the indices
-		for (unsigned int i = 0; i < t.size(); i += 3) {
-			iverts << i << ", " << i + 1 << ", " << i + 2 << ", -1,\n";
-
+		// Now to write out the indices, non-indexed meshes use three
+		// consecutive vertices for each triangle
+		const std::vector<unsigned int> &ind = mesh.indices();
+		if (ind.empty()) {
+			for (unsigned int i = 0; i < t.size(); i += 3)
+				iverts << i << ", " << i + 1 << ", " << i + 2 << ", -1,\n";
+		}
+		else {
+			for (unsigned int i = 0; i < ind.size(); i += 3)
+				iverts << ind[i] << ", " << ind[i + 1] << ", " << ind[i + 2] << ", -1,\n";
 		}
 
 		// Now to write out the full mesh - could be pretty big...
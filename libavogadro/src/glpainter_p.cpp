@@ -33,6 +33,7 @@
 #include "camera.h"
 #include "sphere_p.h"
 #include "cylinder_p.h"
+#include "instancedrenderer_p.h"
 #include "textrenderer_p.h"
 
 #include <avogadro/atom.h>
@@ -45,6 +46,10 @@
 #include <QDebug>
 #include <QColor>
 #include <QVarLengthArray>
+#include <QVector>
+#include <QHash>
+#include <QPointer>
+#include <QOpenGLBuffer>
 #include <Eigen/Geometry>
 #define _USE_MATH_DEFINES
 #include <cmath>
@@ -110,17 +115,40 @@ namespace Avogadro
     / ( PAINTER_CYLINDERS_SQRT_LIMIT_MAX_LEVEL - PAINTER_CYLINDERS_SQRT_LIMIT_MIN_LEVEL );
 //  const double   PAINTER_FRUSTUM_CULL_TRESHOLD = -0.8;
 
+  /**
+   * Buffer objects holding a copy of a Mesh on the graphics card. They are
+   * updated whenever the revision of the Mesh changes.
+   */
+  struct MeshBuffers
+  {
+    MeshBuffers() : vertices(QOpenGLBuffer::VertexBuffer),
+      colors(QOpenGLBuffer::VertexBuffer), indices(QOpenGLBuffer::IndexBuffer),
+      revision(0), numVertices(0), numIndices(0), alpha(-1.0f) {}
+
+    QPointer<Mesh> mesh;
+    QOpenGLBuffer vertices; // The vertices followed by the normals
+    QOpenGLBuffer colors;   // RGBA colors using the alpha below
+    QOpenGLBuffer indices;
+    unsigned int revision;
+    int numVertices;
+    int numIndices;
+    float alpha;            // Alpha of the uploaded colors, -1 if none yet
+    Color3f averageColor;
+  };
+
   class GLPainterPrivate
   {
   public:
     GLPainterPrivate() : widget ( 0 ), newQuality(-1), quality ( 0 ), overflow(0),
                          spheres ( 0 ), cylinders ( 0 ),
                          textRenderer ( new TextRenderer ), initialized ( false ), sharing ( 0 ),
-                         type(Primitive::OtherType), id ( -1 ), color(0)  {};
+                         type(Primitive::OtherType), id ( -1 ), color(0),
+                         impostors(false) {};
     ~GLPainterPrivate()
     {
       deleteObjects();
       delete textRenderer;
+      qDeleteAll(meshBuffers);
     }
 
     GLWidget *widget;
@@ -160,6 +188,27 @@ namespace Avogadro
     Primitive::Type type;
     int id;
     Color color;
+
+    /**
+     * Draws spheres and cylinders in batches when possible.
+     */
+    InstancedRenderer instancedRenderer;
+
+    /**
+     * Whether the batched spheres and cylinders are drawn as impostors.
+     */
+    bool impostors;
+
+    /**
+     * Buffer objects of the meshes drawn so far, keyed on the Mesh.
+     */
+    QHash<const Mesh *, MeshBuffers *> meshBuffers;
+
+    /**
+     * @return The buffer objects for the Mesh, or 0 if buffer objects are not
+     * supported. Buffers of meshes that have been deleted are released.
+     */
+    MeshBuffers * buffersForMesh(const Mesh &mesh);
   };
 
   inline bool GLPainterPrivate::isValid()
@@ -193,6 +242,125 @@ namespace Avogadro
     return true;
   }
 
+  MeshBuffers * GLPainterPrivate::buffersForMesh(const Mesh &mesh)
+  {
+    // Release the buffers of any meshes that no longer exist
+    QHash<const Mesh *, MeshBuffers *>::iterator it = meshBuffers.begin();
+    while (it != meshBuffers.end()) {
+      if (it.value()->mesh.isNull()) {
+        delete it.value();
+        it = meshBuffers.erase(it);
+      }
+      else {
+        ++it;
+      }
+    }
+
+    MeshBuffers *buffers = meshBuffers.value(&mesh);
+    if (buffers)
+      return buffers;
+
+    buffers = new MeshBuffers;
+    if (!buffers->vertices.create() || !buffers->colors.create()
+        || !buffers->indices.create()) {
+      delete buffers;
+      return 0;
+    }
+    buffers->vertices.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    buffers->colors.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    buffers->indices.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    buffers->mesh = const_cast<Mesh *>(&mesh);
+    meshBuffers.insert(&mesh, buffers);
+    return buffers;
+  }
+
+  /**
+   * Fill rgba with the colors of the mesh and the supplied alpha.
+   * @return The average color of the mesh.
+   */
+  static Color3f meshColors(const std::vector<Color3f> &colors, float alpha,
+                            std::vector<float> &rgba)
+  {
+    float r = 0.0f, g = 0.0f, b = 0.0f;
+    rgba.resize(4 * colors.size());
+    for (unsigned int i = 0; i < colors.size(); ++i) {
+      rgba[4*i]   = colors[i].red();
+      rgba[4*i+1] = colors[i].green();
+      rgba[4*i+2] = colors[i].blue();
+      rgba[4*i+3] = alpha;
+      r += colors[i].red();
+      g += colors[i].green();
+      b += colors[i].blue();
+    }
+    if (colors.size())
+      return Color3f(r / colors.size(), g / colors.size(), b / colors.size());
+    return Color3f();
+  }
+
+  /**
+   * Scale the ambient of the light model and of the enabled lights. Save the
+   * lighting state with glPushAttrib(GL_LIGHTING_BIT) first.
+   */
+  static void scaleAmbient(float factor)
+  {
+    float ambient[4];
+    glGetFloatv(GL_LIGHT_MODEL_AMBIENT, ambient);
+    for (int i = 0; i < 3; ++i)
+      ambient[i] *= factor;
+    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, ambient);
+
+    GLint maxLights = 0;
+    glGetIntegerv(GL_MAX_LIGHTS, &maxLights);
+    for (GLint light = GL_LIGHT0; light < GL_LIGHT0 + maxLights; ++light) {
+      if (!glIsEnabled(light))
+        continue;
+      glGetLightfv(light, GL_AMBIENT, ambient);
+      for (int i = 0; i < 3; ++i)
+        ambient[i] *= factor;
+      glLightfv(light, GL_AMBIENT, ambient);
+    }
+  }
+
+  /**
+   * Append the instance data of a sphere as used by InstancedRenderer.
+   */
+  static void appendSphere(std::vector<float> &instances,
+                           const Eigen::Vector3d &center, double radius,
+                           const QColor &color)
+  {
+    float instance[8] = { static_cast<float>(center.x()),
+                          static_cast<float>(center.y()),
+                          static_cast<float>(center.z()),
+                          static_cast<float>(radius),
+                          static_cast<float>(color.redF()),
+                          static_cast<float>(color.greenF()),
+                          static_cast<float>(color.blueF()),
+                          static_cast<float>(color.alphaF()) };
+    instances.insert(instances.end(), instance, instance + 8);
+  }
+
+  /**
+   * Append the instance data of a cylinder as used by InstancedRenderer.
+   */
+  static void appendCylinder(std::vector<float> &instances,
+                             const Eigen::Vector3d &end1,
+                             const Eigen::Vector3d &end2, double radius,
+                             const QColor &color)
+  {
+    float instance[12] = { static_cast<float>(end1.x()),
+                           static_cast<float>(end1.y()),
+                           static_cast<float>(end1.z()),
+                           static_cast<float>(radius),
+                           static_cast<float>(end2.x()),
+                           static_cast<float>(end2.y()),
+                           static_cast<float>(end2.z()), 0.0f,
+                           static_cast<float>(color.redF()),
+                           static_cast<float>(color.greenF()),
+                           static_cast<float>(color.blueF()),
+                           static_cast<float>(color.alphaF()) };
+    instances.insert(instances.end(), instance, instance + 12);
+  }
+
   void GLPainterPrivate::deleteObjects()
   {
     int level, lastLevel, n;
@@ -340,24 +508,21 @@ namespace Avogadro
     d->color.setFromQColor(QColor(name));
   }
 
+  void GLPainter::setImpostors(bool enabled)
+  {
+#ifdef ENABLE_GLSL
+    d->impostors = enabled;
+#else
+    Q_UNUSED(enabled);
+#endif
+  }
+
   void GLPainter::drawSphere (const Eigen::Vector3d &center, double radius)
   {
     if(!d->isValid())
       return;
 
-    // Default to the minimum detail level for this quality
-    int detailLevel = PAINTER_MAX_DETAIL_LEVEL / 3;
-
-    if (d->widget->projection() != GLWidget::Orthographic &&
-        m_dynamicScaling) {
-      double apparentRadius = radius / d->widget->camera()->distance(center);
-      detailLevel = 1 + static_cast<int>(floor (PAINTER_SPHERES_DETAIL_COEFF
-                        * (sqrt(apparentRadius) - PAINTER_SPHERES_SQRT_LIMIT_MIN_LEVEL)));
-      if (detailLevel < 0)
-        detailLevel = 0;
-      if (detailLevel > PAINTER_MAX_DETAIL_LEVEL)
-        detailLevel = PAINTER_MAX_DETAIL_LEVEL;
-    }
+    int detailLevel = sphereDetailLevel(center, radius);
 
     d->color.applyAsMaterials();
     pushName();
@@ -370,33 +535,201 @@ namespace Avogadro
   {
     if(!d->isValid()) { return; }
 
+    int detailLevel = cylinderDetailLevel(end1, radius);
+
+    d->color.applyAsMaterials();
+    pushName();
+    d->cylinders[detailLevel]->draw ( end1, end2, radius );
+    popName();
+  }
+
+  void GLPainter::drawMultiCylinder ( const Eigen::Vector3d &end1, const Eigen::Vector3d &end2,
+                                      double radius, int order, double shift )
+  {
+    if(!d->isValid()) { return; }
+
+    int detailLevel = cylinderDetailLevel(end1, radius);
+
+    d->color.applyAsMaterials();
+    pushName();
+    d->cylinders[detailLevel]->drawMulti ( end1, end2, radius, order,
+                                           shift, d->widget->normalVector() );
+    popName();
+  }
+
+  void GLPainter::drawSpheres(const QVector<Eigen::Vector3d> &centers,
+                              const QVector<double> &radii,
+                              const QVector<QColor> &colors)
+  {
+    if(!d->isValid()) { return; }
+    resetName();
+
+    if (!d->instancedRenderer.isUsable()) {
+      Painter::drawSpheres(centers, radii, colors);
+      return;
+    }
+
+    if (d->impostors) {
+      std::vector<float> instances;
+      instances.reserve(8 * centers.size());
+      for (int i = 0; i < centers.size(); ++i)
+        appendSphere(instances, centers[i], radii[i], colors[i]);
+      if (d->instancedRenderer.drawSphereImpostors(instances))
+        return;
+    }
+
+    // Several detail levels may share the same Sphere, group the spheres by
+    // the first detail level using each Sphere
+    std::vector<float> instances[PAINTER_DETAIL_LEVELS];
+    for (int i = 0; i < centers.size(); ++i) {
+      int level = sphereDetailLevel(centers[i], radii[i]);
+      while (level > 0 && d->spheres[level - 1] == d->spheres[level])
+        --level;
+      appendSphere(instances[level], centers[i], radii[i], colors[i]);
+    }
+
+    for (int level = 0; level < PAINTER_DETAIL_LEVELS; ++level) {
+      const std::vector<float> &group = instances[level];
+      if (d->instancedRenderer.drawSpheres(*d->spheres[level], group))
+        continue;
+      for (unsigned int i = 0; i < group.size(); i += 8) {
+        d->color.setFromRgba(group[i+4], group[i+5], group[i+6], group[i+7]);
+        d->color.applyAsMaterials();
+        d->spheres[level]->draw(Eigen::Vector3d(group[i], group[i+1],
+                                                group[i+2]), group[i+3]);
+      }
+    }
+  }
+
+  void GLPainter::drawCylinders(const QVector<Eigen::Vector3d> &ends1,
+                                const QVector<Eigen::Vector3d> &ends2,
+                                const QVector<double> &radii,
+                                const QVector<QColor> &colors)
+  {
+    if(!d->isValid()) { return; }
+    resetName();
+
+    if (!d->instancedRenderer.isUsable()) {
+      Painter::drawCylinders(ends1, ends2, radii, colors);
+      return;
+    }
+
+    if (d->impostors) {
+      std::vector<float> instances;
+      instances.reserve(12 * ends1.size());
+      for (int i = 0; i < ends1.size(); ++i)
+        appendCylinder(instances, ends1[i], ends2[i], radii[i], colors[i]);
+      if (d->instancedRenderer.drawCylinderImpostors(instances))
+        return;
+    }
+
+    // Group the cylinders by the first detail level using each Cylinder
+    std::vector<float> instances[PAINTER_DETAIL_LEVELS];
+    for (int i = 0; i < ends1.size(); ++i) {
+      int level = cylinderDetailLevel(ends1[i], radii[i]);
+      while (level > 0 && d->cylinders[level - 1] == d->cylinders[level])
+        --level;
+      appendCylinder(instances[level], ends1[i], ends2[i], radii[i],
+                     colors[i]);
+    }
+
+    for (int level = 0; level < PAINTER_DETAIL_LEVELS; ++level) {
+      const std::vector<float> &group = instances[level];
+      if (d->instancedRenderer.drawCylinders(*d->cylinders[level], group))
+        continue;
+      // Cylinders drawn as lines can not be instanced
+      for (unsigned int i = 0; i < group.size(); i += 12) {
+        d->color.setFromRgba(group[i+8], group[i+9], group[i+10], group[i+11]);
+        d->color.applyAsMaterials();
+        d->cylinders[level]->draw(Eigen::Vector3d(group[i], group[i+1],
+                                                  group[i+2]),
+                                  Eigen::Vector3d(group[i+4], group[i+5],
+                                                  group[i+6]), group[i+3]);
+      }
+    }
+  }
+
+  void GLPainter::drawMultiCylinders(const QVector<Eigen::Vector3d> &ends1,
+                                     const QVector<Eigen::Vector3d> &ends2,
+                                     double radius, const QVector<int> &orders,
+                                     double shift,
+                                     const QVector<QColor> &colors)
+  {
+    if(!d->isValid()) { return; }
+
+    if (!d->instancedRenderer.isUsable()) {
+      Painter::drawMultiCylinders(ends1, ends2, radius, orders, shift, colors);
+      return;
+    }
+
+    // Split the multiple cylinders into single ones, placed around the axis
+    // in the same way as Cylinder::drawMulti()
+    QVector<Eigen::Vector3d> cylinderEnds1, cylinderEnds2;
+    QVector<double> cylinderRadii;
+    QVector<QColor> cylinderColors;
+    cylinderEnds1.reserve(ends1.size());
+    cylinderEnds2.reserve(ends1.size());
+    cylinderRadii.reserve(ends1.size());
+    cylinderColors.reserve(ends1.size());
+    const Eigen::Vector3d &planeNormal = d->widget->normalVector();
+    for (int i = 0; i < ends1.size(); ++i) {
+      int order = orders[i];
+      if (order <= 1) {
+        cylinderEnds1.append(ends1[i]);
+        cylinderEnds2.append(ends2[i]);
+        cylinderRadii.append(radius);
+        cylinderColors.append(colors[i]);
+        continue;
+      }
+
+      Eigen::Vector3d axis = (ends2[i] - ends1[i]).normalized();
+      Eigen::Vector3d ortho1 = axis.cross(planeNormal);
+      if (ortho1.norm() > 0.001)
+        ortho1.normalize();
+      else
+        ortho1 = axis.unitOrthogonal();
+      Eigen::Vector3d ortho2 = axis.cross(ortho1);
+
+      double angleOffset = 0.0;
+      if (order >= 3) {
+        if (order == 3) angleOffset = 90.0;
+        else angleOffset = 22.5;
+      }
+      for (int j = 0; j < order; ++j) {
+        double angle = (angleOffset + 360.0 * j / order) * M_PI / 180.0;
+        Eigen::Vector3d displacement = shift * (cos(angle) * ortho1
+                                                + sin(angle) * ortho2);
+        cylinderEnds1.append(ends1[i] + displacement);
+        cylinderEnds2.append(ends2[i] + displacement);
+        cylinderRadii.append(radius);
+        cylinderColors.append(colors[i]);
+      }
+    }
+    drawCylinders(cylinderEnds1, cylinderEnds2, cylinderRadii, cylinderColors);
+  }
+
+  int GLPainter::sphereDetailLevel(const Eigen::Vector3d &center,
+                                   double radius) const
+  {
     // Default to the minimum detail level for this quality
     int detailLevel = PAINTER_MAX_DETAIL_LEVEL / 3;
 
     if (d->widget->projection() != GLWidget::Orthographic &&
         m_dynamicScaling) {
-      double apparentRadius = radius / d->widget->camera()->distance(end1);
-      detailLevel = 1 + static_cast<int> ( floor (
-                                                    PAINTER_CYLINDERS_DETAIL_COEFF
-                                                    * ( sqrt ( apparentRadius ) - PAINTER_CYLINDERS_SQRT_LIMIT_MIN_LEVEL )
-                                                    ) );
+      double apparentRadius = radius / d->widget->camera()->distance(center);
+      detailLevel = 1 + static_cast<int>(floor (PAINTER_SPHERES_DETAIL_COEFF
+                        * (sqrt(apparentRadius) - PAINTER_SPHERES_SQRT_LIMIT_MIN_LEVEL)));
       if (detailLevel < 0)
         detailLevel = 0;
       if (detailLevel > PAINTER_MAX_DETAIL_LEVEL)
         detailLevel = PAINTER_MAX_DETAIL_LEVEL;
     }
-
-    d->color.applyAsMaterials();
-    pushName();
-    d->cylinders[detailLevel]->draw ( end1, end2, radius );
-    popName();
+    return detailLevel;
   }
 
-  void GLPainter::drawMultiCylinder ( const Eigen::Vector3d &end1, const Eigen::Vector3d &end2,
-                                      double radius, int order, double shift )
+  int GLPainter::cylinderDetailLevel(const Eigen::Vector3d &end1,
+                                     double radius) const
   {
-    if(!d->isValid()) { return; }
-
     // Default to the minimum detail level for this quality
     int detailLevel = PAINTER_MAX_DETAIL_LEVEL / 3;
 
@@ -412,12 +745,7 @@ namespace Avogadro
       if (detailLevel > PAINTER_MAX_DETAIL_LEVEL)
         detailLevel = PAINTER_MAX_DETAIL_LEVEL;
     }
-
-    d->color.applyAsMaterials();
-    pushName();
-    d->cylinders[detailLevel]->drawMulti ( end1, end2, radius, order,
-                                           shift, d->widget->normalVector() );
-    popName();
+    return detailLevel;
   }
 
   void GLPainter::drawCone(const Eigen::Vector3d &base,
@@ -1017,22 +1345,7 @@ namespace Avogadro
     d->color.applyAsMaterials();
 
     // Render the triangles of the mesh
-    std::vector<Eigen::Vector3f> v = mesh.vertices();
-    std::vector<Eigen::Vector3f> n = mesh.normals();
-
-    if (v.size() != n.size()) {
-      qDebug() << "Vertices size does not equal normals size:" << v.size()
-               << n.size();
-      return;
-    }
-
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glEnableClientState(GL_NORMAL_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, &(v[0]));
-    glNormalPointer(GL_FLOAT, 0, &(n[0]));
-    glDrawArrays(GL_TRIANGLES, 0, v.size());
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_NORMAL_ARRAY);
+    drawMeshArrays(mesh, false);
 
     glPolygonMode(GL_FRONT, GL_FILL);
     glEnable(GL_LIGHTING);
@@ -1058,45 +1371,127 @@ namespace Avogadro
     }
 
     // Render the triangles of the mesh
-    std::vector<Eigen::Vector3f> v = mesh.vertices();
-    std::vector<Eigen::Vector3f> n = mesh.normals();
-    std::vector<Color3f> c = mesh.colors();
+    drawMeshArrays(mesh, true);
+
+    glPolygonMode(GL_FRONT, GL_FILL);
+    glEnable(GL_LIGHTING);
+  }
+
+  void GLPainter::drawMeshArrays(const Mesh &mesh, bool useColors)
+  {
+    // Take the revision first, should the mesh change while it is being
+    // uploaded it will simply be uploaded again next time
+    unsigned int revision = mesh.revision();
+    const std::vector<Eigen::Vector3f> &v = mesh.vertices();
+    const std::vector<Eigen::Vector3f> &n = mesh.normals();
+    const std::vector<Color3f> &c = mesh.colors();
+    const std::vector<unsigned int> &indices = mesh.indices();
 
-    if (v.size() != n.size() || v.size() != c.size()) {
-      qDebug() << "Vertices size does not equal normals size or color size:"
-               << v.size() << n.size() << c.size();
+    if (v.size() != n.size()) {
+      qDebug() << "Vertices size does not equal normals size:" << v.size()
+               << n.size();
+      return;
+    }
+    if (useColors && v.size() != c.size()) {
+      qDebug() << "Vertices size does not equal color size:"
+               << v.size() << c.size();
       return;
     }
+    if (v.empty())
+      return;
 
-    d->color.applyAsMaterials();
+    float alpha = d->color.alpha();
+    std::vector<float> rgba;
+    Color3f averageColor;
+    const unsigned int *indexPointer = indices.empty() ? 0 : &indices[0];
+    int numVertices = v.size();
+    int numIndices = indices.size();
+
+    MeshBuffers *buffers = d->buffersForMesh(mesh);
+    if (buffers) {
+      if (buffers->revision != revision) {
+        int size = v.size() * sizeof(Eigen::Vector3f);
+        buffers->vertices.bind();
+        buffers->vertices.allocate(2 * size);
+        buffers->vertices.write(0, &v[0], size);
+        buffers->vertices.write(size, &n[0], size);
+        if (!indices.empty()) {
+          buffers->indices.bind();
+          buffers->indices.allocate(&indices[0],
+                                    indices.size() * sizeof(unsigned int));
+          buffers->indices.release();
+        }
+        buffers->numVertices = v.size();
+        buffers->numIndices = indices.size();
+        buffers->alpha = -1.0f;
+        buffers->revision = revision;
+      }
+      if (useColors && buffers->alpha != alpha) {
+        buffers->averageColor = meshColors(c, alpha, rgba);
+        buffers->colors.bind();
+        buffers->colors.allocate(&rgba[0], rgba.size() * sizeof(float));
+        buffers->alpha = alpha;
+      }
+      averageColor = buffers->averageColor;
+      numVertices = buffers->numVertices;
+      numIndices = buffers->numIndices;
+      // Offsets into the bound buffer objects
+      indexPointer = 0;
+    }
+    else if (useColors) {
+      averageColor = meshColors(c, alpha, rgba);
+    }
 
-    /* Need to work out issues with material properties, lighting etc...
-    glEnable(GL_COLOR_MATERIAL);
     glEnableClientState(GL_VERTEX_ARRAY);
     glEnableClientState(GL_NORMAL_ARRAY);
-    glEnableClientState(GL_COLOR_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, &(v[0]));
-    glNormalPointer(GL_FLOAT, 0, &(n[0]));
-    glColorPointer(3, GL_FLOAT, 0, &(c[0]));
-    glDrawArrays(GL_TRIANGLES, 0, v.size());
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glDisableClientState(GL_NORMAL_ARRAY);
-    glDisableClientState(GL_COLOR_ARRAY);
-    glDisable(GL_COLOR_MATERIAL);
-*/
-
-    float alpha = d->color.alpha();
+    if (useColors) {
+      // The colors of the vertices are tracked by the ambient and diffuse
+      // materials, only the specular uses the average color of the mesh.
+      // The ambient material is a third of the color in applyAsMaterials(),
+      // so the ambient of the lights is scaled instead while drawing.
+      applyAsMaterials(averageColor, alpha);
+      glPushAttrib(GL_LIGHTING_BIT);
+      scaleAmbient(1.0f / 3.0f);
+      glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+      glEnable(GL_COLOR_MATERIAL);
+      glEnableClientState(GL_COLOR_ARRAY);
+      if (buffers) {
+        buffers->colors.bind();
+        glColorPointer(4, GL_FLOAT, 0, 0);
+      }
+      else {
+        glColorPointer(4, GL_FLOAT, 0, &rgba[0]);
+      }
+    }
+    if (buffers) {
+      buffers->vertices.bind();
+      glVertexPointer(3, GL_FLOAT, 0, 0);
+      glNormalPointer(GL_FLOAT, 0, reinterpret_cast<const GLvoid *>(
+                        numVertices * sizeof(Eigen::Vector3f)));
+      buffers->vertices.release();
+    }
+    else {
+      glVertexPointer(3, GL_FLOAT, 0, &v[0]);
+      glNormalPointer(GL_FLOAT, 0, &n[0]);
+    }
 
-    glBegin(GL_TRIANGLES);
-    for(unsigned int i = 0; i < v.size(); ++i) {
-      applyAsMaterials(c[i], alpha);
-      glNormal3fv(n[i].data());
-      glVertex3fv(v[i].data());
+    if (numIndices) {
+      if (buffers)
+        buffers->indices.bind();
+      glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, indexPointer);
+      if (buffers)
+        buffers->indices.release();
+    }
+    else {
+      glDrawArrays(GL_TRIANGLES, 0, numVertices);
     }
-    glEnd();
 
-    glPolygonMode(GL_FRONT, GL_FILL);
-    glEnable(GL_LIGHTING);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    if (useColors) {
+      glDisableClientState(GL_COLOR_ARRAY);
+      glPopAttrib();
+    }
   }
 
   int GLPainter::drawText ( int x, int y, const QString &string )
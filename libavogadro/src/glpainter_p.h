@@ -118,6 +118,13 @@ namespace Avogadro
      */    
     void setColor(QString name);
 
+    /**
+     * Draw spheres and cylinders passed to the batch calls as ray cast
+     * impostors. Only honoured when built with GLSL support and when the
+     * OpenGL context can build the impostor shaders.
+     */
+    void setImpostors(bool enabled);
+
     /**
      * Draws a sphere, leaving the Painter choose the appropriate detail level based on the
      * apparent radius (ratio of radius over distance) and the global quality setting.
@@ -161,6 +168,32 @@ namespace Avogadro
     void drawMultiCylinder(const Eigen::Vector3d &end1, const Eigen::Vector3d &end2,
                            double radius, int order, double shift);
 
+    /**
+     * Draws a set of spheres. When the OpenGL context supports it the spheres
+     * of each detail level are drawn with a single instanced draw call,
+     * otherwise they are drawn one by one as with drawSphere(). If impostors
+     * are enabled all the spheres are ray cast in one draw call instead.
+     */
+    void drawSpheres(const QVector<Eigen::Vector3d> &centers,
+                     const QVector<double> &radii,
+                     const QVector<QColor> &colors);
+
+    /**
+     * Draws a set of cylinders, instanced like drawSpheres().
+     */
+    void drawCylinders(const QVector<Eigen::Vector3d> &ends1,
+                       const QVector<Eigen::Vector3d> &ends2,
+                       const QVector<double> &radii,
+                       const QVector<QColor> &colors);
+
+    /**
+     * Draws a set of multiple cylinders, instanced like drawSpheres().
+     */
+    void drawMultiCylinders(const QVector<Eigen::Vector3d> &ends1,
+                            const QVector<Eigen::Vector3d> &ends2,
+                            double radius, const QVector<int> &orders,
+                            double shift, const QVector<QColor> &colors);
+
     /**
      * Draws a cone between the tip and the base with the base radius given.
      * @param base the position of the base of the cone.
@@ -542,6 +575,25 @@ namespace Avogadro
      * specular colors. This is only useful if lighting is enabled.
      */
     inline void applyAsMaterials(const Color3f &color, float alpha = 1.0);
+
+    /**
+     * Draws the triangles of the mesh, using the per vertex colors of the
+     * mesh if @p useColors is true. The mesh is kept in buffer objects that
+     * are only updated when the mesh changes, if buffer objects are not
+     * available it is drawn from client memory.
+     */
+    void drawMeshArrays(const Mesh &mesh, bool useColors);
+
+    /**
+     * @return The sphere detail level for a sphere of this size and position.
+     */
+    int sphereDetailLevel(const Eigen::Vector3d &center, double radius) const;
+
+    /**
+     * @return The cylinder detail level for a cylinder of this radius
+     * starting at end1.
+     */
+    int cylinderDetailLevel(const Eigen::Vector3d &end1, double radius) const;
   };
 } // end namespace Avogadro
 
@@ -33,6 +33,7 @@
 #include "glwidget.h"
 #include "glpainter_p.h"
 #include "glhit.h"
+#include "picker_p.h"
 
 #include <QtWidgets/QMessageBox>
 #include <QtGui/QPen>
@@ -181,8 +182,7 @@ void GLWidget::updateViewport()
                         camera( new Camera ),
                         tool( 0 ),
                         toolGroup( 0 ),
-                        selectBuf( 0 ),
-                        selectBufSize( -1 ),
+                        picker( 0 ),
                         undoStack(0),
 #ifdef ENABLE_THREADED_GL
                         thread( 0 ),
@@ -207,7 +207,6 @@ void GLWidget::updateViewport()
 
     ~GLWidgetPrivate()
     {
-      if ( selectBuf ) delete[] selectBuf;
       delete camera;
 
       // free the display lists
@@ -249,8 +248,7 @@ void GLWidget::updateViewport()
     ToolGroup             *toolGroup;
     QList<Extension*>     extensions;
 
-    GLuint                *selectBuf;
-    int                    selectBufSize;
+    Picker                *picker;
 
     QList<QPair<QString, QPair<QList<unsigned int>, QList<unsigned int> > > > namedSelections;
     PrimitiveList          selectedPrimitives;
@@ -459,6 +457,8 @@ GLWidget::GLWidget( Molecule *molecule,
     }
     d->painter->incrementShare();
 
+    d->picker = new Picker(this);
+
     setAutoFillBackground( false );
     setSizePolicy( QSizePolicy::MinimumExpanding,QSizePolicy::MinimumExpanding );
     d->camera->setParent( this );
@@ -2029,6 +2029,7 @@ namespace Avogadro {
     emit moleculeChanged(molecule);
 
     d->molecule = molecule;
+    d->picker->setMolecule(molecule);
 
     // Clear the selection list
     d->selectedPrimitives.clear();
@@ -2175,9 +2176,11 @@ namespace Avogadro {
   {
     connect(engine, SIGNAL(changed()), this, SLOT(update()));
     connect(engine, SIGNAL(changed()), this, SLOT(invalidateDLs()));
+    connect(engine, SIGNAL(changed()), d->picker, SLOT(invalidate()));
     connect(this, SIGNAL(moleculeChanged(Molecule *)),
             engine, SLOT(setMolecule(Molecule *)));
     d->engines.append(engine);
+    d->picker->invalidate();
     qSort(d->engines.begin(), d->engines.end(), engineLessThan);
     engine->setPainterDevice(d->pd);
     emit engineAdded(engine);
@@ -2188,7 +2191,9 @@ namespace Avogadro {
   {
     disconnect(engine, 0, this, 0);
     disconnect(this, 0, engine, 0);
+    disconnect(engine, 0, d->picker, 0);
     d->engines.removeAll(engine);
+    d->picker->invalidate();
     emit engineRemoved(engine);
     engine->deleteLater();
     update();
@@ -2281,115 +2286,23 @@ namespace Avogadro {
 
   QList<GLHit> GLWidget::hits( int x, int y, int w, int h )
   {
-    QList<GLHit> hits;
-
-    if ( !molecule() ) return hits;
-
-    GLint viewport[4];
-    unsigned int hit_count;
-
-    int cx = w/2 + x;
-    int cy = h/2 + y;
-
-    // setup the selection buffer
-    int requiredSelectBufSize = (d->molecule->numAtoms() + d->molecule->numBonds()) * 8;
-    if ( requiredSelectBufSize > d->selectBufSize ) {
-      //resize selection buffer
-      if ( d->selectBuf ) delete[] d->selectBuf;
-      // add some margin so that resizing doesn't occur every time an atom is added
-      d->selectBufSize = requiredSelectBufSize + SEL_BUF_MARGIN;
-      if ( d->selectBufSize > SEL_BUF_MAX_SIZE ) {
-        d->selectBufSize = SEL_BUF_MAX_SIZE;
-      }
-      d->selectBuf = new GLuint[d->selectBufSize];
-    }
+    if ( !molecule() ) return QList<GLHit>();
 
+    // The shapes named by the engines are only recorded again after the
+    // molecule or the engines changed, moving atoms just refits them
+    if ( d->picker->needsBuild() ) {
 #ifdef ENABLE_THREADED_GL
-    d->renderMutex.lock();
-#endif
-    makeCurrent();
-    //X   hits.clear();
-
-    glSelectBuffer( d->selectBufSize, d->selectBuf );
-    glRenderMode( GL_SELECT );
-    glInitNames();
-
-    // Setup a projection matrix for picking in the zone delimited by (x,y,w,h).
-    glGetIntegerv( GL_VIEWPORT, viewport );
-    glMatrixMode( GL_PROJECTION );
-    glPushMatrix();
-    glLoadIdentity();
-    gluPickMatrix( cx,viewport[3]-cy, w, h,viewport );
-
-    // now multiply that projection matrix with the perspective of the camera
-    d->camera->applyProjection();
-
-    // now load the modelview matrix from the camera
-    glMatrixMode( GL_MODELVIEW );
-    glPushMatrix();
-    glLoadIdentity();
-    d->camera->applyModelview();
-
-    // now actually render using low quality, "pickrender"
-    d->painter->begin(this);
-#ifdef ENABLE_GLSL
-        if (m_glslEnabled) glUseProgramObjectARB(0);
+      d->renderMutex.lock();
 #endif
-    foreach(Engine *engine, d->engines) {
-      if(engine->isEnabled()) {
-        engine->renderPick(d->pd);
-      }
-    }
-    d->painter->end();
-
-    // returning to normal rendering mode
-    hit_count = glRenderMode( GL_RENDER );
-
-    glMatrixMode( GL_PROJECTION );
-    glPopMatrix();
-    glMatrixMode( GL_MODELVIEW );
-    glPopMatrix();
-
+      makeCurrent();
+      d->picker->build(d->engines);
 #ifdef ENABLE_THREADED_GL
-    doneCurrent();
-    d->renderMutex.unlock();
+      doneCurrent();
+      d->renderMutex.unlock();
 #endif
-
-    // if no error occurred and there are hits, process them
-    if ( hit_count > 0 ) {
-      unsigned int i, j;
-      GLuint names, type, *ptr;
-      GLuint minZ, maxZ;
-      long name;
-
-      //X   printf ("hits = %d\n", hits);
-      ptr = ( GLuint * ) d->selectBuf;
-      // for all hits and not past end of buffer
-      for (i = 0; i < hit_count && !(ptr > d->selectBuf + d->selectBufSize); ++i) {
-        names = *ptr++;
-        // make sure that we won't be passing the end of bufer
-        if ( ptr + names + 2 > d->selectBuf + d->selectBufSize ) {
-          break;
-        }
-        minZ = *ptr++;
-        maxZ = *ptr++;
-
-        // allow names of 0
-        name = -1;
-        for (j = 0; j < names/2; ++j) { /*  for each name */
-          type = *ptr++;
-          name = *ptr++;
-        }
-        if (name > -1) {
-          //            printf ("%ld(%d) ", name,type);
-          hits.append( GLHit( type,name,minZ,maxZ ) );
-        }
-      }
-      //      printf ("\n");
-      qSort( hits );
     }
 
-    return( hits );
+    return d->picker->hits(x, y, w, h);
   }
 
   Primitive* GLWidget::computeClickedPrimitive(const QPoint& p)
@@ -0,0 +1,626 @@
+/**********************************************************************
+  InstancedRenderer - Draws many spheres or cylinders in one call
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "instancedrenderer_p.h"
+#include "sphere_p.h"
+#include "cylinder_p.h"
+
+#include <QDebug>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+
+namespace Avogadro {
+
+  // Attribute locations, bound explicitly so that they never alias
+  // gl_Vertex or gl_Normal
+  enum {
+    InstanceAttribute0 = 1,
+    InstanceAttribute1 = 2,
+    InstanceAttribute2 = 3
+  };
+
+  // Lighting shared by all shaders. The materials are those set by
+  // GLPainter::applyAsMaterials() and the lights are the fixed function ones
+  // set up by GLWidget. The specular highlight is returned separately as
+  // GLWidget uses a separate specular color.
+  static const char lightSource[] =
+    "uniform bool lighting;\n"
+    "uniform bool light1;\n"
+    "void light(vec3 eye, vec3 n, vec3 color, out vec3 front,\n"
+    "           out vec3 highlight)\n"
+    "{\n"
+    "  vec3 ambient = color / 3.0;\n"
+    "  float s = (0.5 + abs(color.r - color.g) + abs(color.b - color.g)\n"
+    "             + abs(color.b - color.r)) / 4.0;\n"
+    "  vec3 specular = vec3(s) + (1.0 - s) * color;\n"
+    "  front = gl_LightModel.ambient.rgb * ambient;\n"
+    "  highlight = vec3(0.0);\n"
+    "  for (int i = 0; i < 2; ++i) {\n"
+    "    if (i == 1 && !light1)\n"
+    "      break;\n"
+    "    vec3 l = normalize(gl_LightSource[i].position.xyz\n"
+    "                       - gl_LightSource[i].position.w * eye);\n"
+    "    float diffuse = max(dot(n, l), 0.0);\n"
+    "    front += gl_LightSource[i].ambient.rgb * ambient\n"
+    "      + gl_LightSource[i].diffuse.rgb * color * diffuse;\n"
+    "    if (diffuse > 0.0) {\n"
+    "      vec3 h = normalize(l + vec3(0.0, 0.0, 1.0));\n"
+    "      highlight += gl_LightSource[i].specular.rgb * specular\n"
+    "        * pow(max(dot(n, h), 0.0), 50.0);\n"
+    "    }\n"
+    "  }\n"
+    "}\n";
+
+  // Places a vertex of the instanced geometry and lights it, the secondary
+  // color is added by the fixed function fragment stage
+  static const char shadeSource[] =
+    "void shade(vec4 position, vec3 normal, vec4 color)\n"
+    "{\n"
+    "  vec4 eye = gl_ModelViewMatrix * position;\n"
+    "  gl_Position = gl_ProjectionMatrix * eye;\n"
+    "  gl_ClipVertex = eye;\n"
+    "  gl_FogFragCoord = abs(eye.z);\n"
+    "  if (!lighting) {\n"
+    "    gl_FrontColor = color;\n"
+    "    gl_FrontSecondaryColor = vec4(0.0);\n"
+    "    return;\n"
+    "  }\n"
+    "  vec3 front, highlight;\n"
+    "  light(eye.xyz, normalize(gl_NormalMatrix * normal), color.rgb, front,\n"
+    "        highlight);\n"
+    "  gl_FrontColor = vec4(front, color.a);\n"
+    "  gl_FrontSecondaryColor = vec4(highlight, 0.0);\n"
+    "}\n";
+
+  // The unit sphere is scaled by the radius and moved to the center
+  static const char sphereSource[] =
+    "attribute vec4 sphere;\n"
+    "attribute vec4 color;\n"
+    "void main()\n"
+    "{\n"
+    "  shade(vec4(sphere.xyz + sphere.w * gl_Vertex.xyz, 1.0), gl_Normal,\n"
+    "        color);\n"
+    "}\n";
+
+  // The unit cylinder is mapped onto the same basis Cylinder::draw() uses
+  static const char cylinderSource[] =
+    "attribute vec4 end1;\n"
+    "attribute vec3 end2;\n"
+    "attribute vec4 color;\n"
+    "void main()\n"
+    "{\n"
+    "  vec3 axis = end2 - end1.xyz;\n"
+    "  vec3 a = normalize(axis);\n"
+    "  vec3 u;\n"
+    "  if (abs(a.x) > 1.0e-4 * abs(a.z) || abs(a.y) > 1.0e-4 * abs(a.z))\n"
+    "    u = normalize(vec3(-a.y, a.x, 0.0));\n"
+    "  else\n"
+    "    u = normalize(vec3(0.0, -a.z, a.y));\n"
+    "  vec3 v = cross(a, u);\n"
+    "  vec3 position = end1.xyz + end1.w * (gl_Vertex.x * u + gl_Vertex.y * v)\n"
+    "    + gl_Vertex.z * axis;\n"
+    "  shade(vec4(position, 1.0), gl_Normal.x * u + gl_Normal.y * v, color);\n"
+    "}\n";
+
+  // Impostors are ray cast in eye space. The fragment shaders find the
+  // point where the ray through the fragment hits the surface, discard the
+  // fragment if there is none and otherwise light it, fog it and write its
+  // real depth.
+  static const char finishSource[] =
+    "uniform bool fog;\n"
+    "void eyeRay(vec3 point, out vec3 origin, out vec3 direction)\n"
+    "{\n"
+    "  if (gl_ProjectionMatrix[3][3] != 0.0) {\n"
+    "    origin = vec3(point.xy, 0.0);\n"
+    "    direction = vec3(0.0, 0.0, -1.0);\n"
+    "  }\n"
+    "  else {\n"
+    "    origin = vec3(0.0);\n"
+    "    direction = normalize(point);\n"
+    "  }\n"
+    "}\n"
+    "void finish(vec3 eye, vec3 normal, vec4 color)\n"
+    "{\n"
+    "  vec4 clip = gl_ProjectionMatrix * vec4(eye, 1.0);\n"
+    "  gl_FragDepth = 0.5 * (gl_DepthRange.diff * clip.z / clip.w\n"
+    "                        + gl_DepthRange.near + gl_DepthRange.far);\n"
+    "  vec4 result = color;\n"
+    "  if (lighting) {\n"
+    "    vec3 front, highlight;\n"
+    "    light(eye, normal, color.rgb, front, highlight);\n"
+    "    result.rgb = clamp(front, 0.0, 1.0) + highlight;\n"
+    "  }\n"
+    "  if (fog) {\n"
+    "    float f = clamp((gl_Fog.end - abs(eye.z)) * gl_Fog.scale, 0.0, 1.0);\n"
+    "    result.rgb = mix(gl_Fog.color.rgb, result.rgb, f);\n"
+    "  }\n"
+    "  gl_FragColor = result;\n"
+    "}\n";
+
+  // One quad per sphere, facing the eye and just large enough to cover the
+  // outline of the sphere in perspective
+  static const char sphereImpostorVertexSource[] =
+    "attribute vec4 sphere;\n"
+    "attribute vec4 color;\n"
+    "varying vec3 center;\n"
+    "varying float radius;\n"
+    "varying vec3 point;\n"
+    "varying vec4 sphereColor;\n"
+    "void main()\n"
+    "{\n"
+    "  center = (gl_ModelViewMatrix * vec4(sphere.xyz, 1.0)).xyz;\n"
+    "  radius = sphere.w * length(gl_ModelViewMatrix[0].xyz);\n"
+    "  vec3 view = vec3(0.0, 0.0, 1.0);\n"
+    "  float extent = radius;\n"
+    "  if (gl_ProjectionMatrix[3][3] == 0.0) {\n"
+    "    float centerDistance = length(center);\n"
+    "    view = -center / centerDistance;\n"
+    "    float tangent = centerDistance * centerDistance - radius * radius;\n"
+    "    extent *= centerDistance\n"
+    "      / sqrt(max(tangent, 1.0e-4 * radius * radius));\n"
+    "  }\n"
+    "  vec3 up = abs(view.y) < 0.9 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);\n"
+    "  vec3 right = normalize(cross(up, view));\n"
+    "  up = cross(view, right);\n"
+    "  point = center + extent * (gl_Vertex.x * right + gl_Vertex.y * up);\n"
+    "  sphereColor = color;\n"
+    "  gl_Position = gl_ProjectionMatrix * vec4(point, 1.0);\n"
+    "  gl_ClipVertex = vec4(point, 1.0);\n"
+    "}\n";
+
+  static const char sphereImpostorFragmentSource[] =
+    "varying vec3 center;\n"
+    "varying float radius;\n"
+    "varying vec3 point;\n"
+    "varying vec4 sphereColor;\n"
+    "void main()\n"
+    "{\n"
+    "  vec3 origin, direction;\n"
+    "  eyeRay(point, origin, direction);\n"
+    "  vec3 oc = origin - center;\n"
+    "  float b = dot(oc, direction);\n"
+    "  float discriminant = b * b - dot(oc, oc) + radius * radius;\n"
+    "  if (discriminant < 0.0)\n"
+    "    discard;\n"
+    "  vec3 eye = origin + (-b - sqrt(discriminant)) * direction;\n"
+    "  finish(eye, (eye - center) / radius, sphereColor);\n"
+    "}\n";
+
+  // One box per cylinder, with the same basis as the instanced cylinder
+  static const char cylinderImpostorVertexSource[] =
+    "attribute vec4 end1;\n"
+    "attribute vec3 end2;\n"
+    "attribute vec4 color;\n"
+    "varying vec3 base;\n"
+    "varying vec3 axis;\n"
+    "varying float radius;\n"
+    "varying vec3 point;\n"
+    "varying vec4 cylinderColor;\n"
+    "void main()\n"
+    "{\n"
+    "  vec3 a = normalize(end2 - end1.xyz);\n"
+    "  vec3 u;\n"
+    "  if (abs(a.x) > 1.0e-4 * abs(a.z) || abs(a.y) > 1.0e-4 * abs(a.z))\n"
+    "    u = normalize(vec3(-a.y, a.x, 0.0));\n"
+    "  else\n"
+    "    u = normalize(vec3(0.0, -a.z, a.y));\n"
+    "  vec3 v = cross(a, u);\n"
+    "  vec3 position = end1.xyz + end1.w * (gl_Vertex.x * u + gl_Vertex.y * v)\n"
+    "    + gl_Vertex.z * (end2 - end1.xyz);\n"
+    "  vec4 eye = gl_ModelViewMatrix * vec4(position, 1.0);\n"
+    "  base = (gl_ModelViewMatrix * vec4(end1.xyz, 1.0)).xyz;\n"
+    "  axis = (gl_ModelViewMatrix * vec4(end2, 1.0)).xyz - base;\n"
+    "  radius = end1.w * length(gl_ModelViewMatrix[0].xyz);\n"
+    "  point = eye.xyz;\n"
+    "  cylinderColor = color;\n"
+    "  gl_Position = gl_ProjectionMatrix * eye;\n"
+    "  gl_ClipVertex = eye;\n"
+    "}\n";
+
+  // Closed cylinder, the flat caps are usually hidden inside the atoms
+  static const char cylinderImpostorFragmentSource[] =
+    "varying vec3 base;\n"
+    "varying vec3 axis;\n"
+    "varying float radius;\n"
+    "varying vec3 point;\n"
+    "varying vec4 cylinderColor;\n"
+    "void main()\n"
+    "{\n"
+    "  vec3 origin, direction;\n"
+    "  eyeRay(point, origin, direction);\n"
+    "  vec3 oc = origin - base;\n"
+    "  float aa = dot(axis, axis);\n"
+    "  float ad = dot(axis, direction);\n"
+    "  float ao = dot(axis, oc);\n"
+    "  float k2 = aa - ad * ad;\n"
+    "  float k1 = aa * dot(oc, direction) - ao * ad;\n"
+    "  float k0 = aa * dot(oc, oc) - ao * ao - radius * radius * aa;\n"
+    "  float h = k1 * k1 - k2 * k0;\n"
+    "  if (h < 0.0)\n"
+    "    discard;\n"
+    "  h = sqrt(h);\n"
+    "  float t = (-k1 - h) / k2;\n"
+    "  float y = ao + t * ad;\n"
+    "  vec3 normal;\n"
+    "  if (k2 > 1.0e-6 * aa && y > 0.0 && y < aa) {\n"
+    "    normal = (oc + t * direction - axis * y / aa) / radius;\n"
+    "  }\n"
+    "  else {\n"
+    "    // The cap the ray enters through, 0 at end1 and 1 at end2\n"
+    "    float cap = k2 > 1.0e-6 * aa ? step(0.0, y) : step(ad, 0.0);\n"
+    "    if (ad * ad < 1.0e-12 * aa)\n"
+    "      discard;\n"
+    "    t = (cap * aa - ao) / ad;\n"
+    "    vec3 r = oc + t * direction - cap * axis;\n"
+    "    if (dot(r, r) > radius * radius)\n"
+    "      discard;\n"
+    "    normal = (2.0 * cap - 1.0) * axis / sqrt(aa);\n"
+    "  }\n"
+    "  finish(origin + t * direction, normal, cylinderColor);\n"
+    "}\n";
+
+  // The geometry the impostors are drawn on, a quad for the spheres and a
+  // box around the cylinders with the faces wound counter clockwise
+  static const GLfloat quadVertices[] = {
+    -1.0f, -1.0f, 0.0f,   1.0f, -1.0f, 0.0f,
+     1.0f,  1.0f, 0.0f,  -1.0f,  1.0f, 0.0f
+  };
+  static const GLushort quadIndices[] = { 0, 1, 2, 0, 2, 3 };
+
+  static const GLfloat boxVertices[] = {
+    -1.0f, -1.0f, 0.0f,   1.0f, -1.0f, 0.0f,
+    -1.0f,  1.0f, 0.0f,   1.0f,  1.0f, 0.0f,
+    -1.0f, -1.0f, 1.0f,   1.0f, -1.0f, 1.0f,
+    -1.0f,  1.0f, 1.0f,   1.0f,  1.0f, 1.0f
+  };
+  static const GLushort boxIndices[] = {
+    0, 2, 3, 0, 3, 1,   4, 5, 7, 4, 7, 6,
+    0, 4, 6, 0, 6, 2,   1, 3, 7, 1, 7, 5,
+    0, 1, 5, 0, 5, 4,   2, 6, 7, 2, 7, 3
+  };
+
+  typedef void (QOPENGLF_APIENTRYP VertexAttribDivisorFunction)(GLuint index,
+                                                                GLuint divisor);
+  typedef void (QOPENGLF_APIENTRYP DrawElementsInstancedFunction)(GLenum mode,
+    GLsizei count, GLenum type, const GLvoid *indices, GLsizei primcount);
+
+  class InstancedRendererPrivate
+  {
+    public:
+      InstancedRendererPrivate() : initialized(false), supported(false),
+        impostorsInitialized(false), impostorsSupported(false),
+        vertexAttribDivisor(0), drawElementsInstanced(0),
+        instanceBuffer(QOpenGLBuffer::VertexBuffer),
+        quadVertexBuffer(QOpenGLBuffer::VertexBuffer),
+        quadIndexBuffer(QOpenGLBuffer::IndexBuffer),
+        boxVertexBuffer(QOpenGLBuffer::VertexBuffer),
+        boxIndexBuffer(QOpenGLBuffer::IndexBuffer) {}
+
+      bool initialize();
+      bool initializeImpostors();
+      bool buildProgram(QOpenGLShaderProgram &program,
+                        const QByteArray &vertexCode,
+                        const QByteArray &fragmentCode,
+                        const char *attribute0, const char *attribute1,
+                        const char *attribute2);
+      bool uploadGeometry(QOpenGLBuffer &vertexBuffer,
+                          QOpenGLBuffer &indexBuffer,
+                          const GLfloat *vertices, int vertexCount,
+                          const GLushort *indices, int indexCount);
+      void draw(QOpenGLShaderProgram &program, int indexCount, bool normals,
+                const std::vector<float> &instances, int stride,
+                const int *offsets, const int *sizes, int attributes);
+
+      bool initialized;
+      bool supported;
+      bool impostorsInitialized;
+      bool impostorsSupported;
+      VertexAttribDivisorFunction vertexAttribDivisor;
+      DrawElementsInstancedFunction drawElementsInstanced;
+      QOpenGLShaderProgram sphereProgram;
+      QOpenGLShaderProgram cylinderProgram;
+      QOpenGLShaderProgram sphereImpostorProgram;
+      QOpenGLShaderProgram cylinderImpostorProgram;
+      QOpenGLBuffer instanceBuffer;
+      QOpenGLBuffer quadVertexBuffer;
+      QOpenGLBuffer quadIndexBuffer;
+      QOpenGLBuffer boxVertexBuffer;
+      QOpenGLBuffer boxIndexBuffer;
+  };
+
+  bool InstancedRendererPrivate::initialize()
+  {
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (!context || !QOpenGLShaderProgram::hasOpenGLShaderPrograms(context))
+      return false;
+
+    // Core in OpenGL 3.3, otherwise from GL_ARB_instanced_arrays. Check the
+    // version and extensions first, getProcAddress() may return entry points
+    // the context does not support, e.g. with GLX.
+    vertexAttribDivisor = 0;
+    drawElementsInstanced = 0;
+    if (!context->isOpenGLES()
+        && context->format().version() >= qMakePair(3, 3)) {
+      vertexAttribDivisor = reinterpret_cast<VertexAttribDivisorFunction>(
+        context->getProcAddress("glVertexAttribDivisor"));
+      drawElementsInstanced = reinterpret_cast<DrawElementsInstancedFunction>(
+        context->getProcAddress("glDrawElementsInstanced"));
+    }
+    else if (context->hasExtension("GL_ARB_instanced_arrays")) {
+      vertexAttribDivisor = reinterpret_cast<VertexAttribDivisorFunction>(
+        context->getProcAddress("glVertexAttribDivisorARB"));
+      if (context->hasExtension("GL_ARB_draw_instanced"))
+        drawElementsInstanced = reinterpret_cast<DrawElementsInstancedFunction>(
+          context->getProcAddress("glDrawElementsInstancedARB"));
+      else if (context->hasExtension("GL_EXT_draw_instanced"))
+        drawElementsInstanced = reinterpret_cast<DrawElementsInstancedFunction>(
+          context->getProcAddress("glDrawElementsInstancedEXT"));
+    }
+    if (!vertexAttribDivisor || !drawElementsInstanced) {
+      qDebug() << "Instanced arrays not supported, drawing atoms one by one.";
+      return false;
+    }
+
+    QByteArray vertexCode("#version 120\n");
+    vertexCode += lightSource;
+    vertexCode += shadeSource;
+    if (!buildProgram(sphereProgram, vertexCode + sphereSource, QByteArray(),
+                      "sphere", "color", 0)
+        || !buildProgram(cylinderProgram, vertexCode + cylinderSource,
+                         QByteArray(), "end1", "color", "end2"))
+      return false;
+
+    if (!instanceBuffer.create())
+      return false;
+    instanceBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    return true;
+  }
+
+  bool InstancedRendererPrivate::initializeImpostors()
+  {
+    QByteArray fragmentCode("#version 120\n");
+    fragmentCode += lightSource;
+    fragmentCode += finishSource;
+    QByteArray vertexCode("#version 120\n");
+    if (!buildProgram(sphereImpostorProgram,
+                      vertexCode + sphereImpostorVertexSource,
+                      fragmentCode + sphereImpostorFragmentSource,
+                      "sphere", "color", 0)
+        || !buildProgram(cylinderImpostorProgram,
+                         vertexCode + cylinderImpostorVertexSource,
+                         fragmentCode + cylinderImpostorFragmentSource,
+                         "end1", "color", "end2"))
+      return false;
+
+    return uploadGeometry(quadVertexBuffer, quadIndexBuffer, quadVertices, 4,
+                          quadIndices, 6)
+      && uploadGeometry(boxVertexBuffer, boxIndexBuffer, boxVertices, 8,
+                        boxIndices, 36);
+  }
+
+  bool InstancedRendererPrivate::buildProgram(QOpenGLShaderProgram &program,
+                                              const QByteArray &vertexCode,
+                                              const QByteArray &fragmentCode,
+                                              const char *attribute0,
+                                              const char *attribute1,
+                                              const char *attribute2)
+  {
+    if (!program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexCode)
+        || (!fragmentCode.isEmpty()
+            && !program.addShaderFromSourceCode(QOpenGLShader::Fragment,
+                                                fragmentCode))) {
+      qDebug() << "Instanced rendering shader failed to compile:"
+               << program.log();
+      return false;
+    }
+    program.bindAttributeLocation(attribute0, InstanceAttribute0);
+    program.bindAttributeLocation(attribute1, InstanceAttribute1);
+    if (attribute2)
+      program.bindAttributeLocation(attribute2, InstanceAttribute2);
+    if (!program.link()) {
+      qDebug() << "Instanced rendering shader failed to link:" << program.log();
+      return false;
+    }
+    return true;
+  }
+
+  bool InstancedRendererPrivate::uploadGeometry(QOpenGLBuffer &vertexBuffer,
+                                                QOpenGLBuffer &indexBuffer,
+                                                const GLfloat *vertices,
+                                                int vertexCount,
+                                                const GLushort *indices,
+                                                int indexCount)
+  {
+    if (!vertexBuffer.create() || !indexBuffer.create())
+      return false;
+    vertexBuffer.bind();
+    vertexBuffer.allocate(vertices, 3 * vertexCount * sizeof(GLfloat));
+    vertexBuffer.release();
+    indexBuffer.bind();
+    indexBuffer.allocate(indices, indexCount * sizeof(GLushort));
+    indexBuffer.release();
+    return true;
+  }
+
+  void InstancedRendererPrivate::draw(QOpenGLShaderProgram &program,
+                                      int indexCount, bool normals,
+                                      const std::vector<float> &instances,
+                                      int stride, const int *offsets,
+                                      const int *sizes, int attributes)
+  {
+    // The geometry has been bound as the vertex (and normal) arrays
+    glEnableClientState(GL_VERTEX_ARRAY);
+    if (normals)
+      glEnableClientState(GL_NORMAL_ARRAY);
+
+    program.bind();
+    program.setUniformValue("lighting",
+                            static_cast<GLint>(glIsEnabled(GL_LIGHTING)));
+    program.setUniformValue("light1",
+                            static_cast<GLint>(glIsEnabled(GL_LIGHT1)));
+    program.setUniformValue("fog", static_cast<GLint>(glIsEnabled(GL_FOG)));
+
+    instanceBuffer.bind();
+    instanceBuffer.allocate(&instances[0], instances.size() * sizeof(float));
+    for (int i = 0; i < attributes; ++i) {
+      program.enableAttributeArray(InstanceAttribute0 + i);
+      program.setAttributeBuffer(InstanceAttribute0 + i, GL_FLOAT,
+                                 offsets[i] * sizeof(float), sizes[i],
+                                 stride * sizeof(float));
+      vertexAttribDivisor(InstanceAttribute0 + i, 1);
+    }
+    instanceBuffer.release();
+
+    drawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, 0,
+                          instances.size() / stride);
+
+    for (int i = 0; i < attributes; ++i) {
+      vertexAttribDivisor(InstanceAttribute0 + i, 0);
+      program.disableAttributeArray(InstanceAttribute0 + i);
+    }
+    program.release();
+    QOpenGLBuffer::release(QOpenGLBuffer::IndexBuffer);
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    if (normals)
+      glDisableClientState(GL_NORMAL_ARRAY);
+  }
+
+  InstancedRenderer::InstancedRenderer() : d(new InstancedRendererPrivate)
+  {
+  }
+
+  InstancedRenderer::~InstancedRenderer()
+  {
+    delete d;
+  }
+
+  bool InstancedRenderer::isUsable()
+  {
+    if (!d->initialized) {
+      d->supported = d->initialize();
+      d->initialized = true;
+    }
+    if (!d->supported)
+      return false;
+
+    GLint value = 0;
+    glGetIntegerv(GL_RENDER_MODE, &value);
+    if (value != GL_RENDER)
+      return false;
+    glGetIntegerv(GL_LIST_INDEX, &value);
+    if (value != 0)
+      return false;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &value);
+    if (value != 0)
+      return false;
+    return true;
+  }
+
+  bool InstancedRenderer::impostorsSupported()
+  {
+    if (!d->impostorsInitialized) {
+      d->impostorsSupported = d->initializeImpostors();
+      d->impostorsInitialized = true;
+      if (!d->impostorsSupported)
+        qDebug() << "Impostors not supported, drawing tessellated atoms.";
+    }
+    return d->impostorsSupported;
+  }
+
+  bool InstancedRenderer::drawSpheres(const Sphere &sphere,
+                                      const std::vector<float> &instances)
+  {
+    if (instances.empty())
+      return true;
+    int indexCount = sphere.bindTriangles();
+    if (!indexCount)
+      return false;
+
+    // sphere = center and radius, color = RGBA
+    const int offsets[2] = { 0, 4 };
+    const int sizes[2] = { 4, 4 };
+    d->draw(d->sphereProgram, indexCount, true, instances, 8, offsets, sizes,
+            2);
+    return true;
+  }
+
+  bool InstancedRenderer::drawCylinders(const Cylinder &cylinder,
+                                        const std::vector<float> &instances)
+  {
+    if (instances.empty())
+      return true;
+    int indexCount = cylinder.bindTriangles();
+    if (!indexCount)
+      return false;
+
+    // end1 = first end and radius, color = RGBA, end2 = second end
+    const int offsets[3] = { 0, 8, 4 };
+    const int sizes[3] = { 4, 4, 3 };
+    d->draw(d->cylinderProgram, indexCount, true, instances, 12, offsets,
+            sizes, 3);
+    return true;
+  }
+
+  bool InstancedRenderer::drawSphereImpostors(const std::vector<float> &instances)
+  {
+    if (!impostorsSupported())
+      return false;
+    if (instances.empty())
+      return true;
+
+    d->quadVertexBuffer.bind();
+    glVertexPointer(3, GL_FLOAT, 0, 0);
+    d->quadVertexBuffer.release();
+    d->quadIndexBuffer.bind();
+
+    const int offsets[2] = { 0, 4 };
+    const int sizes[2] = { 4, 4 };
+    d->draw(d->sphereImpostorProgram, 6, false, instances, 8, offsets, sizes,
+            2);
+    return true;
+  }
+
+  bool InstancedRenderer::drawCylinderImpostors(const std::vector<float> &instances)
+  {
+    if (!impostorsSupported())
+      return false;
+    if (instances.empty())
+      return true;
+
+    d->boxVertexBuffer.bind();
+    glVertexPointer(3, GL_FLOAT, 0, 0);
+    d->boxVertexBuffer.release();
+    d->boxIndexBuffer.bind();
+
+    const int offsets[3] = { 0, 8, 4 };
+    const int sizes[3] = { 4, 4, 3 };
+    d->draw(d->cylinderImpostorProgram, 36, false, instances, 12, offsets,
+            sizes, 3);
+    return true;
+  }
+
+}
@@ -0,0 +1,118 @@
+/**********************************************************************
+  InstancedRenderer - Draws many spheres or cylinders in one call
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef INSTANCEDRENDERER_H
+#define INSTANCEDRENDERER_H
+
+#include "config.h"
+
+#include <avogadro/global.h>
+
+#include <vector>
+
+namespace Avogadro {
+
+  class Sphere;
+  class Cylinder;
+
+  /**
+   * @class InstancedRenderer
+   * @internal
+   * @brief Draws all spheres or cylinders of one detail level in one call.
+   *
+   * The per instance data (position, radius and color) is uploaded to a
+   * vertex buffer object and the geometry of the Sphere or Cylinder is drawn
+   * once for every instance with glDrawElementsInstanced. A small vertex
+   * shader places each instance and reproduces the fixed function lighting
+   * and materials used by GLPainter, so the result looks the same as
+   * drawing the primitives one by one.
+   *
+   * This needs GLSL and instanced arrays (OpenGL 3.3 or
+   * GL_ARB_instanced_arrays). When they are not available isUsable()
+   * returns false and the caller should draw the primitives one by one.
+   *
+   * The spheres and cylinders can also be drawn as impostors: a quad per
+   * sphere and a box per cylinder on which a fragment shader ray casts the
+   * exact surface, writing its lighting and depth per pixel. The cost per
+   * primitive is then constant whatever the quality setting.
+   */
+  class InstancedRendererPrivate;
+  class InstancedRenderer
+  {
+    public:
+      InstancedRenderer();
+      ~InstancedRenderer();
+
+      /**
+       * @return true if instanced drawing can be used with the current
+       * OpenGL context and state. Instanced draw calls cannot be compiled
+       * into display lists, do not report hits in selection mode and would
+       * replace a shader program set by an engine, so they are not used in
+       * those cases either.
+       */
+      bool isUsable();
+
+      /**
+       * Draws one copy of @p sphere for every 8 floats in @p instances:
+       * the center, the radius and the RGBA color.
+       * @return false if nothing could be drawn.
+       */
+      bool drawSpheres(const Sphere &sphere, const std::vector<float> &instances);
+
+      /**
+       * Draws one copy of @p cylinder for every 12 floats in @p instances:
+       * the first end, the radius, the second end, one unused float and the
+       * RGBA color.
+       * @return false if nothing could be drawn.
+       */
+      bool drawCylinders(const Cylinder &cylinder,
+                         const std::vector<float> &instances);
+
+      /**
+       * @return true if the impostor shaders could be built. Must only be
+       * called once isUsable() returned true.
+       */
+      bool impostorsSupported();
+
+      /**
+       * Draws the spheres in @p instances, laid out as for drawSpheres(), as
+       * ray cast impostors.
+       * @return false if impostors are not supported.
+       */
+      bool drawSphereImpostors(const std::vector<float> &instances);
+
+      /**
+       * Draws the cylinders in @p instances, laid out as for drawCylinders(),
+       * as ray cast impostors with flat caps.
+       * @return false if impostors are not supported.
+       */
+      bool drawCylinderImpostors(const std::vector<float> &instances);
+
+    private:
+      InstancedRendererPrivate * const d;
+  };
+
+}
+
+#endif
@@ -26,6 +26,7 @@
 #include "color3f.h"
 
 #include <QReadWriteLock>
+#include <QAtomicInt>
 #include <QDebug>
 
 using Eigen::Vector3f;
@@ -33,9 +34,18 @@ using std::vector;
 
 namespace Avogadro {
 
+  // Revisions are unique across all meshes so that a new Mesh allocated at
+  // the address of a deleted one is never mistaken for it
+  static QAtomicInt meshRevision(0);
+
+  static unsigned int nextRevision()
+  {
+    return static_cast<unsigned int>(meshRevision.fetchAndAddRelaxed(1) + 1);
+  }
+
   Mesh::Mesh(QObject *parent) : Primitive(MeshType, parent), m_vertices(0),
     m_normals(0), m_colors(0), m_stable(true), m_other(FALSE_ID), m_cube(0),
-    m_lock(new QReadWriteLock)
+    m_revision(nextRevision()), m_lock(new QReadWriteLock)
   {
     m_vertices.reserve(100);
     m_normals.reserve(100);
@@ -86,6 +96,7 @@ namespace Avogadro {
     QWriteLocker lock(m_lock);
     m_vertices.clear();
     m_vertices = values;
+    m_revision = nextRevision();
     return true;
   }
 
@@ -99,6 +110,7 @@ namespace Avogadro {
       for (unsigned int i = 0; i < values.size(); ++i) {
         m_vertices.push_back(values.at(i));
       }
+      m_revision = nextRevision();
       return true;
     }
     else {
@@ -124,6 +136,7 @@ namespace Avogadro {
     QWriteLocker lock(m_lock);
     m_normals.clear();
     m_normals = values;
+    m_revision = nextRevision();
     return true;
   }
 
@@ -137,6 +150,7 @@ namespace Avogadro {
       for (unsigned int i = 0; i < values.size(); ++i) {
         m_normals.push_back(values.at(i));
       }
+      m_revision = nextRevision();
       return true;
     }
     else {
@@ -168,6 +182,7 @@ namespace Avogadro {
     QWriteLocker lock(m_lock);
     m_colors.clear();
     m_colors = values;
+    m_revision = nextRevision();
     return true;
   }
 
@@ -181,6 +196,7 @@ namespace Avogadro {
       for (unsigned int i = 0; i < values.size(); ++i) {
         m_colors.push_back(values.at(i));
       }
+      m_revision = nextRevision();
       return true;
     }
     else {
@@ -189,11 +205,51 @@ namespace Avogadro {
     }
   }
 
+  const vector<unsigned int> & Mesh::indices() const
+  {
+    QReadLocker lock(m_lock);
+    return m_indices;
+  }
+
+  unsigned int Mesh::numTriangles() const
+  {
+    QReadLocker lock(m_lock);
+    if (m_indices.empty())
+      return m_vertices.size() / 3;
+    else
+      return m_indices.size() / 3;
+  }
+
+  bool Mesh::setIndices(const vector<unsigned int> &values)
+  {
+    QWriteLocker lock(m_lock);
+    if (values.size() % 3 == 0) {
+      m_indices.clear();
+      m_indices = values;
+      m_revision = nextRevision();
+      return true;
+    }
+    else {
+      qDebug() << "Error setting indices." << values.size();
+      return false;
+    }
+  }
+
+  unsigned int Mesh::revision() const
+  {
+    QReadLocker lock(m_lock);
+    return m_revision;
+  }
+
   bool Mesh::valid() const
   {
     QWriteLocker lock(m_lock);
     if (m_vertices.size() == m_normals.size()) {
       if (m_colors.size() == 1 || m_colors.size() == m_vertices.size()) {
+        // All indices must refer to an existing vertex
+        for (unsigned int i = 0; i < m_indices.size(); ++i)
+          if (m_indices[i] >= m_vertices.size())
+            return false;
         return true;
       }
       else {
@@ -211,6 +267,8 @@ namespace Avogadro {
     m_vertices.clear();
     m_normals.clear();
     m_colors.clear();
+    m_indices.clear();
+    m_revision = nextRevision();
     return true;
   }
 
@@ -219,9 +277,11 @@ namespace Avogadro {
     QWriteLocker lock(m_lock);
     QReadLocker oLock(other.m_lock);
     m_vertices = other.m_vertices;
-    m_normals = other.m_vertices;
+    m_normals = other.m_normals;
     m_colors = other.m_colors;
+    m_indices = other.m_indices;
     m_name = other.m_name;
+    m_revision = nextRevision();
     return *this;
   }
 
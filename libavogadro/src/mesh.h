@@ -48,6 +48,10 @@ namespace Avogadro {
    * meshes must be owned by a Molecule. It should also be removed by the
    * Molecule that owns it. Meshes encapsulate triangular meshes that can also
    * have colors associated with each vertex.
+   *
+   * A Mesh may optionally be indexed, in which case each triangle is made up
+   * of three entries in indices() that refer to shared vertices. When no
+   * indices are set every three consecutive vertices make up a triangle.
    */
   class MeshPrivate;
   class A_EXPORT Mesh : public Primitive
@@ -193,6 +197,41 @@ namespace Avogadro {
      */
     bool addColors(const std::vector<Color3f> &values);
 
+    /**
+     * @return Vector containing the vertex indices of the triangles, three
+     * for each triangle. Empty if the Mesh is not indexed.
+     */
+    const std::vector<unsigned int> & indices() const;
+
+    /**
+     * @return The number of indices.
+     */
+    unsigned int numIndices() const { return m_indices.size(); }
+
+    /**
+     * @return True if the triangles of the Mesh are described by indices().
+     */
+    bool isIndexed() const { return !m_indices.empty(); }
+
+    /**
+     * @return The number of triangles in the Mesh.
+     */
+    unsigned int numTriangles() const;
+
+    /**
+     * Clear the indices vector and assign new values. The vector is expected
+     * to be of length 3 x n where n is the number of triangles. An empty
+     * vector makes the Mesh non-indexed again.
+     */
+    bool setIndices(const std::vector<unsigned int> &values);
+
+    /**
+     * @return A number that changes whenever the vertices, normals, colors or
+     * indices of the Mesh change. Renderers can use this to decide when cached
+     * copies of the Mesh must be updated.
+     */
+    unsigned int revision() const;
+
     /**
      * Sanity checking function - is the mesh sane?
      * @return True if the Mesh object is sane and composed of the right number
@@ -232,11 +271,13 @@ namespace Avogadro {
     std::vector<Eigen::Vector3f> m_vertices;
     std::vector<Eigen::Vector3f> m_normals;
     std::vector<Color3f> m_colors;
+    std::vector<unsigned int> m_indices;
     QString m_name;
     bool m_stable;
     float m_isoValue;
     unsigned int m_other; // Unique id of the other mesh if this is part of a pair
     unsigned int m_cube; // Unique id of the cube this mesh was generated from
+    unsigned int m_revision; // Changed whenever the mesh data changes
     QReadWriteLock *m_lock;
     Q_DECLARE_PRIVATE(Mesh)
   };
@@ -31,13 +31,30 @@
 #include <avogadro/mesh.h>
 
 #include <QReadWriteLock>
+#include <QtConcurrent/QtConcurrentMap>
 #include <QDebug>
 
+#include <algorithm>
+
 using Eigen::Vector3f;
 using Eigen::Vector3i;
+using std::vector;
 
 namespace Avogadro {
 
+  struct MeshSlab
+  {
+    MeshGenerator *generator;
+    int begin, end;            // The range of cubes along x in this slab
+    vector<Vector3f> vertices, normals;
+    vector<unsigned int> indices;
+    // The vertices on the y and z edges of the first and last planes of grid
+    // points, shared with the slabs either side
+    vector<int> firstPlane, lastPlane;
+    // The vertices on the edges of the current layer of cubes, -1 if none
+    vector<int> plane0, plane1, xEdges;
+  };
+
   MeshGenerator::MeshGenerator(QObject *parent) :
     QThread(parent),
     m_iso(0.0),
@@ -95,37 +112,96 @@ namespace Avogadro {
     m_mesh->setStable(false);
     m_mesh->clear();
 
-    m_vertices.reserve(m_dim.x()*m_dim.y()*m_dim.z()*3);
-    m_normals.reserve(m_dim.x()*m_dim.y()*m_dim.z()*3);
-
     if (!m_cube->lock()->tryLockForRead()) {
       qDebug() << "Cannot get a read lock...";
     }
 
+    // Split the cube into slabs along x, a few per core to balance the load
+    int layers = m_dim.x() - 1;
+    int numSlabs = std::max(1, std::min(QThread::idealThreadCount() * 4,
+                                        layers / 2));
+    QVector<MeshSlab> slabs(layers > 0 ? numSlabs : 0);
+    for (int i = 0; i < slabs.size(); ++i) {
+      slabs[i].generator = this;
+      slabs[i].begin = layers * i / numSlabs;
+      slabs[i].end = layers * (i + 1) / numSlabs;
+    }
+
     // Now to march the cube
-    for(int i = 0; i < m_dim.x()-1; ++i) {
-      for(int j = 0; j < m_dim.y()-1; ++j) {
-        for(int k = 0; k < m_dim.z()-1; ++k) {
-          marchingCube(Vector3i(i, j, k));
-        }
+    m_progress.fetchAndStoreRelaxed(0);
+    QtConcurrent::blockingMap(slabs, MeshGenerator::processSlab);
+
+    m_cube->lock()->unlock();
+
+    // Stitch the slabs together, the vertices on the first plane of each slab
+    // were also found by the slab before it
+    m_vertices.clear();
+    m_normals.clear();
+    m_indices.clear();
+    vector<int> previousPlane;
+    for (int i = 0; i < slabs.size(); ++i) {
+      MeshSlab &slab = slabs[i];
+      vector<int> remap(slab.vertices.size(), -1);
+      if (i > 0) {
+        for (unsigned int j = 0; j < slab.firstPlane.size(); ++j)
+          if (slab.firstPlane[j] >= 0 && previousPlane[j] >= 0)
+            remap[slab.firstPlane[j]] = previousPlane[j];
       }
-      if (m_vertices.capacity() < m_vertices.size() + m_dim.y()*m_dim.x()*3) {
-        m_vertices.reserve(m_vertices.capacity()*2);
-        m_normals.reserve(m_normals.capacity()*2);
+      for (unsigned int j = 0; j < slab.vertices.size(); ++j) {
+        if (remap[j] < 0) {
+          remap[j] = m_vertices.size();
+          m_vertices.push_back(slab.vertices[j]);
+          m_normals.push_back(slab.normals[j]);
+        }
       }
-      emit progressValueChanged(i);
+      for (unsigned int j = 0; j < slab.indices.size(); ++j)
+        m_indices.push_back(remap[slab.indices[j]]);
+      previousPlane.resize(slab.lastPlane.size());
+      for (unsigned int j = 0; j < slab.lastPlane.size(); ++j)
+        previousPlane[j] = slab.lastPlane[j] >= 0 ? remap[slab.lastPlane[j]]
+                                                  : -1;
+      // Give the memory of the slab back as we go
+      slab = MeshSlab();
     }
 
-    m_cube->lock()->unlock();
-
-    // Copy the data across
+    // Copy the data across, the triangles share their vertices
     m_mesh->setVertices(m_vertices);
     m_mesh->setNormals(m_normals);
+    m_mesh->setIndices(m_indices);
     m_mesh->setStable(true);
 
     // Now we are done give all that memory back
-    m_vertices.resize(0);
-    m_normals.resize(0);
+    vector<Vector3f>().swap(m_vertices);
+    vector<Vector3f>().swap(m_normals);
+    vector<unsigned int>().swap(m_indices);
+  }
+
+  void MeshGenerator::processSlab(MeshSlab &slab)
+  {
+    MeshGenerator *gen = slab.generator;
+    const int ny = gen->m_dim.y();
+    const int nz = gen->m_dim.z();
+
+    slab.plane0.assign(2 * ny * nz, -1);
+    slab.plane1.assign(2 * ny * nz, -1);
+    for (int i = slab.begin; i < slab.end; ++i) {
+      slab.xEdges.assign(ny * nz, -1);
+      for (int j = 0; j < ny - 1; ++j) {
+        for (int k = 0; k < nz - 1; ++k) {
+          gen->marchingCube(Vector3i(i, j, k), slab);
+        }
+      }
+      // All of the cubes touching the first plane are in this layer
+      if (i == slab.begin)
+        slab.firstPlane = slab.plane0;
+      slab.plane0.swap(slab.plane1);
+      slab.plane1.assign(2 * ny * nz, -1);
+      emit gen->progressValueChanged(gen->m_progress.fetchAndAddRelaxed(1));
+    }
+    slab.lastPlane.swap(slab.plane0);
+    vector<int>().swap(slab.plane0);
+    vector<int>().swap(slab.plane1);
+    vector<int>().swap(slab.xEdges);
   }
 
   void MeshGenerator::clear()
@@ -159,17 +235,10 @@ namespace Avogadro {
     return (m_iso - val1) / (val2 - val1);
   }
 
-  unsigned long MeshGenerator::duplicate(const Vector3i &, const Vector3f &)
-  {
-    // FIXME Not implemented yet.
-    return 0;
-  }
-
-  bool MeshGenerator::marchingCube(const Vector3i &pos)
+  bool MeshGenerator::marchingCube(const Vector3i &pos, MeshSlab &slab)
   {
     float afCubeValue[8];
-    Vector3f asEdgeVertex[12];
-    Vector3f asEdgeNorm[12];
+    int aiEdgeVertex[12];
 
     // Calculate the position in the Cube
     Vector3f fPos(pos.x() * m_spacing.x() + m_min.x(),
@@ -199,22 +268,44 @@ namespace Avogadro {
 
     //Find the point of intersection of the surface with each edge
     //Then find the normal to the surface at those points
+    const int nz = m_dim.z();
     for(int i = 0; i < 12; ++i) {
       //if there is an intersection on this edge
       if(iEdgeFlags & (1<<i)) {
-        float fOffset = offset(afCubeValue[a2iEdgeConnection[i][0]],
-                               afCubeValue[a2iEdgeConnection[i][1]]);
-
-        asEdgeVertex[i] = Vector3f(
-          fPos.x() + (a2fVertexOffset[a2iEdgeConnection[i][0]][0]
-                      + fOffset * a2fEdgeDirection[i][0]) * m_spacing.x(),
-          fPos.y() + (a2fVertexOffset[a2iEdgeConnection[i][0]][1]
-                      + fOffset * a2fEdgeDirection[i][1]) * m_spacing.y(),
-          fPos.z() + (a2fVertexOffset[a2iEdgeConnection[i][0]][2]
-                      + fOffset * a2fEdgeDirection[i][2]) * m_spacing.z());
-
-        /// FIXME Optimize this to only calculate normals when required
-        asEdgeNorm[i] = normal(asEdgeVertex[i]);
+        // Look the edge up by its lowest grid point and direction, the vertex
+        // may already have been found by a neighboring cube
+        const int *c0 = a2iVertexOffset[a2iEdgeConnection[i][0]];
+        const int *c1 = a2iVertexOffset[a2iEdgeConnection[i][1]];
+        int point = (pos.y() + std::min(c0[1], c1[1])) * nz
+            + pos.z() + std::min(c0[2], c1[2]);
+        int *vertex;
+        if (c0[0] != c1[0])
+          vertex = &slab.xEdges[point];
+        else if (c0[0] == 0)
+          vertex = &slab.plane0[2 * point + (c0[1] != c1[1] ? 0 : 1)];
+        else
+          vertex = &slab.plane1[2 * point + (c0[1] != c1[1] ? 0 : 1)];
+
+        if (*vertex < 0) {
+          float fOffset = offset(afCubeValue[a2iEdgeConnection[i][0]],
+                                 afCubeValue[a2iEdgeConnection[i][1]]);
+
+          Vector3f edgeVertex(
+            fPos.x() + (a2fVertexOffset[a2iEdgeConnection[i][0]][0]
+                        + fOffset * a2fEdgeDirection[i][0]) * m_spacing.x(),
+            fPos.y() + (a2fVertexOffset[a2iEdgeConnection[i][0]][1]
+                        + fOffset * a2fEdgeDirection[i][1]) * m_spacing.y(),
+            fPos.z() + (a2fVertexOffset[a2iEdgeConnection[i][0]][2]
+                        + fOffset * a2fEdgeDirection[i][2]) * m_spacing.z());
+
+          *vertex = slab.vertices.size();
+          slab.vertices.push_back(edgeVertex);
+          if (!m_reverseWinding)
+            slab.normals.push_back(normal(edgeVertex));
+          else
+            slab.normals.push_back(-normal(edgeVertex));
+        }
+        aiEdgeVertex[i] = *vertex;
       }
     }
 
@@ -222,26 +313,17 @@ namespace Avogadro {
     for(int i = 0; i < 5; ++i) {
       if(a2iTriangleConnectionTable[iFlagIndex][3*i] < 0)
         break;
-      int iVertex = 0;
-      iEdgeFlags = a2iTriangleConnectionTable[iFlagIndex][3*i];
       // Make sure we get the triangle winding the right way around!
       if (!m_reverseWinding) {
-        for(int j = 0; j < 3; ++j) {
-          iVertex = a2iTriangleConnectionTable[iFlagIndex][3*i+j];
-          m_indices.push_back(m_vertices.size());
-          m_normals.push_back(asEdgeNorm[iVertex]);
-          m_vertices.push_back(asEdgeVertex[iVertex]);
-        }
+        for(int j = 0; j < 3; ++j)
+          slab.indices.push_back(
+                aiEdgeVertex[a2iTriangleConnectionTable[iFlagIndex][3*i+j]]);
       }
       else {
-        for(int j = 2; j >= 0; --j) {
-          iVertex = a2iTriangleConnectionTable[iFlagIndex][3*i+j];
-          m_indices.push_back(m_vertices.size());
-          m_normals.push_back(-asEdgeNorm[iVertex]);
-          m_vertices.push_back(asEdgeVertex[iVertex]);
-        }
+        for(int j = 2; j >= 0; --j)
+          slab.indices.push_back(
+                aiEdgeVertex[a2iTriangleConnectionTable[iFlagIndex][3*i+j]]);
       }
-
     }
     return true;
   }
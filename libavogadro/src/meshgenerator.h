@@ -32,6 +32,7 @@
 #include <Eigen/Core>
 
 #include <QThread>
+#include <QAtomicInt>
 
 #include <vector>
 
@@ -39,6 +40,7 @@
 
   class Cube;
   class Mesh;
+  struct MeshSlab;
 
   /**
    * @class MeshGenerator meshgenerator.h <avogadro/meshgenerator.h>
@@ -55,6 +57,10 @@
    * You must first initialize the class and then call run() to actually
    * polygonize the isosurface. Connect to the classes finished() signal to
    * do something once the polygonization is complete.
+   *
+   * The cube is split into slabs along x that are polygonized in parallel.
+   * Vertices are shared between the triangles that meet at them, including
+   * across the boundaries between slabs.
    */
 
   class A_EXPORT MeshGenerator : public QThread
@@ -145,13 +151,17 @@
      */
     float offset(float val1, float val2);
 
-    unsigned long duplicate(const Eigen::Vector3i &c,
-                            const Eigen::Vector3f &pos);
+    /**
+     * Find the part of the isosurface in one slab of the cube. Re-entrant,
+     * the slabs are processed in parallel.
+     */
+    static void processSlab(MeshSlab &slab);
 
     /**
-     * Perform a marching cubes step on a single cube.
+     * Perform a marching cubes step on a single cube, adding any new vertices
+     * and triangles to the slab.
      */
-    bool marchingCube(const Eigen::Vector3i &pos);
+    bool marchingCube(const Eigen::Vector3i &pos, MeshSlab &slab);
 
     float m_iso;               /** The value of the isosurface.                 */
     bool m_reverseWinding;     /** Whether the winding and normals are reversed */
@@ -161,9 +171,10 @@
     Eigen::Vector3f m_min;     /** The minimum point in the cube.               */
     Eigen::Vector3i m_dim;     /** The dimensions of the cube.                  */
     std::vector<Eigen::Vector3f> m_vertices, m_normals;
-    std::vector<unsigned int> m_indices;
+    std::vector<unsigned int> m_indices; /** Three vertices per triangle.     */
     int m_progmin;
     int m_progmax;
+    QAtomicInt m_progress;     /** The number of layers of cubes completed.   */
 
     /**
      * These are the tables of constants for the marching cubes and tetrahedra
@@ -40,6 +40,7 @@
 
 #include <Eigen/Geometry>
 
+#include <algorithm>
 #include <vector>
 
 #include <openbabel/mol.h>
@@ -59,6 +60,7 @@
 #include <QtCore/QDebug>
 #include <QtCore/QVariant>
 #include <QtCore/QVector>
+#include <QtCore/QSet>
 
 namespace Avogadro{
 
@@ -69,11 +71,15 @@ namespace Avogadro{
     public:
       MoleculePrivate() : farthestAtom(0), invalidGeomInfo(true),
                           invalidRings(true), invalidGroupIndices(true),
-                         obmol(0), obunitcell(0),
+                         topologyVersion(0), geometryVersion(0),
+                         chargeVersion(0), obmolTopologyVersion(0),
+                         obmolGeometryVersion(0), obmolChargeVersion(0),
+                         obunitcell(0),
                          obvibdata(0), obdosdata(0),
                          obelectronictransitiondata(0),
                          obconformerdata(0),
-                         oborcaspecdata(0), oborcanearirdata(0)
+                         oborcaspecdata(0), oborcanearirdata(0),
+                         editDepth(0)
     {}
     // These are logically cached variables and thus are marked as mutable.
     // Const objects should be logically constant (and not mutable)
@@ -101,8 +107,17 @@ namespace Avogadro{
       QList<Fragment *>             ringList;
       QList<ZMatrix *>              zMatrixList;
 
-      // Our OpenBabel OBMol object
-      OpenBabel::OBMol *            obmol;
+      // Bumped on edits, see Molecule::topologyVersion()
+      unsigned int                  topologyVersion;
+      unsigned int                  geometryVersion;
+      // Bumped when a partial charge is set, see Molecule::chargeChanged()
+      unsigned int                  chargeVersion;
+      // Shared OBMol and the versions it was made at, see
+      // Molecule::OBMolSnapshot()
+      mutable QSharedPointer<OpenBabel::OBMol> obmol;
+      mutable unsigned int          obmolTopologyVersion;
+      mutable unsigned int          obmolGeometryVersion;
+      mutable unsigned int          obmolChargeVersion;
       // Our OpenBabel OBUnitCell object (if any)
       OpenBabel::OBUnitCell *       obunitcell;
       // Our OpenBabel OBVibrationData object (if any)
@@ -116,6 +131,14 @@ namespace Avogadro{
       OpenBabel::OBOrcaSpecData *   oborcaspecdata;
       OpenBabel::OBOrcaNearIRData * oborcanearirdata;
 
+      // Batch edits, see Molecule::beginEdit()
+      int                           editDepth;
+      QList<Atom *>                 addedAtoms;
+      QList<Atom *>                 removedAtoms;
+      QList<Bond *>                 addedBonds;
+      QList<Bond *>                 removedBonds;
+      // Primitives added in the batch and not removed since
+      QSet<Primitive *>             pendingAdditions;
   };
 
   Molecule::Molecule(QObject *parent) : Primitive(MoleculeType, parent),
@@ -126,6 +149,7 @@ namespace Avogadro{
                                         m_dipoleMoment(0),
                                         m_invalidPartialCharges(true),
                                         m_invalidAromaticity(true),
+                                        m_invalidLists(false),
                                         m_lock(new QReadWriteLock)
   {
     connect(this, SIGNAL(updated()), this, SLOT(updatePrimitive()));
@@ -138,7 +162,8 @@ namespace Avogadro{
   Molecule::Molecule(const Molecule &other) :
     Primitive(MoleculeType, other.parent()), d_ptr(new MoleculePrivate),
     m_atomPos(0), m_dipoleMoment(0), m_invalidPartialCharges(true),
-    m_invalidAromaticity(true), m_lock(new QReadWriteLock)
+    m_invalidAromaticity(true), m_invalidLists(false),
+    m_lock(new QReadWriteLock)
   {
     *this = other;
     connect(this, SIGNAL(updated()), this, SLOT(updatePrimitive()));
@@ -173,8 +198,9 @@ namespace Avogadro{
     // do some fancy footwork when we add an atom previously created
   Atom *Molecule::addAtom(unsigned long id)
   {
-    Q_D(const Molecule);
+    Q_D(Molecule);
     d->invalidGeomInfo = true;
+    ++d->topologyVersion;
     Atom *atom = new Atom(this);
 
     if (!m_atomPos) {
@@ -197,7 +223,12 @@ namespace Avogadro{
     // now that the id is correct, emit the signal
     connect(atom, SIGNAL(updated()), this, SLOT(updateAtom()));
     d->invalidGroupIndices = true;
-    emit atomAdded(atom);
+    if (d->editDepth) {
+      d->addedAtoms.push_back(atom);
+      d->pendingAdditions.insert(atom);
+    }
+    else
+      emit atomAdded(atom);
     return atom;
   }
 
@@ -224,10 +255,11 @@ namespace Avogadro{
 
   void Molecule::setAtomPos(unsigned long id, const Eigen::Vector3d& vec)
   {
-    Q_D(const Molecule);
+    Q_D(Molecule);
     if (id < m_atomPos->size()) {
       (*m_atomPos)[id] = vec;
       d->invalidGeomInfo = true;
+      ++d->geometryVersion;
     }
   }
 
@@ -239,7 +271,7 @@ namespace Avogadro{
 
   void Molecule::removeAtom(Atom *atom)
   {
-    Q_D(const Molecule);
+    Q_D(Molecule);
     if(atom && atom->parent() == this) {
       // When deleting an atom this also implicitly deletes any bonds to the atom
       foreach (unsigned long bond, atom->bonds()) {
@@ -247,16 +279,29 @@ namespace Avogadro{
       }
 
       m_atoms[atom->id()] = 0;
+      ++d->topologyVersion;
       // 1 based arrays stored/shown to user
       int index = atom->index();
-      m_atomList.removeAt(index);
-      for (int i = index; i < m_atomList.size(); ++i)
-        m_atomList[i]->setIndex(i);
+      if (d->editDepth) {
+        // Renumbered once the batch is finished
+        m_atomList[index] = 0;
+        m_invalidLists = true;
+      }
+      else {
+        m_atomList.removeAt(index);
+        for (int i = index; i < m_atomList.size(); ++i)
+          m_atomList[i]->setIndex(i);
+      }
       atom->deleteLater();
 
       disconnect(atom, SIGNAL(updated()), this, SLOT(updateAtom()));
       d->invalidGroupIndices = true;
-      emit atomRemoved(atom);
+      if (d->editDepth) {
+        if (!d->pendingAdditions.remove(atom))
+          d->removedAtoms.push_back(atom);
+      }
+      else
+        emit atomRemoved(atom);
     }
   }
 
@@ -278,6 +323,7 @@ namespace Avogadro{
     d->invalidRings = true;
     m_invalidPartialCharges = true;
     m_invalidAromaticity = true;
+    ++d->topologyVersion;
     if(id >= m_bonds.size())
       m_bonds.resize(id+1,0);
     m_bonds[id] = bond;
@@ -287,7 +333,12 @@ namespace Avogadro{
     bond->setIndex(m_bondList.size()-1);
     // now that the id is correct, emit the signal
     connect(bond, SIGNAL(updated()), this, SLOT(updateBond()));
-    emit bondAdded(bond);
+    if (d->editDepth) {
+      d->addedBonds.push_back(bond);
+      d->pendingAdditions.insert(bond);
+    }
+    else
+      emit bondAdded(bond);
     return(bond);
   }
 
@@ -325,13 +376,20 @@ namespace Avogadro{
       d->invalidRings = true;
       m_invalidPartialCharges = true;
       m_invalidAromaticity = true;
+      ++d->topologyVersion;
       Bond *bond = m_bonds[id];
       m_bonds[id] = 0;
       // Delete the bond from the list and reorder the remaining bonds
       int index = bond->index();
-      m_bondList.removeAt(index);
-      for (int i = index; i < m_bondList.size(); ++i) {
-        m_bondList[i]->setIndex(i);
+      if (d->editDepth) {
+        m_bondList[index] = 0;
+        m_invalidLists = true;
+      }
+      else {
+        m_bondList.removeAt(index);
+        for (int i = index; i < m_bondList.size(); ++i) {
+          m_bondList[i]->setIndex(i);
+        }
       }
 
       // Also delete the bond from the attached atoms
@@ -345,7 +403,12 @@ namespace Avogadro{
       }
 
       disconnect(bond, SIGNAL(updated()), this, SLOT(updateBond()));
-      emit bondRemoved(bond);
+      if (d->editDepth) {
+        if (!d->pendingAdditions.remove(bond))
+          d->removedBonds.push_back(bond);
+      }
+      else
+        emit bondRemoved(bond);
       bond->deleteLater();
     }
   }
@@ -779,11 +842,13 @@ namespace Avogadro{
     }
     // Delete all of the hydrogens
     else {
-      foreach (Atom *atom, m_atomList) {
+      beginEdit();
+      foreach (Atom *atom, atoms()) {
         if (atom->isHydrogen()) {
           removeAtom(atom);
         }
       }
+      endEdit();
     }
   }
 
@@ -828,11 +893,15 @@ namespace Avogadro{
     if (numAtoms() < 1 || !m_invalidPartialCharges) {
       return;
     }
-    OpenBabel::OBMol obmol = OBMol();
+    Q_D(const Molecule);
+    QSharedPointer<OpenBabel::OBMol> obmol = OBMolSnapshot();
     for (unsigned int i = 0; i < numAtoms(); ++i) {
       // Warning: OB off-by-one index
-      atom(i)->setPartialCharge(obmol.GetAtom(i+1)->GetPartialCharge());
+      atom(i)->setPartialCharge(obmol->GetAtom(i+1)->GetPartialCharge());
     }
+    // The charges came from the snapshot, so it is still up to date
+    if (obmol == d->obmol)
+      d->obmolChargeVersion = d->chargeVersion;
     m_invalidPartialCharges = false;
   }
 
@@ -841,9 +910,9 @@ namespace Avogadro{
     if (numBonds() < 1 || !m_invalidAromaticity)
       return;
 
-    OpenBabel::OBMol obmol = OBMol();
-    for (unsigned int i = 0; i < obmol.NumBonds(); ++i) {
-      bond(i)->setAromaticity(obmol.GetBond(i)->IsAromatic());
+    QSharedPointer<OpenBabel::OBMol> obmol = OBMolSnapshot();
+    for (unsigned int i = 0; i < obmol->NumBonds(); ++i) {
+      bond(i)->setAromaticity(obmol->GetBond(i)->IsAromatic());
     }
     m_invalidAromaticity = false;
   }
@@ -897,11 +966,15 @@ namespace Avogadro{
 
   unsigned int Molecule::numAtoms() const
   {
+    if (m_invalidLists)
+      compactLists();
     return m_atomList.size();
   }
 
   unsigned int Molecule::numBonds() const
   {
+    if (m_invalidLists)
+      compactLists();
     return m_bondList.size();
   }
 
@@ -933,6 +1006,7 @@ namespace Avogadro{
   {
     Q_D(Molecule);
     d->invalidGeomInfo = true;
+    ++d->topologyVersion;
     emit moleculeChanged();
     emit updated();
   }
@@ -942,6 +1016,12 @@ namespace Avogadro{
     Q_D(Molecule);
     Primitive *primitive = qobject_cast<Primitive *>(sender());
     d->invalidGeomInfo = true;
+    // Residues and cubes are part of the OBMol, rings and meshes are not
+    if (primitive == this)
+      ++d->geometryVersion;
+    else if (primitive && (primitive->type() == ResidueType
+                           || primitive->type() == CubeType))
+      ++d->topologyVersion;
     emit primitiveUpdated(primitive);
   }
 
@@ -951,12 +1031,15 @@ namespace Avogadro{
     Atom *atom = qobject_cast<Atom *>(sender());
     d->invalidGeomInfo = true;
     d->invalidGroupIndices = true;
+    ++d->geometryVersion;
     emit atomUpdated(atom);
   }
 
   void Molecule::updateBond()
   {
+    Q_D(Molecule);
     Bond *bond = qobject_cast<Bond *>(sender());
+    ++d->topologyVersion;
     emit bondUpdated(bond);
   }
 
@@ -965,20 +1048,94 @@ namespace Avogadro{
     emit updated();
   }
 
-  Bond* Molecule::bond(unsigned long id1, unsigned long id2)
+  void Molecule::beginEdit()
   {
-    // Take two atom IDs and see if we have a bond between the two
-    if (atomById(id1)) {
-      QList<unsigned long> bonds = atomById(id1)->bonds();
-      foreach (unsigned long id, bonds) {
-        Bond *bond = bondById(id);
-        if (bond) {
-          if (bond->otherAtom(id1) == id2) {
-            return bond;
-          }
-        }
+    Q_D(Molecule);
+    ++d->editDepth;
+  }
+
+  void Molecule::endEdit()
+  {
+    Q_D(Molecule);
+    if (d->editDepth == 0 || --d->editDepth > 0)
+      return;
+
+    if (m_invalidLists)
+      compactLists();
+
+    // Take the pending changes first, listeners may start another batch
+    QList<Atom *> addedAtoms = d->addedAtoms;
+    QList<Atom *> removedAtoms = d->removedAtoms;
+    QList<Bond *> addedBonds = d->addedBonds;
+    QList<Bond *> removedBonds = d->removedBonds;
+    QSet<Primitive *> pendingAdditions = d->pendingAdditions;
+    d->addedAtoms.clear();
+    d->removedAtoms.clear();
+    d->addedBonds.clear();
+    d->removedBonds.clear();
+    d->pendingAdditions.clear();
+
+    foreach (Bond *bond, removedBonds)
+      emit bondRemoved(bond);
+    foreach (Atom *atom, removedAtoms)
+      emit atomRemoved(atom);
+    foreach (Atom *atom, addedAtoms)
+      if (pendingAdditions.contains(atom))
+        emit atomAdded(atom);
+    foreach (Bond *bond, addedBonds)
+      if (pendingAdditions.contains(bond))
+        emit bondAdded(bond);
+
+    if (!addedAtoms.isEmpty() || !removedAtoms.isEmpty()
+        || !addedBonds.isEmpty() || !removedBonds.isEmpty()) {
+      d->invalidGeomInfo = true;
+      emit moleculeChanged();
+    }
+  }
+
+  void Molecule::compactLists() const
+  {
+    int count = 0;
+    for (int i = 0; i < m_atomList.size(); ++i) {
+      Atom *atom = m_atomList.at(i);
+      if (atom) {
+        atom->setIndex(count);
+        m_atomList[count++] = atom;
       }
     }
+    m_atomList.erase(m_atomList.begin() + count, m_atomList.end());
+
+    count = 0;
+    for (int i = 0; i < m_bondList.size(); ++i) {
+      Bond *bond = m_bondList.at(i);
+      if (bond) {
+        bond->setIndex(count);
+        m_bondList[count++] = bond;
+      }
+    }
+    m_bondList.erase(m_bondList.begin() + count, m_bondList.end());
+
+    m_invalidLists = false;
+  }
+
+  Bond* Molecule::bond(unsigned long id1, unsigned long id2)
+  {
+    // Take two atom IDs and see if we have a bond between the two, looking
+    // through the bonds of the atom with the fewest
+    const Atom *a1 = atomById(id1);
+    const Atom *a2 = atomById(id2);
+    if (!a1 || !a2)
+      return 0;
+    if (a2->m_bonds.size() < a1->m_bonds.size()) {
+      std::swap(a1, a2);
+      std::swap(id1, id2);
+    }
+    QList<unsigned long>::const_iterator it = a1->m_bonds.constBegin();
+    for (; it != a1->m_bonds.constEnd(); ++it) {
+      Bond *bond = bondById(*it);
+      if (bond && bond->otherAtom(id1) == id2)
+        return bond;
+    }
     return 0;
   }
 
@@ -998,6 +1155,10 @@ namespace Avogadro{
     if (conformer.size() != m_atomPos->size())
       return false;
 
+    if (index == m_currentConformer) {
+      Q_D(Molecule);
+      ++d->geometryVersion;
+    }
     if (m_atomConformers.size() < index+1) {
       unsigned int size = m_atomConformers.size();
       // If there is a gap between the current last conformer and the new index, pad it
@@ -1052,6 +1213,8 @@ namespace Avogadro{
         m_atomPos->push_back(Eigen::Vector3d::Zero());
       // set the current conformer index
       m_currentConformer = index;
+      Q_D(Molecule);
+      ++d->geometryVersion;
       return true;
     }
   }
@@ -1081,6 +1244,8 @@ namespace Avogadro{
 
     m_atomPos = m_atomConformers[0];
     m_currentConformer = 0;
+    Q_D(Molecule);
+    ++d->geometryVersion;
     return true;
   }
 
@@ -1093,6 +1258,8 @@ namespace Avogadro{
       m_atomPos = m_atomConformers[0];
     }
     m_currentConformer = 0;
+    Q_D(Molecule);
+    ++d->geometryVersion;
   }
 
   unsigned int Molecule::numConformers() const
@@ -1154,11 +1321,15 @@ namespace Avogadro{
 
   QList<Atom *> Molecule::atoms() const
   {
+    if (m_invalidLists)
+      compactLists();
     return m_atomList;
   }
 
   QList<Bond *> Molecule::bonds() const
   {
+    if (m_invalidLists)
+      compactLists();
     return m_bondList;
   }
 
@@ -1189,9 +1360,9 @@ namespace Avogadro{
       foreach(Fragment *ring, d->ringList) {
         removeRing(ring);
       }
-      OpenBabel::OBMol obmol = OBMol();
+      QSharedPointer<OpenBabel::OBMol> obmol = OBMolSnapshot();
       std::vector<OpenBabel::OBRing *> rings;
-      rings = obmol.GetSSSR();
+      rings = obmol->GetSSSR();
       foreach(OpenBabel::OBRing *r, rings) {
         Fragment *ring = addRing();
         foreach(int index, r->_path) {
@@ -1205,19 +1376,99 @@ namespace Avogadro{
 
   OpenBabel::OBMol Molecule::OBMol() const
   {
-    Q_D(const Molecule);
     // Right now we make an OBMol each time
     OpenBabel::OBMol obmol;
+    fillOBMol(obmol);
+    return obmol;
+  }
+
+  QSharedPointer<OpenBabel::OBMol> Molecule::OBMolSnapshot() const
+  {
+    Q_D(const Molecule);
+    bool rebuild = !d->obmol || d->obmolTopologyVersion != d->topologyVersion
+        || d->obmolChargeVersion != d->chargeVersion;
+
+    if (!rebuild && d->obmolGeometryVersion != d->geometryVersion) {
+      // Only copy the coordinates, unless an element changed
+      OpenBabel::OBMol *obmol = d->obmol.data();
+      QList<Atom *> atomList = atoms();
+      if (static_cast<int>(obmol->NumAtoms()) != atomList.size())
+        rebuild = true;
+      for (int i = 0; !rebuild && i < atomList.size(); ++i) {
+        OpenBabel::OBAtom *obatom = obmol->GetAtom(i + 1);
+        if (obatom->GetAtomicNum()
+            != static_cast<unsigned int>(atomList[i]->atomicNumber())) {
+          rebuild = true;
+          break;
+        }
+        const Vector3d *pos = atomList[i]->pos();
+        obatom->SetVector(pos->x(), pos->y(), pos->z());
+      }
+      if (!rebuild) {
+        // Stereochemistry is perceived from the coordinates
+        obmol->SetChiralityPerceived(false);
+        d->obmolGeometryVersion = d->geometryVersion;
+      }
+    }
+
+    if (rebuild) {
+      // Earlier snapshots stay valid for whoever still holds them
+      d->obmol = QSharedPointer<OpenBabel::OBMol>(new OpenBabel::OBMol);
+      fillOBMol(*d->obmol);
+      d->obmolTopologyVersion = d->topologyVersion;
+      d->obmolGeometryVersion = d->geometryVersion;
+      d->obmolChargeVersion = d->chargeVersion;
+    }
+    else
+      d->obmol->SetEnergy(energy() / OpenBabel::KCAL_TO_KJ);
+
+    return d->obmol;
+  }
+
+  void Molecule::chargeChanged(bool formal)
+  {
+    Q_D(Molecule);
+    // Formal charges change atom typing and SMARTS matches, so they count
+    // as a topology change
+    if (formal)
+      ++d->topologyVersion;
+    else
+      ++d->chargeVersion;
+  }
+
+  void Molecule::bondChanged()
+  {
+    Q_D(Molecule);
+    d->invalidRings = true;
+    m_invalidAromaticity = true;
+    ++d->topologyVersion;
+  }
+
+  unsigned int Molecule::topologyVersion() const
+  {
+    Q_D(const Molecule);
+    return d->topologyVersion;
+  }
+
+  unsigned int Molecule::geometryVersion() const
+  {
+    Q_D(const Molecule);
+    return d->geometryVersion;
+  }
+
+  void Molecule::fillOBMol(OpenBabel::OBMol &obmol) const
+  {
+    Q_D(const Molecule);
     obmol.BeginModify();
 
-    foreach(Atom *atom, m_atomList) {
+    foreach(Atom *atom, atoms()) {
       OpenBabel::OBAtom *a = obmol.NewAtom();
       OpenBabel::OBAtom obatom = atom->OBAtom();
       *a = obatom;
     }
     // we are copying partial charges above
     obmol.SetPartialChargesPerceived();
-    foreach(Bond *bond, m_bondList) {
+    foreach(Bond *bond, bonds()) {
       Atom *beginAtom = atomById(bond->beginAtomId());
       if (!beginAtom)
         continue;
@@ -1328,8 +1579,6 @@ namespace Avogadro{
     if (d->oborcanearirdata != NULL) {
       obmol.SetData(d->oborcanearirdata->Clone(&obmol));
     }
-
-    return obmol;
   }
 
   bool Molecule::setOBMol(OpenBabel::OBMol *obmol)
@@ -1475,7 +1724,7 @@ namespace Avogadro{
         std::vector< std::vector<OpenBabel::vector3> > allForces = cd->GetForces();
         if (allForces.size() && allForces[0].size() == numAtoms()) {
           OpenBabel::vector3 force;
-          foreach (Atom *atom, m_atomList) { // loop through each atom
+          foreach (Atom *atom, atoms()) { // loop through each atom
             force = allForces[0][atom->index()];
             atom->setForceVector(Eigen::Vector3d(force.x(), force.y(), force.z()));
           } // end setting forces on each atom
@@ -1598,11 +1847,7 @@ namespace Avogadro{
   {
     Q_D(Molecule);
     d->obunitcell = obunitcell;
-    if (obunitcell == NULL) {
-      // delete it from our private obmol
-      if (d->obmol)
-        d->obmol->DeleteData(OpenBabel::OBGenericDataType::UnitCell);
-    }
+    ++d->topologyVersion;
     return true;
   }
 
@@ -1639,9 +1884,10 @@ namespace Avogadro{
     if (!m_atomPos)
       return; // nothing to do
 
-    Q_D(const Molecule);
+    Q_D(Molecule);
     d->invalidGeomInfo = true;
-    foreach (Atom *atom, m_atomList) {
+    ++d->geometryVersion;
+    foreach (Atom *atom, atoms()) {
       (*m_atomPos)[atom->id()] += offset;
       emit atomUpdated(atom);
     }
@@ -1650,6 +1896,23 @@ namespace Avogadro{
   void Molecule::clear()
   {
     Q_D(Molecule);
+    ++d->topologyVersion;
+    if (m_invalidLists)
+      compactLists();
+    // Removals held back by a batch edit are signalled now, additions are
+    // signalled as removed below
+    QList<Bond *> removedBonds = d->removedBonds;
+    QList<Atom *> removedAtoms = d->removedAtoms;
+    d->addedAtoms.clear();
+    d->removedAtoms.clear();
+    d->addedBonds.clear();
+    d->removedBonds.clear();
+    d->pendingAdditions.clear();
+    foreach (Bond *bond, removedBonds)
+      emit bondRemoved(bond);
+    foreach (Atom *atom, removedAtoms)
+      emit atomRemoved(atom);
+
     m_atoms.clear();
     foreach (Atom *atom, m_atomList) {
       atom->deleteLater();
@@ -1709,6 +1972,8 @@ namespace Avogadro{
   {
     // FIXME: Copy all the other stuff in the molecule!
     clear();
+    if (other.m_invalidLists)
+      other.compactLists();
     //const MoleculePrivate *e = other.d_func();
     m_atoms.resize(other.m_atoms.size(), 0);
     if (other.m_atomPos) {
@@ -1782,13 +2047,14 @@ namespace Avogadro{
     //const MoleculePrivate *e = other.d_func();
     // Create a temporary map from the old indices to the new for bonding
     QList<int> map;
-    foreach (Atom *a, other.m_atomList) {
+    beginEdit();
+    foreach (Atom *a, other.atoms()) {
       Atom *atom = addAtom();
       *atom = *a;
       map.push_back(atom->id());
       emit primitiveAdded(atom);
     }
-    foreach (Bond *b, other.m_bondList) {
+    foreach (Bond *b, other.bonds()) {
       Bond *bond = addBond();
       *bond = *b;
       bond->setBegin(atomById(map.at(other.atomById(b->beginAtomId())->index())));
@@ -1807,6 +2073,7 @@ namespace Avogadro{
       }
       residue->setAtomIds(r->atomIds());
     }
+    endEdit();
 
     return *this;
   }
@@ -1946,7 +2213,7 @@ namespace Avogadro{
         // First compute the geometric center from all atom positions
         int i = 0;
         Vector3d **atomPositions = new Vector3d*[nAtoms];
-        foreach (Atom *atom, m_atomList) {
+        foreach (Atom *atom, atoms()) {
           Vector3d *pos = &(*m_atomPos)[atom->id()];
           d->center += *pos;
           atomPositions[i++] = pos;
@@ -1956,7 +2223,7 @@ namespace Avogadro{
         // Determine the radius and the farthest atom relative to the center
         double farthestSqDist = -1.0;
         d->farthestAtom = 0;
-        foreach (Atom *atom, m_atomList) {
+        foreach (Atom *atom, atoms()) {
           double dist = (*atom->pos() - d->center).squaredNorm();
           if (dist > farthestSqDist) {
             farthestSqDist = dist;
@@ -2033,7 +2300,7 @@ namespace Avogadro{
       // Discover the farthestAtom info and radius
       double farthestAtomSqDistance = std::numeric_limits<double>::min();
       d->farthestAtom = NULL;
-      foreach (Atom *atom, m_atomList) {
+      foreach (Atom *atom, atoms()) {
         double distanceToCenter = (*atom->pos() - d->center).squaredNorm();
         if(distanceToCenter > farthestAtomSqDistance) {
           farthestAtomSqDistance = distanceToCenter;
@@ -30,6 +30,7 @@
 
 // Used by the inline functions
 #include <QReadWriteLock>
+#include <QSharedPointer>
 
 #include <vector>
 
@@ -113,6 +114,31 @@ namespace Avogadro {
     QString fileName() const;
     /** @} */
 
+    /** @name Batched editing
+     * These functions group many additions and removals of atoms and bonds,
+     * such as deleting a large selection, so that they take linear time.
+     * @{
+     */
+
+    /**
+     * Start a batch of edits. Until the matching endEdit() removing an Atom
+     * or a Bond does not renumber the remaining ones, and the atomAdded(),
+     * atomRemoved(), bondAdded() and bondRemoved() signals are held back.
+     * Batches may be nested, only the outermost endEdit() finishes the batch.
+     * @note The index of the atoms and bonds is only up to date after atom(),
+     * atoms(), numAtoms(), bond(), bonds() or numBonds() has been called.
+     */
+    void beginEdit();
+
+    /**
+     * Finish a batch of edits started with beginEdit(). The atoms and bonds
+     * left are renumbered in one pass and the signals held back are emitted,
+     * followed by a single moleculeChanged() if anything was added or removed.
+     * Primitives both added and removed in the batch are not signalled.
+     */
+    void endEdit();
+    /** @} */
+
     /** @name Atom properties
      * These functions are used to change and retrieve the properties of the
      * Atom objects in the Molecule.
@@ -740,6 +766,30 @@ namespace Avogadro {
      */
     OpenBabel::OBMol OBMol() const;
 
+    /**
+     * Get a shared OpenBabel::OBMol of the Molecule for reading. It is only
+     * rebuilt when the topology or a charge changed since the last call,
+     * otherwise just the atom coordinates are copied over when the geometry
+     * changed.
+     * @note The snapshot is shared and updated in place by later calls, do
+     * not change it. Atom labels, colors and properties are those of the
+     * last rebuild. Use OBMol() for a copy that can be changed.
+     */
+    QSharedPointer<OpenBabel::OBMol> OBMolSnapshot() const;
+
+    /**
+     * @return A counter that changes whenever atoms, bonds, residues or cubes
+     * are added, removed or updated, formal charges are set, or the unit cell
+     * is replaced.
+     */
+    unsigned int topologyVersion() const;
+
+    /**
+     * @return A counter that changes whenever atoms move, or the current
+     * conformer changes.
+     */
+    unsigned int geometryVersion() const;
+
     /**
      * Copy as much data as possible from the supplied OpenBabel::OBMol to the
      * Avogadro Molecule object.
@@ -855,8 +905,10 @@ namespace Avogadro {
 
     std::vector<Atom *>   m_atoms;
     std::vector<Bond *>   m_bonds;
-    QList<Atom *>         m_atomList;
-    QList<Bond *>         m_bondList;
+    // Removed atoms and bonds are left as null entries during a batch edit
+    mutable QList<Atom *> m_atomList;
+    mutable QList<Bond *> m_bondList;
+    mutable bool          m_invalidLists;
 
     QReadWriteLock *m_lock;
 
@@ -868,12 +920,38 @@ namespace Avogadro {
     void computeGeomInfo() const;
 
   private:
+    /**
+     * Copy the Molecule into the empty @p obmol, used by OBMol() and
+     * OBMolSnapshot().
+     */
+    void fillOBMol(OpenBabel::OBMol &obmol) const;
+
+    /**
+     * Called by Atom when its formal or partial charge is set, so that
+     * OBMolSnapshot() picks it up.
+     */
+    void chargeChanged(bool formal);
+    friend class Atom;
+
+    /**
+     * Called by Bond when its atoms or order are set, these signal nothing
+     * but change the topology.
+     */
+    void bondChanged();
+    friend class Bond;
+
     /**
      * Helper function for setting cached geometry information from the unit
      * unit cell. This is called as needed by Molecule::computeGeomInfo.
      */
     void computeGeomInfoFromUnitCell() const;
 
+    /**
+     * Drop the atoms and bonds removed during a batch edit from the lists
+     * and renumber the rest, see beginEdit().
+     */
+    void compactLists() const;
+
   public Q_SLOTS:
     /**
      * Signal that the molecule has been changed in some large way, emits the
@@ -974,6 +1052,8 @@ namespace Avogadro {
 
   inline Atom * Molecule::atom(int index) const
   {
+    if (m_invalidLists)
+      compactLists();
     if (index >= 0 && index < m_atomList.size())
       return m_atomList[index];
     else
@@ -998,6 +1078,8 @@ namespace Avogadro {
 
   inline Bond * Molecule::bond(int index) const
   {
+    if (m_invalidLists)
+      compactLists();
     if (index >= 0 && index < m_bondList.size())
       return m_bondList[index];
     else
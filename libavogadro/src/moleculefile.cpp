@@ -44,6 +44,8 @@
 
 // Included in obconversion.h
 //#include <iostream>
+#include <sstream>
+#include <algorithm>
 
 namespace Avogadro {
 
@@ -69,6 +71,25 @@ namespace Avogadro {
       // OBMol in specialCaseOBMol. MoleculeFile::molecule will return this
       // OBMol object (if non 0) regardless of the index.
       OBMol *specialCaseOBMol;
+
+      // A molecule to write at index, replacing the molecule there or
+      // inserted before it
+      struct Edit
+      {
+        unsigned int index;
+        bool replace;
+        const Molecule *molecule;
+        bool operator<(const Edit &other) const
+        {
+          return index < other.index
+              || (index == other.index && !replace && other.replace);
+        }
+      };
+
+      // Rewrite the file with edits applied, copying the unchanged bytes in
+      // large blocks, and update the offsets and titles
+      bool rewrite(const QString &fileName, const QString &fileType,
+                   std::vector<Edit> edits, QString &error);
   };
 
   MoleculeFile::MoleculeFile(const QString &fileName, const QString &fileType,
@@ -185,101 +206,193 @@ namespace Avogadro {
     return obmol;
   }
 
-  bool MoleculeFile::replaceMolecule(unsigned int i, Molecule *molecule,
-                                     QString)
-  {
-    if (!d->ready)
-      return false;
-    if (i >= d->streampos.size()) {
-      m_error.append(tr("replaceMolecule: index %1 out of reach.").arg(i));
-      return false;
+  namespace {
+    // Copy the bytes [from, to) of in, which is mapped at data if not 0
+    bool copyRange(QFile &in, const uchar *data, qint64 from, qint64 to,
+                   QFile &out)
+    {
+      if (data)
+        return out.write(reinterpret_cast<const char *>(data) + from,
+                         to - from) == to - from;
+
+      // Could not map the file, copy in large blocks
+      const qint64 blockSize = 1 << 20;
+      QByteArray buffer(static_cast<int>(qMin(blockSize, to - from)), 0);
+      if (!in.seek(from))
+        return false;
+      while (from < to) {
+        qint64 n = in.read(buffer.data(), qMin(blockSize, to - from));
+        if (n <= 0 || out.write(buffer.constData(), n) != n)
+          return false;
+        from += n;
+      }
+      return true;
     }
+  }
 
+  bool MoleculeFilePrivate::rewrite(const QString &fileName,
+                                    const QString &fileType,
+                                    std::vector<Edit> edits, QString &error)
+  {
     // Construct the OpenBabel objects, set the file type
     OBConversion conv;
     OBFormat *outFormat;
-    if (!m_fileType.isEmpty() && !conv.SetOutFormat(m_fileType.toLatin1())) {
+    if (!fileType.isEmpty() && !conv.SetOutFormat(fileType.toLatin1())) {
       // Output format not supported
-      m_error.append(tr("File type '%1' is not supported for writing.").arg(m_fileType));
+      error.append(QObject::tr("File type '%1' is not supported for writing.").arg(fileType));
       return false;
     } else {
-      outFormat = conv.FormatFromExt(m_fileName.toLatin1());
+      outFormat = conv.FormatFromExt(fileName.toLatin1());
       if (!outFormat || !conv.SetOutFormat(outFormat)) {
         // Output format not supported
-        m_error.append(tr("File type for file '%1' is not supported for writing.").arg(m_fileName));
+        error.append(QObject::tr("File type for file '%1' is not supported for writing.").arg(fileName));
         return false;
       }
     }
 
-    // Now attempt to open the file.new for writing
-    ofstream ofs;
-    QString newFilename(m_fileName.toLocal8Bit() + QLatin1String(".new"));
-    ofs.open(newFilename.toLatin1().data(), std::ios::out | std::ios::binary); // This handles utf8 file names etc
-    if (!ofs) {
-      m_error.append(tr("Could not open file '%1' for writing.").arg(m_fileName));
+    // Inserts go before a replacement of the same index, in the order given
+    std::stable_sort(edits.begin(), edits.end());
+
+    QFile in(fileName);
+    if (!in.open(QIODevice::ReadOnly)) {
+      error.append(QObject::tr("Could not open file '%1' for reading.").arg(fileName));
       return false;
     }
-    // Copy molecules 0 to i-1 to .new file
-    ifstream ifs;
-    ifs.open(m_fileName.toLocal8Bit(), std::ios::in | std::ios::binary); // This handles utf8 file names etc
-    if (!ifs) {
-      m_error.append(tr("Could not open file '%1' for reading.").arg(m_fileName));
+    const qint64 size = in.size();
+    uchar *data = size ? in.map(0, size) : 0;
+
+    // Now attempt to open the file.new for writing
+    QString newFileName(fileName + QLatin1String(".new"));
+    QFile out(newFileName);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      error.append(QObject::tr("Could not open file '%1' for writing.").arg(fileName));
       return false;
     }
-    for (std::streampos pos = 0; pos < d->streampos.at(i); pos+=1)
-      ofs.put(ifs.get()); // FIXME using istream_iterator or something
 
-    // write the molecule
-    OpenBabel::OBMol obmol = molecule->OBMol();
-    if (!conv.Write(&obmol, &ofs)) {
-      m_error.append(tr("Replacing molecule with index %1 in file '%2' failed.").arg(i).arg(m_fileName));
+    // Copy the unchanged ranges in one go and write the new molecules in
+    // between, computing the new offsets on the way
+    const unsigned int numRecords = streampos.size();
+    std::vector<std::streampos> newStreampos;
+    newStreampos.reserve(numRecords + edits.size());
+    QStringList newTitles;
+    unsigned int record = 0;
+    qint64 copied = 0;
+    bool success = true;
+    for (std::vector<Edit>::const_iterator edit = edits.begin();
+         success && edit != edits.end(); ++edit) {
+      for (; record < edit->index; ++record) {
+        newStreampos.push_back(std::streampos(out.pos() +
+                      (static_cast<qint64>(streampos[record]) - copied)));
+        newTitles.append(titles.value(record));
+      }
+
+      qint64 start = edit->index < numRecords
+          ? static_cast<qint64>(streampos[edit->index]) : size;
+      success = copyRange(in, data, copied, start, out);
+      copied = start;
+
+      // write the molecule
+      std::ostringstream oss;
+      OpenBabel::OBMol obmol = edit->molecule->OBMol();
+      if (!success || !conv.Write(&obmol, &oss)) {
+        success = false;
+        break;
+      }
+      newStreampos.push_back(std::streampos(out.pos()));
+      const std::string &str = oss.str();
+      success = out.write(str.data(), str.size())
+          == static_cast<qint64>(str.size());
+
+      QString title = QString::fromLatin1(obmol.GetTitle());
+      if (edit->replace) {
+        if (title.isEmpty())
+          title = titles.value(record);
+        ++record;
+        copied = record < numRecords
+            ? static_cast<qint64>(streampos[record]) : size;
+      }
+      else if (title.isEmpty())
+        title = QObject::tr("Molecule %1").arg(newTitles.size() + 1);
+      newTitles.append(title);
+    }
+    for (; success && record < numRecords; ++record) {
+      newStreampos.push_back(std::streampos(out.pos() +
+                    (static_cast<qint64>(streampos[record]) - copied)));
+      newTitles.append(titles.value(record));
+    }
+    if (success)
+      success = copyRange(in, data, copied, size, out);
+
+    if (data)
+      in.unmap(data);
+    in.close();
+    out.close();
+
+    if (!success) {
+      error.append(QObject::tr("Writing molecules to file '%1' failed.").arg(fileName));
+      out.remove();
       return false;
     }
 
-    std::streampos newSize = ofs.tellp() - d->streampos[i];
-    if (i+1 < d->streampos.size()) {
-      // copy remaining molecules
-      ifs.seekg(0, std::ios::end);
-      std::streampos endpos = ifs.tellg();
-      ifs.seekg(d->streampos.at(i+1));
-      while (ifs.tellg() < endpos)
-        ofs.put(ifs.get()); // FIXME using istream_iterator or something
-    }
-    /*
-    std::copy(std::istream_iterator<char>(ifs),
-              std::istream_iterator<char>(),
-              std::ostream_iterator<char>(ofs));
-    */
-    ifs.close();
-    ofs.close();
+    QFile(fileName).remove();
+    out.rename(fileName);
 
-    QFile newFile(newFilename);
-    QFile(m_fileName).remove();
-    newFile.rename(m_fileName);
+    streampos.swap(newStreampos);
+    titles = newTitles;
+    return true;
+  }
 
+  bool MoleculeFile::replaceMolecule(unsigned int i, Molecule *molecule,
+                                     QString fileName)
+  {
+    QMap<unsigned int, Molecule *> molecules;
+    molecules.insert(i, molecule);
+    return replaceMolecules(molecules, fileName);
+  }
 
-    // adjust the cached variables
-    if (i+1 < d->streampos.size()) {
-      // size of the molecule to be replaced (in chars)
-      std::streampos oldSize = d->streampos[i+1] - d->streampos[i];
-      std::streampos delta = newSize - oldSize;
+  bool MoleculeFile::replaceMolecules(const QMap<unsigned int, Molecule *> &molecules,
+                                      QString)
+  {
+    if (!d->ready)
+      return false;
 
-      for (unsigned int j = i+1; j < d->streampos.size(); ++j) {
-        d->streampos[j] += delta;
+    std::vector<MoleculeFilePrivate::Edit> edits;
+    QMap<unsigned int, Molecule *>::const_iterator it = molecules.constBegin();
+    for (; it != molecules.constEnd(); ++it) {
+      if (it.key() >= d->streampos.size()) {
+        m_error.append(tr("replaceMolecule: index %1 out of reach.").arg(it.key()));
+        return false;
       }
+      MoleculeFilePrivate::Edit edit = { it.key(), true, it.value() };
+      edits.push_back(edit);
     }
+    if (edits.empty())
+      return true;
 
-    return true;
+    return d->rewrite(m_fileName, m_fileType, edits, m_error);
   }
 
-  bool MoleculeFile::insertMolecule(unsigned int, Molecule *, QString)
+  bool MoleculeFile::insertMolecule(unsigned int i, Molecule *molecule,
+                                    QString)
   {
-    return false;
+    if (!d->ready)
+      return false;
+    if (i > d->streampos.size()) {
+      m_error.append(tr("insertMolecule: index %1 out of reach.").arg(i));
+      return false;
+    }
+
+    std::vector<MoleculeFilePrivate::Edit> edits;
+    MoleculeFilePrivate::Edit edit = { i, false, molecule };
+    edits.push_back(edit);
+    return d->rewrite(m_fileName, m_fileType, edits, m_error);
   }
 
-  bool MoleculeFile::appendMolecule(Molecule *, QString)
+  bool MoleculeFile::appendMolecule(Molecule *molecule, QString fileName)
   {
-    return false;
+    if (!d->ready)
+      return false;
+    return insertMolecule(d->streampos.size(), molecule, fileName);
   }
 
   void MoleculeFile::threadFinished()
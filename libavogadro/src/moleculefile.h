@@ -31,6 +31,7 @@
 
 #include <QString>
 #include <QIODevice>
+#include <QMap>
 
 #include <vector>
 #include <Eigen/Core>
@@ -109,18 +110,24 @@ namespace Avogadro {
      */
     bool replaceMolecule(unsigned int i, Molecule *molecule, QString fileName);
     /**
-     * Insert a molecule at index @p i.
-     * @param i The index for inserting the molecule
+     * Replace several molecules at once, the file is only rewritten once.
+     * @param molecules The new molecules by the index they replace.
+     * @param fileName The name of the file for saving.
+     */
+    bool replaceMolecules(const QMap<unsigned int, Molecule *> &molecules,
+                          QString fileName);
+    /**
+     * Insert a molecule at index @p i, the molecules from index @p i on move
+     * one index up.
+     * @param i The index for inserting the molecule, numMolecules() appends.
      * @param molecule The molecule to insert
      * @param fileName The name of the file for saving.
-     * @todo implement this method
      */
     bool insertMolecule(unsigned int i, Molecule *molecule, QString fileName);
     /**
      * Append @p molecule to the end of the file.
      * @param molecule The molecule to append.
      * @param fileName The name of the file for saving.
-     * @todo implement this method
      */
     bool appendMolecule(Molecule *molecule, QString fileName);
     //@}
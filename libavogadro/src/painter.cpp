@@ -27,6 +27,9 @@
 
 #include "painter.h"
 
+#include <QColor>
+#include <QVector>
+
 namespace Avogadro
 {
 
@@ -48,11 +51,48 @@ namespace Avogadro
     return false;
   }
 
+  void Painter::setImpostors(bool)
+  {
+  }
+
   void Painter::drawSphere(const Eigen::Vector3d *center, double radius)
   {
     drawSphere(*center, radius);
   }
 
+  void Painter::drawSpheres(const QVector<Eigen::Vector3d> &centers,
+                            const QVector<double> &radii,
+                            const QVector<QColor> &colors)
+  {
+    for (int i = 0; i < centers.size(); ++i) {
+      this->setColor(&colors[i]);
+      this->drawSphere(centers[i], radii[i]);
+    }
+  }
+
+  void Painter::drawCylinders(const QVector<Eigen::Vector3d> &ends1,
+                              const QVector<Eigen::Vector3d> &ends2,
+                              const QVector<double> &radii,
+                              const QVector<QColor> &colors)
+  {
+    for (int i = 0; i < ends1.size(); ++i) {
+      this->setColor(&colors[i]);
+      this->drawCylinder(ends1[i], ends2[i], radii[i]);
+    }
+  }
+
+  void Painter::drawMultiCylinders(const QVector<Eigen::Vector3d> &ends1,
+                                   const QVector<Eigen::Vector3d> &ends2,
+                                   double radius, const QVector<int> &orders,
+                                   double shift,
+                                   const QVector<QColor> &colors)
+  {
+    for (int i = 0; i < ends1.size(); ++i) {
+      this->setColor(&colors[i]);
+      this->drawMultiCylinder(ends1[i], ends2[i], radius, orders[i], shift);
+    }
+  }
+
   void Painter::drawQuadrilateral(const Eigen::Vector3d & p1,
                                   const Eigen::Vector3d & p2,
                                   const Eigen::Vector3d & p3,
@@ -122,6 +122,16 @@ namespace Avogadro
      */
     virtual void setColor(QString name) = 0;
 
+    /**
+     * Ask the painter to draw the spheres and cylinders passed to
+     * drawSpheres(), drawCylinders() and drawMultiCylinders() as impostors,
+     * ray cast per pixel on a few flat faces instead of tessellated. Painters
+     * that cannot do this simply ignore it, as does the default
+     * implementation. Engines should switch impostors off again once drawn.
+     * @param enabled true to draw impostors when possible.
+     */
+    virtual void setImpostors(bool enabled);
+
     /**
      * Draws a sphere, leaving the Painter choose the appropriate detail level based on the
      * apparent radius (ratio of radius over distance) and the global quality setting.
@@ -176,6 +186,51 @@ namespace Avogadro
                                    const Eigen::Vector3d &end2,
                                    double radius, int order, double shift) = 0;
 
+    /**
+     * Draws a set of spheres, each with its own color. This is much faster
+     * than calling drawSphere() for each sphere on painters that can draw
+     * many spheres at once. The default implementation simply calls
+     * setColor() and drawSphere() for every sphere.
+     * @param centers the positions of the centers of the spheres.
+     * @param radii the radii of the spheres.
+     * @param colors the colors of the spheres.
+     */
+    virtual void drawSpheres(const QVector<Eigen::Vector3d> &centers,
+                             const QVector<double> &radii,
+                             const QVector<QColor> &colors);
+
+    /**
+     * Draws a set of cylinders, each with its own color. The default
+     * implementation simply calls setColor() and drawCylinder() for every
+     * cylinder.
+     * @param ends1 the positions of the first ends of the cylinders.
+     * @param ends2 the positions of the second ends of the cylinders.
+     * @param radii the radii of the cylinders.
+     * @param colors the colors of the cylinders.
+     */
+    virtual void drawCylinders(const QVector<Eigen::Vector3d> &ends1,
+                               const QVector<Eigen::Vector3d> &ends2,
+                               const QVector<double> &radii,
+                               const QVector<QColor> &colors);
+
+    /**
+     * Draws a set of multiple cylinders, see drawMultiCylinder(), each with
+     * its own order and color. The default implementation simply calls
+     * setColor() and drawMultiCylinder() for every multiple cylinder.
+     * @param ends1 the positions of the first ends of the bonds.
+     * @param ends2 the positions of the second ends of the bonds.
+     * @param radius the radius, i.e. half-width of each cylinder.
+     * @param orders the multiplicity orders of the bonds.
+     * @param shift how far away from the central axis the cylinders are
+     *              shifted.
+     * @param colors the colors of the bonds.
+     */
+    virtual void drawMultiCylinders(const QVector<Eigen::Vector3d> &ends1,
+                                    const QVector<Eigen::Vector3d> &ends2,
+                                    double radius, const QVector<int> &orders,
+                                    double shift,
+                                    const QVector<QColor> &colors);
+
     /**
      * Draws a cone between the tip and the base with the base radius given.
      * @param base the position of the base of the cone.
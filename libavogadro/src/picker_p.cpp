@@ -0,0 +1,611 @@
+/**********************************************************************
+  Picker - Find the primitives under a region of the GLWidget
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "picker_p.h"
+
+#include <avogadro/glwidget.h>
+#include <avogadro/glhit.h>
+#include <avogadro/camera.h>
+#include <avogadro/engine.h>
+#include <avogadro/painter.h>
+#include <avogadro/painterdevice.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+#include <QMultiHash>
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using Eigen::Vector3d;
+using Eigen::Vector4d;
+
+namespace Avogadro {
+
+  // Shapes per leaf of the hierarchy
+  const int PICKER_LEAF_SIZE = 4;
+
+  /**
+   * A sphere (end1 == end2) or a cylinder named in Engine::renderPick().
+   * The ends are stored relative to the atom or bond named so that they can
+   * follow it when it moves.
+   */
+  struct PickShape
+  {
+    GLuint type;
+    GLuint name;
+    Vector3d end1;
+    Vector3d end2;
+    double radius;
+    // For bonds, position of the ends along the bond
+    double t1, t2;
+    // Offsets of the ends from the atom, or from their position on the bond
+    Vector3d offset1, offset2;
+    int leaf;
+  };
+
+  /**
+   * A node of the hierarchy. Leaves have count shapes from first in the
+   * shape order, the children of other nodes are left and left + 1.
+   */
+  struct PickNode
+  {
+    Vector3d min;
+    Vector3d max;
+    int parent;
+    int left;
+    int first;
+    int count;
+  };
+
+  /**
+   * Painter recording the named spheres and cylinders. Everything else is
+   * ignored as only those are ever named, see GLPainter::pushName().
+   */
+  class PickPainter : public Painter
+  {
+    public:
+      PickPainter() : m_type(Primitive::OtherType), m_id(-1), m_shapes(0) {}
+
+      void begin(std::vector<PickShape> *shapes) { m_shapes = shapes; }
+      void end() { m_shapes = 0; }
+
+      int quality() const { return 0; }
+      void setName(const Primitive *primitive)
+      {
+        m_type = primitive->type();
+        if (m_type == Primitive::AtomType || m_type == Primitive::BondType)
+          m_id = static_cast<int>(primitive->index());
+        else
+          m_id = -1;
+      }
+      void setName(Primitive::Type type, int id) { m_type = type; m_id = id; }
+      void setColor(const Color *) { }
+      void setColor(const QColor *) { }
+      void setColor(float, float, float, float = 1.0) { }
+      void setColor(QString) { }
+
+      void drawSphere(const Vector3d &center, double radius)
+      {
+        record(center, center, radius);
+      }
+      void drawCylinder(const Vector3d &end1, const Vector3d &end2,
+                        double radius)
+      {
+        record(end1, end2, radius);
+      }
+      void drawMultiCylinder(const Vector3d &end1, const Vector3d &end2,
+                             double radius, int order, double shift)
+      {
+        // One cylinder around all the cylinders drawn
+        record(end1, end2, order > 1 ? radius + shift : radius);
+      }
+
+      void drawCone(const Vector3d &, const Vector3d &, double, double) { }
+      void drawLine(const Vector3d &, const Vector3d &, double) { }
+      void drawMultiLine(const Vector3d &, const Vector3d &, double, int,
+                         short) { }
+      void drawTriangle(const Vector3d &, const Vector3d &,
+                        const Vector3d &) { }
+      void drawTriangle(const Vector3d &, const Vector3d &, const Vector3d &,
+                        const Vector3d &) { }
+      void drawSpline(const QVector<Vector3d> &, double) { }
+      void drawShadedSector(const Vector3d &, const Vector3d &,
+                            const Vector3d &, double, bool) { }
+      void drawArc(const Vector3d &, const Vector3d &, const Vector3d &,
+                   double, double, bool) { }
+      void drawShadedQuadrilateral(const Vector3d &, const Vector3d &,
+                                   const Vector3d &, const Vector3d &) { }
+      void drawMesh(const Mesh &, int) { }
+      void drawColorMesh(const Mesh &, int) { }
+      int drawText(int, int, const QString &) { return 0; }
+      int drawText(const QPoint &, const QString &) { return 0; }
+      int drawText(const Vector3d &, const QString &) { return 0; }
+      void drawBox(const Vector3d &, const Vector3d &) { }
+      void drawTorus(const Vector3d &, double, double) { }
+      void drawEllipsoid(const Vector3d &, const Eigen::Matrix3d &) { }
+
+    private:
+      void record(const Vector3d &end1, const Vector3d &end2, double radius)
+      {
+        // As with GLPainter the name is only used for one primitive
+        if (m_id == -1 || !m_shapes)
+          return;
+        PickShape shape;
+        shape.type = m_type;
+        shape.name = m_id;
+        shape.end1 = end1;
+        shape.end2 = end2;
+        shape.radius = radius;
+        shape.t1 = shape.t2 = 0.0;
+        shape.leaf = -1;
+        m_shapes->push_back(shape);
+        m_type = Primitive::OtherType;
+        m_id = -1;
+      }
+
+      Primitive::Type m_type;
+      int m_id;
+      std::vector<PickShape> *m_shapes;
+  };
+
+  class PickPainterDevice : public PainterDevice
+  {
+    public:
+      PickPainterDevice(GLWidget *widget) : m_widget(widget) {}
+
+      Painter *painter() const { return const_cast<PickPainter *>(&m_painter); }
+      Camera *camera() const { return m_widget->camera(); }
+      bool isSelected(const Primitive *p) const { return m_widget->isSelected(p); }
+      double radius(const Primitive *p) const { return m_widget->radius(p); }
+      const Molecule *molecule() const { return m_widget->molecule(); }
+      Color *colorMap() const { return m_widget->colorMap(); }
+
+      int width() { return m_widget->width(); }
+      int height() { return m_widget->height(); }
+
+      PickPainter m_painter;
+
+    private:
+      GLWidget *m_widget;
+  };
+
+  class PickerPrivate
+  {
+    public:
+      PickerPrivate(GLWidget *widget) : widget(widget), molecule(0),
+        built(false), moved(false) {}
+
+      void anchor(PickShape &shape) const;
+      void place(PickShape &shape) const;
+      void split(int node, int begin, int end);
+      void fit(int node);
+      void refit();
+      bool atomChanged(const Atom *atom) const;
+
+      GLWidget *widget;
+      Molecule *molecule;
+      bool built;
+      // All positions must be placed again
+      bool moved;
+
+      std::vector<PickShape> shapes;
+      std::vector<int> order;
+      std::vector<PickNode> nodes;
+      std::vector<int> atomicNumbers;
+      QMultiHash<GLuint, int> atomShapes;
+      QMultiHash<GLuint, int> bondShapes;
+      // Leaves with shapes moved since the last pick
+      std::vector<int> movedLeaves;
+  };
+
+  void PickerPrivate::anchor(PickShape &shape) const
+  {
+    if (shape.type == Primitive::AtomType) {
+      const Atom *atom = molecule->atom(shape.name);
+      if (!atom)
+        return;
+      shape.offset1 = shape.end1 - *atom->pos();
+      shape.offset2 = shape.end2 - *atom->pos();
+    }
+    else if (shape.type == Primitive::BondType) {
+      const Bond *bond = molecule->bond(shape.name);
+      if (!bond)
+        return;
+      const Vector3d &begin = *bond->beginPos();
+      Vector3d axis = *bond->endPos() - begin;
+      double length2 = axis.squaredNorm();
+      if (length2 > 0.0) {
+        shape.t1 = (shape.end1 - begin).dot(axis) / length2;
+        shape.t2 = (shape.end2 - begin).dot(axis) / length2;
+      }
+      shape.offset1 = shape.end1 - (begin + shape.t1 * axis);
+      shape.offset2 = shape.end2 - (begin + shape.t2 * axis);
+    }
+  }
+
+  void PickerPrivate::place(PickShape &shape) const
+  {
+    if (shape.type == Primitive::AtomType) {
+      const Atom *atom = molecule->atom(shape.name);
+      if (!atom)
+        return;
+      shape.end1 = *atom->pos() + shape.offset1;
+      shape.end2 = *atom->pos() + shape.offset2;
+    }
+    else if (shape.type == Primitive::BondType) {
+      const Bond *bond = molecule->bond(shape.name);
+      if (!bond)
+        return;
+      const Vector3d &begin = *bond->beginPos();
+      Vector3d axis = *bond->endPos() - begin;
+      shape.end1 = begin + shape.t1 * axis + shape.offset1;
+      shape.end2 = begin + shape.t2 * axis + shape.offset2;
+    }
+  }
+
+  void PickerPrivate::split(int node, int begin, int end)
+  {
+    // Bounds of the shapes, and of their centers to choose the split axis
+    Vector3d min, max, centerMin, centerMax;
+    min = centerMin = Vector3d::Constant(HUGE_VAL);
+    max = centerMax = Vector3d::Constant(-HUGE_VAL);
+    for (int i = begin; i < end; ++i) {
+      const PickShape &shape = shapes[order[i]];
+      Vector3d r = Vector3d::Constant(shape.radius);
+      min = min.cwiseMin(shape.end1.cwiseMin(shape.end2) - r);
+      max = max.cwiseMax(shape.end1.cwiseMax(shape.end2) + r);
+      Vector3d center = 0.5 * (shape.end1 + shape.end2);
+      centerMin = centerMin.cwiseMin(center);
+      centerMax = centerMax.cwiseMax(center);
+    }
+    nodes[node].min = min;
+    nodes[node].max = max;
+
+    if (end - begin <= PICKER_LEAF_SIZE) {
+      nodes[node].first = begin;
+      nodes[node].count = end - begin;
+      for (int i = begin; i < end; ++i)
+        shapes[order[i]].leaf = node;
+      return;
+    }
+
+    // Median split along the longest axis of the centers
+    int axis;
+    (centerMax - centerMin).maxCoeff(&axis);
+    int middle = (begin + end) / 2;
+    const std::vector<PickShape> &s = shapes;
+    std::nth_element(order.begin() + begin, order.begin() + middle,
+                     order.begin() + end,
+                     [&s, axis](int a, int b) {
+                       return s[a].end1[axis] + s[a].end2[axis]
+                         < s[b].end1[axis] + s[b].end2[axis];
+                     });
+
+    int left = static_cast<int>(nodes.size());
+    nodes.resize(left + 2);
+    nodes[node].left = left;
+    nodes[node].count = 0;
+    nodes[left].parent = nodes[left + 1].parent = node;
+    split(left, begin, middle);
+    split(left + 1, middle, end);
+  }
+
+  void PickerPrivate::fit(int node)
+  {
+    PickNode &n = nodes[node];
+    if (n.count) {
+      n.min = Vector3d::Constant(HUGE_VAL);
+      n.max = Vector3d::Constant(-HUGE_VAL);
+      for (int i = n.first; i < n.first + n.count; ++i) {
+        const PickShape &shape = shapes[order[i]];
+        Vector3d r = Vector3d::Constant(shape.radius);
+        n.min = n.min.cwiseMin(shape.end1.cwiseMin(shape.end2) - r);
+        n.max = n.max.cwiseMax(shape.end1.cwiseMax(shape.end2) + r);
+      }
+    }
+    else {
+      n.min = nodes[n.left].min.cwiseMin(nodes[n.left + 1].min);
+      n.max = nodes[n.left].max.cwiseMax(nodes[n.left + 1].max);
+    }
+  }
+
+  void PickerPrivate::refit()
+  {
+    if (moved) {
+      for (unsigned int i = 0; i < shapes.size(); ++i)
+        place(shapes[i]);
+      // Children always come after their parent
+      for (int i = static_cast<int>(nodes.size()) - 1; i >= 0; --i)
+        fit(i);
+    }
+    else {
+      foreach (int leaf, movedLeaves)
+        for (int node = leaf; node != -1; node = nodes[node].parent)
+          fit(node);
+    }
+    moved = false;
+    movedLeaves.clear();
+  }
+
+  bool PickerPrivate::atomChanged(const Atom *atom) const
+  {
+    // The engines may use other radii for other elements
+    unsigned long index = atom->index();
+    return index >= atomicNumbers.size()
+      || atomicNumbers[index] != atom->atomicNumber();
+  }
+
+  Picker::Picker(GLWidget *widget) : QObject(widget),
+    d(new PickerPrivate(widget))
+  {
+  }
+
+  Picker::~Picker()
+  {
+    delete d;
+  }
+
+  void Picker::setMolecule(Molecule *molecule)
+  {
+    if (d->molecule)
+      disconnect(d->molecule, 0, this, 0);
+    d->molecule = molecule;
+    invalidate();
+    if (!molecule)
+      return;
+
+    connect(molecule, SIGNAL(atomAdded(Atom*)), this, SLOT(invalidate()));
+    connect(molecule, SIGNAL(atomRemoved(Atom*)), this, SLOT(invalidate()));
+    connect(molecule, SIGNAL(bondAdded(Bond*)), this, SLOT(invalidate()));
+    connect(molecule, SIGNAL(bondRemoved(Bond*)), this, SLOT(invalidate()));
+    connect(molecule, SIGNAL(bondUpdated(Bond*)), this, SLOT(invalidate()));
+    connect(molecule, SIGNAL(moleculeChanged()), this, SLOT(invalidate()));
+    connect(molecule, SIGNAL(atomUpdated(Atom*)),
+            this, SLOT(updateAtom(Atom*)));
+    connect(molecule, SIGNAL(updated()), this, SLOT(updatePositions()));
+    connect(molecule, SIGNAL(destroyed()), this, SLOT(invalidate()));
+  }
+
+  bool Picker::needsBuild() const
+  {
+    return !d->built;
+  }
+
+  void Picker::build(const QList<Engine *> &engines)
+  {
+    d->shapes.clear();
+    d->nodes.clear();
+    d->order.clear();
+    d->atomShapes.clear();
+    d->bondShapes.clear();
+    d->atomicNumbers.clear();
+    d->movedLeaves.clear();
+    d->moved = false;
+    d->built = true;
+    if (!d->molecule)
+      return;
+
+    // Engines may draw more than their names with OpenGL directly, make sure
+    // none of it reaches the frame buffer
+    glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT
+                 | GL_STENCIL_BUFFER_BIT);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glStencilMask(0);
+
+    PickPainterDevice pd(d->widget);
+    pd.m_painter.begin(&d->shapes);
+    foreach(Engine *engine, engines)
+      if (engine->isEnabled())
+        engine->renderPick(&pd);
+    pd.m_painter.end();
+
+    glPopAttrib();
+
+    d->atomicNumbers.resize(d->molecule->numAtoms());
+    foreach (const Atom *atom, d->molecule->atoms())
+      if (atom->index() < d->atomicNumbers.size())
+        d->atomicNumbers[atom->index()] = atom->atomicNumber();
+
+    int count = static_cast<int>(d->shapes.size());
+    d->order.resize(count);
+    for (int i = 0; i < count; ++i) {
+      PickShape &shape = d->shapes[i];
+      d->anchor(shape);
+      if (shape.type == Primitive::AtomType)
+        d->atomShapes.insert(shape.name, i);
+      else if (shape.type == Primitive::BondType)
+        d->bondShapes.insert(shape.name, i);
+      d->order[i] = i;
+    }
+    if (!count)
+      return;
+
+    d->nodes.reserve(2 * (count / PICKER_LEAF_SIZE + 1));
+    d->nodes.resize(1);
+    d->nodes[0].parent = -1;
+    d->split(0, 0, count);
+  }
+
+  QList<GLHit> Picker::hits(int x, int y, int w, int h)
+  {
+    QList<GLHit> hits;
+    if (!d->built || !d->molecule || d->nodes.empty())
+      return hits;
+    d->refit();
+
+    // The frustum of the region, from the corners of the region on the near
+    // and far planes, with the plane normals pointing inside
+    Camera *camera = d->widget->camera();
+    if (w < 1) w = 1;
+    if (h < 1) h = 1;
+    const double cornerX[4] = { x, x + w, x + w, x };
+    const double cornerY[4] = { y, y, y + h, y + h };
+    Vector3d nearCorners[4], farCorners[4], inside(Vector3d::Zero());
+    for (int i = 0; i < 4; ++i) {
+      nearCorners[i] = camera->unProject(Vector3d(cornerX[i], cornerY[i], 0.0));
+      farCorners[i] = camera->unProject(Vector3d(cornerX[i], cornerY[i], 1.0));
+      inside += nearCorners[i] + farCorners[i];
+    }
+    inside /= 8.0;
+
+    Vector4d planes[6];
+    Vector3d normals[6];
+    for (int i = 0; i < 4; ++i)
+      normals[i] = (farCorners[i] - nearCorners[i]).cross(
+        nearCorners[(i + 1) % 4] - nearCorners[i]);
+    normals[4] = (nearCorners[1] - nearCorners[0]).cross(
+      nearCorners[2] - nearCorners[0]);
+    normals[5] = normals[4];
+    const Vector3d *points[6] = { &nearCorners[0], &nearCorners[1],
+                                  &nearCorners[2], &nearCorners[3],
+                                  &nearCorners[0], &farCorners[0] };
+    for (int i = 0; i < 6; ++i) {
+      Vector3d n = normals[i].normalized();
+      double offset = -n.dot(*points[i]);
+      if (n.dot(inside) + offset < 0.0) {
+        n = -n;
+        offset = -offset;
+      }
+      planes[i] << n, offset;
+    }
+    // Towards the far plane
+    Vector3d forward = planes[4].head<3>();
+
+    std::vector<int> stack;
+    stack.push_back(0);
+    while (!stack.empty()) {
+      const PickNode &node = d->nodes[stack.back()];
+      stack.pop_back();
+
+      Vector3d center = 0.5 * (node.min + node.max);
+      Vector3d extent = 0.5 * (node.max - node.min);
+      bool outside = false;
+      for (int i = 0; i < 6 && !outside; ++i)
+        outside = planes[i].head<3>().dot(center)
+          + planes[i].head<3>().cwiseAbs().dot(extent) + planes[i][3] < 0.0;
+      if (outside)
+        continue;
+
+      if (!node.count) {
+        stack.push_back(node.left);
+        stack.push_back(node.left + 1);
+        continue;
+      }
+
+      for (int i = node.first; i < node.first + node.count; ++i) {
+        const PickShape &shape = d->shapes[d->order[i]];
+        // Clip the axis to the frustum widened by the radius, so that a long
+        // bond only gets the depths of its part under the region
+        Vector3d axis = shape.end2 - shape.end1;
+        double t1 = 0.0, t2 = 1.0;
+        for (int j = 0; j < 6 && t1 <= t2; ++j) {
+          const Vector3d &n = planes[j].head<3>();
+          double distance = n.dot(shape.end1) + planes[j][3] + shape.radius;
+          double rate = n.dot(axis);
+          if (rate > 0.0)
+            t1 = std::max(t1, -distance / rate);
+          else if (rate < 0.0)
+            t2 = std::min(t2, -distance / rate);
+          else if (distance < 0.0)
+            t2 = -1.0;
+        }
+        if (t1 > t2)
+          continue;
+        Vector3d end1 = shape.end1 + t1 * axis;
+        Vector3d end2 = shape.end1 + t2 * axis;
+
+        // Window depths of the nearest and farthest points
+        double depth1 = camera->project(end1).z();
+        double depth2 = camera->project(end2).z();
+        const Vector3d &nearEnd = depth1 < depth2 ? end1 : end2;
+        const Vector3d &farEnd = depth1 < depth2 ? end2 : end1;
+        double minZ = camera->project(nearEnd - shape.radius * forward).z();
+        double maxZ = camera->project(farEnd + shape.radius * forward).z();
+        minZ = std::min(std::max(minZ, 0.0), 1.0);
+        maxZ = std::min(std::max(maxZ, 0.0), 1.0);
+        hits.append(GLHit(shape.type, shape.name,
+                          static_cast<GLuint>(minZ * 4294967295.0),
+                          static_cast<GLuint>(maxZ * 4294967295.0)));
+      }
+    }
+
+    qSort(hits);
+    return hits;
+  }
+
+  void Picker::invalidate()
+  {
+    d->built = false;
+  }
+
+  void Picker::updateAtom(Atom *atom)
+  {
+    if (!d->built || d->moved || !atom)
+      return;
+    if (d->atomChanged(atom)) {
+      invalidate();
+      return;
+    }
+
+    QList<int> moved = d->atomShapes.values(atom->index());
+    foreach (unsigned long id, atom->bonds()) {
+      const Bond *bond = d->molecule->bondById(id);
+      if (bond)
+        moved += d->bondShapes.values(bond->index());
+    }
+    foreach (int i, moved) {
+      d->place(d->shapes[i]);
+      d->movedLeaves.push_back(d->shapes[i].leaf);
+    }
+
+    // Beyond a few atoms it is quicker to refit everything
+    if (d->movedLeaves.size() > d->nodes.size() / 8)
+      d->moved = true;
+  }
+
+  void Picker::updatePositions()
+  {
+    if (!d->built || !d->molecule)
+      return;
+    // Check the atoms still match what the engines named
+    if (d->atomicNumbers.size() != d->molecule->numAtoms()) {
+      invalidate();
+      return;
+    }
+    foreach (const Atom *atom, d->molecule->atoms()) {
+      if (d->atomChanged(atom)) {
+        invalidate();
+        return;
+      }
+    }
+    d->moved = true;
+  }
+
+} // End namespace Avogadro
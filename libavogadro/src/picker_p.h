@@ -0,0 +1,111 @@
+/**********************************************************************
+  Picker - Find the primitives under a region of the GLWidget
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef PICKER_H
+#define PICKER_H
+
+#include <avogadro/global.h>
+
+#include <QObject>
+#include <QList>
+
+namespace Avogadro {
+
+  class Atom;
+  class Engine;
+  class GLHit;
+  class GLWidget;
+  class Molecule;
+
+  /**
+   * @class Picker
+   * @internal
+   * @brief Finds the atoms and bonds under a region of a GLWidget.
+   *
+   * The picker records the spheres and cylinders each engine names in
+   * Engine::renderPick(), without OpenGL, and keeps them in a bounding volume
+   * hierarchy. Picking a region of the widget then only walks the part of the
+   * hierarchy inside the frustum of that region, whatever the size of the
+   * molecule.
+   *
+   * When atoms move the recorded shapes follow them and the hierarchy is
+   * refitted. Adding or removing atoms or bonds, or changing the engines,
+   * records all the shapes again on the next pick.
+   */
+  class PickerPrivate;
+  class Picker : public QObject
+  {
+    Q_OBJECT
+
+    public:
+      Picker(GLWidget *widget);
+      ~Picker();
+
+      /**
+       * Follow the changes of @p molecule.
+       */
+      void setMolecule(Molecule *molecule);
+
+      /**
+       * @return true if the shapes need to be recorded again with build()
+       * before hits() can be answered.
+       */
+      bool needsBuild() const;
+
+      /**
+       * Record the shapes named by @p engines in their renderPick(). The
+       * OpenGL context of the widget must be current as engines may change
+       * its state, nothing is drawn.
+       */
+      void build(const QList<Engine *> &engines);
+
+      /**
+       * @return the hits in the region starting at (x, y) of size (w * h), in
+       * device pixels, sorted from the nearest to the farthest.
+       */
+      QList<GLHit> hits(int x, int y, int w, int h);
+
+    public Q_SLOTS:
+      /**
+       * Record all the shapes again before the next pick.
+       */
+      void invalidate();
+
+      /**
+       * Move the shapes of @p atom and its bonds.
+       */
+      void updateAtom(Atom *atom);
+
+      /**
+       * Move the shapes of all the atoms and bonds before the next pick.
+       */
+      void updatePositions();
+
+    private:
+      PickerPrivate * const d;
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -78,6 +78,20 @@ void export_Mesh()
     .add_property("colors", 
         make_function(&Mesh::colors, return_value_policy<return_by_value>()),
         &Mesh::setColors)
+
+    .add_property("indices", 
+        make_function(&Mesh::indices, return_value_policy<return_by_value>()),
+        &Mesh::setIndices,
+        "List containing the vertex indices of the triangles, three for each "
+        "triangle. Empty if the Mesh is not indexed.")
+
+    .add_property("numIndices", 
+        &Mesh::numIndices, 
+        "The number of indices.")
+
+    .add_property("numTriangles", 
+        &Mesh::numTriangles, 
+        "The number of triangles.")
  
     // real functions
     .def("reserve", 
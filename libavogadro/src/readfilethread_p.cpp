@@ -25,7 +25,16 @@
 #include "moleculefile.h"
 
 #include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QDir>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QCryptographicHash>
 #include <QtCore/QStringList>
+#include <QtCore/QFuture>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include <openbabel/mol.h>
 #include <openbabel/atom.h>
@@ -33,6 +42,8 @@
 #include <openbabel/oberror.h>
 
 #include <fstream>
+#include <cstring>
+#include <cctype>
 
 namespace Avogadro {
 
@@ -40,6 +51,109 @@ using OpenBabel::OBConversion;
 using OpenBabel::OBAtomConstIterator;
 using std::ifstream;
 
+// Smallest part of a file scanned by one thread
+const qint64 SCAN_CHUNK_SIZE = 4 << 20;
+// Smaller files are read again, that is fast enough
+const qint64 INDEX_MIN_FILE_SIZE = 1 << 20;
+const quint32 INDEX_MAGIC = 0x4156494e; // AVIN
+// Version 1 indexed gzipped files by their compressed bytes
+const quint32 INDEX_VERSION = 2;
+
+namespace {
+  enum RecordFormat {
+    SdfRecords,     // Ends with a "$$$$" line
+    SmilesRecords,  // One per line
+    Mol2Records     // Starts with a "@<TRIPOS>MOLECULE" line
+  };
+
+  struct ScanResult
+  {
+    std::vector<std::streampos> offsets;
+    QStringList titles;
+  };
+
+  inline const char * nextLine(const char *p, const char *end)
+  {
+    const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+    return eol ? eol + 1 : end;
+  }
+
+  inline bool startsWith(const char *p, const char *end, const char *prefix)
+  {
+    size_t n = strlen(prefix);
+    return static_cast<size_t>(end - p) >= n && !strncmp(p, prefix, n);
+  }
+
+  // The text of the line starting at p, without surrounding whitespace
+  QString lineText(const char *p, const char *end)
+  {
+    const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+    return QString::fromUtf8(p, (eol ? eol : end) - p).trimmed();
+  }
+
+  // Find the records starting on the lines that start in [begin, end)
+  ScanResult scanChunk(RecordFormat format, const char *data, qint64 size,
+                       qint64 begin, qint64 end)
+  {
+    ScanResult result;
+    const char *fileEnd = data + size;
+    const char *p = data + begin;
+    if (begin > 0 && data[begin - 1] != '\n')
+      p = nextLine(p, fileEnd);
+    while (p < data + end) {
+      const char *next = nextLine(p, fileEnd);
+      switch (format) {
+      case SdfRecords:
+        if (startsWith(p, fileEnd, "$$$$")) {
+          // Ignore trailing whitespace after the last record
+          const char *q = next;
+          while (q < fileEnd && isspace(static_cast<unsigned char>(*q)))
+            ++q;
+          if (q < fileEnd) {
+            result.offsets.push_back(next - data);
+            result.titles.append(lineText(next, fileEnd));
+          }
+        }
+        break;
+      case SmilesRecords: {
+        const char *q = p;
+        while (q < next && (*q == ' ' || *q == '\t'))
+          ++q;
+        if (q < next && *q != '\n' && *q != '\r' && *q != '#') {
+          // The title follows the SMILES
+          while (q < next && !isspace(static_cast<unsigned char>(*q)))
+            ++q;
+          result.offsets.push_back(p - data);
+          result.titles.append(lineText(q, next));
+        }
+        break;
+      }
+      case Mol2Records:
+        if (startsWith(p, fileEnd, "@<TRIPOS>MOLECULE")) {
+          result.offsets.push_back(p - data);
+          result.titles.append(lineText(next, fileEnd));
+        }
+        break;
+      }
+      p = next;
+    }
+    return result;
+  }
+
+  // The index of a file is saved in the cache, the same file can be read
+  // with different types or options
+  QString indexFileName(const MoleculeFile *moleculeFile)
+  {
+    QByteArray key = QFileInfo(moleculeFile->fileName()).absoluteFilePath().toUtf8();
+    key += '\n' + moleculeFile->fileType().toUtf8();
+    key += '\n' + moleculeFile->fileOptions().toUtf8();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+        + QLatin1String("/fileindex/")
+        + QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex()
+        + QLatin1String(".idx");
+  }
+}
+
 ReadFileThread::ReadFileThread(MoleculeFile *moleculeFile)
   : m_moleculeFile(moleculeFile)
 {
@@ -165,63 +279,69 @@ void ReadFileThread::run()
     }
   }
 
-  // Now attempt to read the molecule in
-  ifstream ifs;
-  ifs.open(m_moleculeFile->m_fileName.toLocal8Bit(), std::ios::in | std::ios::binary); // This handles utf8 file names etc
-  if (!ifs) // Should not happen, already checked file could be opened
+  // Reopening a file is instant once its molecules were indexed
+  if (readIndex())
     return;
 
-  // read all molecules
-  OpenBabel::OBMol firstOBMol, currentOBMol;
-  unsigned int c = 0;
-  conv.SetInStream(&ifs);
-  m_moleculeFile->streamposRef().push_back(ifs.tellg());
-  while (ifs.good()) {
-    currentOBMol.Clear();
-    if (!conv.Read(&currentOBMol))
-      break;
-    if (!c)
-      firstOBMol = currentOBMol;
-
-    if (c > 20 && !m_moleculeFile->isConformerFile())
-      m_moleculeFile->setFirstReady(true);
+  if (!scanFile(conv)) {
+    // Now attempt to read the molecule in
+    ifstream ifs;
+    ifs.open(m_moleculeFile->m_fileName.toLocal8Bit(), std::ios::in | std::ios::binary); // This handles utf8 file names etc
+    if (!ifs) // Should not happen, already checked file could be opened
+      return;
 
-    // detect conformer/trajectory files
-    detectConformers(c, firstOBMol, currentOBMol);
-    // store information about molecule
+    // read all molecules
+    OpenBabel::OBMol firstOBMol, currentOBMol;
+    unsigned int c = 0;
+    conv.SetInStream(&ifs);
     m_moleculeFile->streamposRef().push_back(ifs.tellg());
-    m_moleculeFile->titlesRef().append(currentOBMol.GetTitle());
-    // increment count
-    ++c;
-  }
-  m_moleculeFile->streamposRef().pop_back();
-
-  if (!c) {
-    QString detailedError;
-    const std::vector<std::string> obErrors =
-        OpenBabel::obErrorLog.GetMessagesOfLevel(OpenBabel::obError);
-    if (!obErrors.empty()) {
-      QStringList errorList;
-      for (const std::string &msg : obErrors)
-        errorList << QString::fromStdString(msg);
-      detailedError = errorList.join(QStringLiteral("; "));
+    while (ifs.good()) {
+      currentOBMol.Clear();
+      if (!conv.Read(&currentOBMol))
+        break;
+      if (!c)
+        firstOBMol = currentOBMol;
+
+      if (c > 20 && !m_moleculeFile->isConformerFile())
+        m_moleculeFile->setFirstReady(true);
+
+      // detect conformer/trajectory files
+      detectConformers(c, firstOBMol, currentOBMol);
+      // store information about molecule
+      m_moleculeFile->streamposRef().push_back(ifs.tellg());
+      m_moleculeFile->titlesRef().append(currentOBMol.GetTitle());
+      // increment count
+      ++c;
+    }
+    m_moleculeFile->streamposRef().pop_back();
+
+    if (!c) {
+      QString detailedError;
+      const std::vector<std::string> obErrors =
+          OpenBabel::obErrorLog.GetMessagesOfLevel(OpenBabel::obError);
+      if (!obErrors.empty()) {
+        QStringList errorList;
+        for (const std::string &msg : obErrors)
+          errorList << QString::fromStdString(msg);
+        detailedError = errorList.join(QStringLiteral("; "));
+      }
+      if (detailedError.isEmpty())
+        detailedError = tr("No molecules were read from the file.");
+
+      m_moleculeFile->m_error.append(
+          QObject::tr("Reading a molecule from file '%1' failed: %2")
+              .arg(m_moleculeFile->m_fileName, detailedError));
+      QString diagnostics = MoleculeFile::openBabelDiagnostics();
+      if (!diagnostics.isEmpty())
+        m_moleculeFile->m_error.append(QObject::tr("\nOpenBabel diagnostics: %1").arg(diagnostics));
+      return;
     }
-    if (detailedError.isEmpty())
-      detailedError = tr("No molecules were read from the file.");
-
-    m_moleculeFile->m_error.append(
-        QObject::tr("Reading a molecule from file '%1' failed: %2")
-            .arg(m_moleculeFile->m_fileName, detailedError));
-    QString diagnostics = MoleculeFile::openBabelDiagnostics();
-    if (!diagnostics.isEmpty())
-      m_moleculeFile->m_error.append(QObject::tr("\nOpenBabel diagnostics: %1").arg(diagnostics));
-    return;
-  }
 
-  // single molecule files are not conformer files
-  if (c == 1) {
-    m_moleculeFile->setConformerFile(false);
-    m_moleculeFile->m_conformers.clear();
+    // single molecule files are not conformer files
+    if (c == 1) {
+      m_moleculeFile->setConformerFile(false);
+      m_moleculeFile->m_conformers.clear();
+    }
   }
 
   // check for empty titles
@@ -237,6 +357,175 @@ void ReadFileThread::run()
 
     m_moleculeFile->titlesRef()[i] = title;
   }
+
+  writeIndex();
+}
+
+bool ReadFileThread::scanFile(OBConversion &conv)
+{
+  RecordFormat format;
+  OpenBabel::OBFormat *inFormat = conv.GetInFormat();
+  if (inFormat == OBConversion::FindFormat("sdf"))
+    format = SdfRecords;
+  else if (inFormat == OBConversion::FindFormat("smi"))
+    format = SmilesRecords;
+  else if (inFormat == OBConversion::FindFormat("mol2"))
+    format = Mol2Records;
+  else
+    return false;
+
+  // Open Babel reads gzipped files transparently, the records of those can
+  // only be found by reading them in full
+  if (m_moleculeFile->m_fileName.endsWith(QLatin1String(".gz"),
+                                          Qt::CaseInsensitive))
+    return false;
+  QFile file(m_moleculeFile->m_fileName);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+  const QByteArray magic = file.peek(2);
+  if (magic.size() == 2 && static_cast<unsigned char>(magic[0]) == 0x1f
+      && static_cast<unsigned char>(magic[1]) == 0x8b)
+    return false;
+  const qint64 size = file.size();
+  const char *data = size ?
+        reinterpret_cast<const char *>(file.map(0, size)) : 0;
+  if (!data)
+    return false;
+
+  // Each chunk finds the records starting in it
+  int numChunks = static_cast<int>(qBound(qint64(1), size / SCAN_CHUNK_SIZE,
+                                          qint64(QThread::idealThreadCount())));
+  QList<QFuture<ScanResult> > futures;
+  for (int i = 0; i < numChunks; ++i) {
+    qint64 begin = size * i / numChunks;
+    qint64 end = size * (i + 1) / numChunks;
+    futures.append(QtConcurrent::run(scanChunk, format, data, size, begin,
+                                     end));
+  }
+
+  std::vector<std::streampos> &streampos = m_moleculeFile->streamposRef();
+  QStringList &titles = m_moleculeFile->titlesRef();
+  if (format == SdfRecords) {
+    // The first record has no delimiter before it
+    streampos.push_back(0);
+    titles.append(lineText(data, data + size));
+  }
+  for (int i = 0; i < numChunks; ++i) {
+    ScanResult result = futures[i].result();
+    streampos.insert(streampos.end(), result.offsets.begin(),
+                     result.offsets.end());
+    titles.append(result.titles);
+  }
+  // Whatever comes before the first molecule belongs to it
+  if (!streampos.empty())
+    streampos[0] = 0;
+
+  file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(data)));
+  file.close();
+
+  if (streampos.empty())
+    return false;
+  if (streampos.size() == 1)
+    return true;
+
+  // Read the same molecules as the full read to tell conformers apart,
+  // those need all their coordinates read
+  OBConversion probe(conv);
+  ifstream ifs;
+  ifs.open(m_moleculeFile->m_fileName.toLocal8Bit(), std::ios::in | std::ios::binary);
+  OpenBabel::OBMol firstOBMol, currentOBMol;
+  const unsigned int checks[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 20, 50 };
+  for (unsigned int i = 0; i < sizeof(checks) / sizeof(checks[0]); ++i) {
+    unsigned int c = checks[i];
+    if (c >= streampos.size())
+      break;
+    ifs.clear();
+    ifs.seekg(streampos[c]);
+    currentOBMol.Clear();
+    if (!ifs || !probe.Read(&currentOBMol, &ifs)) {
+      // The file does not look like expected
+      m_moleculeFile->setConformerFile(true);
+      break;
+    }
+    if (!c)
+      firstOBMol = currentOBMol;
+    detectConformers(c, firstOBMol, currentOBMol);
+    if (!m_moleculeFile->isConformerFile())
+      break;
+  }
+
+  if (m_moleculeFile->isConformerFile()) {
+    foreach (std::vector<Eigen::Vector3d> *conformer, m_moleculeFile->m_conformers)
+      delete conformer;
+    m_moleculeFile->m_conformers.clear();
+    m_moleculeFile->setConformerFile(false);
+    streampos.clear();
+    titles.clear();
+    return false;
+  }
+  return true;
+}
+
+bool ReadFileThread::readIndex()
+{
+  QFileInfo info(m_moleculeFile->m_fileName);
+  QFile file(indexFileName(m_moleculeFile));
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_0);
+  quint32 magic, version;
+  qint64 size, modified;
+  in >> magic >> version >> size >> modified;
+  if (magic != INDEX_MAGIC || version != INDEX_VERSION || size != info.size()
+      || modified != info.lastModified().toMSecsSinceEpoch())
+    return false;
+
+  quint32 count;
+  in >> count;
+  std::vector<std::streampos> streampos(count);
+  for (quint32 i = 0; i < count; ++i) {
+    qint64 offset;
+    in >> offset;
+    streampos[i] = offset;
+  }
+  QStringList titles;
+  in >> titles;
+  if (in.status() != QDataStream::Ok || titles.size() != static_cast<int>(count))
+    return false;
+
+  m_moleculeFile->streamposRef().swap(streampos);
+  m_moleculeFile->titlesRef() = titles;
+  m_moleculeFile->setConformerFile(false);
+  return true;
+}
+
+void ReadFileThread::writeIndex()
+{
+  // Conformers are not indexed, they need their coordinates read anyway
+  const std::vector<std::streampos> &streampos = m_moleculeFile->streamposRef();
+  QFileInfo info(m_moleculeFile->m_fileName);
+  if (m_moleculeFile->isConformerFile() || streampos.size() < 2
+      || info.size() < INDEX_MIN_FILE_SIZE)
+    return;
+
+  QString fileName = indexFileName(m_moleculeFile);
+  QDir().mkpath(QFileInfo(fileName).absolutePath());
+  QSaveFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly))
+    return;
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << INDEX_MAGIC << INDEX_VERSION << static_cast<qint64>(info.size())
+      << static_cast<qint64>(info.lastModified().toMSecsSinceEpoch());
+  out << static_cast<quint32>(streampos.size());
+  for (size_t i = 0; i < streampos.size(); ++i)
+    out << static_cast<qint64>(streampos[i]);
+  out << m_moleculeFile->titlesRef();
+  // The index is only a cache, e.g. the cache directory may be read-only
+  file.commit();
 }
 
 }
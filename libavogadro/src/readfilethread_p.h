@@ -27,6 +27,7 @@
 
 namespace OpenBabel {
 class OBMol;
+class OBConversion;
 }
 
 namespace Avogadro
@@ -48,6 +49,21 @@ public:
 
   void run();
 
+  /**
+   * Find the molecules by scanning for the record delimiters of SDF, SMILES
+   * and MOL2 files, without parsing them.
+   * @return False if the format has no known delimiter or the molecules
+   * could be conformers, then the file has to be read in full.
+   */
+  bool scanFile(OpenBabel::OBConversion &conv);
+
+  /**
+   * Read the offsets and titles saved by writeIndex() for this version of
+   * the file, if any.
+   */
+  bool readIndex();
+  void writeIndex();
+
   MoleculeFile *m_moleculeFile;
 };
 
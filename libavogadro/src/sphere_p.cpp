@@ -29,6 +29,9 @@
 #endif
 
 #include <QOpenGLWidget>
+#include <QOpenGLBuffer>
+
+#include <vector>
 
 using namespace Eigen;
 
@@ -37,7 +40,10 @@ namespace Avogadro {
   class SpherePrivate
   {
     public:
-      SpherePrivate() : vertexBuffer(0), indexBuffer(0), displayList(0), isValid(false) {}
+      SpherePrivate() : vertexBuffer(0), indexBuffer(0), displayList(0),
+        isValid(false), triangleIndexCount(0),
+        triangleVertexObject(QOpenGLBuffer::VertexBuffer),
+        triangleIndexObject(QOpenGLBuffer::IndexBuffer) {}
 
       /** Pointer to the buffer storing the vertex array */
       Eigen::Vector3f *vertexBuffer;
@@ -55,6 +61,15 @@ namespace Avogadro {
       int detail;
 
       bool isValid;
+
+      /** The vertices and triangles of the sphere, kept until they are
+       * uploaded to the buffer objects below */
+      std::vector<Eigen::Vector3f> triangleVertices;
+      std::vector<unsigned short> triangleIndices;
+      int triangleIndexCount;
+      /** Buffer objects used for instanced drawing, created on first use */
+      QOpenGLBuffer triangleVertexObject;
+      QOpenGLBuffer triangleIndexObject;
   };
 
   Sphere::Sphere(int detail) : d(new SpherePrivate)
@@ -100,6 +115,15 @@ namespace Avogadro {
     // deallocate any previously allocated buffer
     freeBuffers();
     d->isValid = false;
+
+    // the triangles used for instanced drawing must be uploaded again
+    d->triangleVertices.clear();
+    d->triangleIndices.clear();
+    d->triangleIndexCount = 0;
+    if( d->triangleVertexObject.isCreated() )
+      d->triangleVertexObject.destroy();
+    if( d->triangleIndexObject.isCreated() )
+      d->triangleIndexObject.destroy();
     int vertexCount = 0, indexCount = 0;
 
     if( d->detail == 0 )
@@ -132,6 +156,16 @@ namespace Avogadro {
       USE_OCTAHEDRON_VERTEX(1);
       glEnd();
       glEndList();
+
+      // the same two fans as separate triangles
+      const unsigned short octahedronTriangles[24] = { 0, 1, 2,  0, 2, 3,
+        0, 3, 4,  0, 4, 1,  5, 1, 4,  5, 4, 3,  5, 3, 2,  5, 2, 1 };
+      for( int i = 0; i < 6; i++ )
+        d->triangleVertices.push_back( Vector3f( octahedronVertices[i][0],
+              octahedronVertices[i][1], octahedronVertices[i][2] ) );
+      d->triangleIndices.assign( octahedronTriangles,
+          octahedronTriangles + 24 );
+
       d->isValid = true;
       return;
     }
@@ -203,10 +237,62 @@ namespace Avogadro {
     glEndList();
     glDisableClientState( GL_VERTEX_ARRAY );
     glDisableClientState( GL_NORMAL_ARRAY );
+
+    // split the triangle strip into separate triangles, skipping the
+    // degenerate triangles joining the columns. The winding alternates
+    // along the strip.
+    d->triangleVertices.assign( d->vertexBuffer, d->vertexBuffer + vertexCount );
+    for( int j = 0; j + 2 < indexCount; j++ )
+    {
+      unsigned short a = d->indexBuffer[j + (j & 1)];
+      unsigned short b = d->indexBuffer[j + 1 - (j & 1)];
+      unsigned short c = d->indexBuffer[j + 2];
+      if( a == b || b == c || a == c ) continue;
+      d->triangleIndices.push_back( a );
+      d->triangleIndices.push_back( b );
+      d->triangleIndices.push_back( c );
+    }
+
     freeBuffers();
     d->isValid = true;
   }
 
+  int Sphere::bindTriangles() const
+  {
+    if( ! d->isValid ) return 0;
+
+    if( ! d->triangleVertexObject.isCreated() )
+    {
+      if( d->triangleIndices.empty() ) return 0;
+      if( ! d->triangleVertexObject.create()
+          || ! d->triangleIndexObject.create() )
+      {
+        d->triangleVertexObject.destroy();
+        return 0;
+      }
+      d->triangleVertexObject.bind();
+      d->triangleVertexObject.allocate( &d->triangleVertices[0],
+          d->triangleVertices.size() * sizeof(Vector3f) );
+      d->triangleIndexObject.bind();
+      d->triangleIndexObject.allocate( &d->triangleIndices[0],
+          d->triangleIndices.size() * sizeof(unsigned short) );
+      d->triangleIndexCount = d->triangleIndices.size();
+      // the buffer objects now hold the only copy needed
+      std::vector<Vector3f>().swap( d->triangleVertices );
+      std::vector<unsigned short>().swap( d->triangleIndices );
+    }
+    else
+    {
+      d->triangleVertexObject.bind();
+      d->triangleIndexObject.bind();
+    }
+
+    // on the unit sphere the normals are the vertices
+    glVertexPointer( 3, GL_FLOAT, 0, 0 );
+    glNormalPointer( GL_FLOAT, 0, 0 );
+    return d->triangleIndexCount;
+  }
+
   unsigned short Sphere::indexOfVertex( int strip, int column, int row)
   {
     return ( row + ( 3 * d->detail + 1 ) * ( column + d->detail * strip ) );
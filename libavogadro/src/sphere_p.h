@@ -81,6 +81,14 @@ namespace Avogadro {
       /** draws the sphere at specified position and with
        * specified radius */
       void draw( const Eigen::Vector3d &center, double radius ) const;
+
+      /** binds buffer objects holding the triangles of the unit sphere,
+       * and sets them as the vertex, normal and element arrays. The
+       * indices are of type GL_UNSIGNED_SHORT. This is used to draw
+       * many spheres with a single instanced draw call.
+       * @return the number of indices, or 0 if buffer objects are not
+       * available */
+      int bindTriangles() const;
   };
 
 }
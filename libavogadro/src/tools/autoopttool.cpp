@@ -53,7 +53,7 @@ namespace Avogadro {
   AutoOptTool::AutoOptTool(QObject *parent) : Tool(parent), m_clickedAtom(0),
   m_leftButtonPressed(false), m_midButtonPressed(false), m_rightButtonPressed(false),
   m_running(false), m_block(false), m_setupFailed(false), m_timerId(0) ,m_toolGroup(0),
-  m_settingsWidget(0), m_thread(0), m_lastEnergy(0.0)
+  m_settingsWidget(0), m_thread(0), m_energy(0.0), m_lastEnergy(0.0)
   {
     QAction *action = activateAction();
     action->setIcon(QIcon(QString::fromUtf8(":/autoopttool/autoopttool.png")));
@@ -240,9 +240,7 @@ namespace Avogadro {
                                     tr("AutoOpt: Could not setup force field...."));
       }
       else {
-        double energy = m_forceField->Energy(false);
-        if (m_forceField->GetUnit().find("kcal") != string::npos)
-          energy *= KCAL_TO_KJ;
+        double energy = m_energy;
         widget->molecule()->setEnergy(energy);
         widget->painter()->drawText(labelPos,
             tr("AutoOpt: E = %1 %2 (dE = %3)").arg(energy).
@@ -366,7 +364,9 @@ namespace Avogadro {
       return;
 
     if(!m_running) {
-      connect(m_glwidget->molecule(), SIGNAL(destroyed()), this, SLOT(abort()));
+      Molecule *molecule = m_glwidget->molecule();
+      connect(molecule, SIGNAL(destroyed()), this, SLOT(abort()));
+      invalidateSetup();
       m_thread->setup(m_glwidget->molecule(), m_forceField,
                       m_comboAlgorithm->currentIndex(),
                       m_stepsSpinBox->value());
@@ -382,6 +382,12 @@ namespace Avogadro {
     }
   }
 
+  void AutoOptTool::invalidateSetup()
+  {
+    if (m_thread)
+      m_thread->invalidateSetup();
+  }
+
   void AutoOptTool::abort()
   {
     killTimer(m_timerId);
@@ -439,8 +445,15 @@ namespace Avogadro {
     if (m_running && calculated) {
       QList<Atom*> atoms = m_glwidget->molecule()->atoms();
 
-      OBMol mol = m_glwidget->molecule()->OBMol();
-      m_forceField->GetCoordinates( mol );
+      // The thread is idle until the next timer event
+      m_energy = m_thread->energy();
+      OBMol &mol = m_thread->optimizedMolecule();
+      // Atoms were added or removed during the update
+      if (mol.NumAtoms() != static_cast<unsigned int>(atoms.size())) {
+        m_glwidget->update();
+        m_block = false;
+        return;
+      }
       // forces
       if (mol.HasData(OBGenericDataType::ConformerData)) {
         OBConformerData *cd = (OBConformerData*) mol.GetData(OBGenericDataType::ConformerData);
@@ -492,12 +505,20 @@ namespace Avogadro {
     m_setupFailed = false;
   }
 
-  AutoOptThread::AutoOptThread(QObject*)
+  AutoOptThread::AutoOptThread(QObject*) : m_topologyVersion(0),
+    m_instance(0), m_instanceForceField(0), m_setupMolecule(0),
+    m_setupForceField(0), m_setupTopologyVersion(0), m_energy(0.0),
+    m_setupNeeded(1)
   {
     m_stop = false;
     m_velocities = false;
   }
 
+  AutoOptThread::~AutoOptThread()
+  {
+    delete m_instance;
+  }
+
   void AutoOptThread::setup(Molecule *molecule,
                             OpenBabel::OBForceField* forceField,
                             int algorithm, int steps)
@@ -509,10 +530,28 @@ namespace Avogadro {
     m_steps = steps;
     m_stop = false;
     m_velocities = false;
+
+    // Bond orders are also changed without any signal, e.g. by the draw tool
+    m_topologyVersion = molecule->topologyVersion();
+    QList<Atom *> atoms = molecule->atoms();
+    m_coordinates.resize(3 * atoms.size());
+    m_atomicNumbers.resize(atoms.size());
+    for (int i = 0; i < atoms.size(); ++i) {
+      const Vector3d *pos = atoms[i]->pos();
+      m_coordinates[3 * i] = pos->x();
+      m_coordinates[3 * i + 1] = pos->y();
+      m_coordinates[3 * i + 2] = pos->z();
+      m_atomicNumbers[i] = atoms[i]->atomicNumber();
+    }
     m_mutex.unlock();
     emit setupDone();
   }
 
+  void AutoOptThread::invalidateSetup()
+  {
+    m_setupNeeded.store(1);
+  }
+
 
   void AutoOptThread::run()
   {
@@ -529,56 +568,98 @@ namespace Avogadro {
 
     m_mutex.lock();
 
-    m_forceField->SetLogFile(NULL);
-    m_forceField->SetLogLevel(OBFF_LOGLVL_NONE);
-
-    OBMol mol = m_molecule->OBMol();
-
-    // Ignore all atoms with atomic # less than 1
-    foreach(const Atom *atom, m_molecule->atoms()) {
-      if (atom->atomicNumber() < 1)
-        m_forceField->GetConstraints().AddIgnore(atom->index() + 1);
+    if (m_forceField != m_instanceForceField) {
+      delete m_instance;
+      m_instance = m_forceField->MakeNewInstance();
+      m_instanceForceField = m_forceField;
     }
-
-    if (!m_forceField->Setup(mol)) {
+    if (!m_instance) {
+      m_instanceForceField = 0;
       m_stop = true;
       emit setupFailed();
       emit finished(false);
       m_mutex.unlock();
       return;
     }
-    else
-      emit setupSucces();
 
-    m_forceField->SetConformers(mol);
+    m_instance->SetLogFile(NULL);
+    m_instance->SetLogLevel(OBFF_LOGLVL_NONE);
+
+    // Changing an element does not change the topology version, so compare
+    // them too
+    bool setupNeeded = m_setupNeeded.fetchAndStoreOrdered(0)
+        || m_molecule != m_setupMolecule || m_forceField != m_setupForceField
+        || m_topologyVersion != m_setupTopologyVersion
+        || m_atomicNumbers != m_setupAtomicNumbers;
+
+    if (setupNeeded) {
+      m_setupForceField = 0;
+      m_mol = m_molecule->OBMol();
+
+      // Ignore all atoms with atomic # less than 1
+      for (size_t i = 0; i < m_atomicNumbers.size(); ++i) {
+        if (m_atomicNumbers[i] < 1)
+          m_instance->GetConstraints().AddIgnore(static_cast<int>(i) + 1);
+      }
+
+      if (m_mol.NumAtoms() != m_atomicNumbers.size()
+          || !m_instance->Setup(m_mol)) {
+        m_stop = true;
+        emit setupFailed();
+        emit finished(false);
+        m_mutex.unlock();
+        return;
+      }
+      else
+        emit setupSucces();
+
+      m_instance->SetConformers(m_mol);
+      m_setupMolecule = m_molecule;
+      m_setupForceField = m_forceField;
+      m_setupTopologyVersion = m_topologyVersion;
+      m_setupAtomicNumbers = m_atomicNumbers;
+    }
+    else {
+      // Same atoms and bonds, only hand over the new positions
+      for (unsigned int i = 0; i < m_mol.NumAtoms(); ++i)
+        m_mol.GetAtom(i + 1)->SetVector(m_coordinates[3 * i],
+                                        m_coordinates[3 * i + 1],
+                                        m_coordinates[3 * i + 2]);
+      m_instance->SetCoordinates(m_mol);
+    }
 
     switch(m_algorithm) {
       case AutoOptSteepestDescent:
-        m_forceField->SteepestDescent(m_steps);
+        m_instance->SteepestDescent(m_steps);
         break;
       case AutoOptConjugateGradients:
-        m_forceField->ConjugateGradients(m_steps);
+        m_instance->ConjugateGradients(m_steps);
         break;
       case AutoOptBFGS:
-        m_forceField->BFGSInitialize(m_steps, 1.0e-7);
-        m_forceField->BFGSTakeNSteps(m_steps);
+        m_instance->BFGSInitialize(m_steps, 1.0e-7);
+        m_instance->BFGSTakeNSteps(m_steps);
         break;
       case AutoOptLBFGS:
-        m_forceField->LBFGSInitialize(m_steps, 1.0e-7,
-                                      OBFF_ANALYTICAL_GRADIENT, 7);
-        m_forceField->LBFGSTakeNSteps(m_steps);
+        m_instance->LBFGSInitialize(m_steps, 1.0e-7,
+                                    OBFF_ANALYTICAL_GRADIENT, 7);
+        m_instance->LBFGSTakeNSteps(m_steps);
         break;
       case AutoOptMolecularDynamics300K:
-        m_forceField->MolecularDynamicsTakeNSteps(m_steps, 300, 0.001);
+        m_instance->MolecularDynamicsTakeNSteps(m_steps, 300, 0.001);
         break;
       case AutoOptMolecularDynamics600K:
-        m_forceField->MolecularDynamicsTakeNSteps(m_steps, 600, 0.001);
+        m_instance->MolecularDynamicsTakeNSteps(m_steps, 600, 0.001);
         break;
       case AutoOptMolecularDynamics900K:
-        m_forceField->MolecularDynamicsTakeNSteps(m_steps, 900, 0.001);
+        m_instance->MolecularDynamicsTakeNSteps(m_steps, 900, 0.001);
         break;
     }
 
+    m_instance->GetCoordinates(m_mol);
+    m_energy = m_instance->Energy(false);
+    if (m_instance->GetUnit().find("kcal") != string::npos)
+      m_energy *= KCAL_TO_KJ;
+
     m_mutex.unlock();
 
     emit finished(m_stop ? false : true);
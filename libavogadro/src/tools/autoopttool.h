@@ -32,6 +32,7 @@
 #include <openbabel/mol.h>
 #include <openbabel/forcefield.h>
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QMutex>
 #include <QtCore/QThread>
 #include <QtWidgets/QAction>
@@ -59,12 +60,36 @@ namespace Avogadro {
 
     public:
       AutoOptThread(QObject *parent=0);
+      ~AutoOptThread();
 
+      /**
+       * Called before each update(), this also takes the current atom
+       * positions, e.g. of the atoms dragged by the user.
+       */
       void setup(Molecule *molecule, OpenBabel::OBForceField* forceField,
                  int algorithm, /* int convergence, */ int steps);
 
       void run();
 
+      /**
+       * Set up the force field again on the next update(). Until then the
+       * atom types, charges and interactions found by the last setup are
+       * kept and only the coordinates are updated. Safe to call from any
+       * thread.
+       */
+      void invalidateSetup();
+
+      /**
+       * @return The molecule the force field was set up with, holding the
+       * coordinates and forces of the last update().
+       */
+      OpenBabel::OBMol &optimizedMolecule() { return m_mol; }
+
+      /**
+       * @return The energy after the last update(), in kJ/mol.
+       */
+      double energy() const { return m_energy; }
+
     public Q_SLOTS:
       void update();
       void stop();
@@ -85,6 +110,26 @@ namespace Avogadro {
       int m_steps;
       bool m_stop;
       QMutex m_mutex;
+
+      // Positions, elements and topology version taken by setup()
+      std::vector<double> m_coordinates;
+      std::vector<int> m_atomicNumbers;
+      unsigned int m_topologyVersion;
+
+      // Our own instance of m_forceField. FindForceField() returns one
+      // instance for the whole program, which other tools set up with their
+      // own molecules.
+      OpenBabel::OBForceField *m_instance;
+      OpenBabel::OBForceField *m_instanceForceField;
+
+      // What the force field was last set up with
+      OpenBabel::OBMol m_mol;
+      Molecule *m_setupMolecule;
+      OpenBabel::OBForceField *m_setupForceField;
+      unsigned int m_setupTopologyVersion;
+      double m_energy;
+      std::vector<int> m_setupAtomicNumbers;
+      QAtomicInt m_setupNeeded;
   };
 
   /**
@@ -144,6 +189,7 @@ namespace Avogadro {
       void enable();
       void disable();
       void abort();
+      void invalidateSetup();
 
     protected:
       GLWidget *                m_glwidget;
@@ -172,6 +218,7 @@ namespace Avogadro {
       QCheckBox*                m_ignoredMovable;
 
       QPoint                    m_lastDraggingPosition;
+      double                    m_energy;     // of the last finished update
       double                    m_lastEnergy;
 
       void timerEvent(QTimerEvent* event);
@@ -261,8 +261,8 @@ namespace Avogadro {
               // We really want the "connected fragment" since a Molecule can contain
               // multiple user-visible molecule fragments
               // we can use either BFS or DFS interators -- look for the connected fragment
-              OpenBabel::OBMol mol = molecule->OBMol();
-              OpenBabel::OBMolAtomDFSIter iter(mol, atom->index() + 1);
+              QSharedPointer<OpenBabel::OBMol> mol = molecule->OBMolSnapshot();
+              OpenBabel::OBMolAtomDFSIter iter(*mol, atom->index() + 1);
               Atom *tmpNeighbor;
               do {
                 tmpNeighbor = molecule->atom(iter->GetIdx() - 1);
@@ -287,8 +287,8 @@ namespace Avogadro {
               // We really want the "connected fragment" since a Molecule can contain
               // multiple user-visible molecule fragments
               // we can use either BFS or DFS interators -- look for the connected fragment
-              OpenBabel::OBMol mol = molecule->OBMol();
-              OpenBabel::OBMolAtomDFSIter iter(mol, molecule->atomById(bond->beginAtomId())->index() + 1);
+              QSharedPointer<OpenBabel::OBMol> mol = molecule->OBMolSnapshot();
+              OpenBabel::OBMolAtomDFSIter iter(*mol, molecule->atomById(bond->beginAtomId())->index() + 1);
               Atom *tmpNeighbor;
               do {
                 tmpNeighbor = molecule->atom(iter->GetIdx() - 1);
@@ -461,8 +461,8 @@ namespace Avogadro {
         // We really want the "connected fragment" since a Molecule can contain
         // multiple user-visible molecule fragments
         // we can use either BFS or DFS interators -- look for the connected fragment
-        OpenBabel::OBMol mol = molecule->OBMol();
-        OpenBabel::OBMolAtomDFSIter iter(mol, atom->index() + 1);
+        QSharedPointer<OpenBabel::OBMol> mol = molecule->OBMolSnapshot();
+        OpenBabel::OBMolAtomDFSIter iter(*mol, atom->index() + 1);
         Atom *tmpNeighbor;
         do {
           tmpNeighbor = molecule->atom(iter->GetIdx() - 1);
@@ -485,8 +485,8 @@ namespace Avogadro {
         // We really want the "connected fragment" since a Molecule can contain
         // multiple user-visible molecule fragments
         // we can use either BFS or DFS interators -- look for the connected fragment
-        OpenBabel::OBMol mol = molecule->OBMol();
-        OpenBabel::OBMolAtomDFSIter iter(mol, molecule->atomById(bond->beginAtomId())->index() + 1);
+        QSharedPointer<OpenBabel::OBMol> mol = molecule->OBMolSnapshot();
+        OpenBabel::OBMolAtomDFSIter iter(*mol, molecule->atomById(bond->beginAtomId())->index() + 1);
         Atom *tmpNeighbor;
         do {
           tmpNeighbor = molecule->atom(iter->GetIdx() - 1);
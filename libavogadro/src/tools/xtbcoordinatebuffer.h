@@ -0,0 +1,97 @@
+/**********************************************************************
+  XtbCoordinateBuffer - Triple buffer for the coordinates of the xTB tool
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef XTBCOORDINATEBUFFER_H
+#define XTBCOORDINATEBUFFER_H
+
+#include <QtCore/QAtomicInt>
+
+#include <vector>
+
+namespace Avogadro {
+
+  /**
+   * Passes the latest coordinates from the calculation thread to the GUI
+   * thread without locking. The thread fills the back buffer and publishes
+   * it, the GUI reads the front buffer. The third buffer holds the latest
+   * published coordinates until the GUI takes them, so neither side ever
+   * waits for the other and no step is copied more than once.
+   */
+  class XtbCoordinateBuffer
+  {
+    public:
+      XtbCoordinateBuffer() : m_back(0), m_middle(1), m_front(2) {}
+
+      /**
+       * Set all the buffers to @p coords, only while no thread uses them.
+       */
+      void reset(const std::vector<double> &coords)
+      {
+        for (int i = 0; i < 3; ++i)
+          m_buffers[i] = coords;
+        m_back = 0;
+        m_middle.storeRelease(1);
+        m_front = 2;
+      }
+
+      //! The buffer to fill by the calculation thread
+      std::vector<double>& back() { return m_buffers[m_back]; }
+
+      /**
+       * Make the back buffer the latest coordinates.
+       * @return True if the GUI had taken the previous coordinates, so it
+       * needs to be told about these. Otherwise it has not got round to the
+       * previous ones yet and will take these instead.
+       */
+      bool publish()
+      {
+        int previous = m_middle.fetchAndStoreOrdered(m_back | Dirty);
+        m_back = previous & ~Dirty;
+        return !(previous & Dirty);
+      }
+
+      /**
+       * Take the latest published coordinates into front(), in the GUI thread.
+       * @return False if nothing was published since the last call.
+       */
+      bool update()
+      {
+        if (!(m_middle.loadAcquire() & Dirty))
+          return false;
+        m_front = m_middle.fetchAndStoreOrdered(m_front) & ~Dirty;
+        return true;
+      }
+      const std::vector<double>& front() const { return m_buffers[m_front]; }
+
+    private:
+      enum { Dirty = 4 };
+      std::vector<double> m_buffers[3];
+      int m_back;
+      QAtomicInt m_middle;
+      int m_front;
+  };
+
+} // End namespace Avogadro
+
+#endif
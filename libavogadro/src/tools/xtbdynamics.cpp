@@ -0,0 +1,152 @@
+/**********************************************************************
+  XtbDynamics - Molecular dynamics integrator for the xTB tool
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "xtbdynamics.h"
+
+#include <openbabel/elements.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using Eigen::VectorXd;
+
+namespace Avogadro {
+
+  // Atomic units
+  const double AMU_TO_ME = 1822.888486;
+  const double FS_TO_AU = 41.341374575751;
+  const double BOLTZMANN = 3.166811563e-6; // hartree/K
+
+  // Coupling time of the thermostat, in femtoseconds
+  const double THERMOSTAT_TIME = 100.0;
+
+  XtbDynamics::XtbDynamics() : m_timeStep(0.5), m_targetTemperature(300.0),
+    m_started(false)
+  {
+  }
+
+  void XtbDynamics::setAtomicNumbers(const std::vector<int> &atomicNumbers)
+  {
+    m_masses.resize(3 * atomicNumbers.size());
+    for (size_t i = 0; i < atomicNumbers.size(); ++i) {
+      double mass = OpenBabel::OBElements::GetMass(atomicNumbers[i]);
+      // Dummy atoms get the mass of a hydrogen
+      if (mass <= 0.0)
+        mass = 1.0;
+      m_masses.segment<3>(3 * i).setConstant(mass * AMU_TO_ME);
+    }
+    reset();
+  }
+
+  void XtbDynamics::setTimeStep(double femtoseconds)
+  {
+    m_timeStep = femtoseconds;
+  }
+
+  void XtbDynamics::setTemperature(double kelvin)
+  {
+    m_targetTemperature = std::max(kelvin, 0.0);
+  }
+
+  void XtbDynamics::reset()
+  {
+    m_started = false;
+  }
+
+  void XtbDynamics::initializeVelocities()
+  {
+    // Maxwell-Boltzmann distribution without center of mass motion
+    std::mt19937 generator(std::random_device{}());
+    std::normal_distribution<double> normal(0.0, 1.0);
+    m_velocities.resize(m_masses.size());
+    for (int i = 0; i < m_masses.size(); ++i)
+      m_velocities[i] = normal(generator)
+          * std::sqrt(BOLTZMANN * m_targetTemperature / m_masses[i]);
+
+    Eigen::Vector3d momentum = Eigen::Vector3d::Zero();
+    double totalMass = 0.0;
+    for (int i = 0; i < m_masses.size(); i += 3) {
+      momentum += m_masses[i] * m_velocities.segment<3>(i);
+      totalMass += m_masses[i];
+    }
+    if (totalMass > 0.0) {
+      for (int i = 0; i < m_masses.size(); i += 3)
+        m_velocities.segment<3>(i) -= momentum / totalMass;
+    }
+
+    // Start exactly at the requested temperature
+    double current = temperature();
+    if (current > 0.0)
+      m_velocities *= std::sqrt(m_targetTemperature / current);
+  }
+
+  void XtbDynamics::step(VectorXd &coords, const VectorXd &gradient)
+  {
+    if (coords.size() != m_masses.size())
+      return;
+
+    const double dt = m_timeStep * FS_TO_AU;
+    VectorXd acceleration = -gradient.cwiseQuotient(m_masses);
+    if (!m_started) {
+      initializeVelocities();
+      m_started = true;
+    }
+    else {
+      // Second half kick of the previous step, with the new forces
+      m_velocities += 0.5 * dt * acceleration;
+    }
+
+    // Berendsen thermostat
+    double current = temperature();
+    if (current > 0.0) {
+      double lambda = std::sqrt(1.0 + m_timeStep / THERMOSTAT_TIME
+                                * (m_targetTemperature / current - 1.0));
+      m_velocities *= std::min(std::max(lambda, 0.8), 1.25);
+    }
+
+    // First half kick and drift
+    m_velocities += 0.5 * dt * acceleration;
+    coords += dt * m_velocities;
+  }
+
+  double XtbDynamics::kineticEnergy() const
+  {
+    if (m_velocities.size() != m_masses.size())
+      return 0.0;
+    return 0.5 * m_masses.dot(m_velocities.cwiseAbs2());
+  }
+
+  double XtbDynamics::temperature() const
+  {
+    // Three degrees of freedom are taken by the center of mass
+    int degrees = static_cast<int>(m_masses.size()) - 3;
+    if (degrees <= 0)
+      degrees = static_cast<int>(m_masses.size());
+    if (degrees <= 0)
+      return 0.0;
+    return 2.0 * kineticEnergy() / (degrees * BOLTZMANN);
+  }
+
+} // End namespace Avogadro
@@ -0,0 +1,97 @@
+/**********************************************************************
+  XtbDynamics - Molecular dynamics integrator for the xTB tool
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef XTBDYNAMICS_H
+#define XTBDYNAMICS_H
+
+#include <Eigen/Core>
+
+#include <vector>
+
+namespace Avogadro {
+
+  /**
+   * @class XtbDynamics
+   * @brief Velocity Verlet integration with a Berendsen thermostat.
+   *
+   * Like XtbOptimizer, the caller computes the gradient at the current
+   * coordinates and step() moves them one time step further, so each step
+   * costs one xtb_singlepoint() call.
+   *
+   * Coordinates are in bohr and gradients in hartree/bohr, as used by xtb.
+   * Time steps are given in femtoseconds and temperatures in kelvin.
+   */
+  class XtbDynamics
+  {
+    public:
+      XtbDynamics();
+
+      /**
+       * Set the masses from the atomic numbers, this also resets().
+       */
+      void setAtomicNumbers(const std::vector<int> &atomicNumbers);
+
+      void setTimeStep(double femtoseconds);
+      double timeStep() const { return m_timeStep; }
+
+      /**
+       * Set the temperature of the thermostat, the initial velocities are
+       * drawn for it too.
+       */
+      void setTemperature(double kelvin);
+      double targetTemperature() const { return m_targetTemperature; }
+
+      /**
+       * Draw new velocities on the next step.
+       */
+      void reset();
+
+      /**
+       * Move @p coords one time step, given the @p gradient there.
+       */
+      void step(Eigen::VectorXd &coords, const Eigen::VectorXd &gradient);
+
+      /**
+       * @return The kinetic energy in hartree.
+       */
+      double kineticEnergy() const;
+
+      /**
+       * @return The current temperature in kelvin.
+       */
+      double temperature() const;
+
+    private:
+      void initializeVelocities();
+
+      Eigen::VectorXd m_masses;       // per coordinate, in electron masses
+      Eigen::VectorXd m_velocities;
+      double m_timeStep;              // in femtoseconds
+      double m_targetTemperature;
+      bool m_started;
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -0,0 +1,261 @@
+/**********************************************************************
+  XtbOptimizer - Geometry optimizers for the xTB optimization tool
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "xtboptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using Eigen::VectorXd;
+
+namespace Avogadro {
+
+  // Largest displacement of an atom in one step, in bohr
+  const double MAX_STEP = 0.3;
+  // Number of steps kept by L-BFGS
+  const int LBFGS_HISTORY = 10;
+  // Inverse curvature used before L-BFGS has a history, in bohr^2/hartree
+  const double LBFGS_INITIAL_CURVATURE = 1.0;
+
+  // FIRE parameters from Bitzek et al., Phys. Rev. Lett. 97, 170201 (2006)
+  const double FIRE_DT = 0.25;
+  const double FIRE_DT_MAX = 1.0;
+  const int FIRE_N_MIN = 5;
+  const double FIRE_F_INC = 1.1;
+  const double FIRE_F_DEC = 0.5;
+  const double FIRE_ALPHA = 0.1;
+  const double FIRE_F_ALPHA = 0.99;
+
+  // Energy, gradient and displacement thresholds for each Level, the first
+  // two are those of xtb
+  const double LEVEL_THRESHOLDS[8][3] = {
+    { 5e-4, 1e-2, 2e-2 },  // Crude
+    { 1e-4, 6e-3, 1e-2 },  // Sloppy
+    { 5e-5, 4e-3, 6e-3 },  // Loose
+    { 2e-5, 2e-3, 4e-3 },  // Lax
+    { 5e-6, 1e-3, 2e-3 },  // Normal
+    { 1e-6, 8e-4, 1e-3 },  // Tight
+    { 1e-7, 2e-4, 4e-4 },  // VeryTight
+    { 5e-8, 5e-5, 1e-4 }   // Extreme
+  };
+
+  XtbOptimizer::XtbOptimizer() : m_engine(LBFGS)
+  {
+    setLevel(Normal);
+    reset();
+  }
+
+  void XtbOptimizer::setEngine(Engine engine)
+  {
+    if (engine == m_engine)
+      return;
+    m_engine = engine;
+    reset();
+  }
+
+  void XtbOptimizer::setLevel(Level level)
+  {
+    int i = std::min(std::max(static_cast<int>(level), 0), 7);
+    setThresholds(LEVEL_THRESHOLDS[i][0], LEVEL_THRESHOLDS[i][1],
+                  LEVEL_THRESHOLDS[i][2]);
+  }
+
+  void XtbOptimizer::setThresholds(double energy, double gradient,
+                                   double displacement)
+  {
+    m_energyThreshold = energy;
+    m_gradientThreshold = gradient;
+    m_displacementThreshold = displacement;
+  }
+
+  void XtbOptimizer::reset()
+  {
+    m_numSteps = 0;
+    m_hasPrevious = false;
+    m_previousEnergy = 0.0;
+    m_rejected = 0;
+    m_historySize = 0;
+    m_historyStart = 0;
+    m_velocity.resize(0);
+    m_dt = FIRE_DT;
+    m_mixing = FIRE_ALPHA;
+    m_downhillSteps = 0;
+  }
+
+  double XtbOptimizer::maxDisplacement(const VectorXd &step) const
+  {
+    double max2 = 0.0;
+    for (int i = 0; i + 2 < step.size(); i += 3)
+      max2 = std::max(max2, step.segment<3>(i).squaredNorm());
+    return std::sqrt(max2);
+  }
+
+  void XtbOptimizer::limitStep()
+  {
+    double max = maxDisplacement(m_step);
+    if (max > MAX_STEP)
+      m_step *= MAX_STEP / max;
+  }
+
+  bool XtbOptimizer::step(VectorXd &coords, double energy,
+                          const VectorXd &gradient)
+  {
+    if (m_hasPrevious && coords.size() != m_previousCoords.size())
+      reset();
+
+    if (m_hasPrevious) {
+      double deltaEnergy = energy - m_previousEnergy;
+      if (std::fabs(deltaEnergy) < m_energyThreshold
+          && gradient.norm() < m_gradientThreshold
+          && maxDisplacement(m_step) < m_displacementThreshold)
+        return true;
+
+      // L-BFGS takes no line search, go back half way when the energy
+      // went up instead
+      if (m_engine == LBFGS && deltaEnergy > 1e-10 && m_rejected < 5) {
+        ++m_rejected;
+        m_step *= 0.5;
+        coords = m_previousCoords + m_step;
+        ++m_numSteps;
+        return false;
+      }
+    }
+    m_rejected = 0;
+
+    switch (m_engine) {
+    case SteepestDescent:
+      steepestDescentStep(gradient);
+      break;
+    case LBFGS:
+      lbfgsStep(coords, gradient);
+      break;
+    case FIRE:
+      fireStep(gradient);
+      break;
+    }
+
+    m_hasPrevious = true;
+    m_previousEnergy = energy;
+    m_previousCoords = coords;
+    m_previousGradient = gradient;
+    coords += m_step;
+    ++m_numSteps;
+    return false;
+  }
+
+  void XtbOptimizer::steepestDescentStep(const VectorXd &gradient)
+  {
+    double step = 0.1;
+    double norm = gradient.norm();
+    if (norm > 1.0)
+      step /= norm;
+    m_step = -step * gradient;
+  }
+
+  void XtbOptimizer::lbfgsStep(const VectorXd &coords,
+                               const VectorXd &gradient)
+  {
+    // Add the last step to the history when it had positive curvature
+    if (m_hasPrevious) {
+      VectorXd s = coords - m_previousCoords;
+      VectorXd y = gradient - m_previousGradient;
+      double sy = s.dot(y);
+      if (sy > 1e-10) {
+        if (m_s.size() != static_cast<size_t>(LBFGS_HISTORY)) {
+          m_s.resize(LBFGS_HISTORY);
+          m_y.resize(LBFGS_HISTORY);
+          m_rho.resize(LBFGS_HISTORY);
+          m_alpha.resize(LBFGS_HISTORY);
+        }
+        int slot = (m_historyStart + m_historySize) % LBFGS_HISTORY;
+        if (m_historySize == LBFGS_HISTORY)
+          m_historyStart = (m_historyStart + 1) % LBFGS_HISTORY;
+        else
+          ++m_historySize;
+        m_s[slot] = s;
+        m_y[slot] = y;
+        m_rho[slot] = 1.0 / sy;
+      }
+    }
+
+    // Two loop recursion for the inverse Hessian times the gradient
+    VectorXd q = gradient;
+    for (int k = m_historySize - 1; k >= 0; --k) {
+      int i = (m_historyStart + k) % LBFGS_HISTORY;
+      m_alpha[i] = m_rho[i] * m_s[i].dot(q);
+      q -= m_alpha[i] * m_y[i];
+    }
+    double gamma = LBFGS_INITIAL_CURVATURE;
+    if (m_historySize) {
+      int last = (m_historyStart + m_historySize - 1) % LBFGS_HISTORY;
+      gamma = 1.0 / (m_rho[last] * m_y[last].squaredNorm());
+    }
+    q *= gamma;
+    for (int k = 0; k < m_historySize; ++k) {
+      int i = (m_historyStart + k) % LBFGS_HISTORY;
+      double beta = m_rho[i] * m_y[i].dot(q);
+      q += (m_alpha[i] - beta) * m_s[i];
+    }
+
+    m_step = -q;
+    // Not a descent direction, start over
+    if (m_step.dot(gradient) >= 0.0) {
+      m_historySize = 0;
+      m_step = -LBFGS_INITIAL_CURVATURE * gradient;
+    }
+    limitStep();
+  }
+
+  void XtbOptimizer::fireStep(const VectorXd &gradient)
+  {
+    VectorXd force = -gradient;
+    if (m_velocity.size() != force.size())
+      m_velocity = VectorXd::Zero(force.size());
+
+    double power = force.dot(m_velocity);
+    if (power > 0.0) {
+      // Going downhill, turn the velocity towards the force and speed up
+      double forceNorm = force.norm();
+      if (forceNorm > 0.0)
+        m_velocity = (1.0 - m_mixing) * m_velocity
+            + m_mixing * m_velocity.norm() / forceNorm * force;
+      if (++m_downhillSteps > FIRE_N_MIN) {
+        m_dt = std::min(m_dt * FIRE_F_INC, FIRE_DT_MAX);
+        m_mixing *= FIRE_F_ALPHA;
+      }
+    }
+    else {
+      // Went uphill, stop and slow down
+      m_velocity.setZero();
+      m_dt *= FIRE_F_DEC;
+      m_mixing = FIRE_ALPHA;
+      m_downhillSteps = 0;
+    }
+
+    m_velocity += m_dt * force;
+    m_step = m_dt * m_velocity;
+    limitStep();
+  }
+
+} // End namespace Avogadro
@@ -0,0 +1,145 @@
+/**********************************************************************
+  XtbOptimizer - Geometry optimizers for the xTB optimization tool
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef XTBOPTIMIZER_H
+#define XTBOPTIMIZER_H
+
+#include <Eigen/Core>
+
+#include <vector>
+
+namespace Avogadro {
+
+  /**
+   * @class XtbOptimizer
+   * @brief Minimizes an energy given its gradient, one step at a time.
+   *
+   * The caller computes the energy and gradient at the current coordinates,
+   * then step() moves the coordinates towards the minimum. This way each
+   * step costs exactly one xtb_singlepoint() call.
+   *
+   * Coordinates are in bohr, energies in hartree and gradients in
+   * hartree/bohr, as used by xtb.
+   */
+  class XtbOptimizer
+  {
+    public:
+      enum Engine {
+        SteepestDescent = 0,
+        LBFGS,
+        FIRE
+      };
+
+      /**
+       * The convergence levels of xtb, from Crude to Extreme.
+       */
+      enum Level {
+        Crude = 0,
+        Sloppy,
+        Loose,
+        Lax,
+        Normal,
+        Tight,
+        VeryTight,
+        Extreme
+      };
+
+      XtbOptimizer();
+
+      void setEngine(Engine engine);
+      Engine engine() const { return m_engine; }
+
+      /**
+       * Use the energy, gradient and displacement thresholds of @p level.
+       */
+      void setLevel(Level level);
+
+      /**
+       * Set the convergence thresholds: the energy change between steps,
+       * the norm of the gradient and the largest displacement of an atom.
+       */
+      void setThresholds(double energy, double gradient, double displacement);
+      double energyThreshold() const { return m_energyThreshold; }
+      double gradientThreshold() const { return m_gradientThreshold; }
+      double displacementThreshold() const { return m_displacementThreshold; }
+
+      /**
+       * Forget the history, for example when atoms were moved by hand.
+       */
+      void reset();
+
+      /**
+       * Take a step from @p coords, where the energy is @p energy and the
+       * gradient @p gradient. The coordinates are updated in place.
+       * @return True if the thresholds are met, then @p coords is left as it
+       * is.
+       */
+      bool step(Eigen::VectorXd &coords, double energy,
+                const Eigen::VectorXd &gradient);
+
+      /**
+       * @return The number of steps since the last reset().
+       */
+      int numSteps() const { return m_numSteps; }
+
+    private:
+      void steepestDescentStep(const Eigen::VectorXd &gradient);
+      void lbfgsStep(const Eigen::VectorXd &coords,
+                     const Eigen::VectorXd &gradient);
+      void fireStep(const Eigen::VectorXd &gradient);
+      void limitStep();
+      double maxDisplacement(const Eigen::VectorXd &step) const;
+
+      Engine m_engine;
+      double m_energyThreshold;
+      double m_gradientThreshold;
+      double m_displacementThreshold;
+      int m_numSteps;
+
+      // The last accepted point and the step taken from it
+      bool m_hasPrevious;
+      double m_previousEnergy;
+      Eigen::VectorXd m_previousCoords;
+      Eigen::VectorXd m_previousGradient;
+      Eigen::VectorXd m_step;
+      int m_rejected;
+
+      // L-BFGS history, used as a ring buffer
+      std::vector<Eigen::VectorXd> m_s;
+      std::vector<Eigen::VectorXd> m_y;
+      std::vector<double> m_rho;
+      std::vector<double> m_alpha;
+      int m_historySize;
+      int m_historyStart;
+
+      // FIRE state
+      Eigen::VectorXd m_velocity;
+      double m_dt;
+      double m_mixing;
+      int m_downhillSteps;
+  };
+
+} // End namespace Avogadro
+
+#endif
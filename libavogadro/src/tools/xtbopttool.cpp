@@ -14,6 +14,8 @@
 #include <Eigen/Core>
 #include <QtCore/QMutexLocker>
 
+#include <algorithm>
+
 #include <xtb.h>
 #ifdef _OPENMP
 #  include <omp.h>
@@ -26,18 +28,24 @@ XtbOptTool::XtbOptTool(QObject *parent)
     m_settingsWidget(nullptr), m_running(false),
     m_setupFailed(false), m_threadsSpinBox(nullptr),
     m_comboEngine(nullptr), m_comboLevel(nullptr), m_comboMethod(nullptr),
-    m_progressBar(nullptr), m_lastEnergy(0.0), m_deltaEnergy(0.0)
+    m_comboMode(nullptr), m_timeStepSpinBox(nullptr),
+    m_temperatureSpinBox(nullptr), m_recordCheckBox(nullptr),
+    m_progressBar(nullptr), m_lastEnergy(0.0), m_deltaEnergy(0.0),
+    m_temperature(0.0)
 {
   QAction *action = activateAction();
   action->setIcon(QIcon(QString::fromUtf8(":/xtbopttool/autoopttool.png")));
   action->setToolTip(tr("xTB Optimization Tool"));
 
   connect(m_thread, SIGNAL(finished(bool)), this, SLOT(finished(bool)));
+  connect(m_thread, SIGNAL(coordinatesPublished()),
+          this, SLOT(updateCoordinates()));
   connect(m_thread, SIGNAL(setupDone()), this, SLOT(setupDone()));
   connect(m_thread, SIGNAL(setupFailed()), this, SLOT(setupFailed()));
   connect(m_thread, SIGNAL(setupSucces()), this, SLOT(setupSucces()));
   connect(m_thread, SIGNAL(finished()), this, SLOT(threadFinished()));
   connect(m_thread, SIGNAL(progress(int,int,double)), this, SLOT(updateProgress(int,int,double)));
+  connect(m_thread, SIGNAL(temperatureChanged(double)), this, SLOT(updateTemperature(double)));
 }
 
 XtbOptTool::~XtbOptTool()
@@ -103,9 +111,10 @@ void XtbOptTool::translate(GLWidget *widget, const Eigen::Vector3d &what,
   Eigen::Vector3d toPos = widget->camera()->unProject(to, what);
   Eigen::Vector3d atomTranslation = toPos - fromPos;
   if (m_clickedAtom) {
-    QMutexLocker locker(&m_thread->mutex());
-    m_clickedAtom->setPos(atomTranslation + *m_clickedAtom->pos());
+    Eigen::Vector3d pos = atomTranslation + *m_clickedAtom->pos();
+    m_clickedAtom->setPos(pos);
     m_clickedAtom->update();
+    m_thread->moveAtom(static_cast<int>(m_clickedAtom->index()), pos);
   }
 }
 
@@ -116,6 +125,12 @@ bool XtbOptTool::paint(GLWidget *widget)
     glColor3f(1.0, 1.0, 1.0);
     if (m_setupFailed) {
       widget->painter()->drawText(QPoint(10, 20), tr("xTB setup failed"));
+    } else if (m_thread->dynamics()) {
+      const double factor = 2625.499748;
+      widget->painter()->drawText(QPoint(10, 20),
+                                  tr("xTB MD: T = %1 K, E = %2 kJ/mol")
+                                      .arg(m_temperature, 0, 'f', 0)
+                                      .arg(m_lastEnergy * factor));
     } else {
       const double factor = 2625.499748;
       double e = m_lastEnergy * factor;
@@ -144,8 +159,8 @@ QWidget* XtbOptTool::settingsWidget()
     m_comboEngine = new QComboBox(m_settingsWidget);
     m_comboEngine->addItem(tr("Gradient Descent"));
     m_comboEngine->addItem(tr("L-BFGS"));
-    m_comboEngine->addItem(tr("ANCopt"));
-    m_comboEngine->setCurrentIndex(2);
+    m_comboEngine->addItem(tr("FIRE"));
+    m_comboEngine->setCurrentIndex(1);
 
     QLabel *levelLabel = new QLabel(tr("Level:"));
     m_comboLevel = new QComboBox(m_settingsWidget);
@@ -167,6 +182,30 @@ QWidget* XtbOptTool::settingsWidget()
     m_comboMethod->addItem(tr("GFN-FF"));
     m_comboMethod->setCurrentIndex(2);
 
+    QLabel *modeLabel = new QLabel(tr("Mode:"));
+    m_comboMode = new QComboBox(m_settingsWidget);
+    m_comboMode->addItem(tr("Optimize"));
+    m_comboMode->addItem(tr("Molecular Dynamics"));
+    m_comboMode->setCurrentIndex(0);
+
+    QLabel *timeStepLabel = new QLabel(tr("Time Step:"));
+    m_timeStepSpinBox = new QDoubleSpinBox(m_settingsWidget);
+    m_timeStepSpinBox->setRange(0.1, 4.0);
+    m_timeStepSpinBox->setSingleStep(0.1);
+    m_timeStepSpinBox->setDecimals(1);
+    m_timeStepSpinBox->setSuffix(tr(" fs"));
+    m_timeStepSpinBox->setValue(0.5);
+
+    QLabel *temperatureLabel = new QLabel(tr("Temperature:"));
+    m_temperatureSpinBox = new QSpinBox(m_settingsWidget);
+    m_temperatureSpinBox->setRange(0, 5000);
+    m_temperatureSpinBox->setSingleStep(50);
+    m_temperatureSpinBox->setSuffix(tr(" K"));
+    m_temperatureSpinBox->setValue(300);
+
+    m_recordCheckBox = new QCheckBox(tr("Record Frames"), m_settingsWidget);
+    m_recordCheckBox->setToolTip(tr("Add the frames shown as conformers, to play them back with the animation extension"));
+
     QLabel *threadsLabel = new QLabel(tr("Threads:"));
     m_threadsSpinBox = new QSpinBox(m_settingsWidget);
     m_threadsSpinBox->setMinimum(1);
@@ -189,6 +228,13 @@ QWidget* XtbOptTool::settingsWidget()
     layout->addWidget(m_comboLevel);
     layout->addWidget(methodLabel);
     layout->addWidget(m_comboMethod);
+    layout->addWidget(modeLabel);
+    layout->addWidget(m_comboMode);
+    layout->addWidget(timeStepLabel);
+    layout->addWidget(m_timeStepSpinBox);
+    layout->addWidget(temperatureLabel);
+    layout->addWidget(m_temperatureSpinBox);
+    layout->addWidget(m_recordCheckBox);
     layout->addWidget(m_buttonStartStop);
     layout->addWidget(m_progressBar);
     layout->addStretch(1);
@@ -232,8 +278,11 @@ void XtbOptTool::enable()
 #endif
 
   int method = m_comboMethod ? m_comboMethod->currentIndex() : 2;
-  int engine = m_comboEngine ? m_comboEngine->currentIndex() : 2;
+  int engine = m_comboEngine ? m_comboEngine->currentIndex() : 1;
   int level = m_comboLevel ? m_comboLevel->currentIndex() : 4;
+  m_thread->setDynamics(m_comboMode && m_comboMode->currentIndex() == 1,
+                        m_timeStepSpinBox ? m_timeStepSpinBox->value() : 0.5,
+                        m_temperatureSpinBox ? m_temperatureSpinBox->value() : 300);
   if (!m_thread->setup(m_glwidget->molecule(), method, engine, level,
                         m_stepsSpinBox->value())) {
     m_setupFailed = true;
@@ -251,6 +300,7 @@ void XtbOptTool::enable()
   }
   m_lastEnergy = 0.0;
   m_deltaEnergy = 0.0;
+  m_temperature = 0.0;
 }
 
 void XtbOptTool::abort()
@@ -274,11 +324,17 @@ void XtbOptTool::disable()
 
 void XtbOptTool::finished(bool)
 {
-  if (m_glwidget && m_glwidget->molecule()) {
-    QMutexLocker locker(&m_thread->mutex());
+  updateCoordinates();
+}
+
+void XtbOptTool::updateCoordinates()
+{
+  // Show the latest step as soon as the thread published it
+  if (m_glwidget && m_glwidget->molecule() && m_thread->updateCoords()) {
+    Molecule *molecule = m_glwidget->molecule();
     const std::vector<double> &coords = m_thread->coords();
     int natoms = m_thread->natoms();
-    QList<Atom *> atoms = m_glwidget->molecule()->atoms();
+    QList<Atom *> atoms = molecule->atoms();
     if (atoms.size() >= natoms) {
       const double bohr2ang = 0.52917721092;
       for (int i = 0; i < natoms; ++i) {
@@ -287,8 +343,17 @@ void XtbOptTool::finished(bool)
         double z = coords[3 * i + 2] * bohr2ang;
         atoms[i]->setPos(Eigen::Vector3d(x, y, z));
       }
+
+      // Keep the frames for playback
+      if (m_recordCheckBox && m_recordCheckBox->isChecked()) {
+        std::vector<Eigen::Vector3d> frame(molecule->conformerSize(),
+                                           Eigen::Vector3d::Zero());
+        foreach (Atom *atom, atoms)
+          frame[atom->id()] = *atom->pos();
+        molecule->addConformer(frame, molecule->numConformers());
+      }
     }
-    m_glwidget->molecule()->update();
+    molecule->update();
     m_glwidget->update();
   }
 }
@@ -314,6 +379,11 @@ void XtbOptTool::setupSucces()
 
 void XtbOptTool::threadFinished()
 {
+  if (m_thread->converged()) {
+    const double factor = 2625.499748;
+    emit message(tr("xTB optimization converged: E = %1 kJ/mol")
+                 .arg(m_lastEnergy * factor));
+  }
   m_thread->cleanup();
   m_running = false;
   m_setupFailed = false;
@@ -329,6 +399,11 @@ void XtbOptTool::threadFinished()
     m_glwidget->update();
 }
 
+void XtbOptTool::updateTemperature(double temperature)
+{
+  m_temperature = temperature;
+}
+
 void XtbOptTool::updateProgress(int step, int total, double energy)
 {
   if (m_progressBar) {
@@ -343,7 +418,8 @@ void XtbOptTool::updateProgress(int step, int total, double energy)
 
 XtbOptThread::XtbOptThread(QObject *parent)
   : QThread(parent), m_molecule(nullptr), m_env(nullptr), m_xtbMol(nullptr),
-    m_calc(nullptr), m_results(nullptr), m_stop(false)
+    m_calc(nullptr), m_results(nullptr), m_stop(false), m_converged(false),
+    m_dynamics(false), m_moved(0)
 {
 }
 
@@ -389,6 +465,12 @@ bool XtbOptThread::setup(Molecule *mol, int method, int engine, int level,
   m_molecule = mol;
   m_steps = steps;
   m_stop = false;
+  m_moved.storeRelease(0);
+  m_moves.clear();
+  m_converged = false;
+  m_optimizer.setEngine(static_cast<XtbOptimizer::Engine>(engine));
+  m_optimizer.setLevel(static_cast<XtbOptimizer::Level>(level));
+  m_optimizer.reset();
 
   m_env = xtb_newEnvironment();
   if (!m_env) {
@@ -408,6 +490,10 @@ bool XtbOptThread::setup(Molecule *mol, int method, int engine, int level,
     m_coords[3*i+1] = p.y()*ang2bohr;
     m_coords[3*i+2] = p.z()*ang2bohr;
   }
+  m_positions = Eigen::Map<const Eigen::VectorXd>(m_coords.data(), m_coords.size());
+  m_buffer.reset(m_coords);
+  m_integrator.setAtomicNumbers(m_numbers);
+
   double charge = 0.0;
   int uhf = 0;
   double lattice[3][3] = {{0,0,0},{0,0,0},{0,0,0}};
@@ -446,67 +532,71 @@ bool XtbOptThread::setup(Molecule *mol, int method, int engine, int level,
   return true;
 }
 
+void XtbOptThread::setDynamics(bool enabled, double timeStep,
+                               double temperature)
+{
+  m_dynamics = enabled;
+  m_integrator.setTimeStep(timeStep);
+  m_integrator.setTemperature(temperature);
+}
+
 void XtbOptThread::run()
 {
-  while (!m_stop) {
+  while (!m_stop && !m_converged) {
     update();
   }
 }
 
 void XtbOptThread::update()
 {
-  int natoms;
-  {
-    QMutexLocker locker(&m_mutex);
-    if (!m_env || !m_xtbMol || !m_calc || !m_results || !m_molecule)
-      return;
-
-    natoms = m_numbers.size();
-    const double ang2bohr = 1.8897259886;
-    for (int i = 0; i < natoms; ++i) {
-      const Atom *a = m_molecule->atom(i);
-      Eigen::Vector3d p = *a->pos();
-      m_coords[3 * i] = p.x() * ang2bohr;
-      m_coords[3 * i + 1] = p.y() * ang2bohr;
-      m_coords[3 * i + 2] = p.z() * ang2bohr;
-    }
-  }
+  if (!m_env || !m_xtbMol || !m_calc || !m_results || !m_molecule)
+    return;
 
-  std::vector<double> localCoords;
-  {
-    QMutexLocker locker(&m_mutex);
-    localCoords = m_coords;
-  }
+  m_gradient.resize(m_positions.size());
 
   QElapsedTimer timer;
   timer.start();
   for (int s = 0; s < m_steps && !m_stop; ++s) {
-    double energy = 0.0;
+    // Continue from atoms dragged in the meantime
+    if (m_moved.loadAcquire()) {
+      QMutexLocker locker(&m_mutex);
+      for (int i = 0; i < m_moves.size(); ++i)
+        m_positions.segment<3>(3 * m_moves[i].first) = m_moves[i].second;
+      m_moves.clear();
+      m_moved.storeRelease(0);
+      m_optimizer.reset();
+      m_integrator.reset();
+    }
 
-    xtb_updateMolecule(m_env, m_xtbMol, localCoords.data(), NULL);
+    double energy = 0.0;
+    xtb_updateMolecule(m_env, m_xtbMol, m_positions.data(), NULL);
     xtb_singlepoint(m_env, m_xtbMol, m_calc, m_results);
     xtb_getEnergy(m_env, m_results, &energy);
+    xtb_getGradient(m_env, m_results, m_gradient.data());
 
-    std::vector<double> grad(natoms * 3);
-    xtb_getGradient(m_env, m_results, grad.data());
-
-    double gradNorm = 0.0;
-    for (int i = 0; i < natoms * 3; ++i)
-      gradNorm += grad[i] * grad[i];
-    gradNorm = std::sqrt(gradNorm);
-
-    double step = 0.1;
-    if (gradNorm > 1.0)
-      step /= gradNorm;
-    for (int i = 0; i < natoms * 3; ++i)
-      localCoords[i] -= step * grad[i];
-
-    {
-      QMutexLocker locker(&m_mutex);
-      m_coords = localCoords;
+    bool converged = false;
+    if (m_dynamics) {
+      m_integrator.step(m_positions, m_gradient);
+      // Report the total energy, which should be conserved
+      energy += m_integrator.kineticEnergy();
     }
+    else
+      converged = m_optimizer.step(m_positions, energy, m_gradient);
+
+    // Hand the new coordinates to the GUI
+    std::vector<double> &back = m_buffer.back();
+    std::copy(m_positions.data(), m_positions.data() + m_positions.size(),
+              back.begin());
+    if (m_buffer.publish())
+      emit coordinatesPublished();
 
     emit progress(s + 1, m_steps, energy);
+    if (m_dynamics)
+      emit temperatureChanged(m_integrator.temperature());
+    if (converged) {
+      m_converged = true;
+      break;
+    }
     if (timer.elapsed() >= 1000) {
       emit finished(true);
       timer.restart();
@@ -515,6 +605,16 @@ void XtbOptThread::update()
   emit finished(true);
 }
 
+void XtbOptThread::moveAtom(int index, const Eigen::Vector3d &pos)
+{
+  if (index < 0 || 3 * index + 2 >= static_cast<int>(m_coords.size()))
+    return;
+  const double ang2bohr = 1.8897259886;
+  QMutexLocker locker(&m_mutex);
+  m_moves.append(qMakePair(index, Eigen::Vector3d(pos * ang2bohr)));
+  m_moved.storeRelease(1);
+}
+
 void XtbOptThread::stop()
 {
   m_stop = true;
@@ -561,6 +661,14 @@ void XtbOptTool::writeSettings(QSettings &settings) const
     settings.setValue("level", m_comboLevel->currentIndex());
   if (m_comboMethod)
     settings.setValue("method", m_comboMethod->currentIndex());
+  if (m_comboMode)
+    settings.setValue("mode", m_comboMode->currentIndex());
+  if (m_timeStepSpinBox)
+    settings.setValue("timeStep", m_timeStepSpinBox->value());
+  if (m_temperatureSpinBox)
+    settings.setValue("temperature", m_temperatureSpinBox->value());
+  if (m_recordCheckBox)
+    settings.setValue("record", m_recordCheckBox->isChecked());
 }
 
 void XtbOptTool::readSettings(QSettings &settings)
@@ -571,11 +679,19 @@ void XtbOptTool::readSettings(QSettings &settings)
   if (m_threadsSpinBox)
     m_threadsSpinBox->setValue(settings.value("threads", 1).toInt());
   if (m_comboEngine)
-    m_comboEngine->setCurrentIndex(settings.value("engine", 2).toInt());
+    m_comboEngine->setCurrentIndex(settings.value("engine", 1).toInt());
   if (m_comboLevel)
     m_comboLevel->setCurrentIndex(settings.value("level", 4).toInt());
   if (m_comboMethod)
     m_comboMethod->setCurrentIndex(settings.value("method", 2).toInt());
+  if (m_comboMode)
+    m_comboMode->setCurrentIndex(settings.value("mode", 0).toInt());
+  if (m_timeStepSpinBox)
+    m_timeStepSpinBox->setValue(settings.value("timeStep", 0.5).toDouble());
+  if (m_temperatureSpinBox)
+    m_temperatureSpinBox->setValue(settings.value("temperature", 300).toInt());
+  if (m_recordCheckBox)
+    m_recordCheckBox->setChecked(settings.value("record", false).toBool());
 }
 
 } // namespace Avogadro
@@ -29,15 +29,23 @@
 #include <avogadro/tool.h>
 #include <avogadro/molecule.h>
 
+#include "xtboptimizer.h"
+#include "xtbdynamics.h"
+#include "xtbcoordinatebuffer.h"
+
 #include <xtb.h>
 #include <Eigen/Core>
 
 #include <QtCore/QMutex>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QPair>
 #include <QtCore/QThread>
 #include <QtCore/QSettings>
 #include <QtWidgets/QAction>
 #include <QtWidgets/QPushButton>
 #include <QtWidgets/QSpinBox>
+#include <QtWidgets/QDoubleSpinBox>
+#include <QtWidgets/QCheckBox>
 #include <QtWidgets/QComboBox>
 #include <QtWidgets/QUndoStack>
 #include <QtWidgets/QProgressBar>
@@ -54,19 +62,50 @@ namespace Avogadro {
 
       bool setup(Molecule *molecule, int method, int engine, int level, int steps);
 
+      /**
+       * Run molecular dynamics instead of optimizing, from the next setup().
+       * @param timeStep The time step in femtoseconds.
+       * @param temperature The thermostat temperature in kelvin.
+       */
+      void setDynamics(bool enabled, double timeStep, double temperature);
+      bool dynamics() const { return m_dynamics; }
+
       void run();
       void update();
-      const std::vector<double>& coords() const { return m_coords; }
+
+      /**
+       * Take the latest coordinates, in bohr, into coords(). Call from the
+       * GUI thread only.
+       * @return False if there are no new coordinates since the last call.
+       */
+      bool updateCoords() { return m_buffer.update(); }
+      const std::vector<double>& coords() const { return m_buffer.front(); }
       int natoms() const { return static_cast<int>(m_numbers.size()); }
-      QMutex& mutex() { return m_mutex; }
       void cleanup();
 
+      /**
+       * Move atom @p index to @p pos, in Angstrom, the optimizer continues
+       * from there.
+       */
+      void moveAtom(int index, const Eigen::Vector3d &pos);
+
+      /**
+       * @return True if the last run stopped because the geometry converged.
+       */
+      bool converged() const { return m_converged; }
+
     Q_SIGNALS:
       void finished(bool calculated);
       void setupDone();
       void setupFailed();
       void setupSucces();
+      /**
+       * New coordinates are ready for updateCoords(). Only emitted once
+       * the GUI took the previous ones, so the events do not pile up.
+       */
+      void coordinatesPublished();
       void progress(int step, int total, double energy);
+      void temperatureChanged(double temperature);
 
     public Q_SLOTS:
       void stop();
@@ -79,13 +118,22 @@ namespace Avogadro {
       xtb_TResults m_results;
       std::vector<int> m_numbers;
       std::vector<double> m_coords;
-      bool m_velocities;
       int m_method;
       int m_engine;
       int m_level;
-      //double m_convergence;
       int m_steps;
       bool m_stop;
+      bool m_converged;
+      bool m_dynamics;
+      XtbOptimizer m_optimizer;
+      XtbDynamics m_integrator;
+      Eigen::VectorXd m_positions;
+      Eigen::VectorXd m_gradient;
+      XtbCoordinateBuffer m_buffer;
+
+      // Atoms moved by the GUI, taken by the thread at the next step
+      QAtomicInt m_moved;
+      QList<QPair<int, Eigen::Vector3d> > m_moves;
       QMutex m_mutex;
   };
 
@@ -139,6 +187,7 @@ namespace Avogadro {
 
     public Q_SLOTS:
       void finished(bool calculated);
+      void updateCoordinates();
       void setupDone();
       void setupFailed();
       void setupSucces();
@@ -148,6 +197,7 @@ namespace Avogadro {
       void abort();
       void threadFinished();
       void updateProgress(int step, int total, double energy);
+      void updateTemperature(double temperature);
 
     protected:
       GLWidget *                m_glwidget;
@@ -163,11 +213,16 @@ namespace Avogadro {
       QComboBox*                m_comboEngine;
       QComboBox*                m_comboLevel;
       QComboBox*                m_comboMethod;
+      QComboBox*                m_comboMode;
+      QDoubleSpinBox*           m_timeStepSpinBox;
+      QSpinBox*                 m_temperatureSpinBox;
+      QCheckBox*                m_recordCheckBox;
       QProgressBar*             m_progressBar;
 
       QPoint                    m_lastDraggingPosition;
       double                    m_lastEnergy;
       double                    m_deltaEnergy;
+      double                    m_temperature;
 
 
       void translate(GLWidget *widget, const Eigen::Vector3d &what, const QPoint &from, const QPoint &to) const;
@@ -0,0 +1,377 @@
+/**********************************************************************
+  TrajectoryFile - Frame-indexed access to trajectory files
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "trajectoryfile.h"
+
+#include <QFile>
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QFuture>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDebug>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using Eigen::Vector3d;
+
+namespace Avogadro {
+
+  // Longest line parsed, longer lines are truncated
+  const int TRAJ_LINE_SIZE = 256;
+
+  namespace {
+    // @return the start of the line after the one starting at p
+    inline const char * nextLine(const char *p, const char *end)
+    {
+      const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+      return eol ? eol + 1 : end;
+    }
+
+    // @return the start of the line count lines after p, or end if there
+    // are fewer lines left, in which case complete is set to false
+    inline const char * skipLines(const char *p, const char *end, long count,
+                                  bool *complete = 0)
+    {
+      long i = 0;
+      for (; i < count && p < end; ++i)
+        p = nextLine(p, end);
+      if (complete)
+        *complete = i == count;
+      return p;
+    }
+
+    // Copy the line starting at p to buffer, as the mapped file is not null
+    // terminated
+    inline void copyLine(const char *p, const char *end, char *buffer)
+    {
+      int i = 0;
+      while (p < end && *p != '\n' && i < TRAJ_LINE_SIZE - 1)
+        buffer[i++] = *p++;
+      buffer[i] = '\0';
+    }
+
+    // Read the three coordinates at the end of the line in buffer, after
+    // skipping the first skip fields
+    inline bool readVector(const char *buffer, int skip, Vector3d &v)
+    {
+      const char *p = buffer;
+      for (int i = 0; i < skip; ++i) {
+        while (*p == ' ' || *p == '\t')
+          ++p;
+        while (*p && *p != ' ' && *p != '\t')
+          ++p;
+      }
+      for (int i = 0; i < 3; ++i) {
+        char *next;
+        v[i] = strtod(p, &next);
+        if (next == p)
+          return false;
+        p = next;
+      }
+      return true;
+    }
+  }
+
+  class TrajectoryFilePrivate
+  {
+    public:
+      TrajectoryFilePrivate() : data(0), size(0),
+        format(TrajectoryFile::XyzFormat), numAtoms(0),
+        error(TrajectoryFile::NoError)
+      {
+        cache.setMaxCost(256 * 1024);
+      }
+
+      bool indexXyz();
+      bool indexHistory();
+      bool parse(int index, std::vector<Vector3d> &coords) const;
+      void readFrames(std::vector<int> frames);
+      void insert(int index, const std::vector<Vector3d> &coords);
+
+      QFile file;
+      const char *data;
+      qint64 size;
+      TrajectoryFile::Format format;
+      unsigned int numAtoms;
+      TrajectoryFile::Error error;
+      // Offset of the first line of each frame
+      std::vector<qint64> offsets;
+
+      // Parsed frames, the cost is in kilobytes
+      QMutex mutex;
+      QCache<int, std::vector<Vector3d> > cache;
+      QFuture<void> future;
+  };
+
+  bool TrajectoryFilePrivate::indexXyz()
+  {
+    const char *end = data + size;
+    const char *p = data;
+    char buffer[TRAJ_LINE_SIZE];
+    while (p < end) {
+      copyLine(p, end, buffer);
+      char *next;
+      long count = strtol(buffer, &next, 10);
+      if (next == buffer) {
+        // Allow trailing blank lines
+        while (*next == ' ' || *next == '\t' || *next == '\r')
+          ++next;
+        if (*next == '\0') {
+          p = nextLine(p, end);
+          continue;
+        }
+        error = TrajectoryFile::FormatError;
+        return false;
+      }
+      if (count != static_cast<long>(numAtoms)) {
+        error = TrajectoryFile::AtomCountError;
+        return false;
+      }
+      const char *frame = p;
+      // The count line, the title and the atoms
+      bool complete;
+      p = skipLines(p, end, count + 2, &complete);
+      // Drop a truncated last frame
+      if (!complete)
+        break;
+      offsets.push_back(frame - data);
+    }
+    return true;
+  }
+
+  bool TrajectoryFilePrivate::indexHistory()
+  {
+    const char *end = data + size;
+    // The title, then "keytrj imcon natms"
+    const char *p = nextLine(data, end);
+    char buffer[TRAJ_LINE_SIZE];
+    copyLine(p, end, buffer);
+    int keytrj;
+    if (sscanf(buffer, "%d", &keytrj) != 1 || keytrj < 0 || keytrj > 2) {
+      error = TrajectoryFile::FormatError;
+      return false;
+    }
+    p = nextLine(p, end);
+
+    while (p < end) {
+      if (end - p < 8 || strncmp(p, "timestep", 8) != 0) {
+        // Not where the frame was expected, look for it line by line
+        p = nextLine(p, end);
+        continue;
+      }
+      copyLine(p, end, buffer);
+      long step, natms;
+      int key, imcon;
+      if (sscanf(buffer, "timestep %ld %ld %d %d", &step, &natms, &key,
+                 &imcon) != 4) {
+        error = TrajectoryFile::FormatError;
+        return false;
+      }
+      if (natms != static_cast<long>(numAtoms)) {
+        error = TrajectoryFile::AtomCountError;
+        return false;
+      }
+      const char *frame = p;
+      // The cell vectors, then per atom its label, position and maybe
+      // velocity and force
+      bool complete;
+      p = skipLines(p, end, 1 + (imcon > 0 ? 3 : 0) + natms * (2 + key),
+                    &complete);
+      if (!complete)
+        break;
+      offsets.push_back(frame - data);
+    }
+    return true;
+  }
+
+  bool TrajectoryFilePrivate::parse(int index, std::vector<Vector3d> &coords) const
+  {
+    const char *end = data + size;
+    const char *p = data + offsets[index];
+    char buffer[TRAJ_LINE_SIZE];
+    coords.resize(numAtoms);
+
+    if (format == TrajectoryFile::XyzFormat) {
+      p = skipLines(p, end, 2);
+      for (unsigned int i = 0; i < numAtoms; ++i) {
+        copyLine(p, end, buffer);
+        // Element symbol or atomic number, then the position
+        if (!readVector(buffer, 1, coords[i]))
+          return false;
+        p = nextLine(p, end);
+      }
+    }
+    else {
+      copyLine(p, end, buffer);
+      long step, natms;
+      int key, imcon;
+      if (sscanf(buffer, "timestep %ld %ld %d %d", &step, &natms, &key,
+                 &imcon) != 4)
+        return false;
+      p = skipLines(p, end, 1 + (imcon > 0 ? 3 : 0));
+      for (unsigned int i = 0; i < numAtoms; ++i) {
+        p = nextLine(p, end);
+        copyLine(p, end, buffer);
+        if (!readVector(buffer, 0, coords[i]))
+          return false;
+        p = skipLines(p, end, 1 + key);
+      }
+    }
+    return true;
+  }
+
+  void TrajectoryFilePrivate::insert(int index,
+                                     const std::vector<Vector3d> &coords)
+  {
+    int cost = static_cast<int>(coords.size() * sizeof(Vector3d) / 1024) + 1;
+    QMutexLocker locker(&mutex);
+    if (!cache.contains(index))
+      cache.insert(index, new std::vector<Vector3d>(coords), cost);
+  }
+
+  void TrajectoryFilePrivate::readFrames(std::vector<int> frames)
+  {
+    std::vector<Vector3d> coords;
+    for (unsigned int i = 0; i < frames.size(); ++i) {
+      if (parse(frames[i], coords))
+        insert(frames[i], coords);
+    }
+  }
+
+  TrajectoryFile::TrajectoryFile() : d(new TrajectoryFilePrivate)
+  {
+  }
+
+  TrajectoryFile::~TrajectoryFile()
+  {
+    // The read ahead uses the mapped file
+    d->future.waitForFinished();
+    delete d;
+  }
+
+  bool TrajectoryFile::open(const QString &fileName, Format format,
+                            unsigned int numAtoms)
+  {
+    d->future.waitForFinished();
+    d->cache.clear();
+    d->offsets.clear();
+    if (d->data) {
+      d->file.unmap(const_cast<uchar *>(
+                      reinterpret_cast<const uchar *>(d->data)));
+      d->data = 0;
+    }
+    d->file.close();
+
+    d->format = format;
+    d->numAtoms = numAtoms;
+    d->error = NoError;
+
+    d->file.setFileName(fileName);
+    if (!d->file.open(QIODevice::ReadOnly)) {
+      d->error = OpenError;
+      return false;
+    }
+    d->size = d->file.size();
+    if (d->size == 0) {
+      d->error = FormatError;
+      return false;
+    }
+    d->data = reinterpret_cast<const char *>(d->file.map(0, d->size));
+    if (!d->data) {
+      qDebug() << "Could not map" << fileName << d->file.errorString();
+      d->error = OpenError;
+      return false;
+    }
+
+    bool indexed = format == XyzFormat ? d->indexXyz() : d->indexHistory();
+    if (indexed && d->offsets.empty())
+      d->error = FormatError;
+    return d->error == NoError;
+  }
+
+  TrajectoryFile::Error TrajectoryFile::error() const
+  {
+    return d->error;
+  }
+
+  int TrajectoryFile::numFrames() const
+  {
+    return static_cast<int>(d->offsets.size());
+  }
+
+  unsigned int TrajectoryFile::numAtoms() const
+  {
+    return d->numAtoms;
+  }
+
+  bool TrajectoryFile::frame(int index, std::vector<Vector3d> &coords)
+  {
+    if (index < 0 || index >= numFrames())
+      return false;
+
+    {
+      QMutexLocker locker(&d->mutex);
+      const std::vector<Vector3d> *cached = d->cache.object(index);
+      if (cached) {
+        coords = *cached;
+        return true;
+      }
+    }
+
+    if (!d->parse(index, coords))
+      return false;
+    d->insert(index, coords);
+    return true;
+  }
+
+  void TrajectoryFile::readAhead(int index, int step, int count)
+  {
+    if (d->future.isRunning() || !step)
+      return;
+
+    std::vector<int> frames;
+    {
+      QMutexLocker locker(&d->mutex);
+      for (int i = 0; i < count; ++i, index += step) {
+        if (index < 0 || index >= numFrames())
+          break;
+        if (!d->cache.contains(index))
+          frames.push_back(index);
+      }
+    }
+    if (!frames.empty())
+      d->future = QtConcurrent::run(d, &TrajectoryFilePrivate::readFrames,
+                                    frames);
+  }
+
+  void TrajectoryFile::setCacheSize(int megabytes)
+  {
+    QMutexLocker locker(&d->mutex);
+    d->cache.setMaxCost(megabytes * 1024);
+  }
+
+} // End namespace Avogadro
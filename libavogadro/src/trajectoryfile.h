@@ -0,0 +1,123 @@
+/**********************************************************************
+  TrajectoryFile - Frame-indexed access to trajectory files
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef TRAJECTORYFILE_H
+#define TRAJECTORYFILE_H
+
+#include "config.h"
+
+#include <avogadro/global.h>
+
+#include <QString>
+
+#include <Eigen/Core>
+
+#include <vector>
+
+namespace Avogadro {
+
+  /**
+   * @class TrajectoryFile trajectoryfile.h <avogadro/trajectoryfile.h>
+   * @brief Reads the frames of a trajectory file on demand.
+   *
+   * The file is memory mapped and the start of each frame is found in a
+   * single pass when it is opened. Frames are only parsed when asked for and
+   * kept in a cache of bounded size, least recently used frames are dropped
+   * first. readAhead() parses the next frames in the background so that
+   * playing a trajectory with Animation does not wait for the disk.
+   *
+   * Memory use is therefore independent of the length of the trajectory.
+   *
+   * Supported formats are multi-frame XYZ files, as described at
+   * http://www.ks.uiuc.edu/Research/vmd/plugins/molfile/xyzplugin.html
+   * and DL_POLY HISTORY files.
+   */
+  class TrajectoryFilePrivate;
+  class A_EXPORT TrajectoryFile
+  {
+    public:
+      enum Format {
+        XyzFormat = 0,
+        HistoryFormat
+      };
+
+      enum Error {
+        NoError = 0,
+        OpenError,      //!< The file could not be opened or mapped
+        FormatError,    //!< The file could not be parsed
+        AtomCountError  //!< The frames do not have the expected atom count
+      };
+
+      TrajectoryFile();
+      ~TrajectoryFile();
+
+      /**
+       * Open and index the trajectory @p fileName.
+       * @param numAtoms The number of atoms each frame must have.
+       * @return True on success, otherwise error() tells what went wrong.
+       */
+      bool open(const QString &fileName, Format format,
+                unsigned int numAtoms);
+
+      /**
+       * @return The error of the last call to open().
+       */
+      Error error() const;
+
+      /**
+       * @return The number of frames in the trajectory.
+       */
+      int numFrames() const;
+
+      /**
+       * @return The number of atoms in each frame.
+       */
+      unsigned int numAtoms() const;
+
+      /**
+       * Get the coordinates of frame @p index, counting from 0, in the order
+       * of the atoms in the file.
+       * @return False if the frame could not be read.
+       */
+      bool frame(int index, std::vector<Eigen::Vector3d> &coords);
+
+      /**
+       * Parse @p count frames in the background, starting at frame @p index
+       * and going by @p step, unless they are already cached. Does nothing if
+       * the previous read ahead is still running.
+       */
+      void readAhead(int index, int step, int count);
+
+      /**
+       * Set the maximum size of the frame cache in megabytes, 256 by default.
+       */
+      void setCacheSize(int megabytes);
+
+    private:
+      TrajectoryFilePrivate * const d;
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -0,0 +1,184 @@
+/**********************************************************************
+  BondPerceiverTest - unit testing for the BondPerceiver class
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/bondperceiver.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+#include <Eigen/Core>
+
+using Avogadro::BondPerceiver;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+using Avogadro::Bond;
+
+using Eigen::Vector3d;
+
+class BondPerceiverTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    Atom * addAtom(Molecule &mol, int atomicNumber, const Vector3d &pos);
+
+  private slots:
+    /**
+     * Bonds are found from the covalent radii.
+     */
+    void perceive();
+
+    /**
+     * Only the bonds that changed are replaced.
+     */
+    void incremental();
+
+    /**
+     * Atoms do not get more bonds than their element allows.
+     */
+    void maxBonds();
+
+    /**
+     * Without the valence limit all close atoms are bonded, as in crystals.
+     */
+    void unlimited();
+};
+
+Atom * BondPerceiverTest::addAtom(Molecule &mol, int atomicNumber,
+                                  const Vector3d &pos)
+{
+  Atom *atom = mol.addAtom();
+  atom->setAtomicNumber(atomicNumber);
+  atom->setPos(pos);
+  return atom;
+}
+
+void BondPerceiverTest::perceive()
+{
+  // Water and a distant hydrogen molecule
+  Molecule mol;
+  Atom *o = addAtom(mol, 8, Vector3d(0.0, 0.0, 0.0));
+  Atom *h1 = addAtom(mol, 1, Vector3d(0.96, 0.0, 0.0));
+  Atom *h2 = addAtom(mol, 1, Vector3d(-0.24, 0.93, 0.0));
+  Atom *h3 = addAtom(mol, 1, Vector3d(10.0, 0.0, 0.0));
+  Atom *h4 = addAtom(mol, 1, Vector3d(10.74, 0.0, 0.0));
+
+  BondPerceiver perceiver;
+  QVERIFY(perceiver.update(&mol));
+  QCOMPARE(mol.numBonds(), 3u);
+  QVERIFY(mol.bond(o, h1));
+  QVERIFY(mol.bond(o, h2));
+  QVERIFY(mol.bond(h3, h4));
+  QVERIFY(!mol.bond(h1, h2));
+
+  // Nothing changed
+  QVERIFY(!perceiver.update(&mol));
+  QCOMPARE(mol.numBonds(), 3u);
+}
+
+void BondPerceiverTest::incremental()
+{
+  Molecule mol;
+  Atom *c1 = addAtom(mol, 6, Vector3d(0.0, 0.0, 0.0));
+  Atom *c2 = addAtom(mol, 6, Vector3d(1.54, 0.0, 0.0));
+  Atom *c3 = addAtom(mol, 6, Vector3d(5.0, 0.0, 0.0));
+
+  BondPerceiver perceiver;
+  perceiver.update(&mol);
+  QCOMPARE(mol.numBonds(), 1u);
+  Bond *kept = mol.bond(c1, c2);
+  QVERIFY(kept);
+  kept->setOrder(2);
+
+  QSignalSpy added(&mol, SIGNAL(bondAdded(Bond*)));
+  QSignalSpy removed(&mol, SIGNAL(bondRemoved(Bond*)));
+  QSignalSpy changed(&mol, SIGNAL(moleculeChanged()));
+
+  // Move c3 next to c2, the c1-c2 bond is kept as it was
+  c3->setPos(Vector3d(3.08, 0.0, 0.0));
+  QVERIFY(perceiver.update(&mol));
+  QCOMPARE(mol.numBonds(), 2u);
+  QCOMPARE(mol.bond(c1, c2), kept);
+  QCOMPARE(kept->order(), static_cast<short>(2));
+  QVERIFY(mol.bond(c2, c3));
+  QCOMPARE(added.count(), 1);
+  QCOMPARE(removed.count(), 0);
+  QCOMPARE(changed.count(), 1);
+
+  // Break the c1-c2 bond
+  c1->setPos(Vector3d(-5.0, 0.0, 0.0));
+  QVERIFY(perceiver.update(&mol));
+  QCOMPARE(mol.numBonds(), 1u);
+  QVERIFY(!mol.bond(c1, c2));
+  QCOMPARE(removed.count(), 1);
+  QCOMPARE(changed.count(), 2);
+}
+
+void BondPerceiverTest::maxBonds()
+{
+  // A hydrogen between two others only keeps its shortest bond
+  Molecule mol;
+  Atom *h1 = addAtom(mol, 1, Vector3d(0.0, 0.0, 0.0));
+  Atom *h2 = addAtom(mol, 1, Vector3d(0.70, 0.0, 0.0));
+  Atom *h3 = addAtom(mol, 1, Vector3d(1.50, 0.0, 0.0));
+
+  BondPerceiver perceiver;
+  perceiver.update(&mol);
+  QCOMPARE(mol.numBonds(), 1u);
+  QVERIFY(mol.bond(h1, h2));
+  QVERIFY(!mol.bond(h2, h3));
+}
+
+void BondPerceiverTest::unlimited()
+{
+  // A sodium with its six chlorine neighbors in rock salt
+  Molecule mol;
+  addAtom(mol, 11, Vector3d(0.0, 0.0, 0.0));
+  for (int k = 0; k < 3; ++k) {
+    Vector3d offset = Vector3d::Zero();
+    offset[k] = 2.82;
+    addAtom(mol, 17, offset);
+    addAtom(mol, 17, -offset);
+  }
+
+  BondPerceiver perceiver;
+  perceiver.update(&mol);
+  QCOMPARE(mol.numBonds(), 1u);
+
+  perceiver.setValenceLimited(false);
+  QVERIFY(perceiver.update(&mol));
+  QCOMPARE(mol.numBonds(), 6u);
+
+  // As the crystallography extension caps them, these are no bonds
+  perceiver.setMaxDistance(2.5);
+  QVERIFY(perceiver.update(&mol));
+  QCOMPARE(mol.numBonds(), 0u);
+}
+
+QTEST_MAIN(BondPerceiverTest)
+
+#include "moc_bondperceivertest.cpp"
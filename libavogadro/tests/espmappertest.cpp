@@ -0,0 +1,167 @@
+/**********************************************************************
+  ESPMapperTest - Unit tests for the electrostatic potential mapper
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/mesh.h>
+
+#include "../src/extensions/surfaces/espmapper.h"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using Avogadro::Molecule;
+using Avogadro::Atom;
+using Avogadro::Mesh;
+using Avogadro::ESPMapper;
+
+using Eigen::Vector3d;
+using Eigen::Vector3f;
+
+namespace {
+  // As in SurfaceExtension, potentials beyond it get the full color
+  const double ESP_SATURATION = 0.1;
+  const int NUM_RESIDUES = 200;
+  const unsigned int NUM_VERTICES = 1000;
+
+  // Same sequence on every platform, unlike the std distributions
+  class Random
+  {
+    public:
+      Random() : m_state(12345) {}
+
+      double uniform()
+      {
+        m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<double>(m_state >> 11) / 9007199254740992.0;
+      }
+
+      Vector3d direction()
+      {
+        Vector3d d;
+        do {
+          d = Vector3d(2.0 * uniform() - 1.0, 2.0 * uniform() - 1.0,
+                       2.0 * uniform() - 1.0);
+        } while (d.squaredNorm() > 1.0 || d.squaredNorm() < 1.0e-4);
+        return d.normalized();
+      }
+
+    private:
+      unsigned long long m_state;
+  };
+}
+
+class ESPMapperTest : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void protein();
+};
+
+void ESPMapperTest::protein()
+{
+  // A neutral globule of residues with backbone dipoles, polar side chains
+  // and charged groups, packed about as densely as in a protein
+  const double BACKBONE[6] = { -0.47, 0.31, 0.07, 0.09, 0.51, -0.51 };
+  const double radius = std::pow(NUM_RESIDUES * 130.0 * 3.0 / (4.0 * M_PI),
+                                 1.0 / 3.0);
+  Random random;
+  std::vector<Vector3d> positions;
+  std::vector<double> charges;
+  Vector3d residue = Vector3d::Zero();
+  for (int r = 0; r < NUM_RESIDUES; ++r) {
+    Vector3d next;
+    do {
+      next = residue + 3.8 * random.direction();
+    } while (next.norm() > radius);
+    residue = next;
+    for (int i = 0; i < 6; ++i) {
+      positions.push_back(residue
+                          + (1.0 + 0.5 * random.uniform()) * random.direction());
+      charges.push_back(BACKBONE[i]);
+    }
+    Vector3d side = residue + 2.5 * random.direction();
+    positions.push_back(side);
+    charges.push_back(-0.4);
+    positions.push_back(side + random.direction());
+    charges.push_back(0.4);
+    if (r % 4 == 0) {
+      positions.push_back(side + 1.5 * random.direction());
+      charges.push_back(r % 8 ? -1.0 : 1.0);
+    }
+  }
+
+  Molecule mol;
+  for (unsigned int i = 0; i < positions.size(); ++i) {
+    Atom *atom = mol.addAtom();
+    atom->setAtomicNumber(6);
+    atom->setPos(positions[i]);
+  }
+  // Replace the calculated charges
+  mol.calculatePartialCharges();
+  for (unsigned int i = 0; i < charges.size(); ++i)
+    mol.atom(i)->setPartialCharge(charges[i]);
+
+  // Vertices about where a molecular surface would be
+  std::vector<Vector3f> vertices;
+  while (vertices.size() < NUM_VERTICES) {
+    Vector3d point = (radius + 3.0) * std::pow(random.uniform(), 1.0 / 3.0)
+        * random.direction();
+    double distance2 = HUGE_VAL;
+    for (unsigned int i = 0; i < positions.size(); ++i)
+      distance2 = std::min(distance2, (positions[i] - point).squaredNorm());
+    if (distance2 > 1.4 * 1.4 && distance2 < 2.0 * 2.0)
+      vertices.push_back(point.cast<float>());
+  }
+  Mesh *mesh = mol.addMesh();
+  QVERIFY(mesh->setVertices(vertices));
+
+  ESPMapper mapper;
+  mapper.setCharges(&mol);
+  const std::vector<double> &potentials = mapper.calculate(mesh);
+  QCOMPARE(potentials.size(), vertices.size());
+
+  // Well below the potentials that change the colors visibly
+  double maxError = 0.0;
+  for (unsigned int v = 0; v < vertices.size(); ++v) {
+    Vector3d point = vertices[v].cast<double>();
+    double exact = 0.0;
+    for (unsigned int i = 0; i < positions.size(); ++i)
+      exact += charges[i] / (positions[i] - point).norm();
+    maxError = std::max(maxError, std::fabs(potentials[v] - exact));
+  }
+  QVERIFY2(maxError < 0.03 * ESP_SATURATION,
+           qPrintable(QString("Largest error %1 e/A").arg(maxError)));
+}
+
+QTEST_MAIN(ESPMapperTest)
+
+#include "moc_espmappertest.cpp"
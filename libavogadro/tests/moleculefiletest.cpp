@@ -347,6 +347,49 @@ void MoleculeFileTest::appendMolecule()
   QVERIFY( moleculeFile->errors().isEmpty() );
   QCOMPARE( moleculeFile->isConformerFile(), false );
   QCOMPARE( moleculeFile->numMolecules(), static_cast<unsigned int>(3) );
+
+  // append a copy of the 2nd
+  Molecule *aniline = moleculeFile->molecule(1);
+  QVERIFY( moleculeFile->appendMolecule(aniline, filename) );
+  QCOMPARE( moleculeFile->numMolecules(), static_cast<unsigned int>(4) );
+
+  // insert it in front too
+  QVERIFY( moleculeFile->insertMolecule(0, aniline, filename) );
+  QCOMPARE( moleculeFile->numMolecules(), static_cast<unsigned int>(5) );
+  delete aniline;
+
+  // replace the phenyl and the toluene in one pass
+  Molecule *phenyl = moleculeFile->molecule(1);
+  phenyl->addAtom();
+  Molecule *toluene = moleculeFile->molecule(3);
+  toluene->addAtom();
+  toluene->addAtom();
+  QMap<unsigned int, Molecule *> molecules;
+  molecules.insert(1, phenyl);
+  molecules.insert(3, toluene);
+  QVERIFY( moleculeFile->replaceMolecules(molecules, filename) );
+  delete phenyl;
+  delete toluene;
+
+  // check all of them, also from a new read of the file
+  for (int pass = 0; pass < 2; ++pass) {
+    QCOMPARE( moleculeFile->numMolecules(), static_cast<unsigned int>(5) );
+    const unsigned int numAtoms[5] = { 7, 7, 7, 9, 7 };
+    for (unsigned int i = 0; i < 5; ++i) {
+      Molecule *mol = moleculeFile->molecule(i);
+      QVERIFY( mol );
+      QCOMPARE( mol->numAtoms(), numAtoms[i] );
+      delete mol;
+    }
+    Molecule *last = moleculeFile->molecule(4);
+    QCOMPARE( last->atom(6)->atomicNumber(), 7 );
+    delete last;
+
+    delete moleculeFile;
+    moleculeFile = MoleculeFile::readFile(filename.toLatin1().data());
+    QVERIFY( moleculeFile );
+  }
+  delete moleculeFile;
 }
 
 QTEST_MAIN(MoleculeFileTest)
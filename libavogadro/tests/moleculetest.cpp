@@ -29,6 +29,10 @@
 #include <avogadro/atom.h>
 #include <avogadro/bond.h>
 
+#include <openbabel/mol.h>
+#include <openbabel/atom.h>
+#include <openbabel/bond.h>
+
 #include <Eigen/Core>
 
 using Avogadro::Molecule;
@@ -144,6 +148,16 @@ private slots:
    * Tests conformer support.
    */ 
   void conformers();
+
+  /**
+   * Tests removing and adding atoms and bonds in a batch edit.
+   */
+  void batchEdit();
+
+  /**
+   * Tests the shared OBMol is only rebuilt when the topology changed.
+   */
+  void obmolSnapshot();
 };
 
 void MoleculeTest::prepareMolecule()
@@ -388,6 +402,114 @@ void MoleculeTest::conformers()
 
 }
 
+void MoleculeTest::batchEdit()
+{
+  Molecule mol;
+  for (int i = 0; i < 6; ++i)
+    mol.addAtom();
+  for (unsigned long i = 0; i < 5; ++i)
+    mol.addBond(i, i + 1);
+
+  QSignalSpy atomsRemoved(&mol, SIGNAL(atomRemoved(Atom*)));
+  QSignalSpy atomsAdded(&mol, SIGNAL(atomAdded(Atom*)));
+  QSignalSpy bondsRemoved(&mol, SIGNAL(bondRemoved(Bond*)));
+  QSignalSpy changed(&mol, SIGNAL(moleculeChanged()));
+
+  mol.beginEdit();
+  mol.removeAtom(1ul);
+  mol.removeAtom(4ul);
+  // An atom both added and removed in the batch is never signalled
+  Atom *a = mol.addAtom();
+  mol.removeAtom(a);
+  a = mol.addAtom();
+  QCOMPARE(atomsRemoved.count(), 0);
+  QCOMPARE(bondsRemoved.count(), 0);
+  mol.endEdit();
+
+  QCOMPARE(atomsRemoved.count(), 2);
+  QCOMPARE(atomsAdded.count(), 1);
+  QCOMPARE(bondsRemoved.count(), 4);
+  QCOMPARE(changed.count(), 1);
+
+  // The atoms and bonds left are renumbered in order
+  QCOMPARE(mol.numAtoms(), 5u);
+  QCOMPARE(mol.numBonds(), 1u);
+  QCOMPARE(mol.atom(0)->id(), 0ul);
+  QCOMPARE(mol.atom(1)->id(), 2ul);
+  QCOMPARE(mol.atom(2)->id(), 3ul);
+  QCOMPARE(mol.atom(3)->id(), 5ul);
+  QCOMPARE(mol.atom(4), a);
+  for (unsigned int i = 0; i < mol.numAtoms(); ++i)
+    QCOMPARE(mol.atom(i)->index(), static_cast<unsigned long>(i));
+  QCOMPARE(mol.bond(0)->index(), 0ul);
+
+  // Bond lookup works from either end
+  QVERIFY(mol.bond(2ul, 3ul) == mol.bond(0));
+  QVERIFY(mol.bond(3ul, 2ul) == mol.bond(0));
+  QVERIFY(mol.bond(0ul, 2ul) == 0);
+}
+
+void MoleculeTest::obmolSnapshot()
+{
+  Molecule mol;
+  Atom *a1 = mol.addAtom();
+  a1->setAtomicNumber(6);
+  Atom *a2 = mol.addAtom();
+  a2->setAtomicNumber(8);
+  a2->setPos(Vector3d(1.2, 0.0, 0.0));
+  Bond *bond = mol.addBond(a1->id(), a2->id(), 2);
+
+  QSharedPointer<OpenBabel::OBMol> snapshot = mol.OBMolSnapshot();
+  QCOMPARE(snapshot->NumAtoms(), 2u);
+  QCOMPARE(snapshot->NumBonds(), 1u);
+  QVERIFY(mol.OBMolSnapshot() == snapshot);
+
+  // Moving an atom only copies the coordinates
+  unsigned int topology = mol.topologyVersion();
+  unsigned int geometry = mol.geometryVersion();
+  a2->setPos(Vector3d(1.3, 0.0, 0.0));
+  QCOMPARE(mol.topologyVersion(), topology);
+  QVERIFY(mol.geometryVersion() != geometry);
+  QVERIFY(mol.OBMolSnapshot() == snapshot);
+  QCOMPARE(snapshot->GetAtom(2)->x(), 1.3);
+
+  // Adding an atom makes a new one, the old one is left as it was
+  Atom *a3 = mol.addAtom();
+  a3->setAtomicNumber(1);
+  QVERIFY(mol.topologyVersion() != topology);
+  QSharedPointer<OpenBabel::OBMol> rebuilt = mol.OBMolSnapshot();
+  QVERIFY(rebuilt != snapshot);
+  QCOMPARE(rebuilt->NumAtoms(), 3u);
+  QCOMPARE(snapshot->NumAtoms(), 2u);
+
+  // So does changing an element
+  a3->setAtomicNumber(9);
+  QCOMPARE(mol.OBMolSnapshot()->GetAtom(3)->GetAtomicNum(), 9u);
+
+  // Setting a formal charge, e.g. from the properties table, emits nothing
+  // but still gives a new snapshot
+  rebuilt = mol.OBMolSnapshot();
+  a3->setFormalCharge(-1);
+  QSharedPointer<OpenBabel::OBMol> charged = mol.OBMolSnapshot();
+  QVERIFY(charged != rebuilt);
+  QCOMPARE(charged->GetAtom(3)->GetFormalCharge(), -1);
+  QCOMPARE(rebuilt->GetAtom(3)->GetFormalCharge(), 0);
+
+  // And so does setting a partial charge
+  a1->setPartialCharge(0.25);
+  QCOMPARE(mol.OBMolSnapshot()->GetAtom(1)->GetPartialCharge(), 0.25);
+
+  // Bond orders are set without a signal too, e.g. by the draw tool
+  QSharedPointer<OpenBabel::OBMol> before = mol.OBMolSnapshot();
+  topology = mol.topologyVersion();
+  bond->setOrder(1);
+  QVERIFY(mol.topologyVersion() != topology);
+  QSharedPointer<OpenBabel::OBMol> after = mol.OBMolSnapshot();
+  QVERIFY(after != before);
+  QCOMPARE(after->GetBond(0)->GetBondOrder(), 1u);
+  QCOMPARE(before->GetBond(0)->GetBondOrder(), 2u);
+}
+
 QTEST_MAIN(MoleculeTest)
 
 #include "moc_moleculetest.cpp"
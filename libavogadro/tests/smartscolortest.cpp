@@ -0,0 +1,89 @@
+/**********************************************************************
+  SmartsColorTest - Unit tests for coloring by SMARTS pattern
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+#include "../src/colors/smartscolor.h"
+
+#include <Eigen/Core>
+
+using Avogadro::Molecule;
+using Avogadro::Atom;
+using Avogadro::Bond;
+using Avogadro::SmartsColor;
+
+using Eigen::Vector3d;
+
+class SmartsColorTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  static bool highlighted(const SmartsColor &color)
+  {
+    return color.red() > 0.9f && color.green() < 0.1f;
+  }
+
+private slots:
+  void bondOrder();
+};
+
+void SmartsColorTest::bondOrder()
+{
+  // Ethene without hydrogens
+  Molecule mol;
+  Atom *a1 = mol.addAtom();
+  a1->setAtomicNumber(6);
+  Atom *a2 = mol.addAtom();
+  a2->setAtomicNumber(6);
+  a2->setPos(Vector3d(1.34, 0.0, 0.0));
+  Bond *bond = mol.addBond(a1->id(), a2->id(), 2);
+
+  // Matched atoms get the default highlight, the others a gray
+  SmartsColor color;
+  QVERIFY(QMetaObject::invokeMethod(&color, "smartsChanged",
+                                    Q_ARG(QString, QString("C=C"))));
+  color.setFromPrimitive(a1);
+  QVERIFY(highlighted(color));
+
+  // Changed in place, as the draw tool does
+  bond->setOrder(1);
+  mol.update();
+  color.setFromPrimitive(a1);
+  QVERIFY(!highlighted(color));
+
+  bond->setOrder(2);
+  mol.update();
+  color.setFromPrimitive(a2);
+  QVERIFY(highlighted(color));
+}
+
+QTEST_MAIN(SmartsColorTest)
+
+#include "moc_smartscolortest.cpp"
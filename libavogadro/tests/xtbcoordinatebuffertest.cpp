@@ -0,0 +1,148 @@
+/**********************************************************************
+  XtbCoordinateBufferTest - Unit tests for the xTB tool coordinate buffer
+
+  Copyright (C) 2026 Avogadro developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <QThread>
+
+#include "../src/tools/xtbcoordinatebuffer.h"
+
+#include <algorithm>
+#include <vector>
+
+using Avogadro::XtbCoordinateBuffer;
+
+namespace {
+  // Large enough that a torn copy would be caught
+  const int NUM_COORDS = 3000;
+  const int NUM_FRAMES = 20000;
+
+  // Publishes frames filled with their number, like the xTB thread
+  class Publisher : public QThread
+  {
+    public:
+      Publisher(XtbCoordinateBuffer &buffer) : m_buffer(buffer) {}
+
+      void run()
+      {
+        for (int frame = 1; frame <= NUM_FRAMES; ++frame) {
+          std::vector<double> &back = m_buffer.back();
+          std::fill(back.begin(), back.end(), static_cast<double>(frame));
+          m_buffer.publish();
+        }
+      }
+
+    private:
+      XtbCoordinateBuffer &m_buffer;
+  };
+
+  bool uniform(const std::vector<double> &coords, double value)
+  {
+    for (size_t i = 0; i < coords.size(); ++i)
+      if (coords[i] != value)
+        return false;
+    return true;
+  }
+}
+
+class XtbCoordinateBufferTest : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initial();
+  void publishNotifies();
+  void concurrent();
+};
+
+void XtbCoordinateBufferTest::initial()
+{
+  XtbCoordinateBuffer buffer;
+  buffer.reset(std::vector<double>(NUM_COORDS, 1.0));
+  // Nothing is published yet
+  QVERIFY(!buffer.update());
+  QVERIFY(uniform(buffer.front(), 1.0));
+}
+
+void XtbCoordinateBufferTest::publishNotifies()
+{
+  XtbCoordinateBuffer buffer;
+  buffer.reset(std::vector<double>(NUM_COORDS, 0.0));
+
+  std::fill(buffer.back().begin(), buffer.back().end(), 1.0);
+  QVERIFY(buffer.publish());
+  // Not taken yet, so no need to tell again
+  std::fill(buffer.back().begin(), buffer.back().end(), 2.0);
+  QVERIFY(!buffer.publish());
+
+  // The latest frame is taken, the skipped one is never handed back
+  QVERIFY(buffer.update());
+  QVERIFY(uniform(buffer.front(), 2.0));
+  QVERIFY(!buffer.update());
+  QVERIFY(uniform(buffer.front(), 2.0));
+
+  // Taken, so the next frame needs telling again
+  std::fill(buffer.back().begin(), buffer.back().end(), 3.0);
+  QVERIFY(buffer.publish());
+  QVERIFY(buffer.update());
+  QVERIFY(uniform(buffer.front(), 3.0));
+  QVERIFY(!buffer.update());
+}
+
+void XtbCoordinateBufferTest::concurrent()
+{
+  XtbCoordinateBuffer buffer;
+  buffer.reset(std::vector<double>(NUM_COORDS, 0.0));
+
+  Publisher publisher(buffer);
+  publisher.start();
+  double last = 0.0;
+  int taken = 0;
+  while (!publisher.isFinished()) {
+    if (!buffer.update())
+      continue;
+    // Whole frames only, and never an older one than before
+    const std::vector<double> &front = buffer.front();
+    QVERIFY(uniform(front, front[0]));
+    QVERIFY(front[0] > last);
+    last = front[0];
+    ++taken;
+  }
+  publisher.wait();
+
+  // The last frame is still waiting unless it was taken already
+  if (last < NUM_FRAMES) {
+    QVERIFY(buffer.update());
+    QVERIFY(uniform(buffer.front(), NUM_FRAMES));
+    ++taken;
+  }
+  QVERIFY(!buffer.update());
+  QVERIFY(uniform(buffer.front(), NUM_FRAMES));
+  QVERIFY(taken > 0);
+}
+
+QTEST_MAIN(XtbCoordinateBufferTest)
+
+#include "moc_xtbcoordinatebuffertest.cpp"
@@ -7,12 +7,16 @@
 #include <avogadro/atom.h>
 #include <Eigen/Core>
 #include <xtb.h>
+#include "../src/tools/xtboptimizer.h"
+#include "../src/tools/xtbdynamics.h"
 #include <cmath>
 #include <vector>
 #include <QDir>
 
 using Avogadro::PluginManager;
 using Avogadro::Tool;
+using Avogadro::XtbOptimizer;
+using Avogadro::XtbDynamics;
 
 class XtbOptToolTest : public QObject
 {
@@ -21,6 +25,8 @@ private slots:
   void pluginLoaded();
   void optimizeWater();
   void convergence();
+  void optimizers();
+  void dynamics();
 };
 
 void XtbOptToolTest::pluginLoaded()
@@ -154,5 +160,107 @@ void XtbOptToolTest::convergence()
   xtb_delEnvironment(&env);
 }
 
+void XtbOptToolTest::optimizers()
+{
+  const double ang2bohr = 1.8897259886;
+
+  int natoms = 3;
+  int numbers[3] = {8, 1, 1};
+  double charge = 0.0;
+  int uhf = 0;
+  double lattice[3][3] = {{0,0,0},{0,0,0},{0,0,0}};
+  bool periodic[3] = {false,false,false};
+
+  // Both converge with far fewer single points than steepest descent
+  XtbOptimizer::Engine engines[2] = { XtbOptimizer::LBFGS, XtbOptimizer::FIRE };
+  for (int e = 0; e < 2; ++e) {
+    Eigen::VectorXd coords(9);
+    coords << 0.0, 0.0, 0.0,
+              0.0, 0.0, 1.0 * ang2bohr,
+              0.0, 0.1 * ang2bohr, -1.0 * ang2bohr;
+
+    xtb_TEnvironment env = xtb_newEnvironment();
+    xtb_TMolecule mol = xtb_newMolecule(env, &natoms, numbers, coords.data(),
+                                        &charge, &uhf, &lattice[0][0], periodic);
+    xtb_TCalculator calc = xtb_newCalculator();
+    xtb_loadGFN2xTB(env, mol, calc, NULL);
+    xtb_TResults res = xtb_newResults();
+
+    XtbOptimizer optimizer;
+    optimizer.setEngine(engines[e]);
+    optimizer.setLevel(XtbOptimizer::Normal);
+    Eigen::VectorXd grad(natoms * 3);
+    bool converged = false;
+    int s = 0;
+    for (; s < 200 && !converged; ++s) {
+      double energy = 0.0;
+      xtb_updateMolecule(env, mol, coords.data(), NULL);
+      xtb_singlepoint(env, mol, calc, res);
+      xtb_getEnergy(env, res, &energy);
+      xtb_getGradient(env, res, grad.data());
+      converged = optimizer.step(coords, energy, grad);
+    }
+
+    QVERIFY(converged);
+    QVERIFY(s < 100);
+    QVERIFY(grad.norm() < optimizer.gradientThreshold());
+
+    xtb_delResults(&res);
+    xtb_delCalculator(&calc);
+    xtb_delMolecule(&mol);
+    xtb_delEnvironment(&env);
+  }
+}
+
+void XtbOptToolTest::dynamics()
+{
+  const double ang2bohr = 1.8897259886;
+
+  int natoms = 3;
+  int numbers[3] = {8, 1, 1};
+  double charge = 0.0;
+  int uhf = 0;
+  double lattice[3][3] = {{0,0,0},{0,0,0},{0,0,0}};
+  bool periodic[3] = {false,false,false};
+
+  Eigen::VectorXd coords(9);
+  coords << 0.0, 0.0, 0.0,
+            0.0, 0.0, 0.96 * ang2bohr,
+            0.0, 0.93 * ang2bohr, -0.24 * ang2bohr;
+
+  xtb_TEnvironment env = xtb_newEnvironment();
+  xtb_TMolecule mol = xtb_newMolecule(env, &natoms, numbers, coords.data(),
+                                      &charge, &uhf, &lattice[0][0], periodic);
+  xtb_TCalculator calc = xtb_newCalculator();
+  xtb_loadGFN2xTB(env, mol, calc, NULL);
+  xtb_TResults res = xtb_newResults();
+
+  XtbDynamics integrator;
+  integrator.setAtomicNumbers(std::vector<int>(numbers, numbers + natoms));
+  integrator.setTimeStep(0.5);
+  integrator.setTemperature(300.0);
+  Eigen::VectorXd grad(natoms * 3);
+  for (int s = 0; s < 200; ++s) {
+    xtb_updateMolecule(env, mol, coords.data(), NULL);
+    xtb_singlepoint(env, mol, calc, res);
+    xtb_getGradient(env, res, grad.data());
+    integrator.step(coords, grad);
+    if (s == 0)
+      QVERIFY(std::fabs(integrator.temperature() - 300.0) < 150.0);
+  }
+
+  // The molecule stays together at a sensible temperature
+  for (int i = 1; i < natoms; ++i) {
+    double d = (coords.segment<3>(3 * i) - coords.head<3>()).norm() / ang2bohr;
+    QVERIFY(d > 0.7 && d < 1.4);
+  }
+  QVERIFY(integrator.temperature() < 3000.0);
+
+  xtb_delResults(&res);
+  xtb_delCalculator(&calc);
+  xtb_delMolecule(&mol);
+  xtb_delEnvironment(&env);
+}
+
 QTEST_MAIN(XtbOptToolTest)
 #include "moc_xtbopttooltest.cpp"